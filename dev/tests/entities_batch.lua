@@ -0,0 +1,79 @@
+-- Scripting time with 10k scripted entities: per-entity on_update calls
+-- against batched dispatch (entities.batch)
+
+local util = require "core:tests_util"
+
+local SIDE = 100 -- SIDE * SIDE entities
+local TICKS = 200
+
+util.create_demo_world("core:default")
+app.set_setting("chunks.load-distance", 5)
+app.set_setting("chunks.load-speed", 4)
+
+local pid = player.create("Xerxes")
+player.set_pos(pid, 0, 100, 0)
+app.sleep_until(function ()
+    return block.get(-SIDE / 2, 0, -SIDE / 2) ~= -1 and
+           block.get(SIDE / 2, 0, SIDE / 2) ~= -1
+end)
+
+local itemid = item.index("base:stone.item")
+for z = 1, SIDE do
+    for x = 1, SIDE do
+        -- not picked up and not merged (drops with data are not merged)
+        entities.spawn("base:drop", {x - SIDE / 2, 100, z - SIDE / 2}, {
+            base__drop={id=itemid, count=1, data={}, pickup_delay=1e9}
+        })
+    end
+end
+-- let the drops fall and fall asleep
+for i = 1, 300 do
+    app.tick()
+end
+
+local function measure()
+    local start = time.uptime()
+    for i = 1, TICKS do
+        app.tick()
+    end
+    return (time.uptime() - start) * 1000 / TICKS
+end
+
+local function count_updated(counter)
+    local count = 0
+    for _ in pairs(counter) do
+        count = count + 1
+    end
+    return count
+end
+
+local per_entity = measure()
+
+local handler_time = 0
+local updated = {}
+entities.batch("base:drop", {
+    -- same work as base:drop on_update while the pickup timer is running
+    on_update = function(tps, uids, positions, velocities)
+        local start = time.uptime()
+        for _, uid in ipairs(uids) do
+            local drop = entities.get(uid).components["base:drop"]
+            drop.timer = drop.timer - 1.0 / tps
+            updated[uid] = true
+        end
+        handler_time = handler_time + time.uptime() - start
+    end,
+    on_sensor_events = function(uids, indices, others, enters)
+    end,
+})
+local batched = measure()
+
+assert(count_updated(updated) == SIDE * SIDE)
+print(string.format(
+    "%s entities: per-entity %.2f ms/tick, batched %.2f ms/tick "..
+    "(handler %.2f ms/tick)",
+    SIDE * SIDE, per_entity, batched, handler_time * 1000 / TICKS
+))
+
+entities.batch("base:drop", nil)
+app.close_world(false)
+app.delete_world("demo")
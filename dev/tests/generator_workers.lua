@@ -0,0 +1,40 @@
+-- Chunks generated by generator workers must be equal to ones generated
+-- on the main thread
+
+local util = require "core:tests_util"
+
+local RADIUS = 24
+
+local function generate(workers)
+    app.set_setting("chunks.generator-workers", workers)
+    util.create_demo_world()
+    app.set_setting("chunks.load-distance", 3)
+    app.set_setting("chunks.load-speed", 1)
+
+    local pid = player.create("Xerxes")
+    player.set_pos(pid, 0, 100, 0)
+    app.sleep_until(function ()
+        return block.get(-RADIUS, 0, -RADIUS) ~= -1 and
+               block.get(RADIUS, 0, RADIUS) ~= -1
+    end)
+
+    local ids = {}
+    for z=-RADIUS,RADIUS do
+        for x=-RADIUS,RADIUS do
+            for y=0,255 do
+                table.insert(ids, block.get(x, y, z))
+            end
+        end
+    end
+    app.close_world(false)
+    app.delete_world("demo")
+    return ids
+end
+
+local serial = generate(1)
+local parallel = generate(-2)
+
+assert(#serial == #parallel)
+for i=1,#serial do
+    assert(serial[i] == parallel[i])
+end
@@ -86,8 +86,44 @@ local Entity = {__index={
     end,
 }}
 
+local entities_lib = entities
 local entities = {}
 
+-- Batch handlers of component types: name -> handler table
+local batches = {}
+-- Reused arrays passed to on_update of batch handlers
+local buffers = {}
+
+local function get_buffer(name)
+    local buffer = buffers[name]
+    if not buffer then
+        buffer = {uids={}, positions={}, velocities={}}
+        buffers[name] = buffer
+    end
+    return buffer
+end
+
+local function update_batches(tps, counts)
+    for name, count in pairs(counts) do
+        local buffer = buffers[name]
+        local uids = buffer.uids
+        for i = #uids, count + 1, -1 do
+            uids[i] = nil
+        end
+        local handler = batches[name]
+        local callback = handler and handler.on_update
+        if count > 0 and callback then
+            entities_lib.get_bodies(uids, buffer.positions, buffer.velocities)
+            local result, err = pcall(
+                callback, tps, uids, buffer.positions, buffer.velocities
+            )
+            if err then
+                debug.error(err)
+            end
+        end
+    end
+end
+
 return {
     new_Entity = function(eid)
         local entity = setmetatable({eid=eid}, Entity)
@@ -109,14 +145,28 @@ return {
         end
     end,
     update = function(tps, parts, part)
+        local counts = {}
+        for name, handler in pairs(batches) do
+            if handler.on_update then
+                get_buffer(name)
+                counts[name] = 0
+            end
+        end
         for uid, entity in pairs(entities) do
             if uid % parts ~= part then
                 goto continue
             end
-            for _, component in pairs(entity.components) do
-                local callback = component.on_update
-                if not component.__disabled and callback then
-                    local result, err = pcall(callback, tps)
+            for name, component in pairs(entity.components) do
+                local count = counts[name]
+                if component.__disabled then
+                    -- skipped
+                elseif count then
+                    -- batched type, passed to the handler after the loop
+                    count = count + 1
+                    buffers[name].uids[count] = uid
+                    counts[name] = count
+                elseif component.on_update then
+                    local result, err = pcall(component.on_update, tps)
                     if err then
                         debug.error(err)
                     end
@@ -124,6 +174,43 @@ return {
             end
             ::continue::
         end
+        update_batches(tps, counts)
+    end,
+    set_batch = function(name, handler)
+        batches[name] = handler
+    end,
+    sensor_events = function(name, uids, indices, others, enters)
+        local handler = batches[name]
+        local callback = handler and handler.on_sensor_events
+        if not callback then
+            return
+        end
+        -- skip events of despawned entities and disabled components
+        local count = 0
+        for i = 1, #uids do
+            local entity = entities[uids[i]]
+            local component = entity and entity.components[name]
+            if component and not component.__disabled then
+                count = count + 1
+                uids[count] = uids[i]
+                indices[count] = indices[i]
+                others[count] = others[i]
+                enters[count] = enters[i]
+            end
+        end
+        for i = #uids, count + 1, -1 do
+            uids[i] = nil
+            indices[i] = nil
+            others[i] = nil
+            enters[i] = nil
+        end
+        if count == 0 then
+            return
+        end
+        local result, err = pcall(callback, uids, indices, others, enters)
+        if err then
+            debug.error(err)
+        end
     end,
     render = function(delta)
         for _,entity in pairs(entities) do
@@ -151,5 +238,7 @@ return {
     end,
     __reset = function()
         entities = {}
+        batches = {}
+        buffers = {}
     end
 }
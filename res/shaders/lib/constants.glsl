@@ -6,6 +6,11 @@
 
 // geometry
 #define CURVATURE_FACTOR 0.002
+// chunk vertex position fixed-point format (see ChunkVertex.hpp)
+#define CHUNK_POSITION_SCALE 128.0
+#define CHUNK_POSITION_OFFSET 16.0
+// merged faces tiling regions table (see ContentGfxCache.hpp)
+#define CHUNK_REGIONS_PER_ROW 128
 
 // lighting
 #define SKY_LIGHT_MUL 2.9
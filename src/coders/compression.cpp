@@ -1,11 +1,17 @@
 #include "compression.hpp"
 
+#include <zlib.h>
+
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <stdexcept>
+#include <unordered_map>
 
 #include "rle.hpp"
 #include "gzip.hpp"
+#include "lz4.hpp"
 #include "util/BufferPool.hpp"
 
 using namespace compression;
@@ -55,8 +61,155 @@ static auto compress_rle(
     return data;
 }
 
+static auto compress_lz4(
+    const ubyte* src,
+    size_t srclen,
+    size_t& len,
+    const Dictionary* dictionary
+) {
+    size_t bufferSize = lz4::compress_bound(srclen);
+    auto buffer = get_buffer(bufferSize);
+    auto bytes = buffer.get();
+    std::unique_ptr<ubyte[]> uptr;
+    if (bytes == nullptr) {
+        uptr = std::make_unique<ubyte[]>(bufferSize);
+        bytes = uptr.get();
+    }
+    if (dictionary) {
+        len = lz4::encode(
+            src,
+            srclen,
+            bytes,
+            dictionary->data.data(),
+            dictionary->data.size()
+        );
+    } else {
+        len = lz4::encode(src, srclen, bytes);
+    }
+    auto data = std::make_unique<ubyte[]>(len);
+    std::memcpy(data.get(), bytes, len);
+    return data;
+}
+
+static void check_decompressed_size(size_t expected, size_t decompressed) {
+    if (decompressed != expected) {
+        throw std::runtime_error(
+            "expected decompressed size " + std::to_string(expected) +
+            " got " + std::to_string(decompressed));
+    }
+}
+
+static const std::pair<Method, std::string_view> method_names[] {
+    {Method::NONE, "none"},
+    {Method::EXTRLE8, "extrle8"},
+    {Method::EXTRLE16, "extrle16"},
+    {Method::GZIP, "gzip"},
+    {Method::LZ4, "lz4"},
+    {Method::DEFLATE, "deflate"},
+};
+
+std::string compression::to_string(Method method) {
+    for (const auto& [value, name] : method_names) {
+        if (value == method) {
+            return std::string(name);
+        }
+    }
+    return std::to_string(static_cast<int>(method));
+}
+
+Method compression::method_from_string(const std::string& name) {
+    for (const auto& [value, valueName] : method_names) {
+        if (valueName == name) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("unknown compression method '" + name + "'");
+}
+
+bool compression::supports_dictionary(Method method) {
+    return method == Method::LZ4 || method == Method::DEFLATE;
+}
+
+Dictionary::Dictionary(std::vector<ubyte> data) : data(std::move(data)) {
+    id = crc32(0L, this->data.data(), this->data.size());
+    if (id == 0) {
+        id = 1;
+    }
+}
+
+/// @brief Dictionary training unit
+inline constexpr size_t DICTIONARY_SEGMENT_SIZE = 32;
+
+std::shared_ptr<Dictionary> compression::train_dictionary(
+    const std::vector<std::pair<const ubyte*, size_t>>& samples,
+    size_t capacity
+) {
+    struct Segment {
+        const ubyte* data;
+        /// @brief Number of samples containing the segment
+        uint count;
+        size_t lastSample;
+    };
+    const size_t segmentSize = DICTIONARY_SEGMENT_SIZE;
+    std::unordered_map<std::string_view, Segment> segments;
+    for (size_t index = 0; index < samples.size(); index++) {
+        const auto& [data, length] = samples[index];
+        for (size_t offset = 0; offset + segmentSize <= length;
+             offset += segmentSize / 2) {
+            const ubyte* segment = data + offset;
+            // runs of a single byte are matched without dictionary
+            if (std::all_of(segment, segment + segmentSize, [=](ubyte b) {
+                    return b == segment[0];
+                })) {
+                continue;
+            }
+            std::string_view key(
+                reinterpret_cast<const char*>(segment), segmentSize
+            );
+            auto found = segments.find(key);
+            if (found == segments.end()) {
+                segments[key] = Segment {segment, 1, index};
+            } else if (found->second.lastSample != index) {
+                found->second.count++;
+                found->second.lastSample = index;
+            }
+        }
+    }
+    std::vector<const Segment*> common;
+    for (const auto& [_, segment] : segments) {
+        if (segment.count > 1) {
+            common.push_back(&segment);
+        }
+    }
+    if (common.empty()) {
+        return nullptr;
+    }
+    std::sort(common.begin(), common.end(), [=](auto a, auto b) {
+        if (a->count != b->count) {
+            return a->count > b->count;
+        }
+        return std::memcmp(a->data, b->data, segmentSize) < 0;
+    });
+    size_t count = std::min(
+        common.size(),
+        std::min(capacity, Dictionary::MAX_SIZE) / segmentSize
+    );
+    // the most common segments are placed at the end having the shortest
+    // distance to compressed data
+    std::vector<ubyte> data;
+    data.reserve(count * segmentSize);
+    for (size_t i = count; i-- > 0;) {
+        data.insert(data.end(), common[i]->data, common[i]->data + segmentSize);
+    }
+    return std::make_shared<Dictionary>(std::move(data));
+}
+
 std::unique_ptr<ubyte[]> compression::compress(
-    const ubyte* src, size_t srclen, size_t& len, Method method
+    const ubyte* src,
+    size_t srclen,
+    size_t& len,
+    Method method,
+    const Dictionary* dictionary
 ) {
     switch (method) {
         case Method::NONE:
@@ -72,14 +225,35 @@ std::unique_ptr<ubyte[]> compression::compress(
             len = buffer.size();
             return data;
         }
+        case Method::LZ4:
+            return compress_lz4(src, srclen, len, dictionary);
+        case Method::DEFLATE: {
+            auto buffer = gzip::deflate_raw(
+                src,
+                srclen,
+                Z_BEST_COMPRESSION,
+                dictionary ? dictionary->data.data() : nullptr,
+                dictionary ? dictionary->data.size() : 0
+            );
+            auto data = std::make_unique<ubyte[]>(buffer.size());
+            std::memcpy(data.get(), buffer.data(), buffer.size());
+            len = buffer.size();
+            return data;
+        }
         default:
             throw std::runtime_error("not implemented");
     }
 }
 
 std::unique_ptr<ubyte[]> compression::decompress(
-    const ubyte* src, size_t srclen, size_t dstlen, Method method
+    const ubyte* src,
+    size_t srclen,
+    size_t dstlen,
+    Method method,
+    const Dictionary* dictionary
 ) {
+    const ubyte* dict = dictionary ? dictionary->data.data() : nullptr;
+    size_t dictLength = dictionary ? dictionary->data.size() : 0;
     switch (method) {
         case Method::NONE:
             throw std::invalid_argument("compression method is NONE");
@@ -91,24 +265,32 @@ std::unique_ptr<ubyte[]> compression::decompress(
         case Method::EXTRLE16: {
             auto decompressed = std::make_unique<ubyte[]>(dstlen);
             size_t decoded = extrle::decode16(src, srclen, decompressed.get());
-            if (decoded != dstlen) {
-                throw std::runtime_error(
-                    "expected decompressed size " + std::to_string(dstlen) +
-                    " got " + std::to_string(decoded));
-            }
+            check_decompressed_size(dstlen, decoded);
             return decompressed;
         }
         case Method::GZIP: {
             auto buffer = gzip::decompress(src, srclen);
-            if (buffer.size() != dstlen) {
-                throw std::runtime_error(
-                    "expected decompressed size " + std::to_string(dstlen) +
-                    " got " + std::to_string(buffer.size()));
-            }
+            check_decompressed_size(dstlen, buffer.size());
             auto decompressed = std::make_unique<ubyte[]>(buffer.size());
             std::memcpy(decompressed.get(), buffer.data(), buffer.size());
             return decompressed;
         }
+        case Method::LZ4: {
+            auto decompressed = std::make_unique<ubyte[]>(dstlen);
+            size_t decoded = lz4::decode(
+                src, srclen, decompressed.get(), dstlen, dict, dictLength
+            );
+            check_decompressed_size(dstlen, decoded);
+            return decompressed;
+        }
+        case Method::DEFLATE: {
+            auto decompressed = std::make_unique<ubyte[]>(dstlen);
+            size_t decoded = gzip::inflate_raw(
+                src, srclen, decompressed.get(), dstlen, dict, dictLength
+            );
+            check_decompressed_size(dstlen, decoded);
+            return decompressed;
+        }
         default:
             throw std::runtime_error("not implemented");
     }
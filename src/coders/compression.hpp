@@ -1,30 +1,86 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "typedefs.hpp"
 
 namespace compression {
+    /// @brief Compression methods. Values are stored in files
     enum class Method {
-        NONE, EXTRLE8, EXTRLE16, GZIP
+        NONE,
+        EXTRLE8,
+        EXTRLE16,
+        GZIP,
+        /// @brief Fast LZ codec (LZ4 block format), supports dictionaries
+        LZ4,
+        /// @brief High ratio raw DEFLATE (best compression level),
+        /// supports dictionaries
+        DEFLATE
     };
 
+    /// @return method name used in settings
+    std::string to_string(Method method);
+
+    /// @brief Parse method name
+    /// @throws std::invalid_argument if the name is unknown
+    Method method_from_string(const std::string& name);
+
+    /// @return true if the method makes use of dictionaries
+    bool supports_dictionary(Method method);
+
+    /// @brief Data prepended to the compression window: improves ratio of
+    /// small similar buffers (e.g. chunks voxels)
+    struct Dictionary {
+        /// @brief Max useful dictionary size for all methods
+        static inline constexpr size_t MAX_SIZE = 32 * 1024;
+
+        std::vector<ubyte> data;
+        /// @brief Content hash identifying the dictionary in files, never 0
+        uint32_t id;
+
+        Dictionary(std::vector<ubyte> data);
+    };
+
+    /// @brief Build dictionary from the most common segments of samples
+    /// @param samples source data samples (pointer and length)
+    /// @param capacity max dictionary size (limited by Dictionary::MAX_SIZE)
+    /// @return nullptr if samples have no common segments
+    std::shared_ptr<Dictionary> train_dictionary(
+        const std::vector<std::pair<const ubyte*, size_t>>& samples,
+        size_t capacity = Dictionary::MAX_SIZE
+    );
+
     /// @brief Compress buffer
     /// @param src source buffer
     /// @param srclen length of the source buffer
     /// @param len (out argument) length of result buffer
     /// @param method compression method
+    /// @param dictionary optional dictionary (ignored if not supported by
+    /// the method)
     /// @return compressed bytes array
     /// @throws std::invalid_argument if compression method is NONE
     std::unique_ptr<ubyte[]> compress(
-        const ubyte* src, size_t srclen, size_t& len, Method method
+        const ubyte* src,
+        size_t srclen,
+        size_t& len,
+        Method method,
+        const Dictionary* dictionary = nullptr
     );
 
     /// @brief Decompress buffer
     /// @param src compressed buffer
     /// @param srclen length of compressed buffer
     /// @param dstlen max expected length of source buffer
+    /// @param dictionary dictionary used to compress the buffer
     /// @return decompressed bytes array
     std::unique_ptr<ubyte[]> decompress(
-        const ubyte* src, size_t srclen, size_t dstlen, Method method);
+        const ubyte* src,
+        size_t srclen,
+        size_t dstlen,
+        Method method,
+        const Dictionary* dictionary = nullptr
+    );
 }
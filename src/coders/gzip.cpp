@@ -7,6 +7,7 @@
 #include <zlib.h>
 
 #include <memory>
+#include <stdexcept>
 
 std::vector<ubyte> gzip::compress(const ubyte* src, size_t size) {
     size_t buffer_size = 23 + size * 1.01;
@@ -63,3 +64,91 @@ std::vector<ubyte> gzip::decompress(const ubyte* src, size_t size) {
 
     return buffer;
 }
+
+namespace {
+    /// @brief GZIP inflate stream reset on each use instead of allocating
+    /// new state
+    struct Inflater {
+        z_stream stream {};
+
+        Inflater() {
+            if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+                throw std::runtime_error("could not initialize inflate");
+            }
+        }
+
+        ~Inflater() {
+            inflateEnd(&stream);
+        }
+    };
+}
+
+size_t gzip::decompress(
+    const ubyte* src, size_t size, ubyte* dst, size_t capacity
+) {
+    thread_local Inflater inflater;
+    auto& stream = inflater.stream;
+    inflateReset(&stream);
+    stream.avail_in = size;
+    stream.next_in = src;
+    stream.avail_out = capacity;
+    stream.next_out = dst;
+
+    if (inflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        throw std::runtime_error("invalid or too large gzip data");
+    }
+    return stream.next_out - dst;
+}
+
+std::vector<ubyte> gzip::deflate_raw(
+    const ubyte* src,
+    size_t size,
+    int level,
+    const ubyte* dict,
+    size_t dictLength
+) {
+    z_stream defstream {};
+    deflateInit2(
+        &defstream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY
+    );
+    if (dict && dictLength) {
+        deflateSetDictionary(&defstream, dict, dictLength);
+    }
+    std::vector<ubyte> buffer(deflateBound(&defstream, size));
+    defstream.avail_in = size;
+    defstream.next_in = src;
+    defstream.avail_out = buffer.size();
+    defstream.next_out = buffer.data();
+
+    deflate(&defstream, Z_FINISH);
+    deflateEnd(&defstream);
+
+    buffer.resize(defstream.next_out - buffer.data());
+    return buffer;
+}
+
+size_t gzip::inflate_raw(
+    const ubyte* src,
+    size_t size,
+    ubyte* dst,
+    size_t capacity,
+    const ubyte* dict,
+    size_t dictLength
+) {
+    z_stream infstream {};
+    infstream.avail_in = size;
+    infstream.next_in = src;
+    infstream.avail_out = capacity;
+    infstream.next_out = dst;
+
+    inflateInit2(&infstream, -MAX_WBITS);
+    if (dict && dictLength) {
+        inflateSetDictionary(&infstream, dict, dictLength);
+    }
+    int status = inflate(&infstream, Z_FINISH);
+    inflateEnd(&infstream);
+    if (status != Z_STREAM_END) {
+        throw std::runtime_error("invalid deflate stream");
+    }
+    return infstream.next_out - dst;
+}
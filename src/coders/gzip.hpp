@@ -16,4 +16,47 @@ namespace gzip {
     /// @param src GZIP data
     /// @param size length of GZIP data
     std::vector<ubyte> decompress(const ubyte* src, size_t size);
+
+    /// Decompress bytes array from GZIP to a buffer. Thread-safe, reuses
+    /// inflate state of the calling thread
+    /// @param src GZIP data
+    /// @param size length of GZIP data
+    /// @param dst destination buffer
+    /// @param capacity destination buffer size
+    /// @return decompressed length
+    /// @throws std::runtime_error if data is invalid or does not fit
+    size_t decompress(
+        const ubyte* src, size_t size, ubyte* dst, size_t capacity
+    );
+
+    /// Compress bytes array to raw DEFLATE stream (no GZIP header)
+    /// @param src source bytes array
+    /// @param size length of source bytes array
+    /// @param level zlib compression level
+    /// @param dict preset dictionary (may be nullptr)
+    /// @param dictLength length of preset dictionary
+    std::vector<ubyte> deflate_raw(
+        const ubyte* src,
+        size_t size,
+        int level,
+        const ubyte* dict = nullptr,
+        size_t dictLength = 0
+    );
+
+    /// Decompress raw DEFLATE stream
+    /// @param src DEFLATE data
+    /// @param size length of DEFLATE data
+    /// @param dst destination buffer
+    /// @param capacity destination buffer size
+    /// @param dict preset dictionary used to compress the data
+    /// @param dictLength length of preset dictionary
+    /// @return decompressed length
+    size_t inflate_raw(
+        const ubyte* src,
+        size_t size,
+        ubyte* dst,
+        size_t capacity,
+        const ubyte* dict = nullptr,
+        size_t dictLength = 0
+    );
 }
@@ -0,0 +1,217 @@
+#include "lz4.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+static constexpr size_t MIN_MATCH = 4;
+/// @brief Last bytes of a block are always literals
+static constexpr size_t LAST_LITERALS = 5;
+/// @brief Last match must start at least this count of bytes before end
+static constexpr size_t MF_LIMIT = 12;
+static constexpr uint HASH_BITS = 14;
+/// @brief Literals without matches count before search step increments
+static constexpr uint SKIP_TRIGGER = 6;
+
+static inline uint32_t read32(const ubyte* ptr) {
+    uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hash32(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static inline ubyte* write_length(ubyte* dst, size_t length) {
+    while (length >= 255) {
+        *dst++ = 255;
+        length -= 255;
+    }
+    *dst++ = static_cast<ubyte>(length);
+    return dst;
+}
+
+static ubyte* write_literals(
+    ubyte* dst, ubyte* token, const ubyte* literals, size_t count
+) {
+    *token |= std::min<size_t>(count, 15) << 4;
+    if (count >= 15) {
+        dst = write_length(dst, count - 15);
+    }
+    std::memcpy(dst, literals, count);
+    return dst + count;
+}
+
+size_t lz4::encode(
+    const ubyte* src,
+    size_t length,
+    ubyte* dst,
+    const ubyte* dict,
+    size_t dictLength
+) {
+    // positions + 1 in base buffer, 0 is empty entry
+    thread_local uint32_t table[1 << HASH_BITS];
+    std::memset(table, 0, sizeof(table));
+
+    // dictionary is placed right before the data
+    std::vector<ubyte> joined;
+    const ubyte* base = src;
+    size_t start = 0;
+    if (dict && dictLength) {
+        if (dictLength > max_offset) {
+            dict += dictLength - max_offset;
+            dictLength = max_offset;
+        }
+        joined.resize(dictLength + length);
+        std::memcpy(joined.data(), dict, dictLength);
+        std::memcpy(joined.data() + dictLength, src, length);
+        base = joined.data();
+        start = dictLength;
+    }
+    const ubyte* const end = base + start + length;
+    const ubyte* ip = base + start;
+    const ubyte* anchor = ip;
+    ubyte* op = dst;
+
+    if (length > MF_LIMIT) {
+        const ubyte* const matchLimit = end - LAST_LITERALS;
+        const ubyte* const mfLimit = end - MF_LIMIT;
+        for (size_t i = 0; i + sizeof(uint32_t) <= start; i++) {
+            table[hash32(read32(base + i))] = i + 1;
+        }
+        uint misses = 0;
+        while (ip < mfLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t& entry = table[hash32(sequence)];
+            size_t position = ip - base;
+            size_t ref = entry;
+            entry = position + 1;
+            if (ref == 0 || position - (ref - 1) > max_offset ||
+                read32(base + ref - 1) != sequence) {
+                ip += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+            const ubyte* match = base + ref - 1;
+            while (ip > anchor && match > base && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+            const ubyte* matchEnd = ip + MIN_MATCH;
+            const ubyte* matchPtr = match + MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *matchPtr) {
+                matchEnd++;
+                matchPtr++;
+            }
+            size_t matchLength = matchEnd - ip - MIN_MATCH;
+            size_t offset = ip - match;
+
+            ubyte* token = op++;
+            *token = std::min<size_t>(matchLength, 15);
+            op = write_literals(op, token, anchor, ip - anchor);
+            *op++ = offset & 0xFF;
+            *op++ = offset >> 8;
+            if (matchLength >= 15) {
+                op = write_length(op, matchLength - 15);
+            }
+            ip = matchEnd;
+            anchor = ip;
+            if (ip < mfLimit) {
+                table[hash32(read32(ip - 2))] = ip - 2 - base + 1;
+            }
+        }
+    }
+    ubyte* token = op++;
+    *token = 0;
+    op = write_literals(op, token, anchor, end - anchor);
+    return op - dst;
+}
+
+static inline size_t read_length(const ubyte*& src, const ubyte* end) {
+    size_t length = 0;
+    ubyte value;
+    do {
+        if (src >= end) {
+            throw std::runtime_error("lz4: unexpected end of data");
+        }
+        value = *src++;
+        length += value;
+    } while (value == 255);
+    return length;
+}
+
+size_t lz4::decode(
+    const ubyte* src,
+    size_t length,
+    ubyte* dst,
+    size_t capacity,
+    const ubyte* dict,
+    size_t dictLength
+) {
+    const ubyte* ip = src;
+    const ubyte* const iend = src + length;
+    ubyte* op = dst;
+    ubyte* const oend = dst + capacity;
+
+    while (ip < iend) {
+        uint token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            literals += read_length(ip, iend);
+        }
+        if (literals > static_cast<size_t>(iend - ip) ||
+            literals > static_cast<size_t>(oend - op)) {
+            throw std::runtime_error("lz4: literals out of bounds");
+        }
+        std::memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == iend) {
+            break;
+        }
+        if (iend - ip < 2) {
+            throw std::runtime_error("lz4: unexpected end of data");
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            matchLength += read_length(ip, iend);
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || matchLength > static_cast<size_t>(oend - op)) {
+            throw std::runtime_error("lz4: match out of bounds");
+        }
+        size_t produced = op - dst;
+        if (offset > produced) {
+            size_t fromDict = offset - produced;
+            if (dict == nullptr || fromDict > dictLength) {
+                throw std::runtime_error("lz4: match out of bounds");
+            }
+            size_t count = std::min(fromDict, matchLength);
+            std::memcpy(op, dict + dictLength - fromDict, count);
+            op += count;
+            matchLength -= count;
+            if (matchLength == 0) {
+                continue;
+            }
+        }
+        const ubyte* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+        } else {
+            // overlapping match repeats the last offset bytes: copied part
+            // period grows twice on every step
+            size_t copied = 0;
+            for (size_t period = offset; copied < matchLength; period *= 2) {
+                size_t count = std::min(period, matchLength - copied);
+                std::memcpy(op + copied, op + copied - period, count);
+                copied += count;
+            }
+        }
+        op += matchLength;
+    }
+    return op - dst;
+}
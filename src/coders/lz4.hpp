@@ -0,0 +1,50 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+/// @brief LZ4 block format codec (without frames and checksums).
+/// Matches may reference an optional dictionary placed before the data
+namespace lz4 {
+    /// @brief Max distance of a match
+    constexpr size_t max_offset = 0xFFFF;
+
+    /// @return max encoded size of the data length
+    constexpr size_t compress_bound(size_t length) {
+        return length + length / 255 + 16;
+    }
+
+    /// @brief Encode data to LZ4 block
+    /// @param src source data
+    /// @param length source data length
+    /// @param dst destination buffer of compress_bound(length) bytes at
+    /// least
+    /// @param dict dictionary (may be nullptr), last max_offset bytes are
+    /// used
+    /// @param dictLength dictionary length
+    /// @return encoded length
+    size_t encode(
+        const ubyte* src,
+        size_t length,
+        ubyte* dst,
+        const ubyte* dict = nullptr,
+        size_t dictLength = 0
+    );
+
+    /// @brief Decode LZ4 block
+    /// @param src encoded data
+    /// @param length encoded data length
+    /// @param dst destination buffer
+    /// @param capacity destination buffer size
+    /// @param dict dictionary used to encode the data
+    /// @param dictLength dictionary length
+    /// @return decoded length
+    /// @throws std::runtime_error if the data is malformed
+    size_t decode(
+        const ubyte* src,
+        size_t length,
+        ubyte* dst,
+        size_t capacity,
+        const ubyte* dict = nullptr,
+        size_t dictLength = 0
+    );
+}
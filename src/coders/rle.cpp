@@ -1,39 +1,325 @@
 #include "rle.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
 #include "util/data_io.hpp"
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define RLE_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RLE_TARGET_AVX2
+#else
+#define RLE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Run detection kernels return index of the first element in [start, end)
+// not equal to the value (or end). Run expansion kernels fill count elements
+// with the value (bytes runs are expanded with memset being vectorized by
+// the C library already). Encoders and decoders are built on top of them,
+// so the output does not depend on the kernels used.
+
+static size_t find_run_end_scalar(
+    const ubyte* src, size_t i, size_t end, ubyte value
+) {
+    while (i < end && src[i] == value) {
+        i++;
+    }
+    return i;
+}
+
+static size_t find_run_end16_scalar(
+    const uint16_t* src, size_t i, size_t end, uint16_t value
+) {
+    while (i < end && src[i] == value) {
+        i++;
+    }
+    return i;
+}
+
+static void fill16_scalar(uint16_t* dst, size_t count, uint16_t value) {
+    std::fill_n(dst, count, value);
+}
+
+#ifdef RLE_X86_KERNELS
+
+static inline uint count_trailing_zeros(uint mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static size_t find_run_end_sse2(
+    const ubyte* src, size_t i, size_t end, ubyte value
+) {
+    // runs of a single element are common in 8 bit encoding of 16 bit data
+    if (end - i < 16 || src[i] != value) {
+        return find_run_end_scalar(src, i, end, value);
+    }
+    const __m128i values = _mm_set1_epi8(static_cast<char>(value));
+    while (true) {
+        // last block overlaps already checked elements
+        size_t pos = std::min(i, end - 16);
+        __m128i block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + pos)
+        );
+        uint mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, values)) ^ 0xFFFF;
+        if (mask) {
+            return pos + count_trailing_zeros(mask);
+        }
+        if (pos + 16 == end) {
+            return end;
+        }
+        i = pos + 16;
+    }
+}
+
+static size_t find_run_end16_sse2(
+    const uint16_t* src, size_t i, size_t end, uint16_t value
+) {
+    if (end - i < 8 || src[i] != value) {
+        return find_run_end16_scalar(src, i, end, value);
+    }
+    const __m128i values = _mm_set1_epi16(static_cast<short>(value));
+    while (true) {
+        size_t pos = std::min(i, end - 8);
+        __m128i block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + pos)
+        );
+        uint mask = _mm_movemask_epi8(_mm_cmpeq_epi16(block, values)) ^ 0xFFFF;
+        if (mask) {
+            return pos + count_trailing_zeros(mask) / 2;
+        }
+        if (pos + 8 == end) {
+            return end;
+        }
+        i = pos + 8;
+    }
+}
+
+static void fill16_sse2(uint16_t* dst, size_t count, uint16_t value) {
+    if (count < 8) {
+        fill16_scalar(dst, count, value);
+        return;
+    }
+    const __m128i values = _mm_set1_epi16(static_cast<short>(value));
+    for (size_t i = 0; i + 8 < count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), values);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 8), values);
+}
+
+RLE_TARGET_AVX2 static size_t find_run_end_avx2(
+    const ubyte* src, size_t i, size_t end, ubyte value
+) {
+    if (end - i < 32 || src[i] != value) {
+        return find_run_end_sse2(src, i, end, value);
+    }
+    const __m256i values = _mm256_set1_epi8(static_cast<char>(value));
+    while (true) {
+        size_t pos = std::min(i, end - 32);
+        __m256i block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + pos)
+        );
+        uint mask = ~static_cast<uint>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, values))
+        );
+        if (mask) {
+            return pos + count_trailing_zeros(mask);
+        }
+        if (pos + 32 == end) {
+            return end;
+        }
+        i = pos + 32;
+    }
+}
+
+RLE_TARGET_AVX2 static size_t find_run_end16_avx2(
+    const uint16_t* src, size_t i, size_t end, uint16_t value
+) {
+    if (end - i < 16 || src[i] != value) {
+        return find_run_end16_sse2(src, i, end, value);
+    }
+    const __m256i values = _mm256_set1_epi16(static_cast<short>(value));
+    while (true) {
+        size_t pos = std::min(i, end - 16);
+        __m256i block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + pos)
+        );
+        uint mask = ~static_cast<uint>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi16(block, values))
+        );
+        if (mask) {
+            return pos + count_trailing_zeros(mask) / 2;
+        }
+        if (pos + 16 == end) {
+            return end;
+        }
+        i = pos + 16;
+    }
+}
+
+RLE_TARGET_AVX2 static void fill16_avx2(
+    uint16_t* dst, size_t count, uint16_t value
+) {
+    if (count < 16) {
+        fill16_sse2(dst, count, value);
+        return;
+    }
+    const __m256i values = _mm256_set1_epi16(static_cast<short>(value));
+    for (size_t i = 0; i + 16 < count; i += 16) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), values);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + count - 16), values);
+}
+
+static bool is_avx2_supported() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    // OS saves YMM registers state
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    // may be called by static initialization
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  // RLE_X86_KERNELS
+
+namespace {
+    struct KernelsTable {
+        rle::Kernels kernels;
+        size_t (*findRunEnd)(const ubyte*, size_t, size_t, ubyte);
+        size_t (*findRunEnd16)(const uint16_t*, size_t, size_t, uint16_t);
+        void (*fill16)(uint16_t*, size_t, uint16_t);
+    };
+}
+
+static KernelsTable kernels_table(rle::Kernels kernels) {
+    switch (kernels) {
+#ifdef RLE_X86_KERNELS
+        case rle::Kernels::SSE2:
+            return {
+                kernels,
+                find_run_end_sse2,
+                find_run_end16_sse2,
+                fill16_sse2};
+        case rle::Kernels::AVX2:
+            return {
+                kernels,
+                find_run_end_avx2,
+                find_run_end16_avx2,
+                fill16_avx2};
+#endif
+        default:
+            return {
+                rle::Kernels::SCALAR,
+                find_run_end_scalar,
+                find_run_end16_scalar,
+                fill16_scalar};
+    }
+}
+
+static KernelsTable kernels = kernels_table(rle::best_kernels());
+
+rle::Kernels rle::best_kernels() {
+#ifdef RLE_X86_KERNELS
+    static bool avx2 = is_avx2_supported();
+    return avx2 ? Kernels::AVX2 : Kernels::SSE2;
+#else
+    return Kernels::SCALAR;
+#endif
+}
+
+rle::Kernels rle::get_kernels() {
+    return kernels.kernels;
+}
+
+void rle::use_kernels(Kernels selected) {
+    if (static_cast<int>(selected) > static_cast<int>(best_kernels())) {
+        throw std::invalid_argument(
+            std::string("unsupported rle kernels ") + to_string(selected)
+        );
+    }
+    kernels = kernels_table(selected);
+}
+
+const char* rle::to_string(Kernels kernels) {
+    switch (kernels) {
+        case Kernels::SCALAR: return "scalar";
+        case Kernels::SSE2: return "sse2";
+        case Kernels::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+/// @brief Split source to runs of equal elements no longer than
+/// maxSequence + 1 and pass them to emit(counter, value) where counter is
+/// run length - 1
+template <typename T, typename EmitFunc>
+static void for_each_sequence(
+    const T* src,
+    size_t count,
+    size_t maxSequence,
+    size_t (*findRunEnd)(const T*, size_t, size_t, T),
+    const EmitFunc& emit
+) {
+    for (size_t i = 0; i < count;) {
+        T c = src[i];
+        size_t end = findRunEnd(src, i + 1, count, c);
+        for (size_t length = end - i; length > 0;) {
+            size_t sequence = std::min(length, maxSequence + 1);
+            emit(sequence - 1, c);
+            length -= sequence;
+        }
+        i = end;
+    }
+}
+
 size_t rle::decode(const ubyte* src, size_t srclen, ubyte* dst) {
     size_t offset = 0;
     for (size_t i = 0; i < srclen;) {
         ubyte len = src[i++];
         ubyte c = src[i++];
-        for (size_t j = 0; j <= len; j++) {
-            dst[offset++] = c;
-        }
+        std::memset(dst + offset, c, len + 1);
+        offset += len + 1;
     }
     return offset;
 }
 
 size_t rle::encode(const ubyte* src, size_t srclen, ubyte* dst) {
-    if (srclen == 0) {
-        return 0;
-    }
     size_t offset = 0;
-    ubyte counter = 0;
-    ubyte c = src[0];
-    for (size_t i = 1; i < srclen; i++) {
-        ubyte cnext = src[i];
-        if (cnext != c || counter == 255) {
+    for_each_sequence(
+        src, srclen, 255, kernels.findRunEnd, [&](size_t counter, ubyte c) {
             dst[offset++] = counter;
             dst[offset++] = c;
-            c = cnext;
-            counter = 0;
-        } else {
-            counter++;
         }
-    }
-    dst[offset++] = counter;
-    dst[offset++] = c;
+    );
     return offset;
 }
 
@@ -44,9 +330,8 @@ size_t rle::decode16(const ubyte* src, size_t srclen, ubyte* dst) {
     for (size_t i = 0; i < srclen / 2;) {
         uint16_t len = dataio::le2h(src16[i++]);
         uint16_t c = dataio::le2h(src16[i++]);
-        for (size_t j = 0; j <= len; j++) {
-            dst16[offset++] = c;
-        }
+        kernels.fill16(dst16 + offset, len + 1, c);
+        offset += len + 1;
     }
     return offset * 2;
 }
@@ -58,21 +343,18 @@ size_t rle::encode16(const ubyte* src, size_t srclen, ubyte* dst) {
     auto src16 = reinterpret_cast<const uint16_t*>(src);
     auto dst16 = reinterpret_cast<uint16_t*>(dst);
     size_t offset = 0;
-    uint16_t counter = 0;
-    uint16_t c = src16[0];
-    for (size_t i = 1; i < srclen / 2; i++) {
-        uint16_t cnext = src16[i];
-        if (cnext != c || counter == 0xFFFF) {
-            dst16[offset++] = dataio::h2le(counter);
+    // the first element is always encoded
+    size_t count = std::max<size_t>(srclen / 2, 1);
+    for_each_sequence(
+        src16,
+        count,
+        0xFFFF,
+        kernels.findRunEnd16,
+        [&](size_t counter, uint16_t c) {
+            dst16[offset++] = dataio::h2le(static_cast<uint16_t>(counter));
             dst16[offset++] = dataio::h2le(c);
-            c = cnext;
-            counter = 0;
-        } else {
-            counter++;
         }
-    }
-    dst16[offset++] = dataio::h2le(counter);
-    dst16[offset++] = dataio::h2le(c);
+    );
     return offset * 2;
 }
 
@@ -85,23 +367,20 @@ size_t extrle::decode(const ubyte* src, size_t srclen, ubyte* dst) {
             len |= (static_cast<uint>(src[i++])) << 7;
         }
         ubyte c = src[i++];
-        for (size_t j = 0; j <= len; j++) {
-            dst[offset++] = c;
-        }
+        std::memset(dst + offset, c, len + 1);
+        offset += len + 1;
     }
     return offset;
 }
 
 size_t extrle::encode(const ubyte* src, size_t srclen, ubyte* dst) {
-    if (srclen == 0) {
-        return 0;
-    }
     size_t offset = 0;
-    uint counter = 0;
-    ubyte c = src[0];
-    for (size_t i = 1; i < srclen; i++) {
-        ubyte cnext = src[i];
-        if (cnext != c || counter == max_sequence) {
+    for_each_sequence(
+        src,
+        srclen,
+        max_sequence,
+        kernels.findRunEnd,
+        [&](size_t counter, ubyte c) {
             if (counter >= 0x80) {
                 dst[offset++] = 0x80 | (counter & 0x7F);
                 dst[offset++] = counter >> 7;
@@ -109,24 +388,20 @@ size_t extrle::encode(const ubyte* src, size_t srclen, ubyte* dst) {
                 dst[offset++] = counter;
             }
             dst[offset++] = c;
-            c = cnext;
-            counter = 0;
-        } else {
-            counter++;
         }
-    }
-    if (counter >= 0x80) {
-        dst[offset++] = 0x80 | (counter & 0x7F);
-        dst[offset++] = counter >> 7;
-    } else {
-        dst[offset++] = counter;
-    }
-    dst[offset++] = c;
+    );
     return offset;
 }
 
 size_t extrle::decode16(const ubyte* src, size_t srclen, ubyte* dst8) {
+    return decode16(src, srclen, dst8, SIZE_MAX);
+}
+
+size_t extrle::decode16(
+    const ubyte* src, size_t srclen, ubyte* dst8, size_t capacity
+) {
     auto dst = reinterpret_cast<uint16_t*>(dst8);
+    size_t limit = capacity / 2;
     size_t offset = 0;
     for (size_t i = 0; i < srclen;) {
         uint len = src[i++];
@@ -141,9 +416,11 @@ size_t extrle::decode16(const ubyte* src, size_t srclen, ubyte* dst8) {
         if (widechar) {
             c |= ((static_cast<uint>(src[i++])) << 8);
         }
-        for (size_t j = 0; j <= len; j++) {
-            dst[offset++] = c;
+        if (len + 1 > limit - offset) {
+            throw std::runtime_error("extrle: decoded data is out of bounds");
         }
+        kernels.fill16(dst + offset, len + 1, c);
+        offset += len + 1;
     }
     return offset * 2;
 }
@@ -154,11 +431,14 @@ size_t extrle::encode16(const ubyte* src8, size_t srclen, ubyte* dst) {
     }
     auto src = reinterpret_cast<const uint16_t*>(src8);
     size_t offset = 0;
-    uint counter = 0;
-    uint16_t c = src[0];
-    for (size_t i = 1; i < srclen/2; i++) {
-        uint16_t cnext = src[i];
-        if (cnext != c || counter == max_sequence16) {
+    // the first element is always encoded
+    size_t count = std::max<size_t>(srclen / 2, 1);
+    for_each_sequence(
+        src,
+        count,
+        max_sequence16,
+        kernels.findRunEnd16,
+        [&](size_t counter, uint16_t c) {
             if (counter >= 0x40) {
                 dst[offset++] = 0x80 | ((c > 255) << 6) | (counter & 0x3F);
                 dst[offset++] = counter >> 6;
@@ -171,23 +451,7 @@ size_t extrle::encode16(const ubyte* src8, size_t srclen, ubyte* dst) {
             } else {
                 dst[offset++] = c;
             }
-            c = cnext;
-            counter = 0;
-        } else {
-            counter++;
         }
-    }
-    if (counter >= 0x40) {
-        dst[offset++] = 0x80 | ((c > 255) << 6) | (counter & 0x3F);
-        dst[offset++] = counter >> 6;
-    } else {
-        dst[offset++] = counter | ((c > 255) << 6);
-    }
-    if (c > 255) {
-        dst[offset++] = c & 0xFF;
-        dst[offset++] = c >> 8;
-    } else {
-        dst[offset++] = c;
-    }
+    );
     return offset;
 }
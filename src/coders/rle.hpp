@@ -3,6 +3,24 @@
 #include "typedefs.hpp"
 
 namespace rle {
+    /// @brief Instruction sets of run detection and run expansion kernels
+    /// used by rle and extrle functions
+    enum class Kernels { SCALAR, SSE2, AVX2 };
+
+    /// @return best kernels supported by the CPU (selected by default)
+    Kernels best_kernels();
+
+    /// @return currently used kernels
+    Kernels get_kernels();
+
+    /// @brief Select kernels used by rle and extrle functions (for tests and
+    /// benchmarks). Not thread-safe: no other thread may be encoding or
+    /// decoding at the same time.
+    /// @throws std::invalid_argument if kernels are not supported by the CPU
+    void use_kernels(Kernels kernels);
+
+    const char* to_string(Kernels kernels);
+
     size_t encode(const ubyte* src, size_t length, ubyte* dst);
     size_t decode(const ubyte* src, size_t length, ubyte* dst);
 
@@ -18,4 +36,11 @@ namespace extrle {
     constexpr uint max_sequence16 = 0x3FFF;
     size_t encode16(const ubyte* src, size_t length, ubyte* dst);
     size_t decode16(const ubyte* src, size_t length, ubyte* dst);
+
+    /// @brief Decode untrusted data to a buffer of limited size
+    /// @param capacity destination buffer size
+    /// @throws std::runtime_error if decoded data does not fit
+    size_t decode16(
+        const ubyte* src, size_t length, ubyte* dst, size_t capacity
+    );
 }
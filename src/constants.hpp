@@ -17,9 +17,9 @@ inline constexpr bool ENGINE_DEBUG_BUILD = true;
 inline const std::string ENGINE_VERSION_STRING = "0.27";
 
 /// @brief world regions format version
-inline constexpr uint REGION_FORMAT_VERSION = 3;
+inline constexpr uint REGION_FORMAT_VERSION = 4;
 
-/// @brief max simultaneously open world region files
+/// @brief default max open region files of a regions layer
 inline constexpr uint MAX_OPEN_REGION_FILES = 32;
 
 inline constexpr blockid_t BLOCK_AIR = 0;
@@ -1,5 +1,7 @@
 #include "ContentGfxCache.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 
 #include "UiDocument.hpp"
@@ -7,6 +9,7 @@
 #include "content/Content.hpp"
 #include "content/ContentPack.hpp"
 #include "graphics/core/Atlas.hpp"
+#include "graphics/core/ImageData.hpp"
 #include "maths/UVRegion.hpp"
 #include "voxels/Block.hpp"
 #include "core_defs.hpp"
@@ -19,6 +22,14 @@ ContentGfxCache::ContentGfxCache(
     const GraphicsSettings& settings
 )
     : content(content), assets(assets), settings(settings) {
+    const auto& atlas = assets.require<Atlas>("blocks");
+    for (const auto& [name, region] : atlas.getRegions()) {
+        if (regionsTable.size() == NO_REGION) {
+            break;
+        }
+        regionIndices[name] = regionsTable.size();
+        regionsTable.push_back(region);
+    }
     refresh();
 }
 
@@ -29,10 +40,17 @@ void ContentGfxCache::refresh(const Block& def, const Atlas& atlas) {
             !settings.denseRender.get() && atlas.has(tex + "_opaque")) {
             tex = tex + "_opaque";
         }
+        if (!atlas.has(tex)) {
+            tex = TEXTURE_NOTFOUND;
+        }
+        uint index = def.rt.id * 6 + side;
+        sideindices[index] = NO_REGION;
         if (atlas.has(tex)) {
-            sideregions[def.rt.id * 6 + side] = atlas.get(tex);
-        } else if (atlas.has(TEXTURE_NOTFOUND)) {
-            sideregions[def.rt.id * 6 + side] = atlas.get(TEXTURE_NOTFOUND);
+            sideregions[index] = atlas.get(tex);
+            const auto& found = regionIndices.find(tex);
+            if (found != regionIndices.end()) {
+                sideindices[index] = found->second;
+            }
         }
     }
     if (def.model == BlockModel::custom) {
@@ -58,6 +76,7 @@ void ContentGfxCache::refresh(const Block& def, const Atlas& atlas) {
 void ContentGfxCache::refresh() {
     auto indices = content.getIndices();
     sideregions = std::make_unique<UVRegion[]>(indices->blocks.count() * 6);
+    sideindices = std::make_unique<uint16_t[]>(indices->blocks.count() * 6);
     const auto& atlas = assets.require<Atlas>("blocks");
 
     const auto& blocks = indices->blocks.getIterable();
@@ -69,6 +88,34 @@ void ContentGfxCache::refresh() {
 
 ContentGfxCache::~ContentGfxCache() = default;
 
+static void put_uv16(ubyte* dst, float u, float v) {
+    for (float value : {u, v}) {
+        auto norm = static_cast<uint>(
+            std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f)
+        );
+        *(dst++) = norm >> 8;
+        *(dst++) = norm & 0xFF;
+    }
+}
+
+std::unique_ptr<ImageData> ContentGfxCache::createRegionsImage() const {
+    uint width = REGIONS_PER_ROW * 2;
+    uint height = std::max<uint>(
+        1, (regionsTable.size() + REGIONS_PER_ROW - 1) / REGIONS_PER_ROW
+    );
+    auto image =
+        std::make_unique<ImageData>(ImageFormat::rgba8888, width, height);
+    ubyte* data = image->getData();
+    std::fill_n(data, width * height * 4, 0);
+    for (size_t i = 0; i < regionsTable.size(); i++) {
+        const auto& region = regionsTable[i];
+        ubyte* texel = data + i * 8;
+        put_uv16(texel, region.u1, region.v1);
+        put_uv16(texel + 4, region.u2, region.v2);
+    }
+    return image;
+}
+
 const Content* ContentGfxCache::getContent() const {
     return &content;
 }
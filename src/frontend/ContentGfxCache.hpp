@@ -4,7 +4,9 @@
 
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "graphics/commons/Model.hpp"
 
@@ -12,6 +14,7 @@ class Content;
 class Assets;
 class Atlas;
 class Block;
+class ImageData;
 struct UVRegion;
 struct GraphicsSettings;
 
@@ -26,8 +29,19 @@ class ContentGfxCache {
 
     // array of block sides uv regions (6 per block)
     std::unique_ptr<UVRegion[]> sideregions;
+    // array of block sides tiling region indices (6 per block)
+    std::unique_ptr<uint16_t[]> sideindices;
+    // blocks atlas regions indexed for merged faces
+    std::vector<UVRegion> regionsTable;
+    std::unordered_map<std::string, uint16_t> regionIndices;
     std::unordered_map<blockid_t, model::Model> models;
 public:
+    /// @brief Block side has no tiling region index
+    static constexpr uint16_t NO_REGION = 0xFFFF;
+    /// @brief Regions per row of the regions table image
+    /// (CHUNK_REGIONS_PER_ROW in shaders)
+    static constexpr uint REGIONS_PER_ROW = 128;
+
     ContentGfxCache(
         const Content& content,
         const Assets& assets,
@@ -39,6 +53,20 @@ public:
         return sideregions[id * 6 + side];
     }
 
+    /// @return block side tiling region index or NO_REGION
+    inline uint16_t getRegionIndex(blockid_t id, int side) const {
+        return sideindices[id * 6 + side];
+    }
+
+    inline const UVRegion& getRegionByIndex(uint16_t index) const {
+        return regionsTable.at(index);
+    }
+
+    /// @brief Create regions table image used by chunk shaders to find
+    /// merged faces tiling regions. Each region takes two texels:
+    /// (u1, v1) and (u2, v2) as big-endian normalized 16 bit values
+    std::unique_ptr<ImageData> createRegionsImage() const;
+
     const model::Model& getModel(blockid_t id) const;
 
     const Content* getContent() const;
@@ -26,6 +26,7 @@
 #include "voxels/GlobalChunks.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
+#include "world/files/WorldFiles.hpp"
 
 #include <string>
 #include <memory>
@@ -118,7 +119,26 @@ std::shared_ptr<UINode> create_debug_panel(
     }));
     panel->add(create_label([&]() {
         return L"chunks: "+std::to_wstring(level.chunks->size())+
-               L" visible: "+std::to_wstring(ChunksRenderer::visibleChunks);
+               L" visible: "+std::to_wstring(ChunksRenderer::visibleChunks)+
+               L" memory: "+
+               std::to_wstring(level.chunks->getMemoryUsage() / 1024 / 1024)+
+               L" MiB";
+    }));
+    panel->add(create_label([&]() {
+        auto stats = level.getWorld()->wfile->getRegions().getCacheStats();
+        return L"regions: "+std::to_wstring(stats.regions)+
+               L" memory: "+std::to_wstring(stats.memoryUsage / 1024 / 1024)+
+               L" MiB hits: "+std::to_wstring(stats.hits)+
+               L" misses: "+std::to_wstring(stats.misses)+
+               L" evicted: "+std::to_wstring(stats.evictions);
+    }));
+    panel->add(create_label([&]() {
+        auto stats = level.getWorld()->wfile->getRegions().getCacheStats();
+        size_t reads = stats.prefetchHits + stats.prefetchMisses;
+        return L"prefetch hits: "+std::to_wstring(stats.prefetchHits)+
+               L" misses: "+std::to_wstring(stats.prefetchMisses)+
+               L" ("+std::to_wstring(reads ? stats.prefetchHits * 100 / reads : 0)+
+               L"%) wasted: "+std::to_wstring(stats.prefetchWasted);
     }));
     panel->add(create_label([&]() {
         return L"entities: "+std::to_wstring(level.entities->size())+L" next: "+
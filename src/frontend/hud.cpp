@@ -267,7 +267,7 @@ void Hud::updateWorldGenDebug() {
     const auto& chunks = *player.chunks;
     auto generator =
         frontend.getController()->getChunksController()->getGenerator();
-    auto debugInfo = generator->createDebugInfo();
+    auto debugInfo = generator->createDebugInfo(player.getId());
     
     int width = debugImgWorldGen->getWidth();
     int height = debugImgWorldGen->getHeight();
@@ -331,7 +331,7 @@ void Hud::update(bool visible) {
     }
 
     if (blockUI) {
-        voxel* vox = chunks.get(blockPos.x, blockPos.y, blockPos.z);
+        const voxel* vox = chunks.get(blockPos.x, blockPos.y, blockPos.z);
         if (vox == nullptr || vox->id != currentblockid) {
             closeInventory();
         }
@@ -41,6 +41,10 @@ std::optional<UVRegion> Atlas::getIf(const std::string& name) const {
     return found->second;
 }
 
+const std::unordered_map<std::string, UVRegion>& Atlas::getRegions() const {
+    return regions;
+}
+
 Texture* Atlas::getTexture() const {
     return texture.get();
 }
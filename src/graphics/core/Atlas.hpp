@@ -33,6 +33,7 @@ public:
     bool has(const std::string& name) const;
     const UVRegion& get(const std::string& name) const;
     std::optional<UVRegion> getIf(const std::string& name) const;
+    const std::unordered_map<std::string, UVRegion>& getRegions() const;
 
     Texture* getTexture() const;
     ImageData* getImage() const;
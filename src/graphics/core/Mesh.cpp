@@ -7,13 +7,25 @@ int Mesh::drawCalls = 0;
 
 inline size_t calc_vertex_size(const VertexAttribute* attrs) {
     size_t vertexSize = 0;
-    for (int i = 0; attrs[i].size; i++) {
-        vertexSize += attrs[i].size;
+    for (int i = 0; attrs[i].count; i++) {
+        vertexSize += attrs[i].size();
     }
     assert(vertexSize != 0);
     return vertexSize;
 }
 
+static GLenum to_gl_type(VertexAttribute::Type type) {
+    switch (type) {
+        case VertexAttribute::Type::INT8: return GL_BYTE;
+        case VertexAttribute::Type::UINT8: return GL_UNSIGNED_BYTE;
+        case VertexAttribute::Type::INT16: return GL_SHORT;
+        case VertexAttribute::Type::UINT16: return GL_UNSIGNED_SHORT;
+        case VertexAttribute::Type::INT32: return GL_INT;
+        case VertexAttribute::Type::UINT32: return GL_UNSIGNED_INT;
+        default: return GL_FLOAT;
+    }
+}
+
 Mesh::Mesh(const MeshData& data)
  : Mesh(data.vertices.data(), 
         data.vertices.size() / calc_vertex_size(data.attrs.data()),
@@ -21,16 +33,13 @@ Mesh::Mesh(const MeshData& data)
         data.indices.size(),
         data.attrs.data()) {}
 
-Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const VertexAttribute* attrs) : 
+Mesh::Mesh(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const VertexAttribute* attrs) : 
     ibo(0),
     vertices(0),
     indices(0)
 {
     meshesCount++;
-    vertexSize = 0;
-    for (int i = 0; attrs[i].size; i++) {
-        vertexSize += attrs[i].size;
-    }
+    vertexSize = calc_vertex_size(attrs);
 
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
@@ -38,12 +47,17 @@ Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, s
     reload(vertexBuffer, vertices, indexBuffer, indices);
 
     // attributes
-    int offset = 0;
-    for (int i = 0; attrs[i].size; i++) {
-        int size = attrs[i].size;
-        glVertexAttribPointer(i, size, GL_FLOAT, GL_FALSE, vertexSize * sizeof(float), (GLvoid*)(offset * sizeof(float)));
+    size_t offset = 0;
+    for (int i = 0; attrs[i].count; i++) {
+        const auto& attr = attrs[i];
+        GLenum type = to_gl_type(attr.type);
+        if (attr.integer && attr.type != VertexAttribute::Type::FLOAT) {
+            glVertexAttribIPointer(i, attr.count, type, vertexSize, (GLvoid*)offset);
+        } else {
+            glVertexAttribPointer(i, attr.count, type, attr.normalized ? GL_TRUE : GL_FALSE, vertexSize, (GLvoid*)offset);
+        }
         glEnableVertexAttribArray(i);
-        offset += size;
+        offset += attr.size();
     }
 
     glBindVertexArray(0);
@@ -56,11 +70,11 @@ Mesh::~Mesh(){
     if (ibo != 0) glDeleteBuffers(1, &ibo);
 }
 
-void Mesh::reload(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices){
+void Mesh::reload(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices){
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     if (vertexBuffer != nullptr && vertices != 0) {
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertexSize * vertices, vertexBuffer, GL_STREAM_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexSize * vertices, vertexBuffer, GL_STREAM_DRAW);
     } else {
         glBufferData(GL_ARRAY_BUFFER, 0, {}, GL_STREAM_DRAW);
     }
@@ -11,11 +11,12 @@ class Mesh {
     unsigned int ibo;
     size_t vertices;
     size_t indices;
+    /// @brief Vertex size in bytes
     size_t vertexSize;
 public:
     Mesh(const MeshData& data);
-    Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const VertexAttribute* attrs);
-    Mesh(const float* vertexBuffer, size_t vertices, const VertexAttribute* attrs) :
+    Mesh(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const VertexAttribute* attrs);
+    Mesh(const void* vertexBuffer, size_t vertices, const VertexAttribute* attrs) :
         Mesh(vertexBuffer, vertices, nullptr, 0, attrs) {};
     ~Mesh();
 
@@ -24,7 +25,7 @@ public:
     /// @param vertices number of vertices in new buffer
     /// @param indexBuffer indices buffer
     /// @param indices number of values in indices buffer
-    void reload(const float* vertexBuffer, size_t vertices, const int* indexBuffer = nullptr, size_t indices = 0);
+    void reload(const void* vertexBuffer, size_t vertices, const int* indexBuffer = nullptr, size_t indices = 0);
     
     /// @brief Draw mesh with specified primitives type
     /// @param primitive primitives type
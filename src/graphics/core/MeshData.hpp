@@ -7,12 +7,37 @@
 
 /// @brief Vertex attribute info
 struct VertexAttribute {
-    ubyte size;
+    enum class Type : ubyte {
+        FLOAT, INT8, UINT8, INT16, UINT16, INT32, UINT32
+    };
+    /// @brief Number of components, zero terminates attributes array
+    ubyte count;
+    /// @brief Components type
+    Type type = Type::FLOAT;
+    /// @brief Integer values are mapped to [0, 1] ([-1, 1] for signed types)
+    bool normalized = false;
+    /// @brief Integer values are passed to shader as is (ivecN/uvecN)
+    /// instead of conversion to float
+    bool integer = false;
+
+    /// @return attribute size in bytes
+    inline uint size() const {
+        switch (type) {
+            case Type::INT8:
+            case Type::UINT8:
+                return count;
+            case Type::INT16:
+            case Type::UINT16:
+                return count * 2;
+            default:
+                return count * 4;
+        }
+    }
 };
 
 /// @brief Raw mesh data structure
 struct MeshData {
-    util::Buffer<float> vertices;
+    util::Buffer<ubyte> vertices;
     util::Buffer<int> indices;
     util::Buffer<VertexAttribute> attrs;
 
@@ -20,9 +45,10 @@ struct MeshData {
 
     /// @param vertices vertex data buffer
     /// @param indices nullable indices buffer
-    /// @param attrs vertex attribute sizes (must be null-terminated) 
+    /// @param attrs vertex attributes (must be terminated with zero count
+    /// attribute)
     MeshData(
-        util::Buffer<float> vertices, 
+        util::Buffer<ubyte> vertices, 
         util::Buffer<int> indices,
         util::Buffer<VertexAttribute> attrs
     ) : vertices(std::move(vertices)),
@@ -8,6 +8,10 @@
 #include "voxels/Chunks.hpp"
 #include "lighting/Lightmap.hpp"
 #include "frontend/ContentGfxCache.hpp"
+#include "greedy_meshing.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 const glm::vec3 BlocksRenderer::SUN_VECTOR (0.2275f,0.9388f,-0.1005f);
 
@@ -17,8 +21,9 @@ BlocksRenderer::BlocksRenderer(
     const ContentGfxCache& cache,
     const EngineSettings& settings
 ) : content(content),
-    vertexBuffer(std::make_unique<float[]>(capacity * CHUNK_VERTEX_SIZE)),
-    indexBuffer(std::make_unique<int[]>(capacity)),
+    vertexBuffer(std::make_unique<ChunkVertex[]>(capacity)),
+    // 6 indices per 4 vertices face
+    indexBuffer(std::make_unique<int[]>(capacity * 3 / 2)),
     vertexOffset(0),
     indexOffset(0),
     indexSize(0),
@@ -40,24 +45,9 @@ BlocksRenderer::~BlocksRenderer() {
 void BlocksRenderer::vertex(
     const glm::vec3& coord, float u, float v, const glm::vec4& light
 ) {
-    vertexBuffer[vertexOffset++] = coord.x;
-    vertexBuffer[vertexOffset++] = coord.y;
-    vertexBuffer[vertexOffset++] = coord.z;
-
-    vertexBuffer[vertexOffset++] = u;
-    vertexBuffer[vertexOffset++] = v;
-
-    union {
-        float floating;
-        uint32_t integer;
-    } compressed;
-
-    compressed.integer = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
-    compressed.integer |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
-    compressed.integer |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
-    compressed.integer |= (static_cast<uint32_t>(light.a * 255) & 0xff);
-
-    vertexBuffer[vertexOffset++] = compressed.floating;
+    vertexBuffer[vertexOffset++] = ChunkVertex::pack(
+        coord, {u, v}, ChunkVertex::compressLight(light)
+    );
 }
 
 void BlocksRenderer::index(int a, int b, int c, int d, int e, int f) {
@@ -81,7 +71,7 @@ void BlocksRenderer::face(
     const glm::vec4(&lights)[4],
     const glm::vec4& tint
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + 4 > capacity) {
         overflow = true;
         return;
     }
@@ -96,21 +86,29 @@ void BlocksRenderer::face(
     index(0, 1, 3, 1, 2, 3);
 }
 
-void BlocksRenderer::vertexAO(
-    const glm::vec3& coord, 
-    float u, float v,
-    const glm::vec4& tint,
+glm::vec4 BlocksRenderer::pickVertexAO(
+    const glm::vec3& coord,
     const glm::vec3& axisX,
     const glm::vec3& axisY,
     const glm::vec3& axisZ
-) {
+) const {
     auto pos = coord+axisZ*0.5f+(axisX+axisY)*0.5f;
-    auto light = pickSoftLight(
+    return pickSoftLight(
         glm::ivec3(std::round(pos.x), std::round(pos.y), std::round(pos.z)),
         axisX,
         axisY
     );
-    vertex(coord, u, v, light * tint);
+}
+
+void BlocksRenderer::vertexAO(
+    const glm::vec3& coord, 
+    float u, float v,
+    const glm::vec4& tint,
+    const glm::vec3& axisX,
+    const glm::vec3& axisY,
+    const glm::vec3& axisZ
+) {
+    vertex(coord, u, v, pickVertexAO(coord, axisX, axisY, axisZ) * tint);
 }
 
 void BlocksRenderer::faceAO(
@@ -121,7 +119,7 @@ void BlocksRenderer::faceAO(
     const UVRegion& region,
     bool lights
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + 4 > capacity) {
         overflow = true;
         return;
     }
@@ -159,7 +157,7 @@ void BlocksRenderer::face(
     glm::vec4 tint,
     bool lights
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + 4 > capacity) {
         overflow = true;
         return;
     }
@@ -289,7 +287,7 @@ void BlocksRenderer::blockCustomModel(
 
     const auto& model = cache.getModel(block->rt.id);
     for (const auto& mesh : model.meshes) {
-        if (vertexOffset + CHUNK_VERTEX_SIZE * mesh.vertices.size() > capacity) {
+        if (vertexOffset + mesh.vertices.size() > capacity) {
             overflow = true;
             return;
         }
@@ -382,6 +380,158 @@ void BlocksRenderer::blockCube(
     }
 }
 
+namespace {
+    /// @brief Not rotated block face in blockCube order
+    struct FaceDirection {
+        glm::ivec3 X;
+        glm::ivec3 Y;
+        glm::ivec3 Z;
+        /// @brief Texture face index
+        int side;
+        /// @brief Coordinate index of face X, Y and normal axes
+        int axisA, axisB, axisN;
+    };
+}
+
+static const FaceDirection FACE_DIRECTIONS[6] {
+    {{ 1, 0, 0}, {0, 1, 0}, { 0, 0, 1}, 5, 0, 1, 2}, // north
+    {{-1, 0, 0}, {0, 1, 0}, { 0, 0,-1}, 4, 0, 1, 2}, // south
+    {{ 1, 0, 0}, {0, 0,-1}, { 0, 1, 0}, 3, 0, 2, 1}, // top
+    {{ 1, 0, 0}, {0, 0, 1}, { 0,-1, 0}, 2, 0, 2, 1}, // bottom
+    {{ 0, 0,-1}, {0, 1, 0}, { 1, 0, 0}, 1, 2, 1, 0}, // west
+    {{ 0, 0, 1}, {0, 1, 0}, {-1, 0, 0}, 0, 2, 1, 0}, // east
+};
+
+void BlocksRenderer::blockCubeGreedy(
+    const glm::ivec3& coord,
+    const UVRegion(&texfaces)[6],
+    const Block& block,
+    bool lights,
+    bool ao
+) {
+    uint64_t id = block.rt.id;
+    uint index = vox_index(coord.x, coord.y, coord.z);
+    for (int i = 0; i < 6; i++) {
+        const auto& dir = FACE_DIRECTIONS[i];
+        if (!isOpen(coord + dir.Z, block)) {
+            continue;
+        }
+        glm::vec3 X(dir.X);
+        glm::vec3 Y(dir.Y);
+        glm::vec3 Z(dir.Z);
+        float d = 0.7f + glm::dot(glm::normalize(Z), SUN_VECTOR) * 0.3f;
+
+        // the same values as faceAO and face calculate
+        uint32_t corners[4];
+        if (ao && lights) {
+            glm::vec3 pos(coord);
+            const glm::vec3 offsets[4] {
+                -X - Y + Z, X - Y + Z, X + Y + Z, -X + Y + Z
+            };
+            glm::vec4 tint(d);
+            for (int k = 0; k < 4; k++) {
+                corners[k] = ChunkVertex::compressLight(
+                    pickVertexAO(pos + offsets[k] * 0.5f, X, Y, Z) * tint
+                );
+            }
+        } else {
+            glm::vec4 tint(1.0f);
+            if (!ao) {
+                tint = pickLight(coord + dir.Z);
+                if (lights) {
+                    tint *= d;
+                }
+            }
+            std::fill_n(corners, 4, ChunkVertex::compressLight(tint));
+        }
+        bool indexed =
+            cache.getRegionIndex(id, dir.side) != ContentGfxCache::NO_REGION;
+        if (indexed && corners[0] == corners[1] && corners[0] == corners[2] &&
+            corners[0] == corners[3]) {
+            greedyFaces[i * CHUNK_VOL + index] = id << 32 | corners[0];
+        } else {
+            // smooth lighting of the face does not allow to merge it,
+            // as well as missing tiling region index
+            if (ao) {
+                faceAO(coord, X, Y, Z, texfaces[dir.side], lights);
+            } else {
+                face(
+                    coord, X, Y, Z, texfaces[dir.side],
+                    pickLight(coord + dir.Z), lights
+                );
+            }
+        }
+    }
+}
+
+void BlocksRenderer::flushGreedyFaces() {
+    constexpr int MAX_TILES = ChunkVertex::MAX_TILES;
+    const int strides[3] {1, CHUNK_W * CHUNK_D, CHUNK_W};
+    const int from[3] {0, chunk->bottom, 0};
+    const int to[3] {CHUNK_W, chunk->top, CHUNK_D};
+
+    for (int i = 0; i < 6; i++) {
+        const auto& dir = FACE_DIRECTIONS[i];
+        glm::vec3 X(dir.X);
+        glm::vec3 Y(dir.Y);
+        glm::vec3 Z(dir.Z);
+        int a = dir.axisA;
+        int b = dir.axisB;
+        int n = dir.axisN;
+        uint64_t* faces = greedyFaces.get() + i * CHUNK_VOL;
+
+        auto emit = [&](int layer, const greedy_meshing::Rect& rect) {
+            auto id = static_cast<blockid_t>(rect.key >> 32);
+            auto light = static_cast<uint32_t>(rect.key);
+            uint16_t region = cache.getRegionIndex(id, dir.side);
+
+            // tile coordinates are stored as bytes, so long rectangles
+            // are split
+            for (int pb = 0; pb < rect.h; pb += MAX_TILES) {
+                for (int pa = 0; pa < rect.w; pa += MAX_TILES) {
+                    if (overflow || vertexOffset + 4 > capacity) {
+                        overflow = true;
+                        return;
+                    }
+                    int w = std::min(rect.w - pa, MAX_TILES);
+                    int h = std::min(rect.h - pb, MAX_TILES);
+                    glm::vec3 coord;
+                    coord[n] = layer;
+                    coord[a] = from[a] + rect.a + pa + (w - 1) * 0.5f;
+                    coord[b] = from[b] + rect.b + pb + (h - 1) * 0.5f;
+
+                    auto sX = X * static_cast<float>(w);
+                    auto sY = Y * static_cast<float>(h);
+                    float s = 0.5f;
+                    auto quad = [&](const glm::vec3& pos, int u, int v) {
+                        vertexBuffer[vertexOffset++] = ChunkVertex::packMerged(
+                            pos, light, {u, v}, region
+                        );
+                    };
+                    quad(coord + (-sX - sY + Z) * s, 0, 0);
+                    quad(coord + ( sX - sY + Z) * s, w, 0);
+                    quad(coord + ( sX + sY + Z) * s, w, h);
+                    quad(coord + (-sX + sY + Z) * s, 0, h);
+                    index(0, 1, 2, 0, 2, 3);
+                }
+            }
+        };
+        for (int layer = from[n]; layer < to[n] && !overflow; layer++) {
+            greedy_meshing::merge(
+                faces + layer * strides[n] + from[a] * strides[a] +
+                    from[b] * strides[b],
+                to[a] - from[a],
+                to[b] - from[b],
+                strides[a],
+                strides[b],
+                [&](const greedy_meshing::Rect& rect) {
+                    emit(layer, rect);
+                }
+            );
+        }
+    }
+}
+
 bool BlocksRenderer::isOpenForLight(int x, int y, int z) const {
     blockid_t id = voxelsBuffer->pickBlockId(chunk->x * CHUNK_W + x, 
                                              y, 
@@ -433,8 +583,23 @@ glm::vec4 BlocksRenderer::pickSoftLight(
 }
 
 void BlocksRenderer::render(
-    const voxel* voxels, int beginEnds[256][2]
+    const ChunkVoxels& voxels, int beginEnds[256][2]
 ) {
+    bool greedy = settings.graphics.greedyMeshing.get();
+    if (greedy) {
+        if (greedyFaces == nullptr) {
+            greedyFaces = std::make_unique<uint64_t[]>(6 * CHUNK_VOL);
+        }
+        size_t offset = chunk->bottom * (CHUNK_W * CHUNK_D);
+        size_t count = (chunk->top - chunk->bottom) * (CHUNK_W * CHUNK_D);
+        for (int i = 0; i < 6; i++) {
+            std::memset(
+                greedyFaces.get() + i * CHUNK_VOL + offset,
+                0,
+                count * sizeof(uint64_t)
+            );
+        }
+    }
     for (const auto drawGroup : *content.drawGroups) {
         int begin = beginEnds[drawGroup][0];
         if (begin == 0) {
@@ -442,6 +607,9 @@ void BlocksRenderer::render(
         }
         int end = beginEnds[drawGroup][1];
         for (int i = begin-1; i <= end; i++) {
+            if (skipHidden(i)) {
+                continue;
+            }
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
             blockstate state = vox.state;
@@ -462,6 +630,11 @@ void BlocksRenderer::render(
             int z = (i / CHUNK_D) % CHUNK_W;
             switch (def.model) {
                 case BlockModel::block:
+                    if (greedy && !def.rotatable) {
+                        blockCubeGreedy({x, y, z}, texfaces, def,
+                                        !def.shadeless, def.ambientOcclusion);
+                        break;
+                    }
                     blockCube({x, y, z}, texfaces, def, vox.state, !def.shadeless,
                               def.ambientOcclusion);
                     break;
@@ -487,11 +660,18 @@ void BlocksRenderer::render(
                 return;
             }
         }
+        if (greedy) {
+            // merged faces are cleared, so the buffer is ready for next group
+            flushGreedyFaces();
+            if (overflow) {
+                return;
+            }
+        }
     }
 }
 
 SortingMeshData BlocksRenderer::renderTranslucent(
-    const voxel* voxels, int beginEnds[256][2]
+    const ChunkVoxels& voxels, int beginEnds[256][2]
 ) {
     SortingMeshData sortingMesh {{}};
 
@@ -505,6 +685,9 @@ SortingMeshData BlocksRenderer::renderTranslucent(
         }
         int end = beginEnds[drawGroup][1];
         for (int i = begin-1; i <= end; i++) {
+            if (skipHidden(i)) {
+                continue;
+            }
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
             blockstate state = vox.state;
@@ -555,29 +738,21 @@ SortingMeshData BlocksRenderer::renderTranslucent(
                     y + 0.5f,
                     z + chunk->z * CHUNK_D + 0.5f
                 ),
-                util::Buffer<float>(indexSize * CHUNK_VERTEX_SIZE), 0};
+                util::Buffer<ChunkVertex>(indexSize), 0};
 
             totalSize += entry.vertexData.size();
 
+            // vertices stay chunk-relative, sorted mesh is drawn with
+            // the chunk model matrix
             for (int j = 0; j < indexSize; j++) {
-                std::memcpy(
-                    entry.vertexData.data() + j * CHUNK_VERTEX_SIZE,
-                    vertexBuffer.get() + indexBuffer[j] * CHUNK_VERTEX_SIZE,
-                    sizeof(float) * CHUNK_VERTEX_SIZE
-                );
-                float& vx = entry.vertexData[j * CHUNK_VERTEX_SIZE + 0];
-                float& vy = entry.vertexData[j * CHUNK_VERTEX_SIZE + 1];
-                float& vz = entry.vertexData[j * CHUNK_VERTEX_SIZE + 2];
-
+                entry.vertexData[j] = vertexBuffer[indexBuffer[j]];
+                glm::vec3 pos = entry.vertexData[j].getPosition();
                 if (!aabbInit) {
                     aabbInit = true;
-                    aabb.a = aabb.b = {vx, vy, vz};
+                    aabb.a = aabb.b = pos;
                 } else {
-                    aabb.addPoint(glm::vec3(vx, vy, vz));
+                    aabb.addPoint(pos);
                 }
-                vx += chunk->x * CHUNK_W + 0.5f;
-                vy += 0.5f;
-                vz += chunk->z * CHUNK_D + 0.5f;
             }
             sortingMesh.entries.push_back(std::move(entry));
             vertexOffset = 0;
@@ -591,14 +766,15 @@ SortingMeshData BlocksRenderer::renderTranslucent(
          sortingMesh.entries.size() > 1) {
         SortingMeshEntry newEntry {
             sortingMesh.entries[0].position,
-            util::Buffer<float>(totalSize),
+            util::Buffer<ChunkVertex>(totalSize),
             0
         };
         size_t offset = 0;
         for (const auto& entry : sortingMesh.entries) {
             std::memcpy(
                 newEntry.vertexData.data() + offset,
-                entry.vertexData.data(), entry.vertexData.size() * sizeof(float)
+                entry.vertexData.data(),
+                entry.vertexData.size() * sizeof(ChunkVertex)
             );
             offset += entry.vertexData.size();
         }
@@ -607,6 +783,62 @@ SortingMeshData BlocksRenderer::renderTranslucent(
     return sortingMesh;
 }
 
+uint BlocksRenderer::getHiddenSections(const Chunks& chunks) const {
+    const auto& voxels = chunk->voxels;
+    // missing neighbour chunk is never open (BLOCK_VOID)
+    const ChunkVoxels* neighbours[4] {};
+    const glm::ivec2 offsets[4] {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    for (int i = 0; i < 4; i++) {
+        if (auto neighbour = chunks.getChunk(
+                chunk->x + offsets[i].x, chunk->z + offsets[i].y
+            )) {
+            neighbours[i] = &neighbour->voxels;
+        }
+    }
+    // section of def blocks faces are culled by uniform section of solid
+    // blocks of the same draw group (see isOpen)
+    auto isClosing = [this](
+        const ChunkVoxels& target, int s, const Block& def
+    ) {
+        if (!target.isUniform(s)) {
+            return false;
+        }
+        const auto& other = *blockDefsCache[target.getFill(s).id];
+        return other.rt.id != 0 && other.rt.solid &&
+               (other.drawGroup == def.drawGroup || other.drawGroup == 0);
+    };
+    uint hidden = 0;
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        if (voxels.isEmpty(s)) {
+            hidden |= 1 << s;
+            continue;
+        }
+        if (!voxels.isUniform(s)) {
+            continue;
+        }
+        const auto& def = *blockDefsCache[voxels.getFill(s).id];
+        if (def.model == BlockModel::none) {
+            hidden |= 1 << s;
+            continue;
+        }
+        if (def.model != BlockModel::block ||
+            def.culling != CullingMode::DEFAULT || !def.rt.solid) {
+            continue;
+        }
+        bool enclosed = (s == 0 || isClosing(voxels, s - 1, def)) &&
+                        (s + 1 == CHUNK_SECTIONS ||
+                         isClosing(voxels, s + 1, def));
+        for (int i = 0; i < 4 && enclosed; i++) {
+            enclosed = neighbours[i] == nullptr ||
+                       isClosing(*neighbours[i], s, def);
+        }
+        if (enclosed) {
+            hidden |= 1 << s;
+        }
+    }
+    return hidden;
+}
+
 void BlocksRenderer::build(const Chunk* chunk, const Chunks* chunks) {
     this->chunk = chunk;
     voxelsBuffer->setPosition(
@@ -620,13 +852,17 @@ void BlocksRenderer::build(const Chunk* chunk, const Chunks* chunks) {
         cancelled = true;
         return;
     }
-    const voxel* voxels = chunk->voxels;
+    const auto& voxels = chunk->voxels;
+    hiddenSections = getHiddenSections(*chunks);
 
     int totalBegin = chunk->bottom * (CHUNK_W * CHUNK_D);
     int totalEnd = chunk->top * (CHUNK_W * CHUNK_D);
 
     int beginEnds[256][2] {};
     for (int i = totalBegin; i < totalEnd; i++) {
+        if (skipHidden(i)) {
+            continue;
+        }
         const voxel& vox = voxels[i];
         blockid_t id = vox.id;
         const auto& def = *blockDefsCache[id];
@@ -654,7 +890,10 @@ void BlocksRenderer::build(const Chunk* chunk, const Chunks* chunks) {
 ChunkMeshData BlocksRenderer::createMesh() {
     return ChunkMeshData {
         MeshData(
-            util::Buffer<float>(vertexBuffer.get(), vertexOffset),
+            util::Buffer<ubyte>(
+                reinterpret_cast<const ubyte*>(vertexBuffer.get()),
+                vertexOffset * sizeof(ChunkVertex)
+            ),
             util::Buffer<int>(indexBuffer.get(), indexSize),
             util::Buffer<VertexAttribute>(
                 CHUNK_VATTRS, sizeof(CHUNK_VATTRS) / sizeof(VertexAttribute)
@@ -666,9 +905,8 @@ ChunkMeshData BlocksRenderer::createMesh() {
 ChunkMesh BlocksRenderer::render(const Chunk* chunk, const Chunks* chunks) {
     build(chunk, chunks);
 
-    size_t vcount = vertexOffset / CHUNK_VERTEX_SIZE;
     return ChunkMesh{std::make_unique<Mesh>(
-        vertexBuffer.get(), vcount, indexBuffer.get(), indexSize, CHUNK_VATTRS
+        vertexBuffer.get(), vertexOffset, indexBuffer.get(), indexSize, CHUNK_VATTRS
     ), std::move(sortingMesh)};
 }
 
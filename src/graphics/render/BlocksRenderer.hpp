@@ -28,7 +28,7 @@ struct UVRegion;
 class BlocksRenderer {
     static const glm::vec3 SUN_VECTOR;
     const Content& content;
-    std::unique_ptr<float[]> vertexBuffer;
+    std::unique_ptr<ChunkVertex[]> vertexBuffer;
     std::unique_ptr<int[]> indexBuffer;
     size_t vertexOffset;
     size_t indexOffset, indexSize;
@@ -37,6 +37,8 @@ class BlocksRenderer {
     bool overflow = false;
     bool cancelled = false;
     const Chunk* chunk = nullptr;
+    /// @brief Bitmask of chunk sections producing no geometry
+    uint hiddenSections = 0;
     std::unique_ptr<VoxelsVolume> voxelsBuffer;
 
     const Block* const* blockDefsCache;
@@ -47,9 +49,19 @@ class BlocksRenderer {
 
     SortingMeshData sortingMesh;
 
+    /// @brief Greedy meshing faces for each direction. Cell is
+    /// (block id << 32 | compressed light) or 0 if there is no face
+    std::unique_ptr<uint64_t[]> greedyFaces;
+
     void vertex(const glm::vec3& coord, float u, float v, const glm::vec4& light);
     void index(int a, int b, int c, int d, int e, int f);
 
+    glm::vec4 pickVertexAO(
+        const glm::vec3& coord,
+        const glm::vec3& axisX,
+        const glm::vec3& axisY,
+        const glm::vec3& axisZ
+    ) const;
     void vertexAO(
         const glm::vec3& coord, float u, float v, 
         const glm::vec4& brightness,
@@ -92,6 +104,17 @@ class BlocksRenderer {
         bool lights,
         bool ao
     );
+    /// @brief Not rotatable full block render method collecting equally
+    /// lit faces for greedy meshing
+    void blockCubeGreedy(
+        const glm::ivec3& coord,
+        const UVRegion(&faces)[6],
+        const Block& block,
+        bool lights,
+        bool ao
+    );
+    /// @brief Merge and emit collected greedy meshing faces
+    void flushGreedyFaces();
     void blockAABB(
         const glm::ivec3& coord,
         const UVRegion(&faces)[6], 
@@ -143,8 +166,23 @@ class BlocksRenderer {
     glm::vec4 pickSoftLight(const glm::ivec3& coord, const glm::ivec3& right, const glm::ivec3& up) const;
     glm::vec4 pickSoftLight(float x, float y, float z, const glm::ivec3& right, const glm::ivec3& up) const;
     
-    void render(const voxel* voxels, int beginEnds[256][2]);
-    SortingMeshData renderTranslucent(const voxel* voxels, int beginEnds[256][2]);
+    /// @brief Get bitmask of sections producing no geometry: empty ones,
+    /// uniform sections of invisible blocks and uniform sections of
+    /// opaque cubes enclosed with solid blocks
+    uint getHiddenSections(const Chunks& chunks) const;
+
+    /// @brief Move index to the last voxel of section if it is hidden
+    /// @return true if section is hidden
+    inline bool skipHidden(int& index) const {
+        if (hiddenSections & (1 << (index / CHUNK_SECTION_VOL))) {
+            index = (index / CHUNK_SECTION_VOL + 1) * CHUNK_SECTION_VOL - 1;
+            return true;
+        }
+        return false;
+    }
+
+    void render(const ChunkVoxels& voxels, int beginEnds[256][2]);
+    SortingMeshData renderTranslucent(const ChunkVoxels& voxels, int beginEnds[256][2]);
 public:
     BlocksRenderer(
         size_t capacity,
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+/// @brief Fixed-point scale of chunk vertex coordinates
+inline constexpr float CHUNK_POSITION_SCALE = 128.0f;
+/// @brief Minimal chunk vertex coordinate is -CHUNK_POSITION_OFFSET
+inline constexpr float CHUNK_POSITION_OFFSET = 16.0f;
+
+/// @brief Packed chunk mesh vertex. Coordinates are relative to the chunk
+/// model matrix (see ChunksRenderer).
+/// Must be kept in sync with CHUNK_VATTRS and res/shaders/main.glslv
+struct ChunkVertex {
+    /// @brief Max texture tiles of a merged face side
+    static constexpr int MAX_TILES = 254;
+
+    /// @brief Fixed-point position
+    uint16_t position[3];
+    /// @brief Texture tile coordinates of a merged face plus one,
+    /// zero if the vertex does not belong to a merged face
+    uint8_t tile[2];
+    /// @brief Normalized atlas texture coordinates. Tiling region index
+    /// (see ContentGfxCache::getRegionIndex) in uv[0] if the vertex belongs
+    /// to a merged face
+    uint16_t uv[2];
+    /// @brief Normalized light: r, g, b, sky
+    uint8_t light[4];
+
+    /// @brief Compress light to 8 bits per channel (r << 24 | ... | sky)
+    static inline uint32_t compressLight(const glm::vec4& light) {
+        uint32_t compressed;
+        compressed = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
+        compressed |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
+        compressed |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
+        compressed |= (static_cast<uint32_t>(light.a * 255) & 0xff);
+        return compressed;
+    }
+
+    /// @param position chunk-relative position
+    /// @param uv atlas texture coordinates
+    /// @param light compressed light (see compressLight)
+    static inline ChunkVertex pack(
+        const glm::vec3& position, const glm::vec2& uv, uint32_t light
+    ) {
+        ChunkVertex vertex;
+        vertex.setPosition(position);
+        vertex.setLight(light);
+        vertex.tile[0] = vertex.tile[1] = 0;
+        for (int i = 0; i < 2; i++) {
+            vertex.uv[i] = normalize16(uv[i]);
+        }
+        return vertex;
+    }
+
+    /// @param position chunk-relative position
+    /// @param light compressed light (see compressLight)
+    /// @param tile texture tile coordinates [0, MAX_TILES]
+    /// @param region tiling atlas region index
+    static inline ChunkVertex packMerged(
+        const glm::vec3& position,
+        uint32_t light,
+        const glm::ivec2& tile,
+        uint16_t region
+    ) {
+        ChunkVertex vertex;
+        vertex.setPosition(position);
+        vertex.setLight(light);
+        for (int i = 0; i < 2; i++) {
+            vertex.tile[i] = static_cast<uint8_t>(tile[i] + 1);
+        }
+        vertex.uv[0] = region;
+        vertex.uv[1] = 0;
+        return vertex;
+    }
+
+    inline glm::vec3 getPosition() const {
+        return glm::vec3(position[0], position[1], position[2]) /
+                   CHUNK_POSITION_SCALE -
+               CHUNK_POSITION_OFFSET;
+    }
+
+    inline glm::vec2 getUV() const {
+        return glm::vec2(uv[0], uv[1]) / 65535.0f;
+    }
+
+    inline bool isMerged() const {
+        return tile[0] != 0;
+    }
+
+    inline glm::ivec2 getTile() const {
+        return glm::ivec2(tile[0] - 1, tile[1] - 1);
+    }
+
+    inline uint16_t getRegionIndex() const {
+        return uv[0];
+    }
+
+    inline glm::vec4 getLight() const {
+        return glm::vec4(light[0], light[1], light[2], light[3]) / 255.0f;
+    }
+private:
+    inline void setPosition(const glm::vec3& pos) {
+        for (int i = 0; i < 3; i++) {
+            float value = std::round(
+                (pos[i] + CHUNK_POSITION_OFFSET) * CHUNK_POSITION_SCALE
+            );
+            position[i] =
+                static_cast<uint16_t>(std::clamp(value, 0.0f, 65535.0f));
+        }
+    }
+
+    inline void setLight(uint32_t compressed) {
+        for (int i = 0; i < 4; i++) {
+            light[i] = (compressed >> (24 - i * 8)) & 0xFF;
+        }
+    }
+
+    static inline uint16_t normalize16(float value) {
+        return static_cast<uint16_t>(
+            std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f)
+        );
+    }
+};
+
+static_assert(sizeof(ChunkVertex) == 16);
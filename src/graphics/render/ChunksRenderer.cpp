@@ -1,11 +1,16 @@
 #include "ChunksRenderer.hpp"
 #include "BlocksRenderer.hpp"
+
+#include <GL/glew.h>
+
 #include "debug/Logger.hpp"
 #include "assets/Assets.hpp"
 #include "graphics/core/Mesh.hpp"
 #include "graphics/core/Shader.hpp"
 #include "graphics/core/Texture.hpp"
 #include "graphics/core/Atlas.hpp"
+#include "graphics/core/ImageData.hpp"
+#include "frontend/ContentGfxCache.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
 #include "world/Level.hpp"
@@ -86,6 +91,7 @@ ChunksRenderer::ChunksRenderer(
         settings.graphics.chunkMaxVertices.get(), 
         level->content, cache, settings
     );
+    regionsTexture = Texture::from(cache.createRegionsImage().get());
     logger.info() << "created " << threadPool.getWorkersCount() << " workers";
 }
 
@@ -93,7 +99,7 @@ ChunksRenderer::~ChunksRenderer() {
 }
 
 const Mesh* ChunksRenderer::render(
-    const std::shared_ptr<Chunk>& chunk, bool important
+    const std::shared_ptr<Chunk>& chunk, bool important, int priority
 ) {
     chunk->flags.modified = false;
     if (important) {
@@ -108,7 +114,7 @@ const Mesh* ChunksRenderer::render(
         return nullptr;
     }
     inwork[key] = true;
-    threadPool.enqueueJob(chunk);
+    threadPool.enqueueJob(chunk, priority);
     return nullptr;
 }
 
@@ -126,14 +132,14 @@ void ChunksRenderer::clear() {
 }
 
 const Mesh* ChunksRenderer::getOrRender(
-    const std::shared_ptr<Chunk>& chunk, bool important
+    const std::shared_ptr<Chunk>& chunk, bool important, int priority
 ) {
     auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
     if (found == meshes.end()) {
-        return render(chunk, important);
+        return render(chunk, important, priority);
     }
     if (chunk->flags.modified && chunk->flags.lighted) {
-        render(chunk, important);
+        render(chunk, important, priority);
     }
     return found->second.mesh.get();
 }
@@ -165,7 +171,10 @@ const Mesh* ChunksRenderer::retrieveChunk(
             (chunk->z + 0.5f) * CHUNK_D
         )
     );
-    auto mesh = getOrRender(chunk, distance < CHUNK_W * 1.5f);
+    // nearest chunks meshes are built first
+    auto mesh = getOrRender(
+        chunk, distance < CHUNK_W * 1.5f, -static_cast<int>(distance)
+    );
     if (mesh == nullptr) {
         return nullptr;
     }
@@ -188,6 +197,9 @@ void ChunksRenderer::drawChunks(
     const auto& atlas = assets.require<Atlas>("blocks");
 
     atlas.getTexture()->bind();
+    glActiveTexture(GL_TEXTURE2);
+    regionsTexture->bind();
+    glActiveTexture(GL_TEXTURE0);
     update();
 
     // [warning] this whole method is not thread-safe for chunks
@@ -234,14 +246,14 @@ void ChunksRenderer::drawChunks(
 }
 
 static inline void write_sorting_mesh_entries(
-    float* buffer, const std::vector<SortingMeshEntry>& chunkEntries
+    ChunkVertex* buffer, const std::vector<SortingMeshEntry>& chunkEntries
 ) {
     for (const auto& entry : chunkEntries) {
         const auto& vertexData = entry.vertexData;
         std::memcpy(
             buffer,
             vertexData.data(),
-            vertexData.size() * sizeof(float)
+            vertexData.size() * sizeof(ChunkVertex)
         );
         buffer += vertexData.size();
     }
@@ -259,7 +271,6 @@ void ChunksRenderer::drawSortedMeshes(const Camera& camera, Shader& shader) {
 
     shader.use();
     atlas.getTexture()->bind();
-    shader.uniformMatrix("u_model", glm::mat4(1.0f));
     shader.uniform1i("u_alphaClip", false);
     
     for (const auto& index : indices) {
@@ -285,12 +296,17 @@ void ChunksRenderer::drawSortedMeshes(const Camera& camera, Shader& shader) {
 
         auto& chunkEntries = found->second.sortingMeshData.entries;
 
+        glm::vec3 coord(
+            chunk->x * CHUNK_W + 0.5f, 0.5f, chunk->z * CHUNK_D + 0.5f
+        );
+        shader.uniformMatrix("u_model", glm::translate(glm::mat4(1.0f), coord));
+
         if (chunkEntries.size() == 1) {
             auto& entry = chunkEntries.at(0);
             if (found->second.sortedMesh == nullptr) {
                 found->second.sortedMesh = std::make_unique<Mesh>(
                     entry.vertexData.data(),
-                    entry.vertexData.size() / CHUNK_VERTEX_SIZE,
+                    entry.vertexData.size(),
                     CHUNK_VATTRS
                 );
             }
@@ -310,13 +326,13 @@ void ChunksRenderer::drawSortedMeshes(const Camera& camera, Shader& shader) {
                 size += entry.vertexData.size();
             }
 
-            static util::Buffer<float> buffer;
+            static util::Buffer<ChunkVertex> buffer;
             if (buffer.size() < size) {
-                buffer = util::Buffer<float>(size);
+                buffer = util::Buffer<ChunkVertex>(size);
             }
             write_sorting_mesh_entries(buffer.data(), chunkEntries);
             found->second.sortedMesh = std::make_unique<Mesh>(
-                buffer.data(), size / CHUNK_VERTEX_SIZE, CHUNK_VATTRS
+                buffer.data(), size, CHUNK_VATTRS
             );
         }
         found->second.sortedMesh->draw();
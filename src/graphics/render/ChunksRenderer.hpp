@@ -22,6 +22,7 @@ class Shader;
 class Assets;
 class Chunks;
 class Frustum;
+class Texture;
 class BlocksRenderer;
 class ContentGfxCache;
 struct EngineSettings;
@@ -48,6 +49,8 @@ class ChunksRenderer {
     const EngineSettings& settings;
 
     std::unique_ptr<BlocksRenderer> renderer;
+    /// @brief Merged faces tiling regions table (texture unit 2)
+    std::unique_ptr<Texture> regionsTexture;
     std::unordered_map<glm::ivec2, ChunkMesh> meshes;
     std::unordered_map<glm::ivec2, bool> inwork;
     std::vector<ChunksSortEntry> indices;
@@ -66,14 +69,16 @@ public:
     );
     virtual ~ChunksRenderer();
 
+    /// @param important build mesh immediately instead of a background job
+    /// @param priority background job priority, greater is earlier
     const Mesh* render(
-        const std::shared_ptr<Chunk>& chunk, bool important
+        const std::shared_ptr<Chunk>& chunk, bool important, int priority = 0
     );
     void unload(const Chunk* chunk);
     void clear();
 
     const Mesh* getOrRender(
-        const std::shared_ptr<Chunk>& chunk, bool important
+        const std::shared_ptr<Chunk>& chunk, bool important, int priority = 0
     );
     void drawChunks(const Camera& camera, Shader& shader);
 
@@ -126,6 +126,7 @@ void WorldRenderer::setupWorldShader(
     shader.uniform2f("u_lightDir", skybox->getLightDir());
     shader.uniform3f("u_cameraPos", camera.position);
     shader.uniform1i("u_cubemap", 1);
+    shader.uniform1i("u_regions", 2);
 
     auto indices = level.content.getIndices();
     // Light emission when an emissive item is chosen
@@ -4,19 +4,25 @@
 #include <memory>
 #include <glm/vec3.hpp>
 
+#include "ChunkVertex.hpp"
 #include "graphics/core/MeshData.hpp"
 #include "util/Buffer.hpp"
 
-/// @brief Chunk mesh vertex attributes
-inline const VertexAttribute CHUNK_VATTRS[]{ {3}, {2}, {1}, {0} };
-/// @brief Chunk mesh vertex size divided by sizeof(float)
-inline constexpr int CHUNK_VERTEX_SIZE = 6;
+/// @brief Chunk mesh vertex attributes: position, tile, uv or tiling region
+/// index, light (see ChunkVertex)
+inline const VertexAttribute CHUNK_VATTRS[] {
+    {3, VertexAttribute::Type::UINT16},
+    {2, VertexAttribute::Type::UINT8},
+    {2, VertexAttribute::Type::UINT16, true},
+    {4, VertexAttribute::Type::UINT8, true},
+    {0}
+};
 
 class Mesh;
 
 struct SortingMeshEntry {
     glm::vec3 position;
-    util::Buffer<float> vertexData;
+    util::Buffer<ChunkVertex> vertexData;
     long long distance;
 
     inline bool operator<(const SortingMeshEntry& o) const noexcept {
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Greedy meshing merges equal neighbour faces of a layer into rectangles.
+namespace greedy_meshing {
+    /// @brief Merged rectangle of cells [a, a + w) x [b, b + h)
+    struct Rect {
+        int a;
+        int b;
+        int w;
+        int h;
+        uint64_t key;
+    };
+
+    /// @brief Merge equal non-zero cells of 2D layer into rectangles.
+    /// Merged cells are set to zero.
+    /// @param cells layer origin cell pointer
+    /// @param width layer size along A axis
+    /// @param height layer size along B axis
+    /// @param strideA distance between neighbour cells along A axis
+    /// @param strideB distance between neighbour cells along B axis
+    /// @param emit rectangle consumer (const Rect&)
+    template <class Func>
+    inline void merge(
+        uint64_t* cells,
+        int width,
+        int height,
+        int strideA,
+        int strideB,
+        Func&& emit
+    ) {
+        for (int b = 0; b < height; b++) {
+            for (int a = 0; a < width; a++) {
+                uint64_t key = cells[a * strideA + b * strideB];
+                if (key == 0) {
+                    continue;
+                }
+                int w = 1;
+                while (a + w < width &&
+                       cells[(a + w) * strideA + b * strideB] == key) {
+                    w++;
+                }
+                int h = 1;
+                for (; b + h < height; h++) {
+                    uint64_t* row = cells + (b + h) * strideB;
+                    int i = 0;
+                    while (i < w && row[(a + i) * strideA] == key) {
+                        i++;
+                    }
+                    if (i < w) {
+                        break;
+                    }
+                }
+                for (int j = 0; j < h; j++) {
+                    uint64_t* row = cells + (b + j) * strideB;
+                    for (int i = 0; i < w; i++) {
+                        row[(a + i) * strideA] = 0;
+                    }
+                }
+                emit(Rect {a, b, w, h, key});
+                a += w - 1;
+            }
+        }
+    }
+}
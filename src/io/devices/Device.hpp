@@ -6,6 +6,7 @@
 #include <filesystem>
 
 #include "../path.hpp"
+#include "../mapped_file.hpp"
 
 namespace io {
     /// @brief Device interface for file system operations
@@ -24,6 +25,13 @@ namespace io {
         /// @throw std::runtime_error if file cannot be opened
         virtual std::unique_ptr<std::istream> read(std::string_view path) = 0;
 
+        /// @brief Map file to memory for reading
+        /// @throw std::runtime_error if file cannot be opened
+        /// @return nullptr if the device does not support memory mapping
+        virtual std::unique_ptr<mapped_file> map(std::string_view path) {
+            return nullptr;
+        }
+
         /// @brief Get file size in bytes
         virtual size_t size(std::string_view path) = 0;
 
@@ -80,6 +88,10 @@ namespace io {
             return parent->read((root / path).pathPart());
         }
 
+        std::unique_ptr<mapped_file> map(std::string_view path) override {
+            return parent->map((root / path).pathPart());
+        }
+
         size_t size(std::string_view path) override {
             return parent->size((root / path).pathPart());
         }
@@ -3,6 +3,7 @@
 #include <map>
 #include <stdint.h>
 #include <fstream>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -60,29 +61,67 @@ io::directory_iterator::directory_iterator(const io::path& folder)
     generator = device.list(folder.pathPart());
 }
 
-io::rafile::rafile(const io::path& filename)
-    : file(std::make_unique<std::ifstream>(io::resolve(filename), std::ios::binary | std::ios::ate)) {
-    if (!*file) {
-        throw std::runtime_error("could not to open file " + filename.string());
+io::rafile::rafile(const io::path& filename) {
+    auto& device = io::require_device(filename.entryPoint());
+    mapping = device.map(filename.pathPart());
+    if (mapping) {
+        filelength = mapping->length();
+        return;
     }
-    filelength = file->tellg();
-    file->seekg(0);
+    file = device.read(filename.pathPart());
+    filelength = device.size(filename.pathPart());
 }
 
 io::rafile::rafile(std::unique_ptr<std::istream> file, size_t length)
     : file(std::move(file)), filelength(length) {
 }
 
+io::rafile::~rafile() = default;
+
 size_t io::rafile::length() const {
     return filelength;
 }
 
 void io::rafile::seekg(std::streampos pos) {
-    file->seekg(pos);
+    if (mapping) {
+        position = static_cast<std::streamoff>(pos);
+    } else {
+        file->seekg(pos);
+    }
 }
 
 void io::rafile::read(char* buffer, std::streamsize size) {
+    if (mapping == nullptr) {
+        file->read(buffer, size);
+        return;
+    }
+    if (position > filelength ||
+        static_cast<size_t>(size) > filelength - position) {
+        throw std::runtime_error("read out of file bounds");
+    }
+    std::memcpy(buffer, mapping->data() + position, size);
+    position += size;
+}
+
+void io::rafile::read(size_t offset, char* buffer, size_t size) {
+    if (offset > filelength || size > filelength - offset) {
+        throw std::runtime_error("read out of file bounds");
+    }
+    if (mapping) {
+        std::memcpy(buffer, mapping->data() + offset, size);
+        return;
+    }
+    std::lock_guard lock(streamMutex);
+    file->clear();
+    file->seekg(offset);
     file->read(buffer, size);
+    if (!file->good()) {
+        throw std::runtime_error("could not read file");
+    }
+}
+
+const ubyte* io::rafile::data() const {
+    return mapping ? mapping->data() : nullptr;
 }
 
 bool io::write_bytes(
@@ -4,6 +4,7 @@
 #include <iterator>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -14,6 +15,7 @@
 
 namespace io {
     class Device;
+    class mapped_file;
 
     /// @brief Set device for the entry-point
     void set_device(const std::string& name, std::shared_ptr<Device> device);
@@ -35,17 +37,32 @@ namespace io {
         const std::string& name, const std::string& parent, const path& root
     );
 
-    /// @brief Read-only random access file
+    /// @brief Read-only random access file. Mapped to memory if the device
+    /// supports it, read as stream otherwise
     class rafile {
+        std::unique_ptr<mapped_file> mapping;
         std::unique_ptr<std::istream> file;
         size_t filelength;
+        /// @brief Read position of mapped file
+        size_t position = 0;
+        /// @brief Stream mutex of positional reads
+        std::mutex streamMutex;
     public:
         rafile(const path& filename);
         rafile(std::unique_ptr<std::istream> file, size_t length);
+        ~rafile();
 
         void seekg(std::streampos pos);
+        /// @throw std::runtime_error on read out of mapped file bounds
         void read(char* buffer, std::streamsize size);
+        /// @brief Positional read not changing the read position. Safe to
+        /// call from multiple threads (stream reads are serialized)
+        /// @throw std::runtime_error on read out of file bounds
+        void read(size_t offset, char* buffer, size_t size);
         size_t length() const;
+
+        /// @return mapped file content or nullptr if file is read as stream
+        const ubyte* data() const;
     };
 
     class directory_iterator_impl {
@@ -0,0 +1,114 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace io;
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::filesystem::path& filename) {
+    // region files are written by other handles while open for reading
+    HANDLE file = CreateFileW(
+        filename.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(
+            "could not to open file " + filename.u8string()
+        );
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error(
+            "could not get file size " + filename.u8string()
+        );
+    }
+    filelength = static_cast<size_t>(size.QuadPart);
+    fileHandle = file;
+    if (filelength == 0) {
+        return;
+    }
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("could not map file " + filename.u8string());
+    }
+    mappingHandle = mapping;
+    bytes = static_cast<const ubyte*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+    );
+    if (bytes == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("could not map file " + filename.u8string());
+    }
+}
+
+mapped_file::~mapped_file() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+}
+
+#else  // _WIN32
+
+mapped_file::mapped_file(const std::filesystem::path& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error(
+            "could not to open file " + filename.u8string()
+        );
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error(
+            "could not get file size " + filename.u8string()
+        );
+    }
+    filelength = static_cast<size_t>(info.st_size);
+    if (filelength == 0) {
+        close(fd);
+        return;
+    }
+    void* address = mmap(nullptr, filelength, PROT_READ, MAP_SHARED, fd, 0);
+    // mapping stays valid after the descriptor is closed
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("could not map file " + filename.u8string());
+    }
+    bytes = static_cast<const ubyte*>(address);
+}
+
+mapped_file::~mapped_file() {
+    if (bytes) {
+        munmap(const_cast<ubyte*>(bytes), filelength);
+    }
+}
+
+#endif  // _WIN32
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+
+#include "typedefs.hpp"
+
+namespace io {
+    /// @brief Read-only file mapped to memory
+    class mapped_file {
+        const ubyte* bytes = nullptr;
+        size_t filelength = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    public:
+        /// @throw std::runtime_error if file cannot be opened or mapped
+        mapped_file(const std::filesystem::path& filename);
+        mapped_file(const mapped_file&) = delete;
+        ~mapped_file();
+
+        /// @return file content, nullptr if file is empty
+        const ubyte* data() const {
+            return bytes;
+        }
+
+        size_t length() const {
+            return filelength;
+        }
+    };
+}
@@ -64,11 +64,23 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("load-distance", &settings.chunks.loadDistance);
     builder.add("load-speed", &settings.chunks.loadSpeed);
     builder.add("padding", &settings.chunks.padding);
+    builder.add("generator-workers", &settings.chunks.generatorWorkers);
+    builder.add("lighting-workers", &settings.chunks.lightingWorkers);
+    builder.add("generator-cache-size", &settings.chunks.generatorCacheSize);
+    builder.add("regions-cache-size", &settings.chunks.regionsCacheSize);
+    builder.add("region-files-limit", &settings.chunks.regionFilesLimit);
+    builder.add("voxels-codec", &settings.chunks.voxelsCodec);
+    builder.add("lights-codec", &settings.chunks.lightsCodec);
+    builder.add("voxels-dictionary", &settings.chunks.voxelsDictionary);
+
+    builder.section("physics");
+    builder.add("workers", &settings.physics.workers);
 
     builder.section("graphics");
     builder.add("fog-curve", &settings.graphics.fogCurve);
     builder.add("backlight", &settings.graphics.backlight);
     builder.add("dense-render", &settings.graphics.denseRender);
+    builder.add("greedy-meshing", &settings.graphics.greedyMeshing);
     builder.add("gamma", &settings.graphics.gamma);
     builder.add("frustum-culling", &settings.graphics.frustumCulling);
     builder.add("skybox-resolution", &settings.graphics.skyboxResolution);
@@ -8,6 +8,41 @@
 #include "voxels/Chunk.hpp"
 #include "voxels/voxel.hpp"
 #include "voxels/Block.hpp"
+#include "maths/voxmaths.hpp"
+
+namespace {
+    /// @brief Lazily filled snapshot of the 3x3 chunks area map cells
+    /// around the center chunk
+    class ChunksNeighbourhood {
+        const Chunks& chunks;
+        Chunk* cells[9] {};
+        int centerX = 0;
+        int centerZ = 0;
+        uint16_t fetched = 0;
+    public:
+        ChunksNeighbourhood(const Chunks& chunks) : chunks(chunks) {}
+
+        /// @brief Get chunk by chunk coordinates. Area is moved to the
+        /// requested chunk if it is out of the current one
+        Chunk* get(int cx, int cz) {
+            int dx = cx - centerX + 1;
+            int dz = cz - centerZ + 1;
+            if (dx < 0 || dx > 2 || dz < 0 || dz > 2) {
+                centerX = cx;
+                centerZ = cz;
+                fetched = 0;
+                dx = 1;
+                dz = 1;
+            }
+            int index = dz * 3 + dx;
+            if (!(fetched & (1 << index))) {
+                cells[index] = chunks.getChunk(cx, cz);
+                fetched |= 1 << index;
+            }
+            return cells[index];
+        }
+    };
+}
 
 LightSolver::LightSolver(const ContentIndices& contentIds, Chunks& chunks, int channel) 
     : blockDefs(contentIds.blocks.getDefs()),
@@ -47,7 +82,15 @@ void LightSolver::remove(int x, int y, int z) {
     chunk->lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, 0);
 }
 
-void LightSolver::solve(){
+void LightSolver::solve() {
+    if (chunkLocal) {
+        solveChunkLocal();
+    } else {
+        solveGeneric();
+    }
+}
+
+void LightSolver::solveGeneric() {
     const int coords[] = {
             0, 0, 1,
             0, 0,-1,
@@ -75,7 +118,7 @@ void LightSolver::solve(){
 
                 ubyte light = chunk->lightmap.get(lx,y,lz, channel);
                 if (light != 0 && light == entry.light-1){
-                    voxel* vox = chunks.get(x, y, z);
+                    const voxel* vox = chunks.get(x, y, z);
                     if (vox && vox->id != 0) {
                         const Block* block = blockDefs[vox->id];
                         if (uint8_t emission = block->emission[channel]) {
@@ -111,7 +154,7 @@ void LightSolver::solve(){
                 chunk->flags.modified = true;
 
                 ubyte light = chunk->lightmap.get(lx, y, lz, channel);
-                voxel& v = chunk->voxels[vox_index(lx, y, lz)];
+                const voxel& v = chunk->voxels[vox_index(lx, y, lz)];
                 const Block* block = blockDefs[v.id];
                 if (block->lightPassing && light+2 <= entry.light){
                     chunk->lightmap.set(
@@ -124,3 +167,123 @@ void LightSolver::solve(){
         }
     }
 }
+
+void LightSolver::solveChunkLocal() {
+    const int coords[] = {
+            0, 0, 1,
+            0, 0,-1,
+            0, 1, 0,
+            0,-1, 0,
+            1, 0, 0,
+           -1, 0, 0
+    };
+    const int shift = channel << 2;
+    const light_t mask = ~(0xF << shift);
+
+    ChunksNeighbourhood area(chunks);
+
+    // resolves neighbour voxel of the entry chunk,
+    // lx, lz are converted to the target chunk local coordinates
+    auto neighbour = [&area](Chunk* chunk, int& lx, int& lz) -> Chunk* {
+        if (lx >= 0 && lx < CHUNK_W && lz >= 0 && lz < CHUNK_D) {
+            return chunk;
+        }
+        int cx = chunk->x + floordiv<CHUNK_W>(lx);
+        int cz = chunk->z + floordiv<CHUNK_D>(lz);
+        lx -= (cx - chunk->x) * CHUNK_W;
+        lz -= (cz - chunk->z) * CHUNK_D;
+        return area.get(cx, cz);
+    };
+
+    while (!remqueue.empty()) {
+        const lightentry entry = remqueue.front();
+        remqueue.pop();
+
+        Chunk* chunk = area.get(
+            floordiv<CHUNK_W>(entry.x), floordiv<CHUNK_D>(entry.z)
+        );
+        if (chunk == nullptr) {
+            continue;
+        }
+        int elx = entry.x - chunk->x * CHUNK_W;
+        int elz = entry.z - chunk->z * CHUNK_D;
+
+        for (int i = 0; i < 6; i++) {
+            int imul3 = i*3;
+            int y = entry.y+coords[imul3+1];
+            if (y < 0 || y >= CHUNK_H) {
+                continue;
+            }
+            int lx = elx+coords[imul3];
+            int lz = elz+coords[imul3+2];
+            Chunk* target = neighbour(chunk, lx, lz);
+            if (target == nullptr) {
+                continue;
+            }
+            target->flags.modified = true;
+
+            uint index = vox_index(lx, y, lz);
+            light_t& value = target->lightmap.map[index];
+            ubyte light = (value >> shift) & 0xF;
+            if (light != 0 && light == entry.light-1) {
+                int x = entry.x+coords[imul3];
+                int z = entry.z+coords[imul3+2];
+                const voxel& vox = target->voxels[index];
+                uint8_t emission = 0;
+                if (vox.id != 0) {
+                    emission = blockDefs[vox.id]->emission[channel];
+                }
+                if (emission) {
+                    addqueue.push(lightentry {x, y, z, emission});
+                }
+                value = (value & mask) | (emission << shift);
+                remqueue.push(lightentry {x, y, z, light});
+            } else if (light >= entry.light) {
+                int x = entry.x+coords[imul3];
+                int z = entry.z+coords[imul3+2];
+                addqueue.push(lightentry {x, y, z, light});
+            }
+        }
+    }
+
+    while (!addqueue.empty()) {
+        const lightentry entry = addqueue.front();
+        addqueue.pop();
+
+        Chunk* chunk = area.get(
+            floordiv<CHUNK_W>(entry.x), floordiv<CHUNK_D>(entry.z)
+        );
+        if (chunk == nullptr) {
+            continue;
+        }
+        int elx = entry.x - chunk->x * CHUNK_W;
+        int elz = entry.z - chunk->z * CHUNK_D;
+        light_t next = entry.light - 1;
+
+        for (int i = 0; i < 6; i++) {
+            int imul3 = i*3;
+            int y = entry.y+coords[imul3+1];
+            if (y < 0 || y >= CHUNK_H) {
+                continue;
+            }
+            int lx = elx+coords[imul3];
+            int lz = elz+coords[imul3+2];
+            Chunk* target = neighbour(chunk, lx, lz);
+            if (target == nullptr) {
+                continue;
+            }
+            target->flags.modified = true;
+
+            uint index = vox_index(lx, y, lz);
+            light_t& value = target->lightmap.map[index];
+            const Block* block = blockDefs[target->voxels[index].id];
+            ubyte light = (value >> shift) & 0xF;
+            if (block->lightPassing && light+2 <= entry.light) {
+                int x = entry.x+coords[imul3];
+                int z = entry.z+coords[imul3+2];
+                value = (value & mask) | (next << shift);
+                addqueue.push(lightentry {x, y, z, ubyte(next)});
+            }
+        }
+    }
+}
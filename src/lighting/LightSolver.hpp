@@ -2,6 +2,7 @@
 
 #include <queue>
 
+class Chunk;
 class Chunks;
 class ContentIndices;
 class Block;
@@ -19,6 +20,10 @@ class LightSolver {
     const Block* const* blockDefs;
     Chunks& chunks;
     int channel;
+    bool chunkLocal = true;
+
+    void solveGeneric();
+    void solveChunkLocal();
 public:
     LightSolver(const ContentIndices& contentIds, Chunks& chunks, int channel);
 
@@ -26,4 +31,13 @@ public:
     void add(int x, int y, int z, int emission);
     void remove(int x, int y, int z);
     void solve();
+
+    /// @brief Enable or disable chunk-local mode (enabled by default).
+    /// In chunk-local mode neighbour voxels are accessed via pointers to
+    /// the 3x3 chunks around the current one, so Chunks area map lookup
+    /// is only performed when a column border is crossed.
+    /// Both modes produce the same result.
+    void setChunkLocal(bool flag) {
+        chunkLocal = flag;
+    }
 };
@@ -1,5 +1,6 @@
 #include "Lighting.hpp"
 #include "LightSolver.hpp"
+#include "ParallelLightSolver.hpp"
 #include "Lightmap.hpp"
 #include "content/Content.hpp"
 #include "voxels/Chunks.hpp"
@@ -8,19 +9,27 @@
 #include "voxels/Block.hpp"
 #include "constants.hpp"
 #include "util/timeutil.hpp"
+#include "util/WorkerGroup.hpp"
 #include "debug/Logger.hpp"
 
 #include <memory>
 
 static debug::Logger logger("lighting");
 
-Lighting::Lighting(const Content& content, Chunks& chunks) 
+Lighting::Lighting(const Content& content, Chunks& chunks, uint workersCount)
   : content(content), chunks(chunks) {
     auto& indices = *content.getIndices();
     solverR = std::make_unique<LightSolver>(indices, chunks, 0);
     solverG = std::make_unique<LightSolver>(indices, chunks, 1);
     solverB = std::make_unique<LightSolver>(indices, chunks, 2);
     solverS = std::make_unique<LightSolver>(indices, chunks, 3);
+    if (workersCount > 1) {
+        workers = std::make_unique<util::WorkerGroup>(workersCount);
+        parallelSolver = std::make_unique<ParallelLightSolver>(
+            indices, chunks, *workers
+        );
+        logger.info() << "created " << workersCount << " lighting workers";
+    }
 }
 
 Lighting::~Lighting() = default;
@@ -40,13 +49,33 @@ void Lighting::clear(){
 
 void Lighting::prebuildSkyLight(Chunk& chunk, const ContentIndices& indices){
     const auto* blockDefs = indices.blocks.getDefs();
+    const auto& voxels = chunk.voxels;
+
+    // upper uniform sky light passing sections are lighted entirely
+    int skySections = 0;
+    for (int s = CHUNK_SECTIONS - 1; s >= 0; s--, skySections++) {
+        const Block* def = nullptr;
+        if (voxels.isEmpty(s)) {
+            def = blockDefs[BLOCK_AIR];
+        } else if (voxels.isUniform(s)) {
+            def = blockDefs[voxels.getFill(s).id];
+        }
+        if (def == nullptr || !def->skyLightPassing) {
+            break;
+        }
+    }
+    int skyBottom = CHUNK_H - skySections * CHUNK_SECTION_H;
+    light_t* lights = chunk.lightmap.getLightsWriteable();
+    for (uint i = skyBottom * CHUNK_W * CHUNK_D; i < CHUNK_VOL; i++) {
+        lights[i] = (lights[i] & 0x0FFF) | 0xF000;
+    }
 
     int highestPoint = 0;
     for (int z = 0; z < CHUNK_D; z++){
         for (int x = 0; x < CHUNK_W; x++){
-            for (int y = CHUNK_H-1; y >= 0; y--){
+            for (int y = skyBottom-1; y >= 0; y--){
                 int index = (y * CHUNK_D + z) * CHUNK_W + x;
-                voxel& vox = chunk.voxels[index];
+                const voxel& vox = voxels[index];
                 const Block* block = blockDefs[vox.id];
                 if (!block->skyLightPassing) {
                     if (highestPoint < y)
@@ -62,14 +91,12 @@ void Lighting::prebuildSkyLight(Chunk& chunk, const ContentIndices& indices){
     chunk.lightmap.highestPoint = highestPoint;
 }
 
-void Lighting::buildSkyLight(int cx, int cz){
-    const auto blockDefs = content.getIndices()->blocks.getDefs();
-
-    Chunk* chunk = chunks.getChunk(cx, cz);
-    if (chunk == nullptr) {
-        logger.error() << "attempted to build sky lights to chunk missing in local matrix";
-        return;
-    }
+template <class Func>
+static void build_sky_light(
+    const Block* const* blockDefs, Chunk* chunk, Func&& addS
+) {
+    int cx = chunk->x;
+    int cz = chunk->z;
     for (int z = 0; z < CHUNK_D; z++){
         for (int x = 0; x < CHUNK_W; x++){
             int gx = x + cx * CHUNK_W;
@@ -79,33 +106,48 @@ void Lighting::buildSkyLight(int cx, int cz){
                     y--;
                 }
                 if (chunk->lightmap.getS(x, y, z) != 15) {
-                    solverS->add(gx,y+1,gz);
+                    addS(gx,y+1,gz);
                     for (; y >= 0; y--){
-                        solverS->add(gx+1,y,gz);
-                        solverS->add(gx-1,y,gz);
-                        solverS->add(gx,y,gz+1);
-                        solverS->add(gx,y,gz-1);
+                        addS(gx+1,y,gz);
+                        addS(gx-1,y,gz);
+                        addS(gx,y,gz+1);
+                        addS(gx,y,gz-1);
                     }
                 }
             }
         }
     }
-    solverS->solve();
 }
 
+void Lighting::buildSkyLight(int cx, int cz){
+    const auto blockDefs = content.getIndices()->blocks.getDefs();
 
-void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
-    auto& solverR = *this->solverR;
-    auto& solverG = *this->solverG;
-    auto& solverB = *this->solverB;
-    auto& solverS = *this->solverS;
-
-    auto blockDefs = content.getIndices()->blocks.getDefs();
-    auto chunk = chunks.getChunk(cx, cz);
+    Chunk* chunk = chunks.getChunk(cx, cz);
     if (chunk == nullptr) {
-        logger.error() << "attempted to build lights to chunk missing in local matrix";
+        logger.error() << "attempted to build sky lights to chunk missing in local matrix";
         return;
     }
+    if (parallelSolver) {
+        auto& solver = *parallelSolver;
+        build_sky_light(blockDefs, chunk, [&solver](int x, int y, int z) {
+            solver.add(x, y, z, 3);
+        });
+        solver.solve();
+        return;
+    }
+    auto& solverS = *this->solverS;
+    build_sky_light(blockDefs, chunk, [&solverS](int x, int y, int z) {
+        solverS.add(x, y, z);
+    });
+    solverS.solve();
+}
+
+template <class Func>
+static void add_chunk_lights(
+    const Block* const* blockDefs, Chunk* chunk, bool expand, Func&& add
+) {
+    int cx = chunk->x;
+    int cz = chunk->z;
     for (uint y = 0; y < CHUNK_H; y++){
         for (uint z = 0; z < CHUNK_D; z++){
             for (uint x = 0; x < CHUNK_W; x++){
@@ -114,9 +156,9 @@ void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
                 int gx = x + cx * CHUNK_W;
                 int gz = z + cz * CHUNK_D;
                 if (block->rt.emissive){
-                    solverR.add(gx,y,gz,block->emission[0]);
-                    solverG.add(gx,y,gz,block->emission[1]);
-                    solverB.add(gx,y,gz,block->emission[2]);
+                    add(gx,y,gz,0,block->emission[0]);
+                    add(gx,y,gz,1,block->emission[1]);
+                    add(gx,y,gz,2,block->emission[2]);
                 }
             }
         }
@@ -130,10 +172,10 @@ void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
                     int gz = z + cz * CHUNK_D;
                     int rgbs = chunk->lightmap.get(x, y, z);
                     if (rgbs){
-                        solverR.add(gx,y,gz, Lightmap::extract(rgbs, 0));
-                        solverG.add(gx,y,gz, Lightmap::extract(rgbs, 1));
-                        solverB.add(gx,y,gz, Lightmap::extract(rgbs, 2));
-                        solverS.add(gx,y,gz, Lightmap::extract(rgbs, 3));
+                        add(gx,y,gz,0, Lightmap::extract(rgbs, 0));
+                        add(gx,y,gz,1, Lightmap::extract(rgbs, 1));
+                        add(gx,y,gz,2, Lightmap::extract(rgbs, 2));
+                        add(gx,y,gz,3, Lightmap::extract(rgbs, 3));
                     }
                 }
             }
@@ -145,19 +187,44 @@ void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
                     int gz = z + cz * CHUNK_D;
                     int rgbs = chunk->lightmap.get(x, y, z);
                     if (rgbs){
-                        solverR.add(gx,y,gz, Lightmap::extract(rgbs, 0));
-                        solverG.add(gx,y,gz, Lightmap::extract(rgbs, 1));
-                        solverB.add(gx,y,gz, Lightmap::extract(rgbs, 2));
-                        solverS.add(gx,y,gz, Lightmap::extract(rgbs, 3));
+                        add(gx,y,gz,0, Lightmap::extract(rgbs, 0));
+                        add(gx,y,gz,1, Lightmap::extract(rgbs, 1));
+                        add(gx,y,gz,2, Lightmap::extract(rgbs, 2));
+                        add(gx,y,gz,3, Lightmap::extract(rgbs, 3));
                     }
                 }
             }
         }
     }
-    solverR.solve();
-    solverG.solve();
-    solverB.solve();
-    solverS.solve();
+}
+
+void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
+    auto blockDefs = content.getIndices()->blocks.getDefs();
+    auto chunk = chunks.getChunk(cx, cz);
+    if (chunk == nullptr) {
+        logger.error() << "attempted to build lights to chunk missing in local matrix";
+        return;
+    }
+    if (parallelSolver) {
+        auto& solver = *parallelSolver;
+        add_chunk_lights(blockDefs, chunk, expand,
+        [&solver](int x, int y, int z, int channel, int emission) {
+            solver.add(x, y, z, channel, emission);
+        });
+        solver.solve();
+        return;
+    }
+    LightSolver* solvers[] {
+        solverR.get(), solverG.get(), solverB.get(), solverS.get()
+    };
+    add_chunk_lights(blockDefs, chunk, expand,
+    [&solvers](int x, int y, int z, int channel, int emission) {
+        solvers[channel]->add(x, y, z, emission);
+    });
+    solverR->solve();
+    solverG->solve();
+    solverB->solve();
+    solverS->solve();
 }
 
 void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
@@ -172,7 +239,7 @@ void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
         solverB->solve();
         if (chunks.getLight(x,y+1,z, 3) == 0xF){
             for (int i = y; i >= 0; i--){
-                voxel* vox = chunks.get(x,i,z);
+                const voxel* vox = chunks.get(x,i,z);
                 if ((vox == nullptr || vox->id != 0) && block.skyLightPassing)
                     break;
                 solverS->add(x,i,z, 0xF);
@@ -7,6 +7,11 @@ class ContentIndices;
 class Chunk;
 class Chunks;
 class LightSolver;
+class ParallelLightSolver;
+
+namespace util {
+    class WorkerGroup;
+}
 
 class Lighting {
     const Content& content;
@@ -15,8 +20,12 @@ class Lighting {
     std::unique_ptr<LightSolver> solverG;
     std::unique_ptr<LightSolver> solverB;
     std::unique_ptr<LightSolver> solverS;
+    /// @brief Used for chunk loading floods if workers count is greater than 1
+    std::unique_ptr<util::WorkerGroup> workers;
+    std::unique_ptr<ParallelLightSolver> parallelSolver;
 public:
-    Lighting(const Content& content, Chunks& chunks);
+    /// @param workersCount number of threads used to build chunk lights
+    Lighting(const Content& content, Chunks& chunks, uint workersCount = 1);
     ~Lighting();
 
     void clear();
@@ -0,0 +1,164 @@
+#include "ParallelLightSolver.hpp"
+
+#include <atomic>
+
+#include "Lightmap.hpp"
+#include "content/Content.hpp"
+#include "util/WorkerGroup.hpp"
+#include "voxels/Chunks.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/voxel.hpp"
+#include "voxels/Block.hpp"
+
+// Channels of a voxel share the same light_t, so nibbles owned by different
+// workers are modified with atomic operations.
+static_assert(sizeof(std::atomic<light_t>) == sizeof(light_t));
+static_assert(std::atomic<light_t>::is_always_lock_free);
+
+static inline std::atomic<light_t>& as_atomic(light_t& value) {
+    return *reinterpret_cast<std::atomic<light_t>*>(&value);
+}
+
+ParallelLightSolver::ParallelLightSolver(
+    const ContentIndices& contentIds, Chunks& chunks, util::WorkerGroup& workers
+)
+    : blockDefs(contentIds.blocks.getDefs()),
+      chunks(chunks),
+      workers(workers),
+      states(workers.size()) {
+    for (auto& state : states) {
+        state.outbox.resize(workers.size());
+    }
+}
+
+ParallelLightSolver::~ParallelLightSolver() = default;
+
+uint ParallelLightSolver::getOwner(int cx, int cz, int channel) const {
+    // each (column, channel) pair has a single owner, so no light channel
+    // is written by two workers. Neighbour columns (diagonal included) of
+    // a channel have different owners only if there are 4+ workers
+    return ((cx & 1) | ((cz & 1) << 1) | (channel << 2)) % states.size();
+}
+
+void ParallelLightSolver::add(int x, int y, int z, int channel, int emission) {
+    if (emission <= 1)
+        return;
+    Chunk* chunk = chunks.getChunkByVoxel(x, y, z);
+    if (chunk == nullptr)
+        return;
+    int lx = x - chunk->x * CHUNK_W;
+    int lz = z - chunk->z * CHUNK_D;
+    ubyte light = chunk->lightmap.get(lx, y, lz, channel);
+    if (emission < light) return;
+
+    auto& state = states[getOwner(chunk->x, chunk->z, channel)];
+    state.addqueue.push(
+        channelentry {x, y, z, ubyte(emission), ubyte(channel)}
+    );
+    chunk->flags.modified = true;
+    chunk->lightmap.set(lx, y, lz, channel, emission);
+}
+
+void ParallelLightSolver::add(int x, int y, int z, int channel) {
+    add(x, y, z, channel, chunks.getLight(x, y, z, channel));
+}
+
+void ParallelLightSolver::visit(
+    WorkerState& state, Chunk& chunk, const channelentry& entry
+) const {
+    if (state.modified.empty() || state.modified.back() != &chunk) {
+        state.modified.push_back(&chunk);
+    }
+    int lx = entry.x - chunk.x * CHUNK_W;
+    int lz = entry.z - chunk.z * CHUNK_D;
+    uint index = vox_index(lx, entry.y, lz);
+
+    const Block* block = blockDefs[chunk.voxels[index].id];
+    if (!block->lightPassing) {
+        return;
+    }
+    auto& value = as_atomic(chunk.lightmap.getLightsWriteable()[index]);
+    int shift = entry.channel << 2;
+    light_t prev = value.load(std::memory_order_relaxed);
+    if (((prev >> shift) & 0xF) + 2 > entry.light) {
+        return;
+    }
+    light_t mask = ~(0xF << shift);
+    light_t next = entry.light - 1;
+    while (!value.compare_exchange_weak(
+        prev, (prev & mask) | (next << shift), std::memory_order_relaxed
+    ));
+    state.addqueue.push(
+        channelentry {entry.x, entry.y, entry.z, ubyte(next), entry.channel}
+    );
+}
+
+void ParallelLightSolver::process(uint index) {
+    const int coords[] = {
+            0, 0, 1,
+            0, 0,-1,
+            0, 1, 0,
+            0,-1, 0,
+            1, 0, 0,
+           -1, 0, 0
+    };
+    auto& state = states[index];
+    for (const auto& entry : state.inbox) {
+        Chunk* chunk = chunks.getChunkByVoxel(entry.x, entry.y, entry.z);
+        visit(state, *chunk, entry);
+    }
+    state.inbox.clear();
+
+    auto& addqueue = state.addqueue;
+    while (!addqueue.empty()) {
+        const channelentry entry = addqueue.front();
+        addqueue.pop();
+
+        for (int i = 0; i < 6; i++) {
+            int imul3 = i*3;
+            int x = entry.x+coords[imul3];
+            int y = entry.y+coords[imul3+1];
+            int z = entry.z+coords[imul3+2];
+
+            Chunk* chunk = chunks.getChunkByVoxel(x, y, z);
+            if (chunk == nullptr) {
+                continue;
+            }
+            channelentry next {x, y, z, entry.light, entry.channel};
+            uint owner = getOwner(chunk->x, chunk->z, entry.channel);
+            if (owner == index) {
+                visit(state, *chunk, next);
+            } else {
+                state.outbox[owner].push_back(next);
+            }
+        }
+    }
+}
+
+void ParallelLightSolver::solve() {
+    bool pending = true;
+    while (pending) {
+        workers.run([this](uint index) {
+            process(index);
+        });
+        pending = false;
+        for (auto& state : states) {
+            for (uint i = 0; i < states.size(); i++) {
+                auto& outbox = state.outbox[i];
+                if (outbox.empty()) {
+                    continue;
+                }
+                auto& inbox = states[i].inbox;
+                inbox.insert(inbox.end(), outbox.begin(), outbox.end());
+                outbox.clear();
+                pending = true;
+            }
+        }
+    }
+    for (auto& state : states) {
+        for (auto chunk : state.modified) {
+            chunk->flags.modified = true;
+        }
+        state.modified.clear();
+    }
+}
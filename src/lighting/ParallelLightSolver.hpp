@@ -0,0 +1,63 @@
+#pragma once
+
+#include <queue>
+#include <vector>
+
+#include "typedefs.hpp"
+
+class Chunk;
+class Chunks;
+class ContentIndices;
+class Block;
+
+namespace util {
+    class WorkerGroup;
+}
+
+/// @brief Light propagation solver distributing flood fill over workers.
+/// Each pair (chunk column, channel) is owned by a single worker, so all
+/// channels and neighbour columns are solved concurrently. Entries crossing
+/// column border are passed to the owner worker between rounds.
+/// Only light addition is supported (use LightSolver to remove lights).
+class ParallelLightSolver {
+    struct channelentry {
+        int x;
+        int y;
+        int z;
+        ubyte light;
+        ubyte channel;
+    };
+
+    struct WorkerState {
+        std::queue<channelentry> addqueue;
+        /// @brief Neighbour visits received from other workers
+        std::vector<channelentry> inbox;
+        /// @brief Neighbour visits for other workers (index is worker)
+        std::vector<std::vector<channelentry>> outbox;
+        std::vector<Chunk*> modified;
+    };
+
+    const Block* const* blockDefs;
+    Chunks& chunks;
+    util::WorkerGroup& workers;
+    std::vector<WorkerState> states;
+
+    uint getOwner(int cx, int cz, int channel) const;
+
+    void visit(
+        WorkerState& state, Chunk& chunk, const channelentry& entry
+    ) const;
+
+    void process(uint index);
+public:
+    ParallelLightSolver(
+        const ContentIndices& contentIds,
+        Chunks& chunks,
+        util::WorkerGroup& workers
+    );
+    ~ParallelLightSolver();
+
+    void add(int x, int y, int z, int channel);
+    void add(int x, int y, int z, int channel, int emission);
+    void solve();
+};
@@ -1,11 +1,13 @@
 #include "BlocksController.hpp"
 
+#include <algorithm>
 #include <set>
 
 #include "content/Content.hpp"
 #include "items/Inventories.hpp"
 #include "items/Inventory.hpp"
 #include "lighting/Lighting.hpp"
+#include "maths/aabb.hpp"
 #include "maths/fastmaths.hpp"
 #include "scripting/scripting.hpp"
 #include "util/timeutil.hpp"
@@ -16,6 +18,7 @@
 #include "voxels/blocks_agent.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
+#include "objects/Entities.hpp"
 #include "objects/Player.hpp"
 #include "objects/Players.hpp"
 
@@ -29,6 +32,9 @@ BlocksController::BlocksController(const Level& level, Lighting* lighting)
 }
 
 void BlocksController::updateSides(int x, int y, int z) {
+    glm::vec3 pos(x, y, z);
+    level.entities->wakeUp(AABB(pos - 1.0f, pos + 2.0f));
+
     updateBlock(x - 1, y, z);
     updateBlock(x + 1, y, z);
     updateBlock(x, y - 1, z);
@@ -38,12 +44,17 @@ void BlocksController::updateSides(int x, int y, int z) {
 }
 
 void BlocksController::updateSides(int x, int y, int z, int w, int h, int d) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     const auto& rot = def.rotations.variants[vox->state.rotation];
     const auto& xaxis = rot.axes[0];
     const auto& yaxis = rot.axes[1];
     const auto& zaxis = rot.axes[2];
+
+    glm::vec3 pos(x, y, z);
+    float size = std::max(w, std::max(h, d));
+    level.entities->wakeUp(AABB(pos - size - 1.0f, pos + size + 2.0f));
+
     for (int ly = -1; ly <= h; ly++) {
         for (int lz = -1; lz <= d; lz++) {
             for (int lx = -1; lx <= w; lx++) {
@@ -104,7 +115,7 @@ void BlocksController::placeBlock(
 }
 
 void BlocksController::updateBlock(int x, int y, int z) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     if (vox == nullptr) return;
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     if (def.grounded) {
@@ -148,8 +159,30 @@ void BlocksController::randomTick(
     const Chunk& chunk, int segments, const ContentIndices* indices
 ) {
     const int segheight = CHUNK_H / segments;
+    const auto& voxels = chunk.voxels;
+
+    // empty or uniform section of a block without random update
+    auto isInert = [&voxels, indices](int section) {
+        blockid_t id;
+        if (voxels.isEmpty(section)) {
+            id = BLOCK_AIR;
+        } else if (voxels.isUniform(section)) {
+            id = voxels.getFill(section).id;
+        } else {
+            return false;
+        }
+        return !indices->blocks.require(id).rt.funcsset.randupdate;
+    };
 
     for (int s = 0; s < segments; s++) {
+        bool inert = true;
+        for (int y = s * segheight; y < (s + 1) * segheight && inert;
+             y += CHUNK_SECTION_H) {
+            inert = isInert(y / CHUNK_SECTION_H);
+        }
+        if (inert) {
+            continue;
+        }
         for (int i = 0; i < 4; i++) {
             int bx = random.rand() % CHUNK_W;
             int by = random.rand() % segheight + s * segheight;
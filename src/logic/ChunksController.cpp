@@ -1,5 +1,6 @@
 #include "ChunksController.hpp"
 
+#include <algorithm>
 #include <limits.h>
 #include <memory>
 
@@ -9,7 +10,11 @@
 #include "lighting/Lighting.hpp"
 #include "maths/voxmaths.hpp"
 #include "util/timeutil.hpp"
+#include "util/WorkerGroup.hpp"
+#include "window/Camera.hpp"
 #include "objects/Player.hpp"
+#include "objects/Players.hpp"
+#include "settings.hpp"
 #include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
@@ -20,34 +25,112 @@
 
 const uint MAX_WORK_PER_FRAME = 128;
 const uint MIN_SURROUNDING = 9;
+/// @brief Max number of saved chunks decompressed at once
+const uint LOAD_BATCH_SIZE = 16;
+/// @brief Player movement prediction time in seconds
+const float PREFETCH_TIME = 2.0f;
+/// @brief Max number of chunks in a prediction prefetch request
+const uint PREFETCH_CHUNKS = 32;
 
-ChunksController::ChunksController(Level& level)
+class GeneratorWorker : public util::Worker<GeneratorJob, GeneratorResult> {
+    const WorldGenerator& generator;
+public:
+    GeneratorWorker(const WorldGenerator& generator) : generator(generator) {
+    }
+
+    GeneratorResult operator()(const GeneratorJob& job) override {
+        std::shared_ptr<voxel[]> voxels(new voxel[CHUNK_VOL]);
+        generator.generate(voxels.get(), *job.prototype, job.x, job.z);
+        return GeneratorResult {job.x, job.z, std::move(voxels)};
+    }
+};
+
+ChunksController::ChunksController(
+    Level& level, const EngineSettings& settings
+)
     : level(level),
       generator(std::make_unique<WorldGenerator>(
           level.content.generators.require(level.getWorld()->getGenerator()),
           level.content,
-          level.getWorld()->getSeed()
-      )) {}
+          level.getWorld()->getSeed(),
+          static_cast<size_t>(settings.chunks.generatorCacheSize.get()) *
+              1024 * 1024
+      )) {
+    uint workers = util::WorkerGroup::countFor(
+        settings.chunks.generatorWorkers.get()
+    );
+    if (workers <= 1) {
+        return;
+    }
+    generatorPool = std::make_unique<
+        util::ThreadPool<GeneratorJob, GeneratorResult>>(
+        "chunks-generator-pool",
+        [this]() {
+            return std::make_shared<GeneratorWorker>(*generator);
+        },
+        [this](GeneratorResult& result) { processResult(result); },
+        static_cast<int>(workers)
+    );
+}
 
 ChunksController::~ChunksController() = default;
 
 void ChunksController::update(
     int64_t maxDuration, int loadDistance, uint padding, Player& player
-) const {
+) {
+    if (generatorPool) {
+        generatorPool->update();
+    }
     const auto& position = player.getPosition();
     int centerX = floordiv<CHUNK_W>(position.x);
     int centerY = floordiv<CHUNK_D>(position.z);
     
+    if (loadQueues.size() > level.players->size()) {
+        removeStaleStates();
+    }
+    if (player.isLoadingChunks()) {
+        generator->update(player.getId(), centerX, centerY, loadDistance);
+    } else {
+        generator->removeArea(player.getId());
+    }
+
+    // chunks in the view and movement directions are loaded first
+    auto& state = loadQueues[player.getId()];
+    glm::vec2 forward {};
+    if (player.fpCamera) {
+        glm::vec2 front(player.fpCamera->front.x, player.fpCamera->front.z);
+        if (glm::length(front) > 0.0f) {
+            forward += glm::normalize(front);
+        }
+    }
+    glm::vec2 movement(
+        position.x - state.lastPosition.x, position.z - state.lastPosition.z
+    );
+    if (glm::length(movement) > 0.0f) {
+        forward += glm::normalize(movement);
+    }
+    auto now = std::chrono::steady_clock::now();
+    float delta = std::chrono::duration<float>(now - state.lastUpdate).count();
+    // teleports and pauses are not movement
+    if (delta > 0.0f && delta < 0.5f &&
+        glm::length(movement) < CHUNK_W * 4) {
+        glm::vec2 velocity = movement / glm::vec2(CHUNK_W, CHUNK_D) / delta;
+        state.velocity += (velocity - state.velocity) * 0.1f;
+    } else {
+        state.velocity = {};
+    }
+    state.lastUpdate = now;
+    state.lastPosition = position;
+    state.queue.update(*player.chunks, padding, forward);
     if (player.isLoadingChunks()) {
-        /// FIXME: one generator for multiple players
-        generator->update(centerX, centerY, loadDistance);
+        prefetchPredicted(player, state);
     }
 
     int64_t mcstotal = 0;
 
     for (uint i = 0; i < MAX_WORK_PER_FRAME; i++) {
         timeutil::Timer timer;
-        if (loadVisible(player, padding)) {
+        if (loadVisible(player, state)) {
             int64_t mcs = timer.stop();
             if (mcstotal + mcs < maxDuration * 1000) {
                 mcstotal += mcs;
@@ -58,93 +141,263 @@ void ChunksController::update(
     }
 }
 
-bool ChunksController::loadVisible(const Player& player, uint padding) const {
+static bool is_missing(const Chunks& chunks, glm::ivec2 position) {
+    int lx = position.x - chunks.getOffsetX();
+    int lz = position.y - chunks.getOffsetY();
+    return lx >= 0 && lz >= 0 && lx < chunks.getWidth() &&
+           lz < chunks.getHeight() &&
+           chunks.getChunk(position.x, position.y) == nullptr;
+}
+
+bool ChunksController::loadVisible(
+    const Player& player, PlayerLoading& state
+) {
+    auto& queue = state.queue;
+    const auto& chunks = *player.chunks;
+    glm::ivec2 position;
+    while (queue.popLighting(position)) {
+        auto chunk = chunks.getChunk(position.x, position.y);
+        if (chunk && chunk->flags.loaded && !chunk->flags.lighted &&
+            buildLights(player, *chunk)) {
+            return true;
+        }
+    }
+    if (!player.isLoadingChunks()) {
+        state.batch.clear();
+        return false;
+    }
+    while (!state.batch.empty()) {
+        position = state.batch.back();
+        state.batch.pop_back();
+        if (!is_missing(chunks, position) ||
+            inwork.find(position) != inwork.end()) {
+            continue;
+        }
+        createChunk(player, position.x, position.y);
+        return true;
+    }
+    while (queue.popMissing(chunks, position)) {
+        if (inwork.find(position) != inwork.end()) {
+            continue;
+        }
+        prefetchSaved(player, state, position);
+        createChunk(player, position.x, position.y);
+        return true;
+    }
+    return false;
+}
+
+void ChunksController::prefetchSaved(
+    const Player& player, PlayerLoading& state, glm::ivec2 position
+) {
+    auto& regions = level.getWorld()->wfile->getRegions();
+    if (level.chunks->fetch(position.x, position.y) ||
+        !regions.hasVoxels(position.x, position.y)) {
+        return;
+    }
+    const auto& chunks = *player.chunks;
+    std::vector<glm::ivec2> saved {position};
+    glm::ivec2 next;
+    while (state.batch.size() + 1 < LOAD_BATCH_SIZE &&
+           state.queue.popMissing(chunks, next)) {
+        if (inwork.find(next) != inwork.end()) {
+            continue;
+        }
+        state.batch.push_back(next);
+        if (level.chunks->fetch(next.x, next.y) == nullptr &&
+            regions.hasVoxels(next.x, next.y)) {
+            saved.push_back(next);
+        }
+    }
+    std::reverse(state.batch.begin(), state.batch.end());
+    regions.prefetch(saved);
+}
+
+void ChunksController::prefetchPredicted(
+    const Player& player, PlayerLoading& state
+) {
     const auto& chunks = *player.chunks;
-    int sizeX = chunks.getWidth();
-    int sizeY = chunks.getHeight();
-
-    int nearX = 0;
-    int nearZ = 0;
-    bool assigned = false;
-    int minDistance = ((sizeX - padding * 2) / 2) * ((sizeY - padding * 2) / 2);
-    for (uint z = padding; z < sizeY - padding; z++) {
-        for (uint x = padding; x < sizeX - padding; x++) {
-            int index = z * sizeX + x;
-            auto& chunk = chunks.getChunks()[index];
-            if (chunk != nullptr) {
-                if (chunk->flags.loaded && !chunk->flags.lighted) {
-                    if (buildLights(player, chunk)) {
-                        return true;
-                    }
-                }
+    const auto& position = player.getPosition();
+    glm::vec2 current(position.x / CHUNK_W, position.z / CHUNK_D);
+    int radius = chunks.getWidth() / 2;
+
+    glm::vec2 ahead = state.velocity * PREFETCH_TIME;
+    if (glm::length(ahead) > radius) {
+        ahead = glm::normalize(ahead) * static_cast<float>(radius);
+    }
+    glm::ivec2 predicted = glm::floor(current + ahead);
+    glm::ivec2 offset(chunks.getOffsetX(), chunks.getOffsetY());
+    if (predicted == state.lastPrediction && offset == state.lastOffset) {
+        return;
+    }
+    state.lastPrediction = predicted;
+    state.lastOffset = offset;
+    if (glm::length(ahead) < 1.0f) {
+        // chunks around a standing player are loaded by the queue
+        return;
+    }
+    // chunks of the predicted matrix not covered by the current one
+    std::vector<glm::ivec2> request;
+    for (int z = predicted.y - radius; z < predicted.y + radius; z++) {
+        for (int x = predicted.x - radius; x < predicted.x + radius; x++) {
+            int lx = x - offset.x;
+            int lz = z - offset.y;
+            if (lx >= 0 && lz >= 0 && lx < chunks.getWidth() &&
+                lz < chunks.getHeight()) {
                 continue;
             }
-            int lx = x - sizeX / 2;
-            int lz = z - sizeY / 2;
-            int distance = (lx * lx + lz * lz);
-            if (distance < minDistance) {
-                minDistance = distance;
-                nearX = x;
-                nearZ = z;
-                assigned = true;
+            if (inwork.find({x, z}) != inwork.end() ||
+                level.chunks->fetch(x, z)) {
+                continue;
             }
+            request.emplace_back(x, z);
         }
     }
-
-    const auto& chunk = chunks.getChunks()[nearZ * sizeX + nearX];
-    if (chunk != nullptr || !assigned || !player.isLoadingChunks()) {
-        return false;
+    // the nearest are entered first
+    glm::ivec2 center = glm::floor(current);
+    auto distance = [center](glm::ivec2 pos) {
+        glm::ivec2 d = pos - center;
+        return d.x * d.x + d.y * d.y;
+    };
+    std::sort(
+        request.begin(),
+        request.end(),
+        [&](glm::ivec2 a, glm::ivec2 b) { return distance(a) < distance(b); }
+    );
+    if (request.size() > PREFETCH_CHUNKS) {
+        request.resize(PREFETCH_CHUNKS);
     }
-    int offsetX = chunks.getOffsetX();
-    int offsetY = chunks.getOffsetY();
-    createChunk(player, nearX + offsetX, nearZ + offsetY);
-    return true;
+    level.getWorld()->wfile->getRegions().requestPrefetch(std::move(request));
 }
 
-bool ChunksController::buildLights(
-    const Player& player, const std::shared_ptr<Chunk>& chunk
-) const {
+bool ChunksController::buildLights(const Player& player, Chunk& chunk) const {
     int surrounding = 0;
     for (int oz = -1; oz <= 1; oz++) {
         for (int ox = -1; ox <= 1; ox++) {
-            if (player.chunks->getChunk(chunk->x + ox, chunk->z + oz))
+            if (player.chunks->getChunk(chunk.x + ox, chunk.z + oz))
                 surrounding++;
         }
     }
     if (surrounding == MIN_SURROUNDING) {
         if (lighting) {
-            bool lightsCache = chunk->flags.loadedLights;
+            bool lightsCache = chunk.flags.loadedLights;
             if (!lightsCache) {
-                lighting->buildSkyLight(chunk->x, chunk->z);
+                lighting->buildSkyLight(chunk.x, chunk.z);
             }
-            lighting->onChunkLoaded(chunk->x, chunk->z, !lightsCache);
+            lighting->onChunkLoaded(chunk.x, chunk.z, !lightsCache);
         }
-        chunk->flags.lighted = true;
+        chunk.flags.lighted = true;
         return true;
     }
     return false;
 }
 
-void ChunksController::createChunk(const Player& player, int x, int z) const {
+void ChunksController::createChunk(const Player& player, int x, int z) {
     if (!player.isLoadingChunks()) {
         if (auto chunk = level.chunks->fetch(x, z)) {
-            player.chunks->putChunk(chunk);
+            putChunk(player, chunk);
         }
         return;
     }
+    if (generatorPool && level.chunks->fetch(x, z) == nullptr) {
+        auto& regions = level.getWorld()->wfile->getRegions();
+        if (!regions.hasVoxels(x, z)) {
+            // the chunk is registered in level after generation only, so 
+            // nobody can access it's voxels while worker writes them
+            inwork.insert({x, z});
+            // chunks nearest to the player are generated first
+            const auto& position = player.getPosition();
+            int dx = x - floordiv<CHUNK_W>(position.x);
+            int dz = z - floordiv<CHUNK_D>(position.z);
+            generatorPool->enqueueJob(
+                GeneratorJob {x, z, generator->prepare(x, z)},
+                -(dx * dx + dz * dz)
+            );
+            return;
+        }
+    }
     auto chunk = level.chunks->create(x, z);
-    player.chunks->putChunk(chunk);
-    auto& chunkFlags = chunk->flags;
+    putChunk(player, chunk);
 
-    if (!chunkFlags.loaded) {
-        generator->generate(chunk->voxels, x, z);
-        chunkFlags.unsaved = true;
+    if (!chunk->flags.loaded) {
+        auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+        generator->generate(voxels.get(), x, z);
+        chunk->voxels.assign(voxels.get());
+        chunk->flags.unsaved = true;
     }
-    chunk->updateHeights();
+    completeChunk(*chunk);
+}
+
+void ChunksController::completeChunk(Chunk& chunk) const {
+    auto& chunkFlags = chunk.flags;
+    chunk.updateHeights();
 
     if (!chunkFlags.loadedLights) {
-        Lighting::prebuildSkyLight(*chunk, *level.content.getIndices());
+        Lighting::prebuildSkyLight(chunk, *level.content.getIndices());
     }
     chunkFlags.loaded = true;
     chunkFlags.ready = true;
 }
+
+void ChunksController::processResult(GeneratorResult& result) {
+    int x = result.x;
+    int z = result.z;
+    inwork.erase({x, z});
+
+    std::vector<Player*> receivers;
+    for (const auto& [_, player] : *level.players) {
+        const auto& chunks = *player->chunks;
+        int lx = x - chunks.getOffsetX();
+        int lz = z - chunks.getOffsetY();
+        if (!player->isLoadingChunks() || 
+            lx < 0 || lz < 0 ||
+            lx >= chunks.getWidth() || lz >= chunks.getHeight() ||
+            chunks.getChunk(x, z)) {
+            continue;
+        }
+        receivers.push_back(player.get());
+    }
+    if (receivers.empty()) {
+        // all players moved away, the chunk will be generated again
+        // when needed
+        return;
+    }
+    auto chunk = level.chunks->create(x, z);
+    if (!chunk->flags.loaded) {
+        chunk->voxels.assign(result.voxels.get());
+        chunk->flags.unsaved = true;
+    }
+    if (!chunk->flags.ready) {
+        completeChunk(*chunk);
+    }
+    for (auto player : receivers) {
+        putChunk(*player, chunk);
+    }
+}
+
+void ChunksController::removeStaleStates() {
+    for (auto it = loadQueues.begin(); it != loadQueues.end();) {
+        if (level.players->get(it->first) == nullptr) {
+            generator->removeArea(it->first);
+            it = loadQueues.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ChunksController::invalidateLoadQueues() {
+    for (auto& [_, state] : loadQueues) {
+        state.queue.invalidate();
+    }
+}
+
+void ChunksController::putChunk(
+    const Player& player, const std::shared_ptr<Chunk>& chunk
+) {
+    if (player.chunks->putChunk(chunk)) {
+        loadQueues[player.getId()].queue.onChunkPut(
+            *player.chunks, chunk->x, chunk->z
+        );
+    }
+}
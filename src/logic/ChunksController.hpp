@@ -1,8 +1,19 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 
 #include "typedefs.hpp"
+#include "ChunksLoadQueue.hpp"
+#include "util/ThreadPool.hpp"
+#include "voxels/voxel.hpp"
 
 class Level;
 class Chunk;
@@ -10,27 +21,86 @@ class Chunks;
 class Player;
 class Lighting;
 class WorldGenerator;
+struct ChunkPrototype;
+struct EngineSettings;
+
+struct GeneratorJob {
+    int x;
+    int z;
+    std::shared_ptr<const ChunkPrototype> prototype;
+};
+
+struct GeneratorResult {
+    int x;
+    int z;
+    std::shared_ptr<voxel[]> voxels;
+};
 
 /// @brief ChunksController manages chunks dynamic loading/unloading
 class ChunksController {
 private:
     Level& level;
     std::unique_ptr<WorldGenerator> generator;
+    /// @brief Chunk voxels generation workers. nullptr if chunks are
+    /// generated on the main thread
+    std::unique_ptr<util::ThreadPool<GeneratorJob, GeneratorResult>>
+        generatorPool;
+    /// @brief Positions of chunks being generated by generatorPool
+    std::unordered_set<glm::ivec2> inwork;
+
+    struct PlayerLoading {
+        ChunksLoadQueue queue;
+        glm::vec3 lastPosition {};
+        /// @brief Missing chunks taken from the queue with the prefetched
+        /// saved data, the nearest is the last
+        std::vector<glm::ivec2> batch;
+        /// @brief Smoothed player velocity in chunks per second
+        glm::vec2 velocity {};
+        std::chrono::steady_clock::time_point lastUpdate {};
+        /// @brief Chunks matrix offset on the last prefetch request
+        glm::ivec2 lastOffset {};
+        /// @brief Predicted matrix center of the last prefetch request
+        glm::ivec2 lastPrediction {};
+    };
+    /// @brief Chunks loading order of players by id
+    std::unordered_map<u64id_t, PlayerLoading> loadQueues;
 
     /// @brief Process one chunk: load it or calculate lights for it
-    bool loadVisible(const Player& player, uint padding) const;
-    bool buildLights(const Player& player, const std::shared_ptr<Chunk>& chunk) const;
-    void createChunk(const Player& player, int x, int y) const;
+    bool loadVisible(const Player& player, PlayerLoading& state);
+    /// @brief If the chunk is saved, take next missing chunks to the state
+    /// batch and decompress saved ones in parallel
+    void prefetchSaved(
+        const Player& player, PlayerLoading& state, glm::ivec2 position
+    );
+    /// @brief Request prefetching of saved chunks entering the player
+    /// chunks matrix at the position predicted from the player velocity.
+    /// Requested when the prediction changes or the matrix is shifted
+    void prefetchPredicted(const Player& player, PlayerLoading& state);
+    bool buildLights(const Player& player, Chunk& chunk) const;
+    void createChunk(const Player& player, int x, int y);
+    /// @brief Put chunk to the player chunks matrix
+    void putChunk(const Player& player, const std::shared_ptr<Chunk>& chunk);
+    /// @brief Remove loading states and generation areas of removed players
+    void removeStaleStates();
+    /// @brief Finish chunk loading on the main thread
+    void completeChunk(Chunk& chunk) const;
+    /// @brief Put generated chunk voxels to the level and show the chunk
+    /// to players waiting for it
+    void processResult(GeneratorResult& result);
 public:
     std::unique_ptr<Lighting> lighting;
 
-    ChunksController(Level& level);
+    ChunksController(Level& level, const EngineSettings& settings);
     ~ChunksController();
 
     /// @param maxDuration milliseconds reserved for chunks loading
     void update(
         int64_t maxDuration, int loadDistance, uint padding, Player& player
-    ) const;
+    );
+
+    /// @brief Rescan players chunks matrices for chunks to load or light
+    /// on the next update. Call if chunks lights are reset
+    void invalidateLoadQueues();
 
     const WorldGenerator* getGenerator() const {
         return generator.get();
@@ -0,0 +1,107 @@
+#include "ChunksLoadQueue.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+
+float ChunksLoadQueue::calculatePriority(const glm::ivec2& offset) const {
+    float distance2 = offset.x * offset.x + offset.y * offset.y;
+    if (distance2 == 0.0f) {
+        return 0.0f;
+    }
+    float alignment =
+        glm::dot(glm::vec2(offset), forward) / std::sqrt(distance2);
+    return distance2 * (1.0f - FORWARD_BIAS * std::max(0.0f, alignment));
+}
+
+void ChunksLoadQueue::rebuild(const Chunks& chunks) {
+    missing.clear();
+    lighting.clear();
+    int pad = static_cast<int>(padding);
+    // chunks out of the circle inscribed in the area are not loaded
+    int maxDistance = ((width - pad * 2) / 2) * ((height - pad * 2) / 2);
+    for (int lz = pad; lz < height - pad; lz++) {
+        for (int lx = pad; lx < width - pad; lx++) {
+            const auto& chunk = chunks.getChunks()[lz * width + lx];
+            int x = offsetX + lx;
+            int z = offsetZ + lz;
+            if (chunk == nullptr) {
+                glm::ivec2 offset(lx - width / 2, lz - height / 2);
+                if (offset.x * offset.x + offset.y * offset.y < maxDistance) {
+                    missing.push_back(Entry {calculatePriority(offset), x, z});
+                }
+            } else if (chunk->flags.loaded && !chunk->flags.lighted) {
+                lighting.emplace_back(x, z);
+            }
+        }
+    }
+    std::make_heap(missing.begin(), missing.end());
+    chunksCount = chunks.getChunksCount();
+    valid = true;
+}
+
+void ChunksLoadQueue::update(
+    const Chunks& chunks, uint padding, glm::vec2 forward
+) {
+    float length = glm::length(forward);
+    forward = length > 0.0f ? forward / length : glm::vec2();
+    if (valid && chunks.getOffsetX() == offsetX &&
+        chunks.getOffsetY() == offsetZ && chunks.getWidth() == width &&
+        chunks.getHeight() == height && this->padding == padding &&
+        chunks.getChunksCount() == chunksCount &&
+        (forward == this->forward ||
+         glm::dot(forward, this->forward) >= DIRECTION_THRESHOLD)) {
+        return;
+    }
+    offsetX = chunks.getOffsetX();
+    offsetZ = chunks.getOffsetY();
+    width = chunks.getWidth();
+    height = chunks.getHeight();
+    this->padding = padding;
+    this->forward = forward;
+    rebuild(chunks);
+}
+
+void ChunksLoadQueue::onChunkPut(const Chunks& chunks, int x, int z) {
+    if (!valid) {
+        return;
+    }
+    chunksCount = chunks.getChunksCount();
+    int pad = static_cast<int>(padding);
+    // the chunk completes surroundings of its neighbours
+    for (int oz = -1; oz <= 1; oz++) {
+        for (int ox = -1; ox <= 1; ox++) {
+            int lx = x + ox - offsetX;
+            int lz = z + oz - offsetZ;
+            if (lx < pad || lz < pad || lx >= width - pad ||
+                lz >= height - pad) {
+                continue;
+            }
+            lighting.emplace_back(x + ox, z + oz);
+        }
+    }
+}
+
+bool ChunksLoadQueue::popMissing(const Chunks& chunks, glm::ivec2& position) {
+    while (!missing.empty()) {
+        std::pop_heap(missing.begin(), missing.end());
+        const auto& entry = missing.back();
+        position = {entry.x, entry.z};
+        missing.pop_back();
+        if (chunks.getChunk(position.x, position.y) == nullptr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ChunksLoadQueue::popLighting(glm::ivec2& position) {
+    if (lighting.empty()) {
+        return false;
+    }
+    position = lighting.back();
+    lighting.pop_back();
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "typedefs.hpp"
+
+class Chunks;
+
+/// @brief Chunks loading order for a player chunks matrix.
+/// Missing chunks positions inside the circle inscribed in the matrix
+/// (padding excluded) are kept in a heap ordered by distance to the
+/// matrix centre, chunks in the view and movement direction go first.
+/// The heap is rebuilt only when the matrix is shifted or resized, the
+/// direction changes or chunks are removed from the matrix.
+class ChunksLoadQueue {
+    struct Entry {
+        float priority;
+        int x;
+        int z;
+
+        /// @brief Heap order: least priority value first
+        inline bool operator<(const Entry& o) const {
+            return priority > o.priority;
+        }
+    };
+
+    std::vector<Entry> missing;
+    /// @brief Positions of chunks to check for lights calculation
+    std::vector<glm::ivec2> lighting;
+    int offsetX = 0;
+    int offsetZ = 0;
+    int width = 0;
+    int height = 0;
+    uint padding = 0;
+    size_t chunksCount = 0;
+    glm::vec2 forward {};
+    bool valid = false;
+
+    void rebuild(const Chunks& chunks);
+    /// @param offset position relative to the area centre
+    float calculatePriority(const glm::ivec2& offset) const;
+public:
+    /// @brief Minimal cosine between the current and the last used
+    /// direction not causing the rebuild
+    static inline constexpr float DIRECTION_THRESHOLD = 0.7f;
+    /// @brief Max distance reduction for chunks straight ahead
+    static inline constexpr float FORWARD_BIAS = 0.5f;
+
+    /// @brief Rebuild the queue if the matrix or direction changed
+    /// @param chunks player chunks matrix
+    /// @param padding matrix border not loaded
+    /// @param forward preferred horizontal direction (may be zero)
+    void update(const Chunks& chunks, uint padding, glm::vec2 forward);
+
+    /// @brief Must be called after a chunk is put to the matrix
+    void onChunkPut(const Chunks& chunks, int x, int z);
+
+    /// @brief Get the next missing chunk position
+    /// @return false if there are no missing chunks left
+    bool popMissing(const Chunks& chunks, glm::ivec2& position);
+
+    /// @brief Get position of the next chunk probably ready for lights
+    /// calculation
+    /// @return false if there are no chunks to check
+    bool popLighting(glm::ivec2& position);
+
+    size_t getMissingCount() const {
+        return missing.size();
+    }
+
+    void invalidate() {
+        valid = false;
+    }
+};
@@ -14,6 +14,7 @@
 #include "scripting/scripting.hpp"
 #include "lighting/Lighting.hpp"
 #include "settings.hpp"
+#include "util/WorkerGroup.hpp"
 #include "world/LevelEvents.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
@@ -25,7 +26,7 @@ LevelController::LevelController(
 )
     : settings(engine->getSettings()),
       level(std::move(levelPtr)),
-      chunks(std::make_unique<ChunksController>(*level)),
+      chunks(std::make_unique<ChunksController>(*level, settings)),
       playerTickClock(20, 3) {
     
     level->events->listen(LevelEventType::CHUNK_PRESENT, [](auto, Chunk* chunk) {
@@ -37,12 +38,17 @@ LevelController::LevelController(
 
     if (clientPlayer) {
         chunks->lighting = std::make_unique<Lighting>(
-            level->content, *clientPlayer->chunks
+            level->content,
+            *clientPlayer->chunks,
+            util::WorkerGroup::countFor(settings.chunks.lightingWorkers.get())
         );
     }
     blocks = std::make_unique<BlocksController>(
         *level, chunks ? chunks->lighting.get() : nullptr
     );
+    level->entities->setPhysicsWorkers(
+        util::WorkerGroup::countFor(settings.physics.workers.get())
+    );
     scripting::on_world_load(this);
 
     // TODO: do something to players added later
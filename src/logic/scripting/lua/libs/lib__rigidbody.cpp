@@ -10,7 +10,9 @@ static int l_get_vel(lua::State* L) {
 
 static int l_set_vel(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.velocity = lua::tovec3(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.velocity = lua::tovec3(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -24,7 +26,9 @@ static int l_is_enabled(lua::State* L) {
 
 static int l_set_enabled(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().enabled = lua::toboolean(L, 2);
+        auto& rigidbody = entity->getRigidbody();
+        rigidbody.enabled = lua::toboolean(L, 2);
+        rigidbody.hitbox.wakeUp();
     }
     return 0;
 }
@@ -39,6 +43,7 @@ static int l_get_size(lua::State* L) {
 static int l_set_size(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
         entity->getRigidbody().hitbox.halfsize = lua::tovec3(L, 2) * 0.5f;
+        entity->updateIndex();
     }
     return 0;
 }
@@ -52,7 +57,9 @@ static int l_get_gravity_scale(lua::State* L) {
 
 static int l_set_gravity_scale(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.gravityScale = lua::tonumber(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.gravityScale = lua::tonumber(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -106,7 +113,9 @@ static int l_get_body_type(lua::State* L) {
 static int l_set_body_type(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
         if (auto type = BodyType_from(lua::tostring(L, 2))) {
-            entity->getRigidbody().hitbox.type = *type;
+            auto& hitbox = entity->getRigidbody().hitbox;
+            hitbox.type = *type;
+            hitbox.wakeUp();
         } else {
             throw std::runtime_error(
                 "unknown body type " + util::quote(lua::tostring(L, 2))
@@ -237,6 +237,57 @@ static int l_reload_component(lua::State* L) {
     return 0;
 }
 
+/// @brief Fill flat arrays of entities positions and velocities
+/// (x, y, z per entity). Tables passed as arguments 2 and 3 are reused
+static int l_get_bodies(lua::State* L) {
+    size_t count = lua::objlen(L, 1);
+    for (int i = 2; i <= 3; i++) {
+        if (lua::istable(L, i)) {
+            lua::pushvalue(L, i);
+        } else {
+            lua::createtable(L, count * 3, 0);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        lua::rawgeti(L, i + 1, 1);
+        auto entity = level->entities->get(lua::tointeger(L, -1));
+        lua::pop(L);
+        glm::vec3 pos {};
+        glm::vec3 vel {};
+        if (entity) {
+            pos = entity->getTransform().pos;
+            vel = entity->getRigidbody().hitbox.velocity;
+        }
+        for (int j = 0; j < 3; j++) {
+            lua::pushnumber(L, pos[j]);
+            lua::rawseti(L, i * 3 + j + 1, -3);
+            lua::pushnumber(L, vel[j]);
+            lua::rawseti(L, i * 3 + j + 1, -2);
+        }
+    }
+    // reused tables may be longer
+    for (int idx = -2; idx <= -1; idx++) {
+        size_t length = lua::objlen(L, idx);
+        for (size_t i = count * 3 + 1; i <= length; i++) {
+            lua::pushnil(L);
+            lua::rawseti(L, i, idx - 1);
+        }
+    }
+    return 2;
+}
+
+static int l_batch(lua::State* L) {
+    auto name = lua::require_string(L, 1);
+    bool sensors = lua::istable(L, 2) &&
+                   lua::hasfield(L, "on_sensor_events", 2);
+    scripting::set_sensor_events_batched(name, sensors);
+    lua::get_from(L, "stdcomp", "set_batch", true);
+    lua::pushvalue(L, 1);
+    lua::pushvalue(L, 2);
+    lua::call(L, 2, 0);
+    return 0;
+}
+
 const luaL_Reg entitylib[] = {
     {"exists", lua::wrap<l_exists>},
     {"def_index", lua::wrap<l_def_index>},
@@ -253,5 +304,7 @@ const luaL_Reg entitylib[] = {
     {"get_all_in_radius", lua::wrap<l_get_all_in_radius>},
     {"raycast", lua::wrap<l_raycast>},
     {"reload_component", lua::wrap<l_reload_component>},
+    {"get_bodies", lua::wrap<l_get_bodies>},
+    {"batch", lua::wrap<l_batch>},
     {NULL, NULL}
 };
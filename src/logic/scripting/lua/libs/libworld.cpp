@@ -187,6 +187,7 @@ static int l_set_chunk_data(lua::State* L) {
         return lua::pushboolean(L, true);
     }
     integrate_chunk_client(*chunk);
+    controller->getChunksController()->invalidateLoadQueues();
     return lua::pushboolean(L, true);
 }
 
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <unordered_map>
 
 #include "scripting_commons.hpp"
 #include "content/Content.hpp"
@@ -34,6 +35,18 @@ static debug::Logger logger("scripting");
 
 static inline const std::string STDCOMP = "stdcomp";
 
+namespace {
+    struct SensorEvent {
+        entityid_t uid;
+        size_t index;
+        entityid_t oid;
+        bool enter;
+    };
+}
+
+/// @brief Buffered sensor events of batched component types
+static std::unordered_map<std::string, std::vector<SensorEvent>> sensor_events;
+
 std::ostream* scripting::output_stream = &std::cout;
 std::ostream* scripting::error_stream = &std::cerr;
 Engine* scripting::engine = nullptr;
@@ -298,6 +311,7 @@ void scripting::on_world_quit() {
     if (lua::getglobal(L, "__vc_on_world_quit")) {
         lua::call_nothrow(L, 0, 0);
     }
+    sensor_events.clear();
     scripting::level = nullptr;
     scripting::content = nullptr;
     scripting::indices = nullptr;
@@ -678,34 +692,87 @@ void scripting::on_entity_save(const Entity& entity) {
     );
 }
 
+static void process_sensor_event(
+    const Entity& entity, size_t index, entityid_t oid, bool enter
+) {
+    const auto& script = entity.getScripting();
+    for (auto& component : script.components) {
+        if (!sensor_events.empty()) {
+            auto found = sensor_events.find(component->name);
+            if (found != sensor_events.end()) {
+                found->second.push_back(
+                    SensorEvent {entity.getUID(), index, oid, enter}
+                );
+                continue;
+            }
+        }
+        if (enter ? component->funcsset.on_sensor_enter
+                  : component->funcsset.on_sensor_exit) {
+            process_entity_callback(
+                component->env,
+                enter ? "on_sensor_enter" : "on_sensor_exit",
+                [index, oid](auto L) {
+                    lua::pushinteger(L, index);
+                    lua::pushinteger(L, oid);
+                    return 2;
+                }
+            );
+        }
+    }
+}
+
 void scripting::on_sensor_enter(
     const Entity& entity, size_t index, entityid_t oid
 ) {
-    process_entity_callback(
-        entity,
-        "on_sensor_enter",
-        &EntityFuncsSet::on_sensor_enter,
-        [index, oid](auto L) {
-            lua::pushinteger(L, index);
-            lua::pushinteger(L, oid);
-            return 2;
-        }
-    );
+    process_sensor_event(entity, index, oid, true);
 }
 
 void scripting::on_sensor_exit(
     const Entity& entity, size_t index, entityid_t oid
 ) {
-    process_entity_callback(
-        entity,
-        "on_sensor_exit",
-        &EntityFuncsSet::on_sensor_exit,
-        [index, oid](auto L) {
-            lua::pushinteger(L, index);
-            lua::pushinteger(L, oid);
-            return 2;
+    process_sensor_event(entity, index, oid, false);
+}
+
+void scripting::set_sensor_events_batched(const std::string& name, bool flag) {
+    if (flag) {
+        sensor_events[name];
+    } else {
+        sensor_events.erase(name);
+    }
+}
+
+/// @brief Pass buffered sensor events to batch handlers
+static void flush_sensor_events(lua::State* L) {
+    // handlers may register batches, so the map is not iterated while
+    // calling them
+    std::vector<std::pair<std::string, std::vector<SensorEvent>>> pending;
+    for (auto& [name, events] : sensor_events) {
+        if (!events.empty()) {
+            pending.emplace_back(name, std::move(events));
+            events.clear();
         }
-    );
+    }
+    for (const auto& [name, events] : pending) {
+        lua::get_from(L, STDCOMP, "sensor_events", true);
+        lua::pushstring(L, name);
+        // uids, indices, others, enters
+        for (int i = 0; i < 4; i++) {
+            lua::createtable(L, events.size(), 0);
+        }
+        for (size_t i = 0; i < events.size(); i++) {
+            const auto& event = events[i];
+            lua::pushinteger(L, event.uid);
+            lua::rawseti(L, i + 1, -5);
+            lua::pushinteger(L, event.index);
+            lua::rawseti(L, i + 1, -4);
+            lua::pushinteger(L, event.oid);
+            lua::rawseti(L, i + 1, -3);
+            lua::pushboolean(L, event.enter);
+            lua::rawseti(L, i + 1, -2);
+        }
+        lua::call_nothrow(L, 5, 0);
+        lua::pop(L);
+    }
 }
 
 void scripting::on_aim_on(const Entity& entity, Player* player) {
@@ -752,6 +819,7 @@ void scripting::on_entity_used(const Entity& entity, Player* player) {
 
 void scripting::on_entities_update(int tps, int parts, int part) {
     auto L = lua::get_main_state();
+    flush_sensor_events(L);
     lua::get_from(L, STDCOMP, "update", true);
     lua::pushinteger(L, tps);
     lua::pushinteger(L, parts);
@@ -130,6 +130,10 @@ namespace scripting {
     void on_entities_render(float delta);
     void on_sensor_enter(const Entity& entity, size_t index, entityid_t oid);
     void on_sensor_exit(const Entity& entity, size_t index, entityid_t oid);
+    /// @brief Buffer sensor events of the component type until the next
+    /// entities update, where they are passed to the batch handler at once
+    /// instead of per-entity callbacks
+    void set_sensor_events_batched(const std::string& name, bool flag);
     void on_aim_on(const Entity& entity, Player* player);
     void on_aim_off(const Entity& entity, Player* player);
     void on_attacked(const Entity& entity, Player* player, entityid_t attacker);
@@ -19,6 +19,7 @@
 #include "rigging.hpp"
 #include "physics/Hitbox.hpp"
 #include "physics/PhysicsSolver.hpp"
+#include "util/WorkerGroup.hpp"
 #include "world/Level.hpp"
 
 static debug::Logger logger("entities");
@@ -28,6 +29,13 @@ static inline std::string COMP_RIGIDBODY = "rigidbody";
 static inline std::string COMP_SKELETON = "skeleton";
 static inline std::string SAVED_DATA_VARNAME = "SAVED_DATA";
 
+/// @brief Entities spatial index cell size
+static constexpr float INDEX_CELL_SIZE = 4.0f;
+/// @brief Max speed of a resting body
+static constexpr float SLEEP_VELOCITY = 0.01f;
+/// @brief Time the body should rest before it falls asleep (seconds)
+static constexpr float SLEEP_DELAY = 1.0f;
+
 void Transform::refresh() {
     combined = glm::mat4(1.0f);
     combined = glm::translate(combined, pos);
@@ -50,6 +58,10 @@ glm::vec3 Entity::getInterpolatedPosition() const {
     return getTransform().pos;
 }
 
+void Entity::updateIndex() {
+    entities.updateIndex(*this);
+}
+
 void Entity::destroy() {
     if (isValid()) {
         entities.despawn(id);
@@ -72,7 +84,20 @@ void Entity::setRig(const rigging::SkeletonConfig* rigConfig) {
 }
 
 Entities::Entities(Level& level)
-    : level(level), sensorsTickClock(20, 3), updateTickClock(20, 3) {
+    : level(level),
+      sensorsTickClock(20, 3),
+      updateTickClock(20, 3),
+      bodiesIndex(INDEX_CELL_SIZE) {
+}
+
+Entities::~Entities() = default;
+
+void Entities::setPhysicsWorkers(uint count) {
+    if (count > 1) {
+        physicsWorkers = std::make_unique<util::WorkerGroup>(count);
+    } else {
+        physicsWorkers = nullptr;
+    }
 }
 
 template <void (*callback)(const Entity&, size_t, entityid_t)>
@@ -184,6 +209,7 @@ entityid_t Entities::spawn(
         loadEntity(saved, get(id).value());
     }
     body.hitbox.position = tsf.pos;
+    bodiesIndex.update(id, body.hitbox.getAABB());
     scripting::on_entity_spawn(
         def, id, scripting.components, args, componentsMap);
     return id;
@@ -252,30 +278,46 @@ void Entities::loadEntity(const dv::value& map, Entity entity) {
     }
 }
 
+void Entities::updateIndex(const Entity& entity) {
+    auto& hitbox = entity.getRigidbody().hitbox;
+    hitbox.wakeUp();
+    bodiesIndex.update(entity.getUID(), hitbox.getAABB());
+}
+
+void Entities::wakeUp(const AABB& area) {
+    bodiesIndex.query(area, [this](entityid_t uid, const AABB&) {
+        registry.get<Rigidbody>(entities.at(uid)).hitbox.wakeUp();
+    });
+}
+
 std::optional<Entities::RaycastResult> Entities::rayCast(
     glm::vec3 start, glm::vec3 dir, float maxDistance, entityid_t ignore
 ) {
     Ray ray(start, dir);
-    auto view = registry.view<EntityId, Transform, Rigidbody>();
 
     entityid_t foundUID = 0;
     glm::ivec3 foundNormal;
 
-    for (auto [entity, eid, transform, body] : view.each()) {
-        if (eid.uid == ignore || !body.enabled) {
-            continue;
+    AABB segment(start, start);
+    segment.addPoint(start + dir * maxDistance);
+    bodiesIndex.query(segment, [&](entityid_t uid, const AABB& aabb) {
+        if (uid == ignore) {
+            return;
+        }
+        const auto& body = registry.get<Rigidbody>(entities.at(uid));
+        if (!body.enabled) {
+            return;
         }
-        auto& hitbox = body.hitbox;
         glm::ivec3 normal;
         double distance;
         if (ray.intersectAABB(
-                glm::vec3(), hitbox.getAABB(), maxDistance, normal, distance
+                glm::vec3(), aabb, maxDistance, normal, distance
             ) > RayRelation::None) {
-            foundUID = eid.uid;
+            foundUID = uid;
             foundNormal = normal;
             maxDistance = static_cast<float>(distance);
         }
-    }
+    });
     if (foundUID) {
         return Entities::RaycastResult {foundUID, foundNormal, maxDistance};
     } else {
@@ -399,6 +441,7 @@ void Entities::clean() {
             for (auto& sensor : rigidbody.sensors) {
                 physics->removeSensor(&sensor);
             }
+            bodiesIndex.remove(it->first);
             uids.erase(it->second);
             registry.destroy(it->second);
             it = entities.erase(it);
@@ -454,7 +497,40 @@ void Entities::preparePhysics(float delta) {
             }
             updateSensors(rigidbody, transform, sensors);
         }
+        // sleeping bodies are not stepped, so sensors check them instead
+        std::vector<std::pair<Sensor*, entityid_t>> contacts;
+        for (auto sensor : sensors) {
+            bodiesIndex.query(
+                PhysicsSolver::getSensorBounds(*sensor),
+                [&](entityid_t uid, const AABB&) {
+                    contacts.emplace_back(sensor, uid);
+                }
+            );
+        }
         physics->setSensors(std::move(sensors));
+        for (const auto& [sensor, uid] : contacts) {
+            const auto& hitbox =
+                registry.get<Rigidbody>(entities.at(uid)).hitbox;
+            if (hitbox.sleeping) {
+                physics->checkSensor(*sensor, hitbox, uid);
+            }
+        }
+    }
+}
+
+/// @brief Put the body asleep if it stays at rest long enough
+static void update_rest(Hitbox& hitbox, float delta) {
+    bool resting = (hitbox.grounded || hitbox.gravityScale == 0.0f) &&
+                   glm::length2(hitbox.velocity) <
+                       SLEEP_VELOCITY * SLEEP_VELOCITY;
+    if (!resting) {
+        hitbox.restTime = 0.0f;
+        return;
+    }
+    hitbox.restTime += delta;
+    if (hitbox.restTime >= SLEEP_DELAY) {
+        hitbox.sleeping = true;
+        hitbox.velocity = glm::vec3(0.0f);
     }
 }
 
@@ -463,27 +539,47 @@ void Entities::updatePhysics(float delta) {
 
     auto view = registry.view<EntityId, Transform, Rigidbody>();
     auto physics = level.physics.get();
+    physicsBodies.clear();
+    physicsHitboxes.clear();
     for (auto [entity, eid, transform, rigidbody] : view.each()) {
-        if (!rigidbody.enabled || rigidbody.hitbox.type == BodyType::STATIC) {
+        auto& hitbox = rigidbody.hitbox;
+        if (hitbox.sleeping) {
             continue;
         }
-        auto& hitbox = rigidbody.hitbox;
-        auto prevVel = hitbox.velocity;
-        bool grounded = hitbox.grounded;
-
-        float vel = glm::length(prevVel);
-        int substeps = static_cast<int>(delta * vel * 20);
-        substeps = std::min(100, std::max(2, substeps));
-        physics->step(*level.chunks, hitbox, delta, substeps, eid.uid);
-        hitbox.linearDamping = hitbox.grounded * 24;
-        transform.setPos(hitbox.position);
-        if (hitbox.grounded && !grounded) {
+        if (!rigidbody.enabled || hitbox.type == BodyType::STATIC) {
+            // catches hitbox changes made without updateIndex call
+            bodiesIndex.update(eid.uid, hitbox.getAABB());
+            continue;
+        }
+        physicsBodies.push_back(
+            PhysicsBody {entity, hitbox.velocity, hitbox.grounded}
+        );
+        physicsHitboxes.push_back(&hitbox);
+    }
+    physics->stepBodies(
+        *level.chunks, physicsHitboxes, delta, physicsWorkers.get()
+    );
+
+    // sensors and scripts are processed in the registry order
+    for (const auto& body : physicsBodies) {
+        // scripts may spawn entities, so hitbox pointer is not used here
+        auto& hitbox = registry.get<Rigidbody>(body.entity).hitbox;
+        const auto& eid = registry.get<EntityId>(body.entity);
+        entityid_t uid = eid.uid;
+        registry.get<Transform>(body.entity).setPos(hitbox.position);
+        bodiesIndex.update(uid, hitbox.getAABB());
+        physics->checkSensors(hitbox, uid);
+        // players are controlled directly and never sleep
+        if (eid.player == -1) {
+            update_rest(hitbox, delta);
+        }
+        if (hitbox.grounded && !body.grounded) {
             scripting::on_entity_grounded(
-                *get(eid.uid), glm::length(prevVel - hitbox.velocity)
+                *get(uid), glm::length(body.prevVelocity - hitbox.velocity)
             );
         }
-        if (!hitbox.grounded && grounded) {
-            scripting::on_entity_fall(*get(eid.uid));
+        if (!hitbox.grounded && body.grounded) {
+            scripting::on_entity_fall(*get(uid));
         }
     }
 }
@@ -589,45 +685,40 @@ void Entities::render(
 }
 
 bool Entities::hasBlockingInside(AABB aabb) {
-    auto view = registry.view<EntityId, Rigidbody>();
-    for (auto [entity, eid, body] : view.each()) {
-        if (eid.def.blocking && aabb.intersect(body.hitbox.getAABB(), -0.05f)) {
-            return true;
-        }
-    }
-    return false;
+    bool found = false;
+    bodiesIndex.query(aabb, [&](entityid_t uid, const AABB& bodyAABB) {
+        const auto& eid = registry.get<EntityId>(entities.at(uid));
+        if (eid.def.blocking && aabb.intersect(bodyAABB, -0.05f)) {
+            found = true;
+        }
+    });
+    return found;
 }
 
 std::vector<Entity> Entities::getAllInside(AABB aabb) {
     std::vector<Entity> collected;
-    auto view = registry.view<EntityId, Transform>();
-    for (auto [entity, eid, transform] : view.each()) {
+    aabb.fix();
+    // entity position is the hitbox center
+    bodiesIndex.query(aabb, [&](entityid_t uid, const AABB&) {
+        auto entity = entities.at(uid);
+        const auto& eid = registry.get<EntityId>(entity);
+        const auto& transform = registry.get<Transform>(entity);
         if (!eid.destroyFlag && aabb.contains(transform.pos)) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
+            collected.emplace_back(*this, uid, registry, entity);
         }
-    }
+    });
     return collected;
 }
 
 std::vector<Entity> Entities::getAllInRadius(glm::vec3 center, float radius) {
     std::vector<Entity> collected;
-    auto view = registry.view<Transform>();
-    for (auto [entity, transform] : view.each()) {
+    AABB bounds(center - glm::vec3(radius), center + glm::vec3(radius));
+    bodiesIndex.query(bounds, [&](entityid_t uid, const AABB&) {
+        auto entity = entities.at(uid);
+        const auto& transform = registry.get<Transform>(entity);
         if (glm::distance2(transform.pos, center) <= radius * radius) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
+            collected.emplace_back(*this, uid, registry, entity);
         }
-    }
+    });
     return collected;
 }
@@ -7,6 +7,7 @@
 
 #include "data/dv.hpp"
 #include "physics/Hitbox.hpp"
+#include "physics/SpatialGrid.hpp"
 #include "typedefs.hpp"
 #include "util/Clock.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
@@ -111,6 +112,10 @@ namespace rigging {
     class SkeletonConfig;
 }
 
+namespace util {
+    class WorkerGroup;
+}
+
 class Entity {
     Entities& entities;
     entityid_t id;
@@ -174,6 +179,10 @@ public:
 
     glm::vec3 getInterpolatedPosition() const;
 
+    /// @brief Update entity spatial index entry after the hitbox is moved
+    /// or resized outside of the physics step. Wakes the body up
+    void updateIndex();
+
     void destroy();
 };
 
@@ -185,6 +194,19 @@ class Entities {
     entityid_t nextID = 1;
     util::Clock sensorsTickClock;
     util::Clock updateTickClock;
+    /// @brief Rigidbodies hitboxes index used by spatial queries
+    SpatialGrid<entityid_t> bodiesIndex;
+
+    /// @brief Rigidbody stepped on the current physics tick
+    struct PhysicsBody {
+        entt::entity entity;
+        glm::vec3 prevVelocity;
+        bool grounded;
+    };
+    std::vector<PhysicsBody> physicsBodies;
+    /// @brief Hitboxes of physicsBodies passed to the solver
+    std::vector<Hitbox*> physicsHitboxes;
+    std::unique_ptr<util::WorkerGroup> physicsWorkers;
 
     void updateSensors(
         Rigidbody& body, const Transform& tsf, std::vector<Sensor*>& sensors
@@ -198,6 +220,11 @@ public:
     };
 
     Entities(Level& level);
+    ~Entities();
+
+    /// @brief Set number of threads stepping rigidbodies including the
+    /// main thread. Physics results do not depend on it
+    void setPhysicsWorkers(uint count);
 
     void clean();
     void updatePhysics(float delta);
@@ -244,6 +271,12 @@ public:
         entityid_t ignore = -1
     );
 
+    /// @brief Update entity hitbox in the spatial index, waking the body up
+    void updateIndex(const Entity& entity);
+
+    /// @brief Wake up sleeping bodies overlapping the area
+    void wakeUp(const AABB& area);
+
     void loadEntities(dv::value map);
     void loadEntity(const dv::value& map);
     void loadEntity(const dv::value& map, Entity entity);
@@ -186,6 +186,7 @@ void Player::teleport(glm::vec3 position) {
         entity->getRigidbody().hitbox.position = position;
         entity->getTransform().setPos(position);
         entity->setInterpolatedPosition(position);
+        entity->updateIndex();
     }
 }
 
@@ -200,7 +201,7 @@ void Player::attemptToFindSpawnpoint() {
         newpos.y--;
     }
 
-    voxel* headvox = chunks->get(newpos.x, newpos.y + 1, newpos.z);
+    const voxel* headvox = chunks->get(newpos.x, newpos.y + 1, newpos.z);
     if (chunks->isObstacleBlock(newpos.x, newpos.y, newpos.z) ||
         headvox == nullptr || headvox->id != 0) {
         return;
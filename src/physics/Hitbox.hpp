@@ -54,10 +54,20 @@ struct Hitbox {
     bool grounded = false;
     float gravityScale = 1.0f;
     bool crouching = false;
+    /// @brief Resting body is not simulated until woken up (velocity of a
+    /// sleeping body is zero)
+    bool sleeping = false;
+    /// @brief Time the body stays at rest (seconds)
+    float restTime = 0.0f;
 
     Hitbox(BodyType type, glm::vec3 position, glm::vec3 halfsize);
 
     AABB getAABB() const {
         return AABB(position-halfsize, position+halfsize);
     }
+
+    void wakeUp() {
+        sleeping = false;
+        restTime = 0.0f;
+    }
 };
@@ -2,31 +2,210 @@
 #include "Hitbox.hpp"
 
 #include "maths/aabb.hpp"
+#include "util/WorkerGroup.hpp"
 #include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
 #include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
 #include "voxels/voxel.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/norm.hpp>
 
 const float E = 0.03f;
 const float MAX_FIX = 0.1f;
+/// @brief Sensors index cell size
+const float SENSORS_CELL_SIZE = 4.0f;
+/// @brief Number of bodies taken by a physics worker at once
+const size_t BATCH_SIZE = 64;
 
-PhysicsSolver::PhysicsSolver(glm::vec3 gravity) : gravity(gravity) {
+PhysicsSolver::PhysicsSolver(glm::vec3 gravity)
+    : gravity(gravity), sensorsIndex(SENSORS_CELL_SIZE) {
+}
+
+AABB PhysicsSolver::getSensorBounds(const Sensor& sensor) {
+    switch (sensor.type) {
+        case SensorType::AABB:
+            return sensor.calculated.aabb;
+        case SensorType::RADIUS: {
+            glm::vec3 center(sensor.calculated.radial);
+            // w is squared radius
+            glm::vec3 radius(std::sqrt(sensor.calculated.radial.w));
+            return AABB(center - radius, center + radius);
+        }
+    }
+    return AABB();
+}
+
+void PhysicsSolver::setSensors(std::vector<Sensor*> sensors) {
+    this->sensors = std::move(sensors);
+    sensorsIndex.clear();
+    for (auto sensor : this->sensors) {
+        sensorsIndex.update(sensor, getSensorBounds(*sensor));
+    }
+}
+
+/// @brief Check if block obstacle box overlaps the area.
+/// Box max bounds are exclusive like in AABB::contains, so a body fixed
+/// right on a block face does not touch it
+static inline bool overlaps(const AABB& box, const AABB& area) {
+    return box.a.x <= area.b.x && box.b.x > area.a.x &&
+           box.a.y <= area.b.y && box.b.y > area.a.y &&
+           box.a.z <= area.b.z && box.b.z > area.a.z;
+}
+
+static bool has_obstacle(const std::vector<AABB>& obstacles, const AABB& area) {
+    for (const auto& box : obstacles) {
+        if (overlaps(box, area)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Find the nearest obstacle overlapping the area
+/// @param axis direction axis
+/// @param positive direction sign
+/// @return obstacle box or nullptr
+static const AABB* find_obstacle(
+    const std::vector<AABB>& obstacles, const AABB& area, int axis, bool positive
+) {
+    const AABB* nearest = nullptr;
+    for (const auto& box : obstacles) {
+        if (!overlaps(box, area)) {
+            continue;
+        }
+        if (nearest == nullptr ||
+            (positive ? box.a[axis] < nearest->a[axis]
+                      : box.b[axis] > nearest->b[axis])) {
+            nearest = &box;
+        }
+    }
+    return nearest;
+}
+
+/// @brief Collect obstacle boxes of blocks in the area (world coordinates).
+/// Missing chunks and blocks below the world are full obstacles
+/// like in GlobalChunks::isObstacleAt
+static void collect_obstacles(
+    const GlobalChunks& chunks, const AABB& area, std::vector<AABB>& dst
+) {
+    dst.clear();
+    glm::ivec3 min = glm::floor(area.a);
+    glm::ivec3 max = glm::floor(area.b);
+    const auto& blocks = chunks.getContentIndices().blocks;
+    for (int z = min.z; z <= max.z; z++) {
+        for (int x = min.x; x <= max.x; x++) {
+            int cx = floordiv<CHUNK_W>(x);
+            int cz = floordiv<CHUNK_D>(z);
+            const Chunk* chunk = chunks.getChunk(cx, cz);
+            for (int y = min.y; y <= max.y && y < CHUNK_H; y++) {
+                glm::vec3 pos(x, y, z);
+                if (chunk == nullptr || y < 0) {
+                    dst.emplace_back(pos, pos + 1.0f);
+                    continue;
+                }
+                // sections of air only are skipped without voxels access
+                if (chunk->voxels.isEmpty(y / CHUNK_SECTION_H)) {
+                    y = (y / CHUNK_SECTION_H + 1) * CHUNK_SECTION_H - 1;
+                    continue;
+                }
+                int lx = x - cx * CHUNK_W;
+                int lz = z - cz * CHUNK_D;
+                const voxel& vox = chunk->voxels[vox_index(lx, y, lz)];
+                const auto& def = blocks.require(vox.id);
+                if (!def.obstacle) {
+                    continue;
+                }
+                const auto& boxes = def.rotatable
+                                        ? def.rt.hitboxes[vox.state.rotation]
+                                        : def.hitboxes;
+                if (vox.state.segment) {
+                    // extended block boxes are taken from the origin
+                    glm::ivec3 origin = blocks_agent::seek_origin(
+                        chunks, glm::ivec3(x, y, z), def, vox.state
+                    );
+                    for (const auto& box : boxes) {
+                        dst.emplace_back(
+                            glm::vec3(origin) + box.min(),
+                            glm::vec3(origin) + box.max()
+                        );
+                    }
+                    continue;
+                }
+                for (const auto& box : boxes) {
+                    // block cell is checked only, as in point sampling
+                    dst.emplace_back(
+                        pos + glm::clamp(box.min(), 0.0f, 1.0f),
+                        pos + glm::clamp(box.max(), 0.0f, 1.0f)
+                    );
+                }
+            }
+        }
+    }
+}
+
+/// @brief Resolve collision along the axis
+/// @tparam nx movement axis
+/// @tparam ny, nz other axes
+/// @return true if collided
+template <int nx, int ny, int nz>
+static bool calc_collision(
+    const std::vector<AABB>& obstacles,
+    glm::vec3& pos,
+    glm::vec3& vel,
+    const glm::vec3& half,
+    float stepHeight
+) {
+    if (vel[nx] == 0.0f) {
+        return false;
+    }
+    bool positive = vel[nx] > 0.0f;
+    glm::vec3 offset(0.0f, stepHeight, 0.0f);
+    // body face moved forward by E
+    AABB area;
+    area.a[ny] = (pos + offset)[ny] - half[ny] + E;
+    area.b[ny] = pos[ny] + half[ny] - E;
+    area.a[nz] = pos[nz] - half[nz] + E;
+    area.b[nz] = pos[nz] + half[nz] - E;
+    area.a[nx] = area.b[nx] = positive ? pos[nx] + half[nx] + E
+                                       : pos[nx] - half[nx] - E;
+
+    auto box = find_obstacle(obstacles, area, nx, positive);
+    if (box == nullptr) {
+        return false;
+    }
+    vel[nx] = 0.0f;
+    float newx = positive ? box->a[nx] - half[nx] - E
+                          : box->b[nx] + half[nx] + E;
+    if (std::abs(newx - pos[nx]) <= MAX_FIX) {
+        pos[nx] = newx;
+    }
+    return true;
+}
+
+/// @brief Area of the body bottom (or top) face moved down (up) by E
+static AABB face_area(
+    const glm::vec3& pos, const glm::vec3& half, float y
+) {
+    return AABB(
+        glm::vec3(pos.x - half.x + E, y, pos.z - half.z + E),
+        glm::vec3(pos.x + half.x - E, y, pos.z + half.z - E)
+    );
 }
 
 void PhysicsSolver::step(
     const GlobalChunks& chunks, 
     Hitbox& hitbox, 
     float delta, 
-    uint substeps, 
-    entityid_t entity
+    uint substeps
 ) {
     float dt = delta / static_cast<float>(substeps);
     float linearDamping = hitbox.linearDamping;
-    float s = 2.0f/BLOCK_AABB_GRID;
+    thread_local std::vector<AABB> edgeObstacles;
 
     const glm::vec3& half = hitbox.halfsize;
     glm::vec3& pos = hitbox.position;
@@ -56,150 +235,91 @@ void PhysicsSolver::step(
             pos.y = py;
         }
 
-        if (hitbox.crouching && hitbox.grounded){
-            float y = (pos.y-half.y-E);
-            hitbox.grounded = false;
-            for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-                float x = (px-half.x+E) + ix * s;
-                for (int iz = 0; iz <= (half.z-E)*2/s; iz++){
-                    float z = (pos.z-half.z+E) + iz * s;
-                    if (chunks.isObstacleAt(x,y,z)){
-                        hitbox.grounded = true;
-                        break;
-                    }
-                }
-            }
-            if (!hitbox.grounded) {
+        if (hitbox.crouching && hitbox.grounded) {
+            // crouching body does not leave the supporting blocks
+            glm::vec3 prev(px, py, pz);
+            glm::vec3 reach(E);
+            collect_obstacles(
+                chunks,
+                AABB(
+                    glm::min(prev, pos) - half - reach,
+                    glm::max(prev, pos) + half + reach
+                ),
+                edgeObstacles
+            );
+            float y = pos.y - half.y - E;
+            if (!has_obstacle(
+                    edgeObstacles, face_area(glm::vec3(px, 0, pos.z), half, y)
+                )) {
                 pos.z = pz;
             }
-            hitbox.grounded = false;
-            for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-                float x = (pos.x-half.x+E) + ix * s;
-                for (int iz = 0; iz <= (half.z-E)*2/s; iz++){
-                    float z = (pz-half.z+E) + iz * s;
-                    if (chunks.isObstacleAt(x,y,z)){
-                        hitbox.grounded = true;
-                        break;
-                    }
-                }
-            }
-            if (!hitbox.grounded) {
+            if (!has_obstacle(
+                    edgeObstacles, face_area(glm::vec3(pos.x, 0, pz), half, y)
+                )) {
                 pos.x = px;
             }
             hitbox.grounded = true;
         }
     }
-    AABB aabb;
-    aabb.a = hitbox.position - hitbox.halfsize;
-    aabb.b = hitbox.position + hitbox.halfsize;
-    for (size_t i = 0; i < sensors.size(); i++) {
-        auto& sensor = *sensors[i];
-        if (sensor.entity == entity) {
-            continue;
-        }
-
-        bool triggered = false;
-        switch (sensor.type) {
-            case SensorType::AABB:
-                triggered = aabb.intersect(sensor.calculated.aabb);
-                break;
-            case SensorType::RADIUS:
-                triggered = glm::distance2(
-                    hitbox.position, glm::vec3(sensor.calculated.radial))
-                     < sensor.calculated.radial.w;
-                break;
-        }
-        if (triggered) {
-            if (sensor.prevEntered.find(entity) == sensor.prevEntered.end()) {
-                sensor.enterCallback(sensor.entity, sensor.index, entity);
-            }
-            sensor.nextEntered.insert(entity);
-        }
-    }
 }
 
-static float calc_step_height(
-    const GlobalChunks& chunks, 
-    const glm::vec3& pos, 
-    const glm::vec3& half,
-    float stepHeight,
-    float s
+void PhysicsSolver::stepBodies(
+    const GlobalChunks& chunks,
+    const std::vector<Hitbox*>& bodies,
+    float delta,
+    util::WorkerGroup* workers
 ) {
-    if (stepHeight > 0.0f) {
-        for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-            float x = (pos.x-half.x+E) + ix * s;
-            for (int iz = 0; iz <= (half.z-E)*2/s; iz++) {
-                float z = (pos.z-half.z+E) + iz * s;
-                if (chunks.isObstacleAt(x, pos.y+half.y+stepHeight, z)) {
-                    return 0.0f;
-                }
+    size_t batches = (bodies.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+    std::atomic<size_t> nextBatch = 0;
+    auto stepBatches = [&](uint) {
+        size_t batch;
+        while ((batch = nextBatch++) < batches) {
+            size_t end = std::min(bodies.size(), (batch + 1) * BATCH_SIZE);
+            for (size_t i = batch * BATCH_SIZE; i < end; i++) {
+                auto& hitbox = *bodies[i];
+                float vel = glm::length(hitbox.velocity);
+                int substeps = static_cast<int>(delta * vel * 20);
+                substeps = std::min(100, std::max(2, substeps));
+                step(chunks, hitbox, delta, substeps);
+                hitbox.linearDamping = hitbox.grounded * 24;
             }
         }
+    };
+    if (workers && batches > 1) {
+        workers->run(stepBatches);
+    } else {
+        stepBatches(0);
     }
-    return stepHeight;
 }
 
-template <int nx, int ny, int nz>
-static bool calc_collision_neg(
-    const GlobalChunks& chunks,
-    glm::vec3& pos,
-    glm::vec3& vel,
-    const glm::vec3& half,
-    float stepHeight,
-    float s
-) {
-    if (vel[nx] >= 0.0f) {
-        return false;
-    }
-    glm::vec3 offset(0.0f, stepHeight, 0.0f);
-    for (int iy = 0; iy <= ((half-offset*0.5f)[ny]-E)*2/s; iy++) {
-        glm::vec3 coord;
-        coord[ny] = ((pos+offset)[ny]-half[ny]+E) + iy * s;
-        for (int iz = 0; iz <= (half[nz]-E)*2/s; iz++){
-            coord[nz] = (pos[nz]-half[nz]+E) + iz * s;
-            coord[nx] = (pos[nx]-half[nx]-E);
-
-            if (const auto aabb = chunks.isObstacleAt(coord.x, coord.y, coord.z)) {
-                vel[nx] = 0.0f;
-                float newx = std::floor(coord[nx]) + aabb->max()[nx] + half[nx] + E;
-                if (std::abs(newx-pos[nx]) <= MAX_FIX) {
-                    pos[nx] = newx;
-                }
-                return true;
-            }
-        }
-    }
-    return false;
+void PhysicsSolver::checkSensors(const Hitbox& hitbox, entityid_t entity) {
+    sensorsIndex.query(hitbox.getAABB(), [&](Sensor* sensor, const AABB&) {
+        checkSensor(*sensor, hitbox, entity);
+    });
 }
 
-template <int nx, int ny, int nz>
-static void calc_collision_pos(
-    const GlobalChunks& chunks,
-    glm::vec3& pos,
-    glm::vec3& vel,
-    const glm::vec3& half,
-    float stepHeight,
-    float s
+void PhysicsSolver::checkSensor(
+    Sensor& sensor, const Hitbox& hitbox, entityid_t entity
 ) {
-    if (vel[nx] <= 0.0f) {
+    if (sensor.entity == entity) {
         return;
     }
-    glm::vec3 offset(0.0f, stepHeight, 0.0f);
-    for (int iy = 0; iy <= ((half-offset*0.5f)[ny]-E)*2/s; iy++) {
-        glm::vec3 coord;
-        coord[ny] = ((pos+offset)[ny]-half[ny]+E) + iy * s;
-        for (int iz = 0; iz <= (half[nz]-E)*2/s; iz++) {
-            coord[nz] = (pos[nz]-half[nz]+E) + iz * s;
-            coord[nx] = (pos[nx]+half[nx]+E);
-            if (const auto aabb = chunks.isObstacleAt(coord.x, coord.y, coord.z)) {
-                vel[nx] = 0.0f;
-                float newx = std::floor(coord[nx]) - half[nx] + aabb->min()[nx] - E;
-                if (std::abs(newx-pos[nx]) <= MAX_FIX) {
-                    pos[nx] = newx;
-                }
-                return;
-            }
+    bool triggered = false;
+    switch (sensor.type) {
+        case SensorType::AABB:
+            triggered = hitbox.getAABB().intersect(sensor.calculated.aabb);
+            break;
+        case SensorType::RADIUS:
+            triggered = glm::distance2(
+                hitbox.position, glm::vec3(sensor.calculated.radial))
+                 < sensor.calculated.radial.w;
+            break;
+    }
+    if (triggered) {
+        if (sensor.prevEntered.find(entity) == sensor.prevEntered.end()) {
+            sensor.enterCallback(sensor.entity, sensor.index, entity);
         }
+        sensor.nextEntered.insert(entity);
     }
 }
 
@@ -211,54 +331,52 @@ void PhysicsSolver::colisionCalc(
     const glm::vec3 half,
     float stepHeight
 ) {
-    // step size (smaller - more accurate, but slower)
-    float s = 2.0f/BLOCK_AABB_GRID;
-
-    stepHeight = calc_step_height(chunks, pos, half, stepHeight, s);
+    // obstacles are collected once for all checks: position may be fixed
+    // by MAX_FIX and step height only
+    thread_local std::vector<AABB> obstacles;
+    glm::vec3 reach(E + MAX_FIX + stepHeight);
+    collect_obstacles(
+        chunks, AABB(pos - half - reach, pos + half + reach), obstacles
+    );
+    if (obstacles.empty()) {
+        return;
+    }
 
-    const AABB* aabb;
-    
-    calc_collision_neg<0, 1, 2>(chunks, pos, vel, half, stepHeight, s);
-    calc_collision_pos<0, 1, 2>(chunks, pos, vel, half, stepHeight, s);
+    if (stepHeight > 0.0f && has_obstacle(
+        obstacles, face_area(pos, half, pos.y + half.y + stepHeight)
+    )) {
+        stepHeight = 0.0f;
+    }
 
-    calc_collision_neg<2, 1, 0>(chunks, pos, vel, half, stepHeight, s);
-    calc_collision_pos<2, 1, 0>(chunks, pos, vel, half, stepHeight, s);
+    calc_collision<0, 1, 2>(obstacles, pos, vel, half, stepHeight);
+    calc_collision<2, 1, 0>(obstacles, pos, vel, half, stepHeight);
 
-    if (calc_collision_neg<1, 0, 2>(chunks, pos, vel, half, stepHeight, s)) {
+    if (vel.y < 0.0f &&
+        calc_collision<1, 0, 2>(obstacles, pos, vel, half, stepHeight)) {
         hitbox.grounded = true;
     }
 
-    if (stepHeight > 0.0 && vel.y <= 0.0f){
-        for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-            float x = (pos.x-half.x+E) + ix * s;
-            for (int iz = 0; iz <= (half.z-E)*2/s; iz++) {
-                float z = (pos.z-half.z+E) + iz * s;
-                float y = (pos.y-half.y+E);
-                if ((aabb = chunks.isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = std::floor(y) + aabb->max().y + half.y;
-                    if (std::abs(newy-pos.y) <= MAX_FIX+stepHeight) {
-                        pos.y = newy;    
-                    }
-                    break;
-                }
+    if (stepHeight > 0.0 && vel.y <= 0.0f) {
+        float y = pos.y - half.y + E;
+        if (auto box = find_obstacle(
+                obstacles, face_area(pos, half, y), 1, false
+            )) {
+            vel.y = 0.0f;
+            float newy = box->b.y + half.y;
+            if (std::abs(newy - pos.y) <= MAX_FIX + stepHeight) {
+                pos.y = newy;
             }
         }
     }
-    if (vel.y > 0.0f){
-        for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-            float x = (pos.x-half.x+E) + ix * s;
-            for (int iz = 0; iz <= (half.z-E)*2/s; iz++) {
-                float z = (pos.z-half.z+E) + iz * s;
-                float y = (pos.y+half.y+E);
-                if ((aabb = chunks.isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = std::floor(y) - half.y + aabb->min().y - E;
-                    if (std::abs(newy-pos.y) <= MAX_FIX) {
-                        pos.y = newy;
-                    }
-                    break;
-                }
+    if (vel.y > 0.0f) {
+        float y = pos.y + half.y + E;
+        if (auto box = find_obstacle(
+                obstacles, face_area(pos, half, y), 1, true
+            )) {
+            vel.y = 0.0f;
+            float newy = box->a.y - half.y - E;
+            if (std::abs(newy - pos.y) <= MAX_FIX) {
+                pos.y = newy;
             }
         }
     }
@@ -292,4 +410,5 @@ bool PhysicsSolver::isBlockInside(int x, int y, int z, Block* def, blockstate st
 
 void PhysicsSolver::removeSensor(Sensor* sensor) {
     sensors.erase(std::remove(sensors.begin(), sensors.end(), sensor), sensors.end());
+    sensorsIndex.remove(sensor);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Hitbox.hpp"
+#include "SpatialGrid.hpp"
 
 #include "typedefs.hpp"
 #include "voxels/voxel.hpp"
@@ -12,18 +13,47 @@ class Block;
 class GlobalChunks;
 struct Sensor;
 
+namespace util {
+    class WorkerGroup;
+}
+
 class PhysicsSolver {
     glm::vec3 gravity;
     std::vector<Sensor*> sensors;
+    /// @brief Sensors bounds index checked against each stepped body
+    SpatialGrid<Sensor*> sensorsIndex;
 public:
     PhysicsSolver(glm::vec3 gravity);
+
+    /// @brief Integrate and collide the body with blocks. Modifies the
+    /// hitbox only, so bodies may be stepped from multiple threads at once
+    /// while chunks are not modified
     void step(
         const GlobalChunks& chunks,
         Hitbox& hitbox,
         float delta,
-        uint substeps,
-        entityid_t entity
+        uint substeps
+    );
+
+    /// @brief Step bodies of a physics tick in batches on the workers.
+    /// Bodies are stepped independently, so the result does not depend on
+    /// the workers count
+    /// @param workers workers group, nullptr to step on the calling thread
+    void stepBodies(
+        const GlobalChunks& chunks,
+        const std::vector<Hitbox*>& bodies,
+        float delta,
+        util::WorkerGroup* workers
     );
+
+    /// @brief Check the stepped body against sensors, calling enter
+    /// callbacks. Main thread only
+    void checkSensors(const Hitbox& hitbox, entityid_t entity);
+
+    /// @brief Check the body against the sensor, calling enter callback.
+    /// Used for resting bodies that are not stepped
+    void checkSensor(Sensor& sensor, const Hitbox& hitbox, entityid_t entity);
+
     void colisionCalc(
         const GlobalChunks& chunks,
         Hitbox& hitbox,
@@ -35,9 +65,12 @@ public:
     bool isBlockInside(int x, int y, int z, Hitbox* hitbox);
     bool isBlockInside(int x, int y, int z, Block* def, blockstate state, Hitbox* hitbox);
 
-    void setSensors(std::vector<Sensor*> sensors) {
-        this->sensors = std::move(sensors);
-    }
+    /// @brief Set sensors checked on steps (calculated params must be
+    /// up to date)
+    void setSensors(std::vector<Sensor*> sensors);
+
+    /// @return bounding box of the sensor calculated area
+    static AABB getSensorBounds(const Sensor& sensor);
 
     void removeSensor(Sensor* sensor);
 };
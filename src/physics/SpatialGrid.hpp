@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "maths/aabb.hpp"
+
+/// @brief Broadphase index of boxes: uniform grid of cubic cells, each
+/// cell lists boxes overlapping it. Values are unique keys of the boxes
+/// (entity ids, sensor pointers). Not thread-safe, queries included
+template <typename T>
+class SpatialGrid {
+    /// @brief Boxes covering more cells are kept in a separate list
+    /// checked on every query
+    static inline constexpr int MAX_ITEM_CELLS = 64;
+
+    struct Item {
+        T value;
+        AABB aabb;
+        glm::ivec3 min;
+        glm::ivec3 max;
+        bool large;
+        bool alive;
+        /// @brief Last query reported the item (to report it once)
+        uint32_t stamp;
+    };
+
+    float cellSize;
+    std::vector<Item> items;
+    std::vector<size_t> freeSlots;
+    std::unordered_map<T, size_t> slots;
+    std::unordered_map<glm::ivec3, std::vector<size_t>> cells;
+    std::vector<size_t> largeItems;
+    uint32_t stamp = 0;
+
+    static bool overlaps(const AABB& a, const AABB& b) {
+        return a.a.x <= b.b.x && a.b.x >= b.a.x && a.a.y <= b.b.y &&
+               a.b.y >= b.a.y && a.a.z <= b.b.z && a.b.z >= b.a.z;
+    }
+
+    /// @brief Calculate cells range covered by the box
+    /// @param count [out] cells count
+    /// @return false if the box is not finite or is out of cells range
+    bool calcRange(
+        const AABB& aabb, glm::ivec3& min, glm::ivec3& max, size_t& count
+    ) const {
+        constexpr float LIMIT = 1 << 24;
+        constexpr size_t MAX_COUNT = size_t(1) << 32;
+        glm::vec3 from = glm::floor(aabb.a / cellSize);
+        glm::vec3 to = glm::floor(aabb.b / cellSize);
+        count = 1;
+        for (int i = 0; i < 3; i++) {
+            // NaN fails the check too
+            if (!(std::abs(from[i]) < LIMIT && std::abs(to[i]) < LIMIT)) {
+                return false;
+            }
+            min[i] = static_cast<int>(from[i]);
+            max[i] = std::max(static_cast<int>(to[i]), min[i]);
+            size_t span = max[i] - min[i] + 1;
+            count = count > MAX_COUNT / span ? MAX_COUNT : count * span;
+        }
+        return true;
+    }
+
+    template <typename Func>
+    static void forEachCell(
+        const glm::ivec3& min, const glm::ivec3& max, Func&& func
+    ) {
+        for (int y = min.y; y <= max.y; y++) {
+            for (int z = min.z; z <= max.z; z++) {
+                for (int x = min.x; x <= max.x; x++) {
+                    func(glm::ivec3(x, y, z));
+                }
+            }
+        }
+    }
+
+    static void erase(std::vector<size_t>& list, size_t slot) {
+        for (size_t i = 0; i < list.size(); i++) {
+            if (list[i] == slot) {
+                list[i] = list.back();
+                list.pop_back();
+                return;
+            }
+        }
+    }
+
+    void link(size_t slot) {
+        auto& item = items[slot];
+        if (item.large) {
+            largeItems.push_back(slot);
+            return;
+        }
+        forEachCell(item.min, item.max, [this, slot](const glm::ivec3& cell) {
+            cells[cell].push_back(slot);
+        });
+    }
+
+    void unlink(size_t slot) {
+        auto& item = items[slot];
+        if (item.large) {
+            erase(largeItems, slot);
+            return;
+        }
+        forEachCell(item.min, item.max, [this, slot](const glm::ivec3& cell) {
+            auto found = cells.find(cell);
+            if (found != cells.end()) {
+                erase(found->second, slot);
+            }
+        });
+    }
+
+    template <typename Func>
+    void check(Item& item, const AABB& aabb, Func& func) {
+        if (item.stamp == stamp) {
+            return;
+        }
+        item.stamp = stamp;
+        if (overlaps(item.aabb, aabb)) {
+            func(item.value, item.aabb);
+        }
+    }
+public:
+    /// @param cellSize grid cell size, should be a bit larger than most
+    /// of the boxes
+    explicit SpatialGrid(float cellSize) : cellSize(cellSize) {
+    }
+
+    /// @brief Add box or update the existing one. Cells lists are changed
+    /// only if the box moves to other cells
+    void update(const T& value, const AABB& aabb) {
+        glm::ivec3 min {};
+        glm::ivec3 max {};
+        size_t count;
+        bool large = !calcRange(aabb, min, max, count) ||
+                     count > MAX_ITEM_CELLS;
+
+        auto found = slots.find(value);
+        if (found != slots.end()) {
+            auto& item = items[found->second];
+            if (item.large == large &&
+                (large || (item.min == min && item.max == max))) {
+                item.aabb = aabb;
+                return;
+            }
+            unlink(found->second);
+            item = Item {value, aabb, min, max, large, true, stamp};
+            link(found->second);
+            return;
+        }
+        size_t slot;
+        if (freeSlots.empty()) {
+            slot = items.size();
+            items.push_back(Item {value, aabb, min, max, large, true, stamp});
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            items[slot] = Item {value, aabb, min, max, large, true, stamp};
+        }
+        slots[value] = slot;
+        link(slot);
+    }
+
+    void remove(const T& value) {
+        auto found = slots.find(value);
+        if (found == slots.end()) {
+            return;
+        }
+        size_t slot = found->second;
+        unlink(slot);
+        items[slot].alive = false;
+        freeSlots.push_back(slot);
+        slots.erase(found);
+    }
+
+    /// @brief Remove all boxes. Cells memory is kept for reuse
+    void clear() {
+        for (auto& [_, list] : cells) {
+            list.clear();
+        }
+        // cells of a moving crowd are reused, far ones are dropped
+        if (cells.size() > items.size() * 4 + 64) {
+            cells.clear();
+        }
+        items.clear();
+        freeSlots.clear();
+        slots.clear();
+        largeItems.clear();
+    }
+
+    /// @brief Call func(value, aabb) once for each box overlapping aabb
+    /// (boxes touching it included)
+    template <typename Func>
+    void query(const AABB& aabb, Func&& func) {
+        if (slots.empty()) {
+            return;
+        }
+        if (++stamp == 0) {
+            for (auto& item : items) {
+                item.stamp = 0;
+            }
+            stamp = 1;
+        }
+        glm::ivec3 min {};
+        glm::ivec3 max {};
+        size_t count;
+        if (!calcRange(aabb, min, max, count) || count > slots.size()) {
+            // checking all boxes is cheaper than visiting the cells
+            for (auto& item : items) {
+                if (item.alive) {
+                    check(item, aabb, func);
+                }
+            }
+            return;
+        }
+        forEachCell(min, max, [&](const glm::ivec3& cell) {
+            auto found = cells.find(cell);
+            if (found == cells.end()) {
+                return;
+            }
+            for (size_t slot : found->second) {
+                check(items[slot], aabb, func);
+            }
+        });
+        for (size_t slot : largeItems) {
+            check(items[slot], aabb, func);
+        }
+    }
+
+    size_t size() const {
+        return slots.size();
+    }
+};
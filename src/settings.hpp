@@ -40,6 +40,33 @@ struct ChunksSettings {
     IntegerSetting loadDistance {22, 3, 80};
     /// @brief Buffer zone where chunks are not unloading (chunk is unit)
     IntegerSetting padding {2, 1, 8};
+    /// @brief Limit of threads generating chunk voxels, 1 - generate chunks
+    /// on the main thread (0 is all cores, -n is 1/n of cores)
+    IntegerSetting generatorWorkers {-2, -4, 32};
+    /// @brief Limit of threads used to build loaded chunks lights including
+    /// the main thread (0 is all cores, -n is 1/n of cores)
+    IntegerSetting lightingWorkers {-4, -4, 32};
+    /// @brief Memory budget of chunk prototypes not required by players
+    /// generation areas (megabytes)
+    IntegerSetting generatorCacheSize {256, 16, 4096};
+    /// @brief Memory budget of world regions kept in memory (megabytes)
+    IntegerSetting regionsCacheSize {128, 16, 4096};
+    /// @brief Max open region files of each regions layer
+    IntegerSetting regionFilesLimit {32, 4, 1024};
+    /// @brief Region files compression method of chunks voxels
+    /// (extrle16, lz4, deflate, gzip, none)
+    StringSetting voxelsCodec {"extrle16"};
+    /// @brief Region files compression method of chunks lights
+    StringSetting lightsCodec {"extrle8"};
+    /// @brief Compress voxels with a dictionary trained on the world saved
+    /// chunks (lz4 and deflate only)
+    FlagSetting voxelsDictionary {false};
+};
+
+struct PhysicsSettings {
+    /// @brief Limit of threads used to step entities physics including the
+    /// main thread (0 is all cores, -n is 1/n of cores)
+    IntegerSetting workers {-4, -4, 32};
 };
 
 struct CameraSettings {
@@ -65,6 +92,8 @@ struct GraphicsSettings {
     FlagSetting backlight {true};
     /// @brief Disable culling with 'optional' mode
     FlagSetting denseRender {true};
+    /// @brief Merge equal coplanar faces of full blocks into larger quads
+    FlagSetting greedyMeshing {false};
     /// @brief Enable chunks frustum culling
     FlagSetting frustumCulling {true};
     /// @brief Skybox texture face resolution
@@ -96,6 +125,7 @@ struct EngineSettings {
     AudioSettings audio;
     DisplaySettings display;
     ChunksSettings chunks;
+    PhysicsSettings physics;
     CameraSettings camera;
     GraphicsSettings graphics;
     DebugSettings debug;
@@ -0,0 +1,144 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#include "debug/Logger.hpp"
+
+using namespace util;
+
+static debug::Logger logger("job-system");
+
+static thread_local const JobSystem* current_system = nullptr;
+static thread_local uint current_index = 0;
+
+JobSystem::Queue::Queue() : top(INT_MIN) {
+}
+
+void JobSystem::Queue::push(Job job) {
+    std::lock_guard lock(mutex);
+    job.sequence = sequence++;
+    heap.push_back(std::move(job));
+    std::push_heap(heap.begin(), heap.end());
+    top = heap.front().priority;
+}
+
+bool JobSystem::Queue::pop(Job& job) {
+    std::lock_guard lock(mutex);
+    if (heap.empty()) {
+        return false;
+    }
+    std::pop_heap(heap.begin(), heap.end());
+    job = std::move(heap.back());
+    heap.pop_back();
+    top = heap.empty() ? INT_MIN : heap.front().priority;
+    return true;
+}
+
+JobSystem::JobSystem(uint threadsCount) {
+    threadsCount = std::max(1U, threadsCount);
+    for (uint i = 0; i < threadsCount; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (uint i = 0; i < threadsCount; i++) {
+        threads.emplace_back(&JobSystem::threadLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(sleepMutex);
+        working = false;
+    }
+    sleepCondition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool JobSystem::pop(uint index, Job& job) {
+    size_t count = queues.size();
+    while (pending > 0) {
+        // own queue wins on equal priorities
+        uint best = index;
+        int bestPriority = queues[index]->top;
+        for (size_t i = 1; i < count; i++) {
+            uint other = (index + i) % count;
+            int priority = queues[other]->top;
+            if (priority > bestPriority) {
+                best = other;
+                bestPriority = priority;
+            }
+        }
+        if (bestPriority == INT_MIN) {
+            return false;
+        }
+        if (queues[best]->pop(job)) {
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::threadLoop(uint index) {
+    current_system = this;
+    current_index = index;
+
+    Job job;
+    while (working) {
+        if (pop(index, job)) {
+            if (job.token == nullptr || !job.token->isCancelled()) {
+                try {
+                    job.task();
+                } catch (const std::exception& err) {
+                    logger.error() << "uncaught exception: " << err.what();
+                }
+            }
+            // release captured resources before sleeping
+            job = {};
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        sleeping++;
+        sleepCondition.wait(lock, [this] {
+            return pending > 0 || !working;
+        });
+        sleeping--;
+    }
+}
+
+void JobSystem::submit(
+    std::function<void()> task, int priority, std::shared_ptr<JobToken> token
+) {
+    // INT_MIN marks empty queue
+    priority = std::max(priority, INT_MIN + 1);
+    uint index;
+    if (current_system == this) {
+        index = current_index;
+    } else {
+        index = nextQueue++ % queues.size();
+    }
+    // counted before push, so pop never makes it negative
+    pending++;
+    queues[index]->push(
+        Job {std::move(task), std::move(token), priority, 0}
+    );
+    if (sleeping > 0) {
+        { std::lock_guard lock(sleepMutex); }
+        sleepCondition.notify_one();
+    }
+}
+
+bool JobSystem::isWorkerThread() const {
+    return current_system == this;
+}
+
+JobSystem& JobSystem::getInstance() {
+    static JobSystem instance([]() {
+        uint cores = std::thread::hardware_concurrency();
+        // the main thread is busy with its own work
+        return cores > 1 ? cores - 1 : 1;
+    }());
+    return instance;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "typedefs.hpp"
+
+namespace util {
+    /// @brief Cancellation flag shared by a group of jobs. Jobs of the
+    /// cancelled group are skipped if not started yet
+    class JobToken {
+        std::atomic<bool> cancelled = false;
+    public:
+        void cancel() {
+            cancelled = true;
+        }
+
+        bool isCancelled() const {
+            return cancelled;
+        }
+    };
+
+    /// @brief Engine-wide work-stealing jobs scheduler.
+    /// Every thread owns a priority queue. Jobs submitted from outside are
+    /// distributed between queues, jobs submitted from a scheduler thread
+    /// go to its own queue. Idle threads steal jobs from other queues,
+    /// preferring the queue with the highest priority job.
+    class JobSystem {
+        struct Job {
+            std::function<void()> task;
+            std::shared_ptr<JobToken> token;
+            int priority;
+            uint64_t sequence;
+
+            /// @brief Heap order: higher priority first, then FIFO
+            inline bool operator<(const Job& o) const {
+                if (priority != o.priority) {
+                    return priority < o.priority;
+                }
+                return sequence > o.sequence;
+            }
+        };
+
+        struct Queue {
+            std::mutex mutex;
+            std::vector<Job> heap;
+            uint64_t sequence = 0;
+            /// @brief Priority of the top job, INT_MIN if queue is empty
+            std::atomic<int> top;
+
+            Queue();
+            void push(Job job);
+            bool pop(Job& job);
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        /// @brief Number of jobs in all queues
+        std::atomic<size_t> pending = 0;
+        /// @brief Number of threads waiting for jobs
+        std::atomic<uint> sleeping = 0;
+        std::atomic<uint> nextQueue = 0;
+        std::atomic<bool> working = true;
+
+        bool pop(uint index, Job& job);
+        void threadLoop(uint index);
+    public:
+        /// @param threadsCount number of scheduler threads (at least 1)
+        JobSystem(uint threadsCount);
+        JobSystem(const JobSystem&) = delete;
+        ~JobSystem();
+
+        /// @brief Submit a job
+        /// @param task job function. Exceptions are logged and ignored
+        /// @param priority jobs with greater priority are started earlier
+        /// @param token optional cancellation token
+        void submit(
+            std::function<void()> task,
+            int priority = 0,
+            std::shared_ptr<JobToken> token = nullptr
+        );
+
+        /// @return number of jobs waiting to be started
+        size_t getPendingCount() const {
+            return pending;
+        }
+
+        uint getThreadsCount() const {
+            return threads.size();
+        }
+
+        /// @return true if called from one of the scheduler threads
+        bool isWorkerThread() const;
+
+        /// @brief Engine-wide scheduler using all hardware threads but one
+        static JobSystem& getInstance();
+    };
+}
@@ -0,0 +1,75 @@
+#include "SerialWorker.hpp"
+
+#include <utility>
+
+#include "debug/Logger.hpp"
+
+using namespace util;
+
+static debug::Logger logger("serial-worker");
+
+SerialWorker::SerialWorker(std::string name)
+    : name(std::move(name)), thread([this]() { run(); }) {
+}
+
+SerialWorker::~SerialWorker() {
+    {
+        std::lock_guard lock(mutex);
+        stopped = true;
+    }
+    taskCv.notify_one();
+    thread.join();
+}
+
+void SerialWorker::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            busy = false;
+            if (tasks.empty()) {
+                idleCv.notify_all();
+            }
+            taskCv.wait(lock, [this]() { return stopped || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+            busy = true;
+        }
+        try {
+            task();
+        } catch (const std::exception& err) {
+            logger.error() << name << ": " << err.what();
+            std::lock_guard lock(mutex);
+            if (error == nullptr) {
+                error = std::current_exception();
+            }
+        }
+    }
+}
+
+void SerialWorker::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push(std::move(task));
+    }
+    taskCv.notify_one();
+}
+
+void SerialWorker::flush() {
+    if (std::this_thread::get_id() == thread.get_id()) {
+        return;
+    }
+    std::unique_lock lock(mutex);
+    idleCv.wait(lock, [this]() { return !busy && tasks.empty(); });
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+}
+
+bool SerialWorker::isIdle() {
+    std::lock_guard lock(mutex);
+    return !busy && tasks.empty();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+
+namespace util {
+    /// @brief Dedicated thread running tasks one by one in submission order.
+    /// Used for blocking background work like file writes which should not
+    /// occupy JobSystem threads. The first error thrown by a task is kept
+    /// and rethrown by flush
+    class SerialWorker {
+        std::string name;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable taskCv;
+        std::condition_variable idleCv;
+        bool busy = false;
+        bool stopped = false;
+        /// @brief The first task error not rethrown by flush yet
+        std::exception_ptr error;
+        std::thread thread;
+
+        void run();
+    public:
+        SerialWorker(std::string name);
+        /// @brief Finishes all submitted tasks
+        ~SerialWorker();
+
+        void submit(std::function<void()> task);
+
+        /// @brief Wait until all submitted tasks are done. Does nothing if
+        /// called from a task
+        /// @throws the first error thrown by a task since the last flush
+        void flush();
+
+        /// @return true if there are no tasks running or waiting
+        bool isIdle();
+    };
+}
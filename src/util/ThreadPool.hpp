@@ -1,29 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
-#include <iostream>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "debug/Logger.hpp"
 #include "delegates.hpp"
 #include "interfaces/Task.hpp"
+#include "JobSystem.hpp"
 
 namespace util {
 
-    template <class J, class T>
-    struct ThreadPoolResult {
-        J job;
-        std::condition_variable& variable;
-        int workerIndex;
-        bool& locked;
-        T entry;
-    };
-
     template <class T, class R>
     class Worker {
     public:
@@ -32,76 +27,126 @@ namespace util {
         virtual R operator()(const T&) = 0;
     };
 
+    /// @brief Jobs queue processed by a set of workers with results passed
+    /// to the consumer in update().
+    /// Jobs run on the engine JobSystem threads, the pool only limits
+    /// number of simultaneously running jobs by number of workers.
     template <class T, class R>
     class ThreadPool : public Task {
-        debug::Logger logger;
-        std::queue<T> jobs;
-        std::queue<ThreadPoolResult<T, R>> results;
-        std::mutex resultsMutex;
-        std::vector<std::thread> threads;
-        std::condition_variable jobsMutexCondition;
-        std::mutex jobsMutex;
-        std::vector<std::unique_lock<std::mutex>> workersBlocked;
-        consumer<R&> resultConsumer;
-        consumer<T&> onJobFailed = nullptr;
-        runnable onComplete = nullptr;
-        std::atomic<int> busyWorkers = 0;
-        std::atomic<uint> jobsDone = 0;
-        std::atomic<bool> working = true;
-        bool failed = false;
-        bool standaloneResults = true;
-        bool stopOnFail = true;
+        struct QueuedJob {
+            T job;
+            int priority;
+            uint64_t sequence;
+
+            inline bool operator<(const QueuedJob& o) const {
+                if (priority != o.priority) {
+                    return priority < o.priority;
+                }
+                return sequence > o.sequence;
+            }
+        };
+
+        struct Result {
+            T job;
+            R entry;
+            uint workerIndex;
+        };
 
-        void threadLoop(int index, std::shared_ptr<Worker<T, R>> worker) {
-            std::condition_variable variable;
+        /// @brief State shared with scheduled jobs. May outlive the pool
+        /// while cancelled jobs are still in the scheduler queues
+        struct State {
+            debug::Logger logger;
+            JobSystem& system;
+            std::shared_ptr<JobToken> token = std::make_shared<JobToken>();
             std::mutex mutex;
-            bool locked = false;
-            while (working) {
+            std::condition_variable idleCondition;
+            /// @brief Heap of jobs waiting for a free worker
+            std::vector<QueuedJob> jobs;
+            std::queue<Result> results;
+            std::vector<std::shared_ptr<Worker<T, R>>> workers;
+            std::vector<uint> freeWorkers;
+            consumer<T&> onJobFailed = nullptr;
+            /// @brief Number of submitted but not started jobs
+            uint scheduled = 0;
+            uint busyWorkers = 0;
+            uint64_t sequence = 0;
+            std::atomic<uint> jobsDone = 0;
+            bool working = true;
+            bool failed = false;
+            bool standaloneResults = true;
+            bool stopOnFail = true;
+
+            State(std::string name, JobSystem& system)
+                : logger(std::move(name)), system(system) {
+            }
+
+            /// @brief Submit jobs to the scheduler while there are free
+            /// workers for them. Mutex must be locked
+            void dispatch(const std::shared_ptr<State>& self) {
+                while (working && !failed && scheduled < jobs.size() &&
+                       scheduled < freeWorkers.size()) {
+                    scheduled++;
+                    system.submit(
+                        [self]() { self->process(self); },
+                        jobs.front().priority,
+                        token
+                    );
+                }
+            }
+
+            void process(const std::shared_ptr<State>& self) {
                 T job;
+                uint index;
+                std::shared_ptr<Worker<T, R>> worker;
                 {
-                    std::unique_lock<std::mutex> lock(jobsMutex);
-                    jobsMutexCondition.wait(lock, [this] {
-                        return !jobs.empty() || !working;
-                    });
-                    if (!working || failed) {
-                        break;
+                    std::lock_guard lock(mutex);
+                    scheduled--;
+                    if (!working || failed || jobs.empty() ||
+                        freeWorkers.empty()) {
+                        return;
                     }
-                    job = std::move(jobs.front());
-                    jobs.pop();
-
+                    std::pop_heap(jobs.begin(), jobs.end());
+                    job = std::move(jobs.back().job);
+                    jobs.pop_back();
+                    index = freeWorkers.back();
+                    freeWorkers.pop_back();
+                    worker = workers[index];
                     busyWorkers++;
                 }
                 try {
                     R result = (*worker)(job);
-                    {
-                        std::lock_guard<std::mutex> lock(resultsMutex);
-                        results.push(ThreadPoolResult<T, R> {
-                            job, variable, index, locked, result});
-                        if (!standaloneResults) {
-                            locked = true;
-                        }
-                        busyWorkers--;
-                    }
-                    if (!standaloneResults) {
-                        std::unique_lock<std::mutex> lock(mutex);
-                        variable.wait(lock, [&] {
-                            return !working || !locked;
-                        });
+                    std::lock_guard lock(mutex);
+                    results.push(
+                        Result {std::move(job), std::move(result), index}
+                    );
+                    if (standaloneResults) {
+                        freeWorkers.push_back(index);
                     }
                 } catch (std::exception& err) {
-                    busyWorkers--;
+                    logger.error() << "uncaught exception: " << err.what();
                     if (onJobFailed) {
                         onJobFailed(job);
                     }
+                    std::lock_guard lock(mutex);
+                    freeWorkers.push_back(index);
                     if (stopOnFail) {
-                        std::lock_guard<std::mutex> lock(jobsMutex);
                         failed = true;
                     }
-                    logger.error() << "uncaught exception: " << err.what();
                 }
                 jobsDone++;
+
+                std::lock_guard lock(mutex);
+                busyWorkers--;
+                if (busyWorkers == 0) {
+                    idleCondition.notify_all();
+                }
+                dispatch(self);
             }
-        }
+        };
+
+        std::shared_ptr<State> state;
+        consumer<R&> resultConsumer;
+        runnable onComplete = nullptr;
     public:
         static constexpr int UNLIMITED = 0;
         static constexpr int HALF = -2;
@@ -111,36 +156,31 @@ namespace util {
         /// @param name thread pool name (used in logger)
         /// @param workersSupplier workers factory function
         /// @param resultConsumer workers results consumer function
-        /// @param maxWorkers max number of workers. Special values: 0 is 
-        /// unlimited, -2 is half of auto count, -4 is quarter.
+        /// @param maxWorkers max number of workers. Special values: 0 is
+        /// unlimited, -n is 1/n of auto count (-2 is half, -4 is quarter).
+        /// @param system jobs scheduler
         ThreadPool(
             std::string name,
             supplier<std::shared_ptr<Worker<T, R>>> workersSupplier,
             consumer<R&> resultConsumer,
-            int maxWorkers=UNLIMITED
+            int maxWorkers=UNLIMITED,
+            JobSystem& system=JobSystem::getInstance()
         )
-            : logger(std::move(name)), resultConsumer(resultConsumer) {
-            uint numThreads = std::thread::hardware_concurrency();
-            switch (maxWorkers) {
-                case UNLIMITED:
-                    break;
-                case HALF:
-                    numThreads = std::max(1U, numThreads);
-                    break;
-                case QUARTER:
-                    numThreads = std::max(1U, numThreads / 4);
-                    break;
-                default:
-                    numThreads = std::max(
-                        1U, std::min(numThreads, static_cast<uint>(maxWorkers))
-                    );
-                    break;
+            : state(std::make_shared<State>(std::move(name), system)),
+              resultConsumer(resultConsumer) {
+            uint numThreads = system.getThreadsCount();
+            if (maxWorkers < 0) {
+                numThreads = std::max(
+                    1U, numThreads / static_cast<uint>(-maxWorkers)
+                );
+            } else if (maxWorkers != UNLIMITED) {
+                numThreads = std::max(
+                    1U, std::min(numThreads, static_cast<uint>(maxWorkers))
+                );
             }
             for (uint i = 0; i < numThreads; i++) {
-                threads.emplace_back(
-                    &ThreadPool<T, R>::threadLoop, this, i, workersSupplier()
-                );
-                workersBlocked.emplace_back();
+                state->workers.push_back(workersSupplier());
+                state->freeWorkers.push_back(numThreads - i - 1);
             }
         }
         ~ThreadPool() {
@@ -148,113 +188,109 @@ namespace util {
         }
 
         bool isActive() const override {
-            return working;
+            std::lock_guard lock(state->mutex);
+            return state->working;
         }
 
+        /// @brief Cancel queued jobs and wait for running ones
         void terminate() override {
-            if (!working) {
+            std::unique_lock lock(state->mutex);
+            if (!state->working) {
                 return;
             }
-            {
-                std::lock_guard<std::mutex> lock(jobsMutex);
-                working = false;
-            }
-            {
-                std::lock_guard<std::mutex> lock(resultsMutex);
-                while (!results.empty()) {
-                    ThreadPoolResult<T, R> entry = results.front();
-                    results.pop();
-                    if (!standaloneResults) {
-                        entry.locked = false;
-                        entry.variable.notify_all();
-                    }
-                }
-            }
-
-            jobsMutexCondition.notify_all();
-            for (auto& thread : threads) {
-                thread.join();
-            }
+            state->working = false;
+            state->token->cancel();
+            state->jobs.clear();
+            state->idleCondition.wait(lock, [this] {
+                return state->busyWorkers == 0;
+            });
+            state->results = {};
         }
 
         void update() override {
-            if (!working) {
-                return;
-            }
-            if (failed) {
-                throw std::runtime_error("some job failed");
-            }
-
-            bool complete = false;
+            std::vector<Result> results;
             {
-                std::lock_guard<std::mutex> lock(resultsMutex);
-                while (!results.empty()) {
-                    ThreadPoolResult<T, R> entry = results.front();
-                    results.pop();
-
-                    try {
-                        resultConsumer(entry.entry);
-                    } catch (std::exception& err) {
-                        logger.error() << err.what();
-                        if (onJobFailed) {
-                            onJobFailed(entry.job);
-                        }
-                        if (stopOnFail) {
-                            std::lock_guard<std::mutex> jobsLock(jobsMutex);
-                            failed = true;
-                            complete = false;
-                        }
-                        break;
+                std::lock_guard lock(state->mutex);
+                if (!state->working) {
+                    return;
+                }
+                if (state->failed) {
+                    throw std::runtime_error("some job failed");
+                }
+                while (!state->results.empty()) {
+                    results.push_back(std::move(state->results.front()));
+                    state->results.pop();
+                }
+            }
+            for (size_t i = 0; i < results.size(); i++) {
+                auto& result = results[i];
+                try {
+                    resultConsumer(result.entry);
+                } catch (std::exception& err) {
+                    state->logger.error() << err.what();
+                    if (state->onJobFailed) {
+                        state->onJobFailed(result.job);
                     }
-
-                    if (!standaloneResults) {
-                        entry.locked = false;
-                        entry.variable.notify_all();
+                    if (state->stopOnFail) {
+                        std::lock_guard lock(state->mutex);
+                        state->failed = true;
+                        break;
                     }
                 }
-
-                if (onComplete && busyWorkers == 0) {
-                    std::lock_guard<std::mutex> jobsLock(jobsMutex);
-                    if (jobs.empty()) {
-                        onComplete();
-                        complete = true;
-                    }
+                if (!state->standaloneResults) {
+                    std::lock_guard lock(state->mutex);
+                    state->freeWorkers.push_back(result.workerIndex);
+                    state->dispatch(state);
                 }
             }
-            if (failed) {
-                throw std::runtime_error("some job failed");
+            bool complete = false;
+            {
+                std::lock_guard lock(state->mutex);
+                if (state->failed) {
+                    throw std::runtime_error("some job failed");
+                }
+                if (onComplete && state->busyWorkers == 0 &&
+                    state->jobs.empty() && state->results.empty()) {
+                    complete = true;
+                }
             }
             if (complete) {
+                onComplete();
                 terminate();
             }
         }
 
-        void enqueueJob(T job) {
-            {
-                std::lock_guard<std::mutex> lock(jobsMutex);
-                jobs.push(std::move(job));
-            }
-            jobsMutexCondition.notify_one();
+        /// @param job job to process
+        /// @param priority jobs with greater priority are processed earlier
+        void enqueueJob(T job, int priority = 0) {
+            std::lock_guard lock(state->mutex);
+            state->jobs.push_back(
+                QueuedJob {std::move(job), priority, state->sequence++}
+            );
+            std::push_heap(state->jobs.begin(), state->jobs.end());
+            state->dispatch(state);
         }
 
+        /// @brief Remove jobs not started yet
         void clearQueue() {
-            std::lock_guard<std::mutex> lock(jobsMutex);
-            jobs = {};
+            std::lock_guard lock(state->mutex);
+            state->jobs.clear();
         }
 
-        /// @brief If false: worker will be blocked until it's result performed
+        /// @brief If false: worker will not get a new job until it's
+        /// result is performed
         void setStandaloneResults(bool flag) {
-            standaloneResults = flag;
+            state->standaloneResults = flag;
         }
 
         void setStopOnFail(bool flag) {
-            stopOnFail = flag;
+            state->stopOnFail = flag;
         }
 
         /// @brief onJobFailed called on exception thrown in worker thread.
         /// Use engine.postRunnable when calling terminate()
         void setOnJobFailed(consumer<T&> callback) {
-            this->onJobFailed = callback;
+            state->onJobFailed = callback;
         }
 
         /// @brief onComplete called in ThreadPool.update() when all jobs done
@@ -264,23 +300,24 @@ namespace util {
         }
 
         uint getWorkTotal() const override {
-            return jobs.size() + jobsDone + busyWorkers;
+            std::lock_guard lock(state->mutex);
+            return state->jobs.size() + state->jobsDone + state->busyWorkers;
         }
 
         uint getWorkDone() const override {
-            return jobsDone;
+            return state->jobsDone;
         }
 
         virtual void waitForEnd() override {
             using namespace std::chrono_literals;
-            while (working) {
+            while (isActive()) {
                 std::this_thread::sleep_for(2ms);
                 update();
             }
         }
 
         uint getWorkersCount() const {
-            return threads.size();
+            return state->workers.size();
         }
     };
 
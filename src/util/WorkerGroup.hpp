@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "typedefs.hpp"
+#include "JobSystem.hpp"
+
+namespace util {
+    /// @brief Group of workers running the same task simultaneously
+    /// (fork-join) on the JobSystem threads. Unlike ThreadPool, the caller
+    /// thread is blocked until all workers finish and takes part in the
+    /// work: it runs worker indices not yet taken by the scheduler threads,
+    /// so the group never waits for busy scheduler threads.
+    class WorkerGroup {
+        struct Round {
+            const std::function<void(uint)>* task;
+            uint count;
+            std::atomic<uint> next = 0;
+            std::mutex mutex;
+            std::condition_variable endCondition;
+            std::exception_ptr error = nullptr;
+            uint finished = 0;
+
+            Round(const std::function<void(uint)>* task, uint count)
+                : task(task), count(count) {
+            }
+
+            /// @brief Run not taken worker indices
+            void process() {
+                uint index;
+                while ((index = next++) < count) {
+                    std::exception_ptr taskError = nullptr;
+                    try {
+                        (*task)(index);
+                    } catch (...) {
+                        taskError = std::current_exception();
+                    }
+                    std::lock_guard lock(mutex);
+                    if (taskError && error == nullptr) {
+                        error = taskError;
+                    }
+                    if (++finished == count) {
+                        endCondition.notify_one();
+                    }
+                }
+            }
+        };
+
+        JobSystem& system;
+        uint count;
+    public:
+        /// @param count total number of workers including the caller thread
+        /// @param system jobs scheduler
+        WorkerGroup(uint count, JobSystem& system=JobSystem::getInstance())
+            : system(system), count(std::max(1U, count)) {
+        }
+
+        WorkerGroup(const WorkerGroup&) = delete;
+
+        /// @brief Run task on all workers and wait until all of them finish
+        /// @param task task function taking worker index [0, size())
+        /// @throws first exception thrown by the task
+        void run(const std::function<void(uint)>& task) {
+            if (count == 1) {
+                task(0);
+                return;
+            }
+            // jobs started after the round end find no indices left
+            auto round = std::make_shared<Round>(&task, count);
+            for (uint i = 1; i < count; i++) {
+                system.submit([round]() { round->process(); }, INT_MAX);
+            }
+            round->process();
+
+            std::unique_lock lock(round->mutex);
+            round->endCondition.wait(lock, [&round] {
+                return round->finished == round->count;
+            });
+            if (round->error) {
+                std::rethrow_exception(round->error);
+            }
+        }
+
+        /// @return total number of workers including the caller thread
+        uint size() const {
+            return count;
+        }
+
+        /// @brief Get workers count for limit with special values:
+        /// 0 is all cores, -n is 1/n of cores (-2 is half, -4 is quarter)
+        static uint countFor(int maxWorkers) {
+            uint cores = std::max(1U, std::thread::hardware_concurrency());
+            if (maxWorkers <= 0) {
+                return std::max(1U, cores / std::max(1, -maxWorkers));
+            }
+            return std::min(cores, static_cast<uint>(maxWorkers));
+        }
+    };
+}
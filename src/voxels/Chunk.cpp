@@ -1,7 +1,13 @@
 #include "Chunk.hpp"
 
+#include <algorithm>
 #include <utility>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHUNK_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "content/ContentReport.hpp"
 #include "items/Inventory.hpp"
 #include "lighting/Lightmap.hpp"
@@ -14,13 +20,21 @@ Chunk::Chunk(int xpos, int zpos) : x(xpos), z(zpos) {
 }
 
 void Chunk::updateHeights() {
-    for (uint i = 0; i < CHUNK_VOL; i++) {
+    uint from = 0;
+    while (from < CHUNK_SECTIONS && voxels.isEmpty(from)) {
+        from++;
+    }
+    int to = CHUNK_SECTIONS;
+    while (to > 0 && voxels.isEmpty(to - 1)) {
+        to--;
+    }
+    for (uint i = from * CHUNK_SECTION_VOL; i < CHUNK_VOL; i++) {
         if (voxels[i].id != 0) {
             bottom = i / (CHUNK_D * CHUNK_W);
             break;
         }
     }
-    for (int i = CHUNK_VOL - 1; i >= 0; i--) {
+    for (int i = to * CHUNK_SECTION_VOL - 1; i >= 0; i--) {
         if (voxels[i].id != 0) {
             top = i / (CHUNK_D * CHUNK_W) + 1;
             break;
@@ -57,9 +71,9 @@ std::shared_ptr<Inventory> Chunk::getBlockInventory(uint x, uint y, uint z)
 
 std::unique_ptr<Chunk> Chunk::clone() const {
     auto other = std::make_unique<Chunk>(x, z);
-    for (uint i = 0; i < CHUNK_VOL; i++) {
-        other->voxels[i] = voxels[i];
-    }
+    auto buffer = std::make_unique<voxel[]>(CHUNK_VOL);
+    voxels.copyTo(buffer.get());
+    other->voxels.assign(buffer.get());
     other->lightmap.set(&lightmap);
     return other;
 }
@@ -87,15 +101,48 @@ std::unique_ptr<ubyte[]> Chunk::encode() const {
 
 bool Chunk::decode(const ubyte* data) {
     auto src = reinterpret_cast<const uint16_t*>(data);
-    for (uint i = 0; i < CHUNK_VOL; i++) {
-        voxel& vox = voxels[i];
+    voxel section[CHUNK_SECTION_VOL];
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        for (uint j = 0; j < CHUNK_SECTION_VOL; j++) {
+            uint i = s * CHUNK_SECTION_VOL + j;
+            voxel& vox = section[j];
 
-        vox.id = dataio::le2h(src[i]);
-        vox.state = int2blockstate(dataio::le2h(src[CHUNK_VOL + i]));
+            vox.id = dataio::le2h(src[i]);
+            vox.state = int2blockstate(dataio::le2h(src[CHUNK_VOL + i]));
+        }
+        voxels.setSection(s, section);
     }
     return true;
 }
 
+blockid_t Chunk::findMaxBlockId(const ubyte* data) {
+    auto src = reinterpret_cast<const uint16_t*>(data);
+    uint i = 0;
+    uint16_t maxId = 0;
+#ifdef CHUNK_SSE2
+    // SSE2 has signed 16 bit max only: values are shifted by 0x8000
+    const __m128i bias = _mm_set1_epi16(-0x8000);
+    __m128i max0 = bias;
+    __m128i max1 = bias;
+    for (; i + 16 <= CHUNK_VOL; i += 16) {
+        auto ptr = reinterpret_cast<const __m128i*>(src + i);
+        max0 = _mm_max_epi16(max0, _mm_xor_si128(_mm_loadu_si128(ptr), bias));
+        max1 = _mm_max_epi16(
+            max1, _mm_xor_si128(_mm_loadu_si128(ptr + 1), bias)
+        );
+    }
+    __m128i max = _mm_max_epi16(max0, max1);
+    max = _mm_max_epi16(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm_max_epi16(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(2, 3, 0, 1)));
+    max = _mm_max_epi16(max, _mm_srli_epi32(max, 16));
+    maxId = static_cast<uint16_t>(_mm_cvtsi128_si32(max)) ^ 0x8000;
+#endif
+    for (; i < CHUNK_VOL; i++) {
+        maxId = std::max(maxId, dataio::le2h(src[i]));
+    }
+    return maxId;
+}
+
 void Chunk::convert(ubyte* data, const ContentReport* report) {
     auto buffer = reinterpret_cast<uint16_t*>(data);
     for (uint i = 0; i < CHUNK_VOL; i++) {
@@ -10,6 +10,7 @@
 #include "util/SmallHeap.hpp"
 #include "maths/aabb.hpp"
 #include "voxel.hpp"
+#include "ChunkVoxels.hpp"
 
 /// @brief Total bytes number of chunk voxel data
 inline constexpr int CHUNK_DATA_LEN = CHUNK_VOL * 4;
@@ -26,7 +27,7 @@ class Chunk {
 public:
     int x, z;
     int bottom, top;
-    voxel voxels[CHUNK_VOL] {};
+    ChunkVoxels voxels;
     Lightmap lightmap;
     struct {
         bool modified : 1;
@@ -63,6 +64,11 @@ public:
     /// @return inventory bound to the given block or nullptr
     std::shared_ptr<Inventory> getBlockInventory(uint x, uint y, uint z) const;
 
+    /// @return approximate memory used by chunk voxels and lights in bytes
+    size_t getMemoryUsage() const {
+        return sizeof(Chunk) + voxels.getMemoryUsage();
+    }
+
     inline void setModifiedAndUnsaved() {
         flags.modified = true;
         flags.unsaved = true;
@@ -77,6 +83,10 @@ public:
 
     static void convert(ubyte* data, const ContentReport* report);
 
+    /// @brief Find max block id of encoded chunk data (vectorized)
+    /// @param data chunk data of size CHUNK_DATA_LEN
+    static blockid_t findMaxBlockId(const ubyte* data);
+
     AABB getAABB() const {
         return AABB(
             glm::vec3(x * CHUNK_W, -INFINITY, z * CHUNK_D),
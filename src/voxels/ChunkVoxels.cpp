@@ -0,0 +1,92 @@
+#include "ChunkVoxels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+/// @brief Buffer is filled before it is published to section.data, so
+/// reader never sees a section pointing to uninitialized voxels
+static void publish(
+    std::unique_ptr<voxel[]>& dst, std::unique_ptr<voxel[]> data
+) {
+    std::atomic_thread_fence(std::memory_order_release);
+    dst = std::move(data);
+}
+
+void ChunkVoxels::allocate(Section& section) {
+    auto data = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+    std::fill_n(data.get(), CHUNK_SECTION_VOL, section.fill);
+    publish(section.data, std::move(data));
+}
+
+uint ChunkVoxels::getOccupiedMask() const {
+    uint mask = 0;
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        mask |= (sections[i].occupied != 0) << i;
+    }
+    return mask;
+}
+
+uint ChunkVoxels::getUniformMask() const {
+    uint mask = 0;
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        mask |= (sections[i].data == nullptr) << i;
+    }
+    return mask;
+}
+
+void ChunkVoxels::setSection(uint index, const voxel* src) {
+    auto& section = sections[index];
+    const voxel& first = src[0];
+    bool uniform = true;
+    uint occupied = 0;
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        occupied += src[i].id != 0;
+        uniform = uniform && equals(src[i], first);
+    }
+    section.occupied = occupied;
+    if (uniform) {
+        section.data = nullptr;
+        section.fill = first;
+        return;
+    }
+    if (section.data == nullptr) {
+        auto data = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+        std::memcpy(data.get(), src, CHUNK_SECTION_VOL * sizeof(voxel));
+        publish(section.data, std::move(data));
+        return;
+    }
+    std::memcpy(section.data.get(), src, CHUNK_SECTION_VOL * sizeof(voxel));
+}
+
+void ChunkVoxels::assign(const voxel* src) {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        setSection(i, src + i * CHUNK_SECTION_VOL);
+    }
+}
+
+void ChunkVoxels::copyTo(voxel* dst) const {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        const auto& section = sections[i];
+        voxel* out = dst + i * CHUNK_SECTION_VOL;
+        if (section.data) {
+            std::memcpy(
+                out, section.data.get(), CHUNK_SECTION_VOL * sizeof(voxel)
+            );
+        } else {
+            std::fill_n(out, CHUNK_SECTION_VOL, section.fill);
+        }
+    }
+}
+
+uint ChunkVoxels::countAllocated() const {
+    uint count = 0;
+    for (const auto& section : sections) {
+        count += section.data != nullptr;
+    }
+    return count;
+}
+
+size_t ChunkVoxels::getMemoryUsage() const {
+    return countAllocated() * CHUNK_SECTION_VOL * sizeof(voxel);
+}
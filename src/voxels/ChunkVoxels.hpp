@@ -0,0 +1,110 @@
+#pragma once
+
+#include <memory>
+
+#include "constants.hpp"
+#include "voxel.hpp"
+
+inline constexpr int CHUNK_SECTION_H = 16;
+inline constexpr int CHUNK_SECTIONS = CHUNK_H / CHUNK_SECTION_H;
+inline constexpr int CHUNK_SECTION_VOL = CHUNK_W * CHUNK_SECTION_H * CHUNK_D;
+
+static_assert(CHUNK_H % CHUNK_SECTION_H == 0);
+static_assert((CHUNK_SECTION_VOL & (CHUNK_SECTION_VOL - 1)) == 0);
+
+/// @brief Chunk voxels storage split into CHUNK_SECTION_H blocks high
+/// sections. Uniform sections (all-air mostly) are stored as a single voxel
+/// value and allocated on first write access.
+/// Read access via operator[] never allocates and may be used from any
+/// thread, write access is main-thread only.
+/// Number of non-air voxels is tracked per section, so block id must be
+/// changed via set() only (write() is fine for state modification).
+class ChunkVoxels {
+    struct Section {
+        std::unique_ptr<voxel[]> data;
+        voxel fill {};
+        /// @brief Non-air voxels count
+        uint16_t occupied = 0;
+    };
+    Section sections[CHUNK_SECTIONS];
+
+    static inline bool equals(const voxel& a, const voxel& b) {
+        return a.id == b.id &&
+               blockstate2int(a.state) == blockstate2int(b.state);
+    }
+
+    static void allocate(Section& section);
+public:
+    inline const voxel& operator[](uint index) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (section.data) {
+            return section.data[index % CHUNK_SECTION_VOL];
+        }
+        return section.fill;
+    }
+
+    /// @brief Get voxel for state modification, allocating section if
+    /// uniform. Use set() to change block id
+    inline voxel& write(uint index) {
+        auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (section.data == nullptr) {
+            allocate(section);
+        }
+        return section.data[index % CHUNK_SECTION_VOL];
+    }
+
+    /// @brief Set voxel value. Section stays uniform if value equals to
+    /// the section fill
+    inline void set(uint index, voxel value) {
+        auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (section.data == nullptr) {
+            if (equals(section.fill, value)) {
+                return;
+            }
+            allocate(section);
+        }
+        voxel& vox = section.data[index % CHUNK_SECTION_VOL];
+        section.occupied += (value.id != 0) - (vox.id != 0);
+        vox = value;
+    }
+
+    /// @brief Set section content, uniform data is not allocated
+    /// @param index section index [0, CHUNK_SECTIONS)
+    /// @param src CHUNK_SECTION_VOL voxels
+    void setSection(uint index, const voxel* src);
+
+    /// @brief Copy all voxels from flat array of CHUNK_VOL voxels
+    void assign(const voxel* src);
+
+    /// @brief Copy all voxels to flat array of CHUNK_VOL voxels
+    void copyTo(voxel* dst) const;
+
+    /// @return true if section is stored as a single value
+    inline bool isUniform(uint index) const {
+        return sections[index].data == nullptr;
+    }
+
+    /// @brief Get uniform section value
+    inline const voxel& getFill(uint index) const {
+        return sections[index].fill;
+    }
+
+    /// @return true if section contains air only
+    inline bool isEmpty(uint index) const {
+        return sections[index].occupied == 0;
+    }
+
+    /// @return bitmask of sections containing non-air voxels
+    uint getOccupiedMask() const;
+
+    /// @return bitmask of sections stored as a single value.
+    /// Uniform section may be not marked if it became uniform after
+    /// modification
+    uint getUniformMask() const;
+
+    /// @return allocated sections count
+    uint countAllocated() const;
+
+    /// @return bytes allocated for non-uniform sections
+    size_t getMemoryUsage() const;
+};
@@ -46,19 +46,23 @@ void Chunks::configure(int32_t x, int32_t z, uint32_t radius) {
     }
 }
 
-voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
+const voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::get(*this, x, y, z);
 }
 
-voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
+const voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::require(*this, x, y, z);
 }
 
+voxel* Chunks::getMutable(int32_t x, int32_t y, int32_t z) {
+    return blocks_agent::get_mutable(*this, x, y, z);
+}
+
 const AABB* Chunks::isObstacleAt(float x, float y, float z) const {
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(ix, iy, iz);
+    const voxel* v = get(ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
@@ -96,7 +100,7 @@ bool Chunks::isReplaceableBlock(int32_t x, int32_t y, int32_t z) {
 }
 
 bool Chunks::isObstacleBlock(int32_t x, int32_t y, int32_t z) {
-    voxel* v = get(x, y, z);
+    const voxel* v = get(x, y, z);
     if (v == nullptr) return false;
     return indices.blocks.require(v->id).obstacle;
 }
@@ -203,7 +207,7 @@ void Chunks::set(
     blocks_agent::set(*this, x, y, z, id, state);
 }
 
-voxel* Chunks::rayCast(
+const voxel* Chunks::rayCast(
     const glm::vec3& start,
     const glm::vec3& dir,
     float maxDist,
@@ -252,7 +256,7 @@ glm::vec3 Chunks::rayCastToObstacle(
     float tzMax = (tzDelta < infinity) ? tzDelta * zdist : infinity;
 
     while (t <= maxDist) {
-        voxel* voxel = get(ix, iy, iz);
+        const voxel* voxel = get(ix, iy, iz);
         if (voxel) {
             const auto& def = indices.blocks.require(voxel->id);
             if (def.obstacle) {
@@ -373,7 +377,7 @@ void Chunks::getVoxels(VoxelsVolume& volume, bool backlight) const {
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
+                const auto& cvoxels = chunk->voxels;
                 const light_t* clights = chunk->lightmap.getLights();
                 for (int ly = y; ly < y + h; ly++) {
                     for (int lz = std::max(z, cz * CHUNK_D);
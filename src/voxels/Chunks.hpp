@@ -64,17 +64,17 @@ public:
         );
     }
 
-    voxel* get(int32_t x, int32_t y, int32_t z) const;
-    voxel& require(int32_t x, int32_t y, int32_t z) const;
-
-    inline voxel* get(const glm::ivec3& pos) {
-        return get(pos.x, pos.y, pos.z);
-    }
+    /// @brief Get voxel for reading, uniform sections are not allocated
+    const voxel* get(int32_t x, int32_t y, int32_t z) const;
+    const voxel& require(int32_t x, int32_t y, int32_t z) const;
 
     inline const voxel* get(const glm::ivec3& pos) const {
         return get(pos.x, pos.y, pos.z);
     }
 
+    /// @brief Get voxel for state modification (see blocks_agent::get_mutable)
+    voxel* getMutable(int32_t x, int32_t y, int32_t z);
+
     light_t getLight(int32_t x, int32_t y, int32_t z) const;
     ubyte getLight(int32_t x, int32_t y, int32_t z, int channel) const;
     void set(int32_t x, int32_t y, int32_t z, uint32_t id, blockstate state);
@@ -102,7 +102,7 @@ public:
 
     void setRotation(int32_t x, int32_t y, int32_t z, uint8_t rotation);
 
-    voxel* rayCast(
+    const voxel* rayCast(
         const glm::vec3& start,
         const glm::vec3& dir,
         float maxLength,
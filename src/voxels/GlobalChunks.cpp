@@ -25,6 +25,25 @@ GlobalChunks::GlobalChunks(Level& level)
     chunksMap.max_load_factor(CHUNKS_MAP_MAX_LOAD_FACTOR);
 }
 
+void GlobalChunks::updateRegionUsage(int chunkX, int chunkZ, int delta) {
+    glm::ivec2 region(
+        floordiv(chunkX, static_cast<int>(REGION_SIZE)),
+        floordiv(chunkZ, static_cast<int>(REGION_SIZE))
+    );
+    auto& count = regionsUsage[region];
+    bool wasUsed = count > 0;
+    count += delta;
+    bool used = count > 0;
+    if (count == 0) {
+        regionsUsage.erase(region);
+    }
+    // regions with loaded chunks are kept in memory
+    auto& wfile = level.getWorld()->wfile;
+    if (wfile && used != wasUsed) {
+        wfile->getRegions().setRegionInUse(region.x, region.y, used);
+    }
+}
+
 void GlobalChunks::setOnUnload(consumer<Chunk&> onUnload) {
     this->onUnload = std::move(onUnload);
 }
@@ -56,13 +75,15 @@ static void check_voxels(const ContentIndices& indices, Chunk& chunk) {
                 abort();
 #endif
             }
-            chunk.voxels[i].id = BLOCK_AIR;
+            chunk.voxels.set(i, voxel {BLOCK_AIR, chunk.voxels[i].state});
         }
     }
 }
 
 void GlobalChunks::erase(int x, int z) {
-    chunksMap.erase(keyfrom(x, z));
+    if (chunksMap.erase(keyfrom(x, z))) {
+        updateRegionUsage(x, z, -1);
+    }
 }
 
 static inline auto load_inventories(
@@ -96,6 +117,7 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
 
     auto chunk = std::make_shared<Chunk>(x, z);
     chunksMap[keyfrom(x, z)] = chunk;
+    updateRegionUsage(x, z, 1);
 
     World& world = *level.getWorld();
     auto& regions = world.wfile.get()->getRegions();
@@ -143,6 +165,14 @@ size_t GlobalChunks::size() const {
     return chunksMap.size();
 }
 
+size_t GlobalChunks::getMemoryUsage() const {
+    size_t total = 0;
+    for (const auto& [_, chunk] : chunksMap) {
+        total += chunk->getMemoryUsage();
+    }
+    return total;
+}
+
 void GlobalChunks::incref(Chunk* chunk) {
     auto key = reinterpret_cast<ptrdiff_t>(chunk);
     const auto& found = refCounters.find(key);
@@ -171,7 +201,9 @@ void GlobalChunks::decref(Chunk* chunk) {
             onUnload(*chunk);
         }
         save(chunk);
-        chunksMap.erase(ekey.key);
+        if (chunksMap.erase(ekey.key)) {
+            updateRegionUsage(ekey.pos[0], ekey.pos[1], -1);
+        }
         refCounters.erase(found);
     }
 }
@@ -201,7 +233,11 @@ void GlobalChunks::saveAll() {
 }
 
 void GlobalChunks::putChunk(std::shared_ptr<Chunk> chunk) {
-    chunksMap[keyfrom(chunk->x, chunk->z)] = std::move(chunk);
+    int x = chunk->x;
+    int z = chunk->z;
+    if (chunksMap.insert_or_assign(keyfrom(x, z), std::move(chunk)).second) {
+        updateRegionUsage(x, z, 1);
+    }
 }
 
 const AABB* GlobalChunks::isObstacleAt(float x, float y, float z) const {
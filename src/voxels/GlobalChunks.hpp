@@ -31,8 +31,12 @@ class GlobalChunks {
     std::unordered_map<uint64_t, std::shared_ptr<Chunk>> chunksMap;
     std::unordered_map<glm::ivec2, std::shared_ptr<Chunk>> pinnedChunks;
     std::unordered_map<ptrdiff_t, int> refCounters;
+    /// @brief Loaded chunks count by region coords
+    std::unordered_map<glm::ivec2, uint> regionsUsage;
 
     consumer<Chunk&> onUnload;
+
+    void updateRegionUsage(int chunkX, int chunkZ, int delta);
 public:
     GlobalChunks(Level& level);
     ~GlobalChunks() = default;
@@ -47,6 +51,9 @@ public:
 
     size_t size() const;
 
+    /// @return approximate memory used by all loaded chunks in bytes
+    size_t getMemoryUsage() const;
+
     void incref(Chunk* chunk);
     void decref(Chunk* chunk);
 
@@ -30,7 +30,7 @@ static inline void set_block(
     size_t index = vox_index(lx, y, lz);
 
     // block finalization
-    voxel& vox = chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
+    const voxel& vox = chunk->voxels[index];
     const auto& prevdef = indices.blocks.require(vox.id);
     if (prevdef.inventorySize != 0) {
         chunk->removeBlockInventory(lx, y, lz);
@@ -48,8 +48,7 @@ static inline void set_block(
 
     // block initialization
     const auto& newdef = indices.blocks.require(id);
-    vox.id = id;
-    vox.state = state;
+    chunk->voxels.set(index, voxel {static_cast<blockid_t>(id), state});
     chunk->setModifiedAndUnsaved();
     if (!state.segment && newdef.rt.extended) {
         repair_segments(chunks, newdef, state, x, y, z);
@@ -99,7 +98,7 @@ void blocks_agent::set(
 }
 
 template <class Storage>
-static inline voxel* raycast_blocks(
+static inline const voxel* raycast_blocks(
     const Storage& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -144,7 +143,7 @@ static inline voxel* raycast_blocks(
     int steppedIndex = -1;
 
     while (t <= maxDist) {
-        voxel* voxel = get(chunks, ix, iy, iz);
+        const voxel* voxel = get(chunks, ix, iy, iz);
         if (voxel == nullptr) {
             return nullptr;
         }
@@ -240,7 +239,7 @@ static inline voxel* raycast_blocks(
     return nullptr;
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -253,7 +252,7 @@ voxel* blocks_agent::raycast(
     return raycast_blocks(chunks, start, dir, maxDist, end, norm, iend, filter);
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -313,7 +312,7 @@ inline void get_voxels_impl(
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
+                const auto& cvoxels = chunk->voxels;
                 const light_t* clights = chunk->lightmap.getLights();
                 for (int ly = y; ly < y + h; ly++) {
                     for (int lz = std::max(z, cz * CHUNK_D);
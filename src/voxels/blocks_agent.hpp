@@ -36,7 +36,9 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
 }
 
 /// @brief Get voxel at specified position.
-/// Returns nullptr if voxel does not exists. 
+/// Returns nullptr if voxel does not exists.
+/// Uniform chunk sections are not allocated, so it may be used from
+/// worker threads.
 /// @tparam Storage chunks storage class
 /// @param chunks chunks storage
 /// @param x position X
@@ -44,13 +46,13 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
 /// @param z position Z
 /// @return voxel pointer or nullptr
 template<class Storage>
-inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline const voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     if (y < 0 || y >= CHUNK_H) {
         return nullptr;
     }
     int cx = floordiv<CHUNK_W>(x);
     int cz = floordiv<CHUNK_D>(z);
-    Chunk* chunk = get_chunk(chunks, cx, cz);
+    const Chunk* chunk = get_chunk(chunks, cx, cz);
     if (chunk == nullptr) {
         return nullptr;
     }
@@ -59,6 +61,31 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     return &chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
 }
 
+/// @brief Get voxel at specified position for state modification.
+/// Allocates uniform chunk section, main thread only. Use set to change
+/// block id.
+/// @tparam Storage chunks storage class
+/// @param chunks chunks storage
+/// @param x position X
+/// @param y position Y
+/// @param z position Z
+/// @return voxel pointer or nullptr
+template<class Storage>
+inline voxel* get_mutable(Storage& chunks, int32_t x, int32_t y, int32_t z) {
+    if (y < 0 || y >= CHUNK_H) {
+        return nullptr;
+    }
+    int cx = floordiv<CHUNK_W>(x);
+    int cz = floordiv<CHUNK_D>(z);
+    Chunk* chunk = get_chunk(chunks, cx, cz);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    int lx = x - cx * CHUNK_W;
+    int lz = z - cz * CHUNK_D;
+    return &chunk->voxels.write((y * CHUNK_D + lz) * CHUNK_W + lx);
+}
+
 /// @brief Get voxel at specified position.
 /// @throws std::runtime_error if voxel does not exists
 /// @tparam Storage chunks storage class
@@ -68,7 +95,7 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
 /// @param z position Z
 /// @return voxel reference
 template<class Storage>
-inline voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline const voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     auto vox = get(chunks, x, y, z);
     if (vox == nullptr) {
         throw std::runtime_error("voxel does not exist");
@@ -325,7 +352,7 @@ inline void set_rotation_extended(
                 blockstate segState = newstate;
                 segState.segment = segment_to_int(sx, sy, sz);
 
-                auto vox = get(chunks, pos.x, pos.y, pos.z);
+                auto vox = get_mutable(chunks, pos.x, pos.y, pos.z);
                 // checked for nullptr by checkReplaceability
                 if (vox->id != def.rt.id) {
                     set(chunks, pos.x, pos.y, pos.z, def.rt.id, segState);
@@ -386,7 +413,7 @@ inline void set_rotation(
         vox = get(chunks, origin.x, origin.y, origin.z);
         set_rotation_extended(chunks, def, vox->state, origin, index);
     } else {
-        vox->state.rotation = index;
+        get_mutable(chunks, x, y, z)->state.rotation = index;
         int cx = floordiv<CHUNK_W>(x);
         int cz = floordiv<CHUNK_D>(z);
         auto chunk = get_chunk(chunks, cx, cz);
@@ -405,7 +432,7 @@ inline void set_rotation(
 /// @param iend [out] ray end integer position (voxel position + normal)
 /// @param filter filtered ids
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -426,7 +453,7 @@ voxel* raycast(
 /// @param iend [out] ray end integer position (voxel position + normal)
 /// @param filter filtered ids
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -446,7 +473,7 @@ inline const AABB* is_obstacle_at(const Storage& chunks, float x, float y, float
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(chunks, ix, iy, iz);
+    const voxel* v = get(chunks, ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
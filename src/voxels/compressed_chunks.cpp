@@ -35,18 +35,50 @@ std::vector<ubyte> compressed_chunks::encode(
 std::vector<ubyte> compressed_chunks::encode(const Chunk& chunk) {
     auto data = chunk.encode();
 
-    /// world.get_chunk_data is only available in the main Lua state
-    static util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
+    thread_local util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
     return encode(data.get(), chunk.blocksMetadata, rleBuffer);
 }
 
-static void read_voxel_data(ByteReader& reader, util::Buffer<ubyte>& dst) {
+/// @brief Decompress voxels data using the calling thread scratch buffer
+/// @param dst destination buffer of CHUNK_DATA_LEN bytes
+static void read_voxel_data(ByteReader& reader, ubyte* dst) {
+    // extrle16 data is 2x larger than the source at worst
+    thread_local util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
+
     size_t gzipCompressedSize = reader.getInt32();
-        
-    auto rleData = gzip::decompress(reader.pointer(), gzipCompressedSize);
+    if (gzipCompressedSize > reader.remaining()) {
+        throw std::runtime_error("incomplete chunk voxels data");
+    }
+    size_t rleSize = gzip::decompress(
+        reader.pointer(), gzipCompressedSize, rleBuffer.data(), rleBuffer.size()
+    );
     reader.skip(gzipCompressedSize);
 
-    extrle::decode16(rleData.data(), rleData.size(), dst.data());
+    size_t size =
+        extrle::decode16(rleBuffer.data(), rleSize, dst, CHUNK_DATA_LEN);
+    if (size != CHUNK_DATA_LEN) {
+        throw std::runtime_error("invalid chunk voxels data length");
+    }
+}
+
+/// @throws std::runtime_error if an unknown block id is found
+static void validate_voxel_data(
+    const Chunk& chunk, const ubyte* data, const ContentIndices& indices
+) {
+    if (Chunk::findMaxBlockId(data) < indices.blocks.count()) {
+        return;
+    }
+    auto src = reinterpret_cast<const uint16_t*>(data);
+    for (size_t i = 0; i < CHUNK_VOL; i++) {
+        blockid_t id = dataio::le2h(src[i]);
+        if (indices.blocks.get(id) == nullptr) {
+            throw std::runtime_error(
+                "block data corruption (chunk: " + std::to_string(chunk.x) +
+                ", " + std::to_string(chunk.z) + ") at " +
+                std::to_string(i) + " id: " + std::to_string(id)
+            );
+        }
+    }
 }
 
 void compressed_chunks::decode(
@@ -58,21 +90,9 @@ void compressed_chunks::decode(
     reader.skip(1); // reserved byte
 
     if (flags & HAS_VOXELS) {
-        /// world.get_chunk_data is only available in the main Lua state
-        static util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
-        read_voxel_data(reader, voxelData);
-        // TODO: move somewhere in Chunk
-        auto src = reinterpret_cast<const uint16_t*>(voxelData.data());
-        for (size_t i = 0; i < CHUNK_VOL; i++) {
-            blockid_t id = dataio::le2h(src[i]);;
-            if (indices.blocks.get(id) == nullptr) {
-                throw std::runtime_error(
-                    "block data corruption (chunk: " + std::to_string(chunk.x) +
-                    ", " + std::to_string(chunk.z) + ") at " +
-                    std::to_string(i) + " id: " + std::to_string(id)
-                );
-            }
-        }
+        thread_local util::Buffer<ubyte> voxelData(CHUNK_DATA_LEN);
+        read_voxel_data(reader, voxelData.data());
+        validate_voxel_data(chunk, voxelData.data(), indices);
         chunk.decode(voxelData.data());
         chunk.updateHeights();
     }
@@ -93,7 +113,7 @@ void compressed_chunks::save(
     reader.skip(1); // reserved byte
     if (flags & HAS_VOXELS) {
         util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
-        read_voxel_data(reader, voxelData);
+        read_voxel_data(reader, voxelData.data());
         regions.put(
             x, z, REGION_LAYER_VOXELS, voxelData.release(), CHUNK_DATA_LEN
         );
@@ -16,6 +16,10 @@ namespace compressed_chunks {
         util::Buffer<ubyte>& rleBuffer
     );
     std::vector<ubyte> encode(const Chunk& chunk);
+
+    /// @brief Decode chunk data to the chunk. Thread-safe, scratch buffers
+    /// are allocated once per thread
+    /// @throws std::runtime_error if data is invalid or has unknown block ids
     void decode(
         Chunk& chunk,
         const ubyte* src,
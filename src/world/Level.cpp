@@ -1,7 +1,9 @@
 #include "Level.hpp"
 
+#include "coders/compression.hpp"
 #include "content/Content.hpp"
 #include "data/dv_util.hpp"
+#include "debug/Logger.hpp"
 #include "items/Inventories.hpp"
 #include "items/Inventory.hpp"
 #include "objects/Entities.hpp"
@@ -13,9 +15,32 @@
 #include "voxels/Chunk.hpp"
 #include "voxels/GlobalChunks.hpp"
 #include "window/Camera.hpp"
+#include "world/files/WorldFiles.hpp"
 #include "LevelEvents.hpp"
 #include "World.hpp"
 
+static debug::Logger logger("level");
+
+static void set_regions_codec(
+    WorldRegions& regions,
+    RegionLayerIndex layer,
+    const StringSetting& setting,
+    bool useDictionary
+) {
+    compression::Method method;
+    try {
+        method = compression::method_from_string(setting.get());
+    } catch (const std::invalid_argument& err) {
+        logger.error() << err.what();
+        return;
+    }
+    std::shared_ptr<const compression::Dictionary> dictionary;
+    if (useDictionary && compression::supports_dictionary(method)) {
+        dictionary = regions.requireDictionary(layer);
+    }
+    regions.setCodec(layer, method, std::move(dictionary));
+}
+
 Level::Level(
     std::unique_ptr<World> worldPtr,
     const Content& content,
@@ -47,6 +72,24 @@ Level::Level(
         cameras.push_back(std::move(camera));
     }
 
+    if (world->wfile) {
+        auto& regions = world->wfile->getRegions();
+        regions.setCacheBudget(
+            static_cast<size_t>(settings.chunks.regionsCacheSize.get()) *
+            1024 * 1024
+        );
+        regions.setRegionFilesLimit(settings.chunks.regionFilesLimit.get());
+        set_regions_codec(
+            regions,
+            REGION_LAYER_VOXELS,
+            settings.chunks.voxelsCodec,
+            settings.chunks.voxelsDictionary.get()
+        );
+        set_regions_codec(
+            regions, REGION_LAYER_LIGHTS, settings.chunks.lightsCodec, false
+        );
+    }
+
     if (worldInfo.nextEntityId) {
         entities->setNextID(worldInfo.nextEntityId);
     }
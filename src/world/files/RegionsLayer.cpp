@@ -1,30 +1,52 @@
 #include "WorldRegions.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 #include "util/data_io.hpp"
 
 #define REGION_FORMAT_MAGIC ".VOXREG"
 
+namespace fs = std::filesystem;
+
+/// @brief Minimal region file size in sectors to be compacted
+static constexpr size_t COMPACTION_MIN_SECTORS = 2048;
+
 static io::path get_region_filename(int x, int z) {
     return std::to_string(x) + "_" + std::to_string(z) + ".bin";
 }
 
-/// @brief Read missing chunks data (null pointers) from region file
-static void fetch_chunks(WorldRegion* region, int x, int z, regfile* file) {
+/// @brief Read missing chunks data (null pointers) from region file.
+/// Unsaved null chunks are removed ones and not read
+static void fetch_chunks(
+    RegionsLayer& layer, WorldRegion* region, int x, int z, regfile* file
+) {
     auto* chunks = region->getChunks();
-    auto sizes = region->getSizes();
+    const auto& unsaved = region->getUnsavedChunks();
 
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        int chunk_x = (i % REGION_SIZE) + x * REGION_SIZE;
-        int chunk_z = (i / REGION_SIZE) + z * REGION_SIZE;
-        if (chunks[i] == nullptr) {
-            chunks[i] = RegionsLayer::readChunkData(
-                    chunk_x, chunk_z, sizes[i][0], sizes[i][1], file);
+        uint local_x = i % REGION_SIZE;
+        uint local_z = i / REGION_SIZE;
+        if (chunks[i] != nullptr || unsaved[i]) {
+            continue;
+        }
+        uint32_t size;
+        uint32_t srcSize;
+        auto data = layer.readChunkData(
+            local_x + x * REGION_SIZE, local_z + z * REGION_SIZE,
+            size, srcSize, file
+        );
+        if (data) {
+            region->put(local_x, local_z, std::move(data), size, srcSize);
         }
     }
 }
 
+static inline uint64_t next_use(std::atomic<uint64_t>* clock) {
+    return clock ? clock->fetch_add(1, std::memory_order_relaxed) + 1 : 0;
+}
+
 regfile::regfile(io::path filename) : file(std::move(filename)) {
     if (file.length() < REGION_HEADER_SIZE)
         throw std::runtime_error("incomplete region file header");
@@ -42,53 +64,104 @@ regfile::regfile(io::path filename) : file(std::move(filename)) {
             "region format " + std::to_string(version) + " is not supported"
         );
     }
-}
+    compression = static_cast<compression::Method>(header[9]);
+    if (version >= 4) {
+        uint32_t buff32;
+        file.read(reinterpret_cast<char*>(&buff32), 4);
+        dictionaryId = dataio::le2h(buff32);
+    }
 
-std::unique_ptr<ubyte[]> regfile::read(int index, uint32_t& size, uint32_t& srcSize) {
-    size_t file_size = file.length();
-    size_t table_offset = file_size - REGION_CHUNKS_COUNT * 4;
+    // entries of version 4 table are offset and length pairs, older
+    // versions have offsets table at the end of file
+    size_t entrySize = version >= 4 ? REGION_TABLE_ENTRY_SIZE : 4;
+    size_t tableOffset = version >= 4 ? REGION_TABLE_OFFSET
+                                      : file.length() - REGION_CHUNKS_COUNT * 4;
+    if (file.length() < REGION_CHUNKS_COUNT * entrySize ||
+        tableOffset + REGION_CHUNKS_COUNT * entrySize > file.length()) {
+        throw illegal_region_format("incomplete region offsets table");
+    }
+    std::vector<ubyte> table(REGION_CHUNKS_COUNT * entrySize);
+    file.seekg(tableOffset);
+    file.read(reinterpret_cast<char*>(table.data()), table.size());
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        uint32_t buff32;
+        std::memcpy(&buff32, table.data() + i * entrySize, 4);
+        offsets[i] = dataio::le2h(buff32);
+    }
+}
 
-    uint32_t buff32;
-    file.seekg(table_offset + index * 4);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    uint32_t offset = dataio::le2h(buff32);
+const ubyte* regfile::getChunkData(
+    int index, uint32_t& size, uint32_t& srcSize, std::vector<ubyte>& buffer
+) {
+    uint32_t offset = offsets[index];
     if (offset == 0) {
         return nullptr;
     }
+    size_t length = file.length();
+    if (offset > length || length - offset < 8) {
+        throw illegal_region_format("corrupted region offsets table");
+    }
+    const ubyte* bytes = file.data();
+    uint32_t sizes[2];
+    if (bytes) {
+        std::memcpy(sizes, bytes + offset, sizeof(sizes));
+    } else {
+        file.read(offset, reinterpret_cast<char*>(sizes), sizeof(sizes));
+    }
+    size = dataio::le2h(sizes[0]);
+    srcSize = dataio::le2h(sizes[1]);
+    if (size > length - offset - 8) {
+        throw illegal_region_format("chunk record is out of region file");
+    }
+    if (bytes) {
+        return bytes + offset + 8;
+    }
+    buffer.resize(std::max<size_t>(size, 1));
+    file.read(offset + 8, reinterpret_cast<char*>(buffer.data()), size);
+    return buffer.data();
+}
 
-    file.seekg(offset);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    size = dataio::le2h(buff32);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    srcSize = dataio::le2h(buff32);
-
+std::unique_ptr<ubyte[]> regfile::read(int index, uint32_t& size, uint32_t& srcSize) {
+    std::vector<ubyte> buffer;
+    const ubyte* bytes = getChunkData(index, size, srcSize, buffer);
+    if (bytes == nullptr) {
+        return nullptr;
+    }
     auto data = std::make_unique<ubyte[]>(size);
-    file.read(reinterpret_cast<char*>(data.get()), size);
+    std::memcpy(data.get(), bytes, size);
     return data;
 }
 
 
 void RegionsLayer::closeRegFile(glm::ivec2 coord) {
     openRegFiles.erase(coord);
-    regFilesCv.notify_one();
 }
 
-regfile_ptr RegionsLayer::useRegFile(glm::ivec2 coord) {
-    auto* file = openRegFiles[coord].get();
-    file->inUse = true;
-    return regfile_ptr(file, &regFilesCv);
+/// @brief Close least recently used files until there is space for count
+/// more files. Files used by other threads stay open until released
+static void close_lru_regfiles(RegionsLayer& layer, size_t count) {
+    auto& files = layer.openRegFiles;
+    while (!files.empty() && files.size() + count > layer.maxOpenRegFiles) {
+        auto oldest = files.begin();
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            if (it->second->lastUse.load(std::memory_order_relaxed) <
+                oldest->second->lastUse.load(std::memory_order_relaxed)) {
+                oldest = it;
+            }
+        }
+        layer.closeRegFile(oldest->first);
+    }
 }
 
-// Marks regfile as used and unmarks when shared_ptr dies
 regfile_ptr RegionsLayer::getRegFile(glm::ivec2 coord, bool create) {
     {
-        std::lock_guard lock(regFilesMutex);
+        std::shared_lock lock(regFilesMutex);
         const auto found = openRegFiles.find(coord);
         if (found != openRegFiles.end()) {
-            if (found->second->inUse) {
-                throw std::runtime_error("regfile is currently in use");
-            }
-            return useRegFile(found->first);
+            found->second->lastUse.store(
+                next_use(&regFilesClock), std::memory_order_relaxed
+            );
+            return found->second;
         }
     }
     if (create) {
@@ -98,35 +171,38 @@ regfile_ptr RegionsLayer::getRegFile(glm::ivec2 coord, bool create) {
 }
 
 regfile_ptr RegionsLayer::createRegFile(glm::ivec2 coord) {
-    auto file = folder / get_region_filename(coord[0], coord[1]);
-    if (!io::exists(file)) {
+    auto path = folder / get_region_filename(coord[0], coord[1]);
+    if (!io::exists(path)) {
         return nullptr;
     }
-    if (openRegFiles.size() == MAX_OPEN_REGION_FILES) {
-        std::unique_lock lock(regFilesMutex);
-        while (true) {
-            bool closed = false;
-            // FIXME: bad choosing algorithm
-            for (auto& entry : openRegFiles) {
-                if (!entry.second->inUse) {
-                    closeRegFile(entry.first);
-                    closed = true;
-                    break;
-                }
-            }
-            if (closed) {
-                break;
-            }
-            // notified when any regfile gets out of use or closed
-            regFilesCv.wait(lock);
-        }
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
-    } else {
-        std::lock_guard lock(regFilesMutex);
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
+    size_t writes;
+    {
+        std::shared_lock lock(regFilesMutex);
+        writes = regFileWrites;
     }
+    // opened without lock, file opened by other thread meanwhile is used
+    auto file = std::make_shared<regfile>(path);
+    file->lastUse = next_use(&regFilesClock);
+
+    std::lock_guard lock(regFilesMutex);
+    const auto found = openRegFiles.find(coord);
+    if (found != openRegFiles.end()) {
+        return found->second;
+    }
+    // offsets table of a file written meanwhile may be outdated
+    if (writes != regFileWrites || writingRegFiles.count(coord)) {
+        return file;
+    }
+    close_lru_regfiles(*this, 1);
+    openRegFiles[coord] = file;
+    regFileOpens++;
+    return file;
+}
+
+void RegionsLayer::setMaxOpenRegFiles(size_t limit) {
+    std::lock_guard lock(regFilesMutex);
+    maxOpenRegFiles = std::max<size_t>(limit, 1);
+    close_lru_regfiles(*this, 0);
 }
 
 WorldRegion* RegionsLayer::getRegion(int x, int z) {
@@ -142,15 +218,172 @@ io::path RegionsLayer::getRegionFilePath(int x, int z) const {
     return folder / get_region_filename(x, z);
 }
 
+static std::unique_ptr<ubyte[]> decompress_chunk(
+    const ubyte* src,
+    size_t size,
+    size_t srcSize,
+    compression::Method method,
+    const compression::Dictionary* dictionary
+) {
+    if (method == compression::Method::NONE) {
+        auto data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), src, size);
+        return data;
+    }
+    return compression::decompress(src, size, srcSize, method, dictionary);
+}
+
+static io::path get_dictionary_filename(uint32_t id) {
+    return "dictionary_" + std::to_string(id) + ".dict";
+}
+
+uint32_t RegionsLayer::getDictionaryId() const {
+    if (dictionary && compression::supports_dictionary(compression)) {
+        return dictionary->id;
+    }
+    return 0;
+}
+
+std::shared_ptr<const compression::Dictionary> RegionsLayer::getDictionary(
+    uint32_t id
+) {
+    std::lock_guard lock(dictionariesMutex);
+    const auto& found = dictionaries.find(id);
+    if (found != dictionaries.end()) {
+        return found->second;
+    }
+    auto file = folder / get_dictionary_filename(id);
+    if (!io::is_regular_file(file)) {
+        throw std::runtime_error(
+            "region compression dictionary not found: " + file.string()
+        );
+    }
+    auto bytes = io::read_bytes_buffer(file);
+    auto dictionary = std::make_shared<compression::Dictionary>(
+        std::vector<ubyte>(bytes.data(), bytes.data() + bytes.size())
+    );
+    if (dictionary->id != id) {
+        throw std::runtime_error("corrupted dictionary " + file.string());
+    }
+    dictionaries[id] = dictionary;
+    return dictionary;
+}
+
+void RegionsLayer::saveDictionary(const compression::Dictionary& dictionary) {
+    auto file = folder / get_dictionary_filename(dictionary.id);
+    if (!io::exists(file)) {
+        io::create_directories(folder);
+        io::write_bytes(file, dictionary.data.data(), dictionary.data.size());
+    }
+}
+
+void RegionsLayer::setCodec(
+    compression::Method method,
+    std::shared_ptr<const compression::Dictionary> dictionary
+) {
+    if (dictionary) {
+        saveDictionary(*dictionary);
+        std::lock_guard lock(dictionariesMutex);
+        dictionaries[dictionary->id] = dictionary;
+    }
+    auto prevMethod = compression;
+    auto prevDictionary = std::move(this->dictionary);
+    uint32_t prevDictionaryId = 0;
+    if (prevDictionary && compression::supports_dictionary(prevMethod)) {
+        prevDictionaryId = prevDictionary->id;
+    }
+
+    compression = method;
+    this->dictionary = std::move(dictionary);
+    if (prevMethod == compression && prevDictionaryId == getDictionaryId()) {
+        return;
+    }
+    std::lock_guard lock(mapMutex);
+    for (auto& [_, region] : regions) {
+        auto chunks = region->getChunks();
+        auto sizes = region->getSizes();
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            if (chunks[i] == nullptr) {
+                continue;
+            }
+            uint32_t size = sizes[i][0];
+            uint32_t srcSize = sizes[i][1];
+            auto data = decompress_chunk(
+                chunks[i].get(), size, srcSize, prevMethod, prevDictionary.get()
+            );
+            size_t newSize;
+            auto compressed = compress(data.get(), srcSize, newSize);
+            region->put(
+                i % REGION_SIZE,
+                i / REGION_SIZE,
+                std::move(compressed),
+                newSize,
+                srcSize
+            );
+        }
+    }
+}
+
+std::unique_ptr<ubyte[]> RegionsLayer::compress(
+    const ubyte* src, size_t srcSize, size_t& size
+) const {
+    if (compression == compression::Method::NONE) {
+        size = srcSize;
+        auto data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), src, size);
+        return data;
+    }
+    return compression::compress(
+        src, srcSize, size, compression, dictionary.get()
+    );
+}
+
+std::unique_ptr<ubyte[]> RegionsLayer::decompress(
+    const ubyte* src, size_t size, size_t srcSize
+) const {
+    return decompress_chunk(
+        src, size, srcSize, compression, dictionary.get()
+    );
+}
+
 WorldRegion* RegionsLayer::getOrCreateRegion(int x, int z) {
-    if (auto region = getRegion(x, z)) {
-        return region;
+    {
+        std::lock_guard lock(mapMutex);
+        auto found = regions.find({x, z});
+        if (found != regions.end()) {
+            hits++;
+            found->second->lastUse = next_use(useClock);
+            return found->second.get();
+        }
+    }
+    if (onRegionCreate) {
+        onRegionCreate();
+    }
+    std::lock_guard lock(mapMutex);
+    auto& region_ptr = regions[{x, z}];
+    if (region_ptr == nullptr) {
+        misses++;
+        region_ptr = std::make_unique<WorldRegion>();
+    }
+    region_ptr->lastUse = next_use(useClock);
+    return region_ptr.get();
+}
+
+bool RegionsLayer::evictRegion(int x, int z) {
+    glm::ivec2 regcoord(x, z);
+    {
+        std::shared_lock lock(regFilesMutex);
+        const auto found = openRegFiles.find(regcoord);
+        if (found != openRegFiles.end() && found->second.use_count() > 1) {
+            return false;
+        }
     }
     std::lock_guard lock(mapMutex);
-    auto region_ptr = std::make_unique<WorldRegion>();
-    auto region = region_ptr.get();
-    regions[{x, z}] = std::move(region_ptr);
-    return region;
+    if (regions.erase(regcoord) == 0) {
+        return false;
+    }
+    evictions++;
+    return true;
 }
 
 ubyte* RegionsLayer::getData(int x, int z, uint32_t& size, uint32_t& srcSize) {
@@ -178,57 +411,309 @@ ubyte* RegionsLayer::getData(int x, int z, uint32_t& size, uint32_t& srcSize) {
     return nullptr;
 }
 
-void RegionsLayer::writeRegion(int x, int z, WorldRegion* entry) {
-    io::path filename = folder / get_region_filename(x, z);
+std::unique_ptr<ubyte[]> RegionsLayer::getDecompressed(
+    int x, int z, uint32_t& srcSize, regfile_ptr* file
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
 
-    glm::ivec2 regcoord(x, z);
-    if (auto regfile = getRegFile(regcoord, false)) {
-        fetch_chunks(entry, x, z, regfile.get());
+    WorldRegion* region = getOrCreateRegion(regionX, regionZ);
+    if (const ubyte* data = region->getChunkData(localX, localZ)) {
+        auto sizevec = region->getChunkDataSize(localX, localZ);
+        srcSize = compression == compression::Method::NONE ? sizevec[0]
+                                                           : sizevec[1];
+        return decompress(data, sizevec[0], srcSize);
+    }
+    if (region->getUnsavedChunks()[localZ * REGION_SIZE + localX]) {
+        // removed chunk
+        return nullptr;
+    }
+    if (auto regfile = getRegFile({regionX, regionZ})) {
+        if (file) {
+            *file = std::move(regfile);
+            return nullptr;
+        }
+        return readChunk(x, z, srcSize, regfile.get());
+    }
+    return nullptr;
+}
+
+namespace {
+    struct TableEntry {
+        uint32_t offset;
+        /// @brief Chunk record length including sizes
+        uint32_t length;
+    };
+}
+
+static inline size_t count_sectors(size_t bytes) {
+    return (bytes + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+}
+
+static void write_uint32(std::ostream& stream, uint32_t value) {
+    value = dataio::h2le(value);
+    stream.write(reinterpret_cast<const char*>(&value), 4);
+}
+
+static uint32_t read_uint32(std::istream& stream) {
+    uint32_t value = 0;
+    stream.read(reinterpret_cast<char*>(&value), 4);
+    return dataio::le2h(value);
+}
 
-        std::lock_guard lock(regFilesMutex);
-        regfile.reset();
-        closeRegFile(regcoord);
+static void write_padding(std::ostream& stream, size_t& position, size_t target) {
+    static const char zeros[REGION_SECTOR_SIZE] {};
+    while (position < target) {
+        size_t count = std::min<size_t>(target - position, REGION_SECTOR_SIZE);
+        stream.write(zeros, count);
+        position += count;
     }
+}
 
-    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
-    header[8] = REGION_FORMAT_VERSION;
-    header[9] = static_cast<ubyte>(compression); // FIXME
-    std::ofstream file(io::resolve(filename), std::ios::out | std::ios::binary);
-    file.write(header, REGION_HEADER_SIZE);
+static void write_chunk_record(
+    std::ostream& stream, const ubyte* data, const glm::u32vec2& sizes
+) {
+    write_uint32(stream, sizes[0]);
+    write_uint32(stream, sizes[1]);
+    stream.write(reinterpret_cast<const char*>(data), sizes[0]);
+}
 
-    size_t offset = REGION_HEADER_SIZE;
-    uint32_t intbuf;
-    uint offsets[REGION_CHUNKS_COUNT] {};
+/// @brief Find free sectors run (first fit) or append sectors to the end
+/// @return first sector index
+static size_t allocate_sectors(std::vector<bool>& used, size_t count) {
+    size_t run = 0;
+    size_t start = used.size();
+    for (size_t i = 0; i < used.size(); i++) {
+        if (used[i]) {
+            run = 0;
+            continue;
+        }
+        if (++run == count) {
+            start = i + 1 - count;
+            break;
+        }
+    }
+    if (start == used.size()) {
+        // free sectors at the end of file are extended
+        start -= run;
+        used.resize(start + count);
+    }
+    std::fill(used.begin() + start, used.begin() + start + count, true);
+    return start;
+}
 
-    auto region = entry->getChunks();
-    auto sizes = entry->getSizes();
+/// @brief Write complete region file. Data is written to a temporary file
+/// replacing the target one when done so the previous file stays valid if
+/// interrupted
+/// @return written bytes count
+static size_t write_region_file(
+    const fs::path& path,
+    WorldRegion& region,
+    compression::Method compression,
+    uint32_t dictionaryId
+) {
+    auto chunks = region.getChunks();
+    auto sizes = region.getSizes();
 
+    TableEntry table[REGION_CHUNKS_COUNT] {};
+    size_t offset = REGION_DATA_OFFSET;
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        ubyte* chunk = region[i].get();
-        if (chunk == nullptr) {
+        if (chunks[i] == nullptr) {
             continue;
         }
-        offsets[i] = offset;
+        uint32_t length = 8 + sizes[i][0];
+        table[i] = {static_cast<uint32_t>(offset), length};
+        offset += count_sectors(length) * REGION_SECTOR_SIZE;
+    }
 
-        auto sizevec = sizes[i];
-        uint32_t compressedSize = sizevec[0];
-        uint32_t srcSize = sizevec[1];
-        
-        intbuf = dataio::h2le(compressedSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::out | std::ios::binary);
+        char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
+        header[8] = REGION_FORMAT_VERSION;
+        header[9] = static_cast<ubyte>(compression);
+        file.write(header, REGION_HEADER_SIZE);
+        write_uint32(file, dictionaryId);
+
+        size_t position = REGION_HEADER_SIZE + 4;
+        write_padding(file, position, REGION_TABLE_OFFSET);
+        for (const auto& entry : table) {
+            write_uint32(file, entry.offset);
+            write_uint32(file, entry.length);
+        }
+        position += REGION_CHUNKS_COUNT * REGION_TABLE_ENTRY_SIZE;
 
-        intbuf = dataio::h2le(srcSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
+        for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            if (chunks[i] == nullptr) {
+                continue;
+            }
+            write_padding(file, position, table[i].offset);
+            write_chunk_record(file, chunks[i].get(), sizes[i]);
+            position += table[i].length;
+        }
+        write_padding(file, position, offset);
+        file.flush();
+        if (!file) {
+            throw std::runtime_error(
+                "could not write region file " + tmpPath.u8string()
+            );
+        }
+    }
+    fs::rename(tmpPath, path);
+    return offset;
+}
 
-        file.write(reinterpret_cast<const char*>(chunk), compressedSize);
-        offset += compressedSize;
+/// @brief Write unsaved chunks to sectors not used by the current offsets
+/// table, then update table entries of the chunks. If interrupted, the file
+/// keeps previous versions of the chunks.
+/// @param usedSectors [out] sectors used by the file header and chunks
+/// @param totalSectors [out] file length in sectors
+/// @return written bytes count
+static size_t write_chunks_in_place(
+    const fs::path& path,
+    WorldRegion& region,
+    size_t& usedSectors,
+    size_t& totalSectors
+) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(
+            "could not open region file " + path.u8string()
+        );
+    }
+    TableEntry table[REGION_CHUNKS_COUNT];
+    file.seekg(REGION_TABLE_OFFSET);
+    for (auto& entry : table) {
+        entry.offset = read_uint32(file);
+        entry.length = read_uint32(file);
     }
+    file.seekg(0, std::ios::end);
+    size_t fileSize = file.tellg();
+
+    const size_t headerSectors = REGION_DATA_OFFSET / REGION_SECTOR_SIZE;
+    std::vector<bool> used(std::max(count_sectors(fileSize), headerSectors));
+    std::fill(used.begin(), used.begin() + headerSectors, true);
+    for (const auto& entry : table) {
+        if (entry.offset == 0) {
+            continue;
+        }
+        size_t first = entry.offset / REGION_SECTOR_SIZE;
+        size_t count = count_sectors(entry.length);
+        if (first + count > used.size()) {
+            throw illegal_region_format("corrupted region offsets table");
+        }
+        std::fill(used.begin() + first, used.begin() + first + count, true);
+    }
+
+    auto chunks = region.getChunks();
+    auto sizes = region.getSizes();
+    const auto& unsaved = region.getUnsavedChunks();
+
+    size_t written = 0;
+    std::vector<std::pair<size_t, TableEntry>> changes;
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        intbuf = dataio::h2le(offsets[i]);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
+        if (!unsaved[i]) {
+            continue;
+        }
+        TableEntry entry {};
+        if (chunks[i]) {
+            entry.length = 8 + sizes[i][0];
+            size_t sector = allocate_sectors(used, count_sectors(entry.length));
+            entry.offset = sector * REGION_SECTOR_SIZE;
+            file.seekp(entry.offset);
+            write_chunk_record(file, chunks[i].get(), sizes[i]);
+            written += entry.length;
+        }
+        changes.emplace_back(i, entry);
+    }
+    // chunks data must be written before the table refers to it
+    file.flush();
+    for (const auto& [index, entry] : changes) {
+        file.seekp(REGION_TABLE_OFFSET + index * REGION_TABLE_ENTRY_SIZE);
+        write_uint32(file, entry.offset);
+        write_uint32(file, entry.length);
+        written += REGION_TABLE_ENTRY_SIZE;
+        table[index] = entry;
+    }
+    file.flush();
+    if (!file) {
+        throw std::runtime_error(
+            "could not write region file " + path.u8string()
+        );
     }
+    usedSectors = headerSectors;
+    for (const auto& entry : table) {
+        if (entry.offset) {
+            usedSectors += count_sectors(entry.length);
+        }
+    }
+    totalSectors = used.size();
+    return written;
+}
+
+namespace {
+    /// @brief Marks region file as being written. Cached file is closed on
+    /// start and end of the write
+    class RegFileWrite {
+        RegionsLayer& layer;
+        glm::ivec2 coord;
+
+        void close() {
+            layer.regFileWrites++;
+            layer.closeRegFile(coord);
+        }
+    public:
+        RegFileWrite(RegionsLayer& layer, glm::ivec2 coord)
+            : layer(layer), coord(coord) {
+            std::lock_guard lock(layer.regFilesMutex);
+            layer.writingRegFiles.insert(coord);
+            close();
+        }
+
+        ~RegFileWrite() {
+            std::lock_guard lock(layer.regFilesMutex);
+            layer.writingRegFiles.erase(coord);
+            close();
+        }
+    };
+}
+
+void RegionsLayer::writeRegion(int x, int z, WorldRegion* entry) {
+    auto path = io::resolve(folder / get_region_filename(x, z));
+
+    glm::ivec2 regcoord(x, z);
+    bool inPlace = false;
+    if (auto regfile = getRegFile(regcoord)) {
+        const auto& file = *regfile.get();
+        inPlace = file.version == REGION_FORMAT_VERSION &&
+                  file.compression == compression &&
+                  file.dictionaryId == getDictionaryId();
+        if (!inPlace) {
+            // older format or other codec file is converted
+            fetch_chunks(*this, entry, x, z, regfile.get());
+        }
+    }
+    RegFileWrite write(*this, regcoord);
+    if (inPlace) {
+        size_t usedSectors;
+        size_t totalSectors;
+        writtenBytes +=
+            write_chunks_in_place(path, *entry, usedSectors, totalSectors);
+        entry->resetUnsaved();
+        if (totalSectors < COMPACTION_MIN_SECTORS ||
+            usedSectors * 2 > totalSectors) {
+            return;
+        }
+        // more than half of the file is free: compact
+        if (auto regfile = getRegFile(regcoord)) {
+            fetch_chunks(*this, entry, x, z, regfile.get());
+        }
+    }
+    writtenBytes += write_region_file(
+        path, *entry, compression, getDictionaryId()
+    );
+    entry->resetUnsaved();
 }
 
 std::unique_ptr<ubyte[]> RegionsLayer::readChunkData(
@@ -237,5 +722,41 @@ std::unique_ptr<ubyte[]> RegionsLayer::readChunkData(
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
     int chunkIndex = localZ * REGION_SIZE + localX;
-    return rfile->read(chunkIndex, size, srcSize);
+    if (rfile->compression == compression &&
+        rfile->dictionaryId == getDictionaryId()) {
+        return rfile->read(chunkIndex, size, srcSize);
+    }
+    auto decompressed = readChunk(x, z, srcSize, rfile);
+    if (decompressed == nullptr) {
+        return nullptr;
+    }
+    size_t newSize;
+    auto data = compress(decompressed.get(), srcSize, newSize);
+    size = newSize;
+    return data;
+}
+
+std::unique_ptr<ubyte[]> RegionsLayer::readChunk(
+    int x, int z, uint32_t& srcSize, regfile* rfile
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+    int chunkIndex = localZ * REGION_SIZE + localX;
+    uint32_t size;
+    std::vector<ubyte> buffer;
+    const ubyte* bytes =
+        rfile->getChunkData(chunkIndex, size, srcSize, buffer);
+    if (bytes == nullptr) {
+        return nullptr;
+    }
+    if (rfile->compression == compression::Method::NONE) {
+        srcSize = size;
+    }
+    std::shared_ptr<const compression::Dictionary> fileDictionary;
+    if (rfile->dictionaryId) {
+        fileDictionary = getDictionary(rfile->dictionaryId);
+    }
+    return decompress_chunk(
+        bytes, size, srcSize, rfile->compression, fileDictionary.get()
+    );
 }
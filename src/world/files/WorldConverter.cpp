@@ -43,6 +43,10 @@ void WorldConverter::addRegionsTasks(
         return;
     }
     for (const auto& file :io::directory_iterator(regionsFolder)) {
+        // compression dictionaries are stored with region files
+        if (file.extension() != ".bin") {
+            continue;
+        }
         int x, z;
         std::string name = file.stem();
         if (!WorldRegions::parseRegionFilename(name, x, z)) {
@@ -183,8 +187,19 @@ void WorldConverter::upgradeRegion(
     const io::path& file, int x, int z, RegionLayerIndex layer
 ) const {
     auto path = wfile->getRegions().getRegionFilePath(layer, x, z);
-    auto bytes = io::read_bytes_buffer(path);
-    auto buffer = compatibility::convert_region_2to3(bytes, layer);
+    auto buffer = io::read_bytes_buffer(path);
+    if (buffer.size() <= REGION_HEADER_SIZE) {
+        logger.error() << "invalid region file " << path.string();
+        return;
+    }
+    uint version = buffer[8];
+    if (version == 2) {
+        buffer = compatibility::convert_region_2to3(buffer, layer);
+        version = 3;
+    }
+    if (version == 3) {
+        buffer = compatibility::convert_region_3to4(buffer);
+    }
     io::write_bytes(path, buffer.data(), buffer.size());
 }
 
@@ -308,6 +323,7 @@ void WorldConverter::write() {
     }
     wfile->patchIndicesFile(patch);
     wfile->write(nullptr, nullptr);
+    wfile->getRegions().flush();
 }
 
 void WorldConverter::waitForEnd() {
@@ -1,6 +1,8 @@
 #include "WorldRegions.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <exception>
 #include <utility>
 #include <vector>
 
@@ -21,16 +23,43 @@ WorldRegion::WorldRegion()
     : chunksData(
           std::make_unique<std::unique_ptr<ubyte[]>[]>(REGION_CHUNKS_COUNT)
       ),
-      sizes(std::make_unique<glm::u32vec2[]>(REGION_CHUNKS_COUNT)) {
+      sizes(std::make_unique<glm::u32vec2[]>(REGION_CHUNKS_COUNT)),
+      memoryUsage(
+          sizeof(WorldRegion) +
+          REGION_CHUNKS_COUNT *
+              (sizeof(std::unique_ptr<ubyte[]>) + sizeof(glm::u32vec2))
+      ) {
 }
 
 WorldRegion::~WorldRegion() = default;
 
-void WorldRegion::setUnsaved(bool unsaved) {
-    this->unsaved = unsaved;
+void WorldRegion::setUnsaved(uint x, uint z) {
+    unsavedChunks.set(z * REGION_SIZE + x);
 }
+
+void WorldRegion::resetUnsaved() {
+    unsavedChunks.reset();
+}
+
 bool WorldRegion::isUnsaved() const {
-    return unsaved;
+    return unsavedChunks.any();
+}
+
+std::unique_ptr<WorldRegion> WorldRegion::copyUnsaved() const {
+    auto copy = std::make_unique<WorldRegion>();
+    copy->unsavedChunks = unsavedChunks;
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        if (!unsavedChunks[i] || chunksData[i] == nullptr) {
+            continue;
+        }
+        uint32_t size = sizes[i][0];
+        auto data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), chunksData[i].get(), size);
+        copy->put(
+            i % REGION_SIZE, i / REGION_SIZE, std::move(data), size, sizes[i][1]
+        );
+    }
+    return copy;
 }
 
 std::unique_ptr<ubyte[]>* WorldRegion::getChunks() const {
@@ -45,6 +74,12 @@ void WorldRegion::put(
     uint x, uint z, std::unique_ptr<ubyte[]> data, uint32_t size, uint32_t srcSize
 ) {
     size_t chunk_index = z * REGION_SIZE + x;
+    if (chunksData[chunk_index]) {
+        memoryUsage -= sizes[chunk_index][0];
+    }
+    if (data) {
+        memoryUsage += size;
+    }
     chunksData[chunk_index] = std::move(data);
     sizes[chunk_index] = glm::u32vec2(size, srcSize);
 }
@@ -60,6 +95,8 @@ glm::u32vec2 WorldRegion::getChunkDataSize(uint x, uint z) {
 WorldRegions::WorldRegions(const io::path& directory) : directory(directory) {
     for (size_t i = 0; i < REGION_LAYERS_COUNT; i++) {
         layers[i].layer = static_cast<RegionLayerIndex>(i);
+        layers[i].useClock = &useClock;
+        layers[i].onRegionCreate = [this]() { evictRegions(); };
     }
     auto& voxels = layers[REGION_LAYER_VOXELS];
     voxels.folder = directory / "regions";
@@ -77,16 +114,12 @@ WorldRegions::WorldRegions(const io::path& directory) : directory(directory) {
     blocksData.folder = directory / "blocksdata";
 }
 
-WorldRegions::~WorldRegions() = default;
-
-void RegionsLayer::writeAll() {
-    for (auto& it : regions) {
-        WorldRegion* region = it.second.get();
-        if (region->getChunks() == nullptr || !region->isUnsaved()) {
-            continue;
-        }
-        const auto& key = it.first;
-        writeRegion(key[0], key[1], region);
+WorldRegions::~WorldRegions() {
+    // put data must be stored before writing
+    try {
+        flush();
+    } catch (const std::exception& err) {
+        logger.error() << "could not write regions: " << err.what();
     }
 }
 
@@ -97,23 +130,127 @@ void WorldRegions::put(
     std::unique_ptr<ubyte[]> data,
     size_t srcSize
 ) {
-    size_t size = srcSize;
-    auto& layer = layers[layerid];
+    auto pendingData = std::make_shared<PendingData>();
+    pendingData->data = std::move(data);
+    pendingData->size = srcSize;
+    glm::ivec3 key(x, z, layerid);
+    bool startBatch;
+    {
+        std::lock_guard lock(pendingMutex);
+        pending[key] = pendingData;
+        if (prefetched.erase(key)) {
+            prefetchWasted++;
+        }
+        if (prefetchesRunning) {
+            putsDuringPrefetch.insert(key);
+        }
+        // data put while the batch is waiting joins it
+        startBatch = storeQueue.empty();
+        storeQueue.emplace_back(key, std::move(pendingData));
+    }
+    if (startBatch) {
+        saver.submit([this]() { storeQueued(); });
+    }
+}
+
+/// @brief Run function for indices [0, count) on all workers of the group
+static void parallel_for(
+    util::WorkerGroup& workers,
+    size_t count,
+    const std::function<void(size_t)>& func
+) {
+    std::atomic<size_t> next = 0;
+    workers.run([&](uint) {
+        size_t index;
+        while ((index = next++) < count) {
+            func(index);
+        }
+    });
+}
+
+void WorldRegions::storeQueued() {
+    decltype(storeQueue) batch;
+    {
+        std::lock_guard lock(pendingMutex);
+        std::swap(batch, storeQueue);
+    }
+    // source data is still readable as pending so it is never moved
+    struct Compressed {
+        std::unique_ptr<ubyte[]> data;
+        size_t size = 0;
+        std::exception_ptr error;
+    };
+    std::vector<Compressed> compressed(batch.size());
+    parallel_for(codecWorkers, batch.size(), [&](size_t index) {
+        const auto& [key, source] = batch[index];
+        const auto& layer = layers[key.z];
+        auto& dst = compressed[index];
+        dst.size = source->size;
+        if (source->data == nullptr) {
+            return;
+        }
+        try {
+            dst.data =
+                layer.compress(source->data.get(), source->size, dst.size);
+        } catch (...) {
+            dst.error = std::current_exception();
+        }
+    });
+    // failed entry does not stop the batch, the first error is rethrown
+    // when pending data is cleaned up
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < batch.size(); i++) {
+            auto& entry = compressed[i];
+            if (entry.error == nullptr) {
+                try {
+                    store(
+                        batch[i].first,
+                        std::move(entry.data),
+                        entry.size,
+                        batch[i].second->size
+                    );
+                } catch (...) {
+                    entry.error = std::current_exception();
+                }
+            }
+            if (entry.error && error == nullptr) {
+                error = entry.error;
+            }
+        }
+    }
+    {
+        std::lock_guard lock(pendingMutex);
+        for (const auto& [key, source] : batch) {
+            auto found = pending.find(key);
+            if (found != pending.end() && found->second == source) {
+                pending.erase(found);
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorldRegions::store(
+    const glm::ivec3& key,
+    std::unique_ptr<ubyte[]> data,
+    size_t size,
+    size_t srcSize
+) {
     int regionX, regionZ, localX, localZ;
-    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+    calc_reg_coords(key.x, key.y, regionX, regionZ, localX, localZ);
 
+    auto& layer = layers[key.z];
     WorldRegion* region = layer.getOrCreateRegion(regionX, regionZ);
-    region->setUnsaved(true);
-    
+    region->setUnsaved(localX, localZ);
+
     if (data == nullptr) {
         region->put(localX, localZ, nullptr, 0, 0);
         return;
     }
-
-    if (layer.compression != compression::Method::NONE) {
-        data = compression::compress(
-            data.get(), size, size, layer.compression);
-    }
     region->put(localX, localZ, std::move(data), size, srcSize);
 }
 
@@ -215,52 +352,235 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
     }
 }
 
+std::shared_ptr<WorldRegions::PendingData> WorldRegions::getPending(
+    int x, int z, RegionLayerIndex layer
+) {
+    std::lock_guard lock(pendingMutex);
+    auto found = pending.find(glm::ivec3(x, z, layer));
+    if (found == pending.end()) {
+        return nullptr;
+    }
+    return found->second;
+}
+
+void WorldRegions::prefetch(const std::vector<glm::ivec2>& chunks) {
+    static const RegionLayerIndex PREFETCH_LAYERS[] {
+        REGION_LAYER_VOXELS, REGION_LAYER_LIGHTS};
+
+    struct Entry {
+        glm::ivec3 key;
+        std::unique_ptr<ubyte[]> source;
+        uint32_t size;
+        uint32_t srcSize;
+        std::shared_ptr<PendingData> decompressed;
+    };
+    std::vector<Entry> entries;
+    {
+        std::lock_guard lock(pendingMutex);
+        prefetchesRunning++;
+        for (const auto& pos : chunks) {
+            for (auto layerid : PREFETCH_LAYERS) {
+                // pending data is newer than stored one
+                glm::ivec3 key(pos.x, pos.y, layerid);
+                if (pending.find(key) == pending.end() &&
+                    prefetched.find(key) == prefetched.end()) {
+                    entries.push_back(Entry {key, nullptr, 0, 0, nullptr});
+                }
+            }
+        }
+    }
+    // region files are read sequentially, only decompression is parallel
+    for (auto& entry : entries) {
+        auto& layer = layers[entry.key.z];
+        try {
+            std::lock_guard lock(mutex);
+            auto bytes = layer.getData(
+                entry.key.x, entry.key.y, entry.size, entry.srcSize
+            );
+            if (bytes == nullptr) {
+                continue;
+            }
+            entry.source = std::make_unique<ubyte[]>(entry.size);
+            std::memcpy(entry.source.get(), bytes, entry.size);
+        } catch (const std::exception& err) {
+            // the chunk is read again on demand reporting the error
+            logger.warning() << "could not prefetch chunk " << entry.key.x
+                             << "_" << entry.key.y << ": " << err.what();
+        }
+    }
+    parallel_for(codecWorkers, entries.size(), [&](size_t index) {
+        auto& entry = entries[index];
+        if (entry.source == nullptr) {
+            return;
+        }
+        auto& layer = layers[entry.key.z];
+        auto data = std::make_shared<PendingData>();
+        if (layer.compression == compression::Method::NONE) {
+            data->data = std::move(entry.source);
+            data->size = entry.size;
+        } else {
+            try {
+                data->data = layer.decompress(
+                    entry.source.get(), entry.size, entry.srcSize
+                );
+            } catch (const std::exception&) {
+                return;
+            }
+            data->size = entry.srcSize;
+        }
+        entry.decompressed = std::move(data);
+    });
+
+    std::lock_guard lock(pendingMutex);
+    for (auto& entry : entries) {
+        if (entry.decompressed == nullptr) {
+            continue;
+        }
+        // data read before a put may be outdated
+        if (putsDuringPrefetch.find(entry.key) != putsDuringPrefetch.end() ||
+            pending.find(entry.key) != pending.end()) {
+            prefetchWasted++;
+            continue;
+        }
+        prefetched[entry.key] = entry.decompressed;
+        prefetchOrder.emplace_back(entry.key, std::move(entry.decompressed));
+        prefetchedCount++;
+    }
+    if (--prefetchesRunning == 0) {
+        putsDuringPrefetch.clear();
+    }
+    trimPrefetched();
+}
+
+void WorldRegions::trimPrefetched() {
+    auto dropFront = [this]() {
+        const auto& [key, data] = prefetchOrder.front();
+        auto found = prefetched.find(key);
+        // read or replaced data is not in the map already
+        bool unused = found != prefetched.end() && found->second == data;
+        if (unused) {
+            prefetched.erase(found);
+        }
+        prefetchOrder.pop_front();
+        return unused;
+    };
+    // the order keeps entries of read data until they reach the front
+    while (!prefetchOrder.empty() &&
+           (prefetched.size() > MAX_PREFETCHED ||
+            prefetchOrder.size() > MAX_PREFETCHED * 2)) {
+        if (dropFront()) {
+            prefetchWasted++;
+        }
+    }
+}
+
+void WorldRegions::requestPrefetch(std::vector<glm::ivec2> chunks) {
+    bool schedule;
+    {
+        std::lock_guard lock(pendingMutex);
+        prefetchRequest = std::move(chunks);
+        schedule = !prefetchScheduled;
+        prefetchScheduled = true;
+    }
+    if (!schedule) {
+        return;
+    }
+    prefetcher.submit([this]() {
+        std::vector<glm::ivec2> request;
+        {
+            std::lock_guard lock(pendingMutex);
+            std::swap(request, prefetchRequest);
+            prefetchScheduled = false;
+        }
+        prefetch(request);
+    });
+}
+
+std::unique_ptr<ubyte[]> WorldRegions::getData(
+    int x, int z, RegionLayerIndex layerid, uint32_t& size
+) {
+    if (auto pendingData = getPending(x, z, layerid)) {
+        if (pendingData->data == nullptr) {
+            return nullptr;
+        }
+        size = pendingData->size;
+        auto data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), pendingData->data.get(), size);
+        return data;
+    }
+    {
+        std::lock_guard lock(pendingMutex);
+        auto found = prefetched.find(glm::ivec3(x, z, layerid));
+        if (found != prefetched.end()) {
+            auto prefetchedData = std::move(found->second);
+            prefetched.erase(found);
+            prefetchHits++;
+            size = prefetchedData->size;
+            return std::move(prefetchedData->data);
+        }
+    }
+    std::unique_ptr<ubyte[]> data;
+    regfile_ptr file;
+    {
+        std::lock_guard lock(mutex);
+        data = layers[layerid].getDecompressed(x, z, size, &file);
+    }
+    if (file) {
+        // region files are read by multiple threads without the lock
+        data = layers[layerid].readChunk(x, z, size, file.get());
+    }
+    if (data && (layerid == REGION_LAYER_VOXELS ||
+                 layerid == REGION_LAYER_LIGHTS)) {
+        std::lock_guard lock(pendingMutex);
+        prefetchMisses++;
+    }
+    return data;
+}
+
 std::unique_ptr<ubyte[]> WorldRegions::getVoxels(int x, int z) {
     uint32_t size;
-    uint32_t srcSize;
-    auto& layer = layers[REGION_LAYER_VOXELS];
-    auto* data = layer.getData(x, z, size, srcSize);
-    if (data == nullptr) {
-        return nullptr;
+    auto data = getData(x, z, REGION_LAYER_VOXELS, size);
+    assert(data == nullptr || size == CHUNK_DATA_LEN);
+    return data;
+}
+
+bool WorldRegions::hasVoxels(int x, int z) {
+    if (auto pendingData = getPending(x, z, REGION_LAYER_VOXELS)) {
+        return pendingData->data != nullptr;
     }
-    assert(srcSize == CHUNK_DATA_LEN);
-    return compression::decompress(data, size, srcSize, layer.compression);
+    uint32_t size;
+    uint32_t srcSize;
+    std::lock_guard lock(mutex);
+    return layers[REGION_LAYER_VOXELS].getData(x, z, size, srcSize) != nullptr;
 }
 
 std::unique_ptr<light_t[]> WorldRegions::getLights(int x, int z) {
     uint32_t size;
-    uint32_t srcSize;
-    auto& layer = layers[REGION_LAYER_LIGHTS];
-    auto* bytes = layer.getData(x, z, size, srcSize);
-    if (bytes == nullptr) {
+    auto data = getData(x, z, REGION_LAYER_LIGHTS, size);
+    if (data == nullptr) {
         return nullptr;
     }
-    auto data = compression::decompress(
-        bytes, size, srcSize, layer.compression
-    );
-    assert(srcSize == LIGHTMAP_DATA_LEN);
+    assert(size == LIGHTMAP_DATA_LEN);
     return Lightmap::decode(data.get());
 }
 
 ChunkInventoriesMap WorldRegions::fetchInventories(int x, int z) {
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_INVENTORIES].getData(x, z, bytesSize, srcSize);
+    uint32_t size;
+    auto bytes = getData(x, z, REGION_LAYER_INVENTORIES, size);
     if (bytes == nullptr) {
         return {};
     }
-    return load_inventories(bytes, bytesSize);
+    return load_inventories(bytes.get(), size);
 }
 
 BlocksMetadata WorldRegions::getBlocksData(int x, int z) {
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_BLOCKS_DATA].getData(x, z, bytesSize, srcSize);
+    uint32_t size;
+    auto bytes = getData(x, z, REGION_LAYER_BLOCKS_DATA, size);
     if (bytes == nullptr) {
         return {};
     }
     BlocksMetadata heap;
-    heap.deserialize(bytes, bytesSize);
+    heap.deserialize(bytes.get(), size);
     return heap;
 }
 
@@ -299,26 +619,21 @@ void WorldRegions::processBlocksData(int x, int z, const BlockDataProc& func) {
 
             uint32_t datLength;
             uint32_t datSrcSize;
-            auto datData = RegionsLayer::readChunkData(
+            auto datData = datLayer.readChunkData(
                 gx, gz, datLength, datSrcSize, datRegfile.get()
             );
             if (datData == nullptr) {
                 continue;
             }
-            uint32_t voxLength;
             uint32_t voxSrcSize;
-            auto voxData = RegionsLayer::readChunkData(
-                gx, gz, voxLength, voxSrcSize, voxRegfile.get()
-            );
+            auto voxData =
+                voxLayer.readChunk(gx, gz, voxSrcSize, voxRegfile.get());
             if (voxData == nullptr) {
                 logger.warning()
                     << "missing voxels for chunk (" << gx << ", " << gz << ")";
                 put(gx, gz, REGION_LAYER_BLOCKS_DATA, nullptr, 0);
                 continue;
             }
-            voxData = compression::decompress(
-                voxData.get(), voxLength, voxSrcSize, voxLayer.compression
-            );
 
             BlocksMetadata blocksData;
             blocksData.deserialize(datData.get(), datLength);
@@ -339,13 +654,12 @@ dv::value WorldRegions::fetchEntities(int x, int z) {
     if (generatorTestMode) {
         return nullptr;
     }
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    const ubyte* data = layers[REGION_LAYER_ENTITIES].getData(x, z, bytesSize, srcSize);
+    uint32_t size;
+    auto data = getData(x, z, REGION_LAYER_ENTITIES, size);
     if (data == nullptr) {
         return nullptr;
     }
-    auto map = json::from_binary(data, bytesSize);
+    auto map = json::from_binary(data.get(), size);
     if (map.empty()) {
         return nullptr;
     }
@@ -367,20 +681,11 @@ void WorldRegions::processRegion(
         for (uint cx = 0; cx < REGION_SIZE; cx++) {
             int gx = cx + x * REGION_SIZE;
             int gz = cz + z * REGION_SIZE;
-            uint32_t length;
             uint32_t srcSize;
-            auto data =
-                RegionsLayer::readChunkData(gx, gz, length, srcSize, regfile.get());
+            auto data = layer.readChunk(gx, gz, srcSize, regfile.get());
             if (data == nullptr) {
                 continue;
             }
-            if (layer.compression != compression::Method::NONE) {
-                data = compression::decompress(
-                    data.get(), length, srcSize, layer.compression
-                );
-            } else {
-                srcSize = length;
-            }
             if (auto writeData = func(std::move(data), &srcSize)) {
                 put(gx, gz, layerid, std::move(writeData), srcSize);
             }
@@ -396,17 +701,258 @@ io::path WorldRegions::getRegionFilePath(RegionLayerIndex layerid, int x, int z)
     return layers[layerid].getRegionFilePath(x, z);
 }
 
+void WorldRegions::writeLayer(RegionsLayer& layer) {
+    std::vector<glm::ivec2> unsaved;
+    {
+        std::lock_guard lock(layer.mapMutex);
+        for (const auto& [coord, region] : layer.regions) {
+            if (region->isUnsaved()) {
+                unsaved.push_back(coord);
+            }
+        }
+    }
+    if (unsaved.empty()) {
+        return;
+    }
+    io::create_directories(layer.folder);
+    for (const auto& coord : unsaved) {
+        writeRegion(layer, coord);
+    }
+}
+
+bool WorldRegions::writeRegion(RegionsLayer& layer, glm::ivec2 coord) {
+    std::unique_ptr<WorldRegion> copy;
+    {
+        std::lock_guard lock(mutex);
+        auto region = layer.getRegion(coord.x, coord.y);
+        if (region == nullptr || !region->isUnsaved()) {
+            return false;
+        }
+        copy = region->copyUnsaved();
+    }
+    // the region keeps unsaved flags until the file is written so removed
+    // chunks are not read from the old file meanwhile
+    layer.writeRegion(coord.x, coord.y, copy.get());
+
+    std::lock_guard lock(mutex);
+    if (auto region = layer.getRegion(coord.x, coord.y)) {
+        region->resetUnsaved();
+    }
+    return true;
+}
+
+void WorldRegions::writeEvicted() {
+    decltype(writebackQueue) queue;
+    {
+        std::lock_guard lock(mutex);
+        std::swap(queue, writebackQueue);
+    }
+    for (const auto& key : queue) {
+        auto& layer = layers[key.z];
+        glm::ivec2 coord(key.x, key.y);
+        io::create_directories(layer.folder);
+        if (writeRegion(layer, coord)) {
+            layer.writebacks++;
+        }
+        std::lock_guard lock(mutex);
+        // region changed or taken in use while written stays in memory
+        auto region = layer.getRegion(coord.x, coord.y);
+        if (region && !region->isUnsaved() &&
+            regionsInUse.find(coord) == regionsInUse.end()) {
+            layer.evictRegion(coord.x, coord.y);
+        }
+    }
+}
+
 void WorldRegions::writeAll() {
     for (auto& layer : layers) {
         io::create_directories(layer.folder);
-        layer.writeAll();
+    }
+    saver.submit([this]() {
+        for (auto& layer : layers) {
+            writeLayer(layer);
+        }
+    });
+}
+
+void WorldRegions::flush() {
+    saver.flush();
+}
+
+void WorldRegions::setCacheBudget(size_t bytes) {
+    std::lock_guard lock(mutex);
+    cacheBudget = bytes;
+    evictRegions();
+}
+
+void WorldRegions::setRegionFilesLimit(size_t limit) {
+    for (auto& layer : layers) {
+        layer.setMaxOpenRegFiles(limit);
+    }
+}
+
+void WorldRegions::setCodec(
+    RegionLayerIndex layerid,
+    compression::Method method,
+    std::shared_ptr<const compression::Dictionary> dictionary
+) {
+    // queued data is compressed with the current codec. Regions are
+    // written by the saver without the lock so the codec is changed by it
+    saver.submit([this, layerid, method, dictionary]() {
+        std::lock_guard lock(mutex);
+        layers[layerid].setCodec(method, dictionary);
+    });
+    flush();
+}
+
+std::shared_ptr<const compression::Dictionary> WorldRegions::requireDictionary(
+    RegionLayerIndex layerid, size_t maxSamples
+) {
+    auto& layer = layers[layerid];
+    auto file = layer.folder / "dictionary.dict";
+    if (io::is_regular_file(file)) {
+        auto bytes = io::read_bytes_buffer(file);
+        return std::make_shared<compression::Dictionary>(
+            std::vector<ubyte>(bytes.data(), bytes.data() + bytes.size())
+        );
+    }
+    if (!io::is_directory(layer.folder)) {
+        return nullptr;
+    }
+    std::vector<std::unique_ptr<ubyte[]>> chunksData;
+    std::vector<std::pair<const ubyte*, size_t>> samples;
+    for (const auto& regionFile : io::directory_iterator(layer.folder)) {
+        int regionX, regionZ;
+        if (regionFile.extension() != ".bin" ||
+            !parseRegionFilename(regionFile.stem(), regionX, regionZ)) {
+            continue;
+        }
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            if (samples.size() >= maxSamples) {
+                break;
+            }
+            uint32_t size;
+            auto data = getData(
+                regionX * REGION_SIZE + i % REGION_SIZE,
+                regionZ * REGION_SIZE + i / REGION_SIZE,
+                layerid,
+                size
+            );
+            if (data) {
+                samples.emplace_back(data.get(), size);
+                chunksData.push_back(std::move(data));
+            }
+        }
+    }
+    auto dictionary = compression::train_dictionary(samples);
+    if (dictionary == nullptr) {
+        return nullptr;
+    }
+    io::write_bytes(file, dictionary->data.data(), dictionary->data.size());
+    logger.info() << "trained " << dictionary->data.size()
+                  << " bytes dictionary on " << samples.size() << " chunks";
+    return dictionary;
+}
+
+void WorldRegions::setRegionInUse(int x, int z, bool inUse) {
+    std::lock_guard lock(mutex);
+    if (inUse) {
+        regionsInUse.insert({x, z});
+    } else {
+        regionsInUse.erase({x, z});
+    }
+}
+
+RegionsCacheStats WorldRegions::getCacheStats() {
+    std::lock_guard lock(mutex);
+    RegionsCacheStats stats {};
+    for (auto& layer : layers) {
+        std::lock_guard lock(layer.mapMutex);
+        stats.hits += layer.hits;
+        stats.misses += layer.misses;
+        stats.evictions += layer.evictions;
+        stats.writebacks += layer.writebacks;
+        stats.writtenBytes += layer.writtenBytes;
+        stats.regions += layer.regions.size();
+        for (const auto& [_, region] : layer.regions) {
+            stats.memoryUsage += region->getMemoryUsage();
+        }
+        std::shared_lock filesLock(layer.regFilesMutex);
+        stats.openFiles += layer.openRegFiles.size();
+        stats.fileOpens += layer.regFileOpens;
+    }
+    std::lock_guard pendingLock(pendingMutex);
+    stats.prefetched = prefetchedCount;
+    stats.prefetchHits = prefetchHits;
+    stats.prefetchMisses = prefetchMisses;
+    stats.prefetchWasted = prefetchWasted;
+    return stats;
+}
+
+void WorldRegions::evictRegions() {
+    struct Candidate {
+        uint64_t lastUse;
+        size_t memoryUsage;
+        bool unsaved;
+        RegionLayerIndex layer;
+        glm::ivec2 coord;
+    };
+    std::vector<Candidate> candidates;
+    size_t total = 0;
+    for (auto& layer : layers) {
+        std::lock_guard lock(layer.mapMutex);
+        for (const auto& [coord, region] : layer.regions) {
+            size_t usage = region->getMemoryUsage();
+            total += usage;
+            candidates.push_back(
+                {region->lastUse, usage, region->isUnsaved(), layer.layer, coord}
+            );
+        }
+    }
+    if (total <= cacheBudget) {
+        return;
+    }
+    std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [](const auto& a, const auto& b) { return a.lastUse < b.lastUse; }
+    );
+    for (const auto& candidate : candidates) {
+        if (total <= cacheBudget) {
+            break;
+        }
+        const auto& coord = candidate.coord;
+        if (regionsInUse.find(coord) != regionsInUse.end()) {
+            continue;
+        }
+        // unsaved data is dropped in generator test mode as on world save
+        if (candidate.unsaved && !generatorTestMode) {
+            // file is written by the saver out of the lock
+            if (writebackQueue.empty()) {
+                saver.submit([this]() { writeEvicted(); });
+            }
+            writebackQueue.insert(glm::ivec3(coord, candidate.layer));
+            total -= candidate.memoryUsage;
+            continue;
+        }
+        if (layers[candidate.layer].evictRegion(coord.x, coord.y)) {
+            total -= candidate.memoryUsage;
+        }
     }
 }
 
 void WorldRegions::deleteRegion(RegionLayerIndex layerid, int x, int z) {
     auto& layer = layers[layerid];
-    if (layer.getRegFile({x, z}, false)) {
-        throw std::runtime_error("region file is currently in use");
+    std::lock_guard lock(mutex);
+    {
+        std::lock_guard filesLock(layer.regFilesMutex);
+        const auto found = layer.openRegFiles.find({x, z});
+        if (found != layer.openRegFiles.end()) {
+            if (found->second.use_count() > 1) {
+                throw std::runtime_error("region file is currently in use");
+            }
+            layer.closeRegFile({x, z});
+        }
     }
     auto file = layer.getRegionFilePath(x, z);
     if (io::exists(file)) {
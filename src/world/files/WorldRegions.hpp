@@ -1,14 +1,22 @@
 #pragma once
 
-#include <condition_variable>
+#include <atomic>
+#include <bitset>
+#include <deque>
 #include <functional>
 #include <glm/glm.hpp>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "typedefs.hpp"
+#include "delegates.hpp"
 #include "util/BufferPool.hpp"
+#include "util/SerialWorker.hpp"
+#include "util/WorkerGroup.hpp"
 #include "voxels/Chunk.hpp"
 #include "maths/voxmaths.hpp"
 #include "coders/compression.hpp"
@@ -24,6 +32,18 @@ inline constexpr uint REGION_SIZE_BIT = 5;
 inline constexpr uint REGION_SIZE = (1 << (REGION_SIZE_BIT));
 inline constexpr uint REGION_CHUNKS_COUNT = ((REGION_SIZE) * (REGION_SIZE));
 
+/// @brief Region file chunks allocation unit (since version 4)
+inline constexpr uint REGION_SECTOR_SIZE = 512;
+/// @brief Offsets table position (since version 4)
+inline constexpr uint REGION_TABLE_OFFSET = 16;
+/// @brief Offsets table entry: chunk record offset and length
+inline constexpr uint REGION_TABLE_ENTRY_SIZE = 8;
+/// @brief First chunk record position (since version 4)
+inline constexpr uint REGION_DATA_OFFSET =
+    (REGION_TABLE_OFFSET + REGION_CHUNKS_COUNT * REGION_TABLE_ENTRY_SIZE +
+     REGION_SECTOR_SIZE - 1) /
+    REGION_SECTOR_SIZE * REGION_SECTOR_SIZE;
+
 class illegal_region_format : public std::runtime_error {
 public:
     illegal_region_format(const std::string& message)
@@ -34,8 +54,13 @@ public:
 class WorldRegion {
     std::unique_ptr<std::unique_ptr<ubyte[]>[]> chunksData;
     std::unique_ptr<glm::u32vec2[]> sizes;
-    bool unsaved = false;
+    /// @brief Chunks changed since the region was written
+    std::bitset<REGION_CHUNKS_COUNT> unsavedChunks;
+    size_t memoryUsage;
 public:
+    /// @brief Regions use clock value of the last access
+    uint64_t lastUse = 0;
+
     WorldRegion();
     ~WorldRegion();
 
@@ -43,9 +68,26 @@ public:
     ubyte* getChunkData(uint x, uint z);
     glm::u32vec2 getChunkDataSize(uint x, uint z);
 
-    void setUnsaved(bool unsaved);
+    /// @brief Mark chunk data to be written on the next region write
+    void setUnsaved(uint x, uint z);
+    /// @brief Mark all chunks saved
+    void resetUnsaved();
+    /// @return true if any chunk is unsaved
     bool isUnsaved() const;
 
+    /// @brief Copy unsaved chunks to write them without locking the region.
+    /// Other chunks are read from the region file if needed
+    std::unique_ptr<WorldRegion> copyUnsaved() const;
+
+    const std::bitset<REGION_CHUNKS_COUNT>& getUnsavedChunks() const {
+        return unsavedChunks;
+    }
+
+    /// @return memory used by the region and its chunks data in bytes
+    size_t getMemoryUsage() const {
+        return memoryUsage;
+    }
+
     std::unique_ptr<ubyte[]>* getChunks() const;
     glm::u32vec2* getSizes() const;
 };
@@ -53,11 +95,34 @@ public:
 struct regfile {
     io::rafile file;
     int version;
-    bool inUse = false;
+    /// @brief Compression method of chunks data
+    compression::Method compression;
+    /// @brief Compression dictionary id, 0 if not used (since version 4)
+    uint32_t dictionaryId = 0;
+    /// @brief Chunk records offsets read from the file table on open
+    uint32_t offsets[REGION_CHUNKS_COUNT] {};
+    /// @brief Last use time of the open files cache
+    std::atomic<uint64_t> lastUse {0};
 
     regfile(io::path filename);
     regfile(const regfile&) = delete;
 
+    /// @brief Get compressed chunk data. Data of a mapped file is not copied.
+    /// Safe to call from multiple threads
+    /// @param index chunk index in region
+    /// @param size [out] compressed chunk data length
+    /// @param srcSize [out] source chunk data length
+    /// @param buffer chunk record buffer used if file is read as stream
+    /// @return chunk data valid until the buffer change or file close,
+    /// nullptr if chunk is not present in the file
+    /// @throws illegal_region_format if chunk record is out of file bounds
+    const ubyte* getChunkData(
+        int index,
+        uint32_t& size,
+        uint32_t& srcSize,
+        std::vector<ubyte>& buffer
+    );
+
     std::unique_ptr<ubyte[]> read(int index, uint32_t& size, uint32_t& srcSize);
 };
 
@@ -66,42 +131,37 @@ using RegionProc = std::function<std::unique_ptr<ubyte[]>(std::unique_ptr<ubyte[
 using InventoryProc = std::function<void(Inventory*)>;
 using BlockDataProc = std::function<void(BlocksMetadata*, std::unique_ptr<ubyte[]>)>;
 
-/// @brief Region file pointer keeping inUse flag on until destroyed
-class regfile_ptr {
-    regfile* file;
-    std::condition_variable* cv;
-public:
-    regfile_ptr(regfile* file, std::condition_variable* cv)
-        : file(file), cv(cv) {
-    }
-
-    regfile_ptr(const regfile_ptr&) = delete;
-
-    regfile_ptr(std::nullptr_t) : file(nullptr), cv(nullptr) {
-    }
-
-    bool operator==(std::nullptr_t) const {
-        return file == nullptr;
-    }
-    bool operator!=(std::nullptr_t) const {
-        return file != nullptr;
-    }
-    operator bool() const {
-        return file != nullptr;
-    }
-    ~regfile_ptr() {
-        reset();
-    }
-    regfile* get() {
-        return file;
-    }
-    void reset() {
-        if (file) {
-            file->inUse = false;
-            cv->notify_one();
-            file = nullptr;
-        }
-    }
+/// @brief Shared region file handle. File closed by the open files cache
+/// stays open until the last handle is released
+using regfile_ptr = std::shared_ptr<regfile>;
+
+struct RegionsCacheStats {
+    /// @brief Region requests served from memory
+    size_t hits = 0;
+    /// @brief Region requests created a new in-memory region
+    size_t misses = 0;
+    /// @brief Regions removed from memory
+    size_t evictions = 0;
+    /// @brief Unsaved regions written to files on eviction
+    size_t writebacks = 0;
+    /// @brief Bytes written to region files
+    size_t writtenBytes = 0;
+    /// @brief In-memory regions count
+    size_t regions = 0;
+    /// @brief Memory used by in-memory regions in bytes
+    size_t memoryUsage = 0;
+    /// @brief Chunks data read and decompressed ahead of time
+    size_t prefetched = 0;
+    /// @brief Chunks data reads served from prefetched data
+    size_t prefetchHits = 0;
+    /// @brief Chunks data reads of saved chunks not prefetched
+    size_t prefetchMisses = 0;
+    /// @brief Prefetched data dropped unused or outdated
+    size_t prefetchWasted = 0;
+    /// @brief Open region files count
+    size_t openFiles = 0;
+    /// @brief Region files opened (including reopened after close)
+    size_t fileOpens = 0;
 };
 
 inline void calc_reg_coords(
@@ -121,6 +181,13 @@ struct RegionsLayer {
     io::path folder;
 
     compression::Method compression = compression::Method::NONE;
+    /// @brief Dictionary used to compress chunks data, may be nullptr
+    std::shared_ptr<const compression::Dictionary> dictionary;
+
+    /// @brief Loaded dictionaries of region files by id
+    std::unordered_map<uint32_t, std::shared_ptr<const compression::Dictionary>>
+        dictionaries;
+    std::mutex dictionariesMutex;
 
     /// @brief In-memory regions data
     RegionsMap regions;
@@ -128,23 +195,88 @@ struct RegionsLayer {
     /// @brief In-memory regions map mutex
     std::mutex mapMutex;
 
-    /// @brief Open region files map
-    std::unordered_map<glm::ivec2, std::unique_ptr<regfile>> openRegFiles;
+    /// @brief Regions use clock shared by all layers
+    std::atomic<uint64_t>* useClock = nullptr;
+
+    /// @brief Called before a new in-memory region is created
+    runnable onRegionCreate;
+
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    /// @brief Changed by the regions writer without mapMutex
+    std::atomic<size_t> writebacks {0};
+    std::atomic<size_t> writtenBytes {0};
+
+    /// @brief Open region files cache
+    std::unordered_map<glm::ivec2, regfile_ptr> openRegFiles;
 
-    /// @brief Open region files map mutex
-    std::mutex regFilesMutex;
-    std::condition_variable regFilesCv;
+    /// @brief Open region files cache mutex. Lookups share the lock
+    std::shared_mutex regFilesMutex;
 
+    /// @brief Open region files use clock
+    std::atomic<uint64_t> regFilesClock {0};
+
+    /// @brief Max open region files count. Least recently used file is
+    /// closed when a new one is opened over the limit
+    size_t maxOpenRegFiles = MAX_OPEN_REGION_FILES;
+
+    /// @brief Region files opened, changed with regFilesMutex locked
+    size_t regFileOpens = 0;
+
+    /// @brief Region files being written. Files opened meanwhile are not
+    /// cached, changed with regFilesMutex locked
+    std::unordered_set<glm::ivec2> writingRegFiles;
+
+    /// @brief Region file writes started or finished, changed with
+    /// regFilesMutex locked. File opened while it changes is not cached
+    size_t regFileWrites = 0;
+
+    /// @brief Get open region file or open it
+    /// @param create open the file if it's not open
+    /// @return nullptr if file does not exist or is not open
     [[nodiscard]] regfile_ptr getRegFile(glm::ivec2 coord, bool create = true);
-    [[nodiscard]] regfile_ptr useRegFile(glm::ivec2 coord);
     regfile_ptr createRegFile(glm::ivec2 coord);
+    /// @brief Remove file from the open files cache. Requires regFilesMutex
+    /// locked exclusively
     void closeRegFile(glm::ivec2 coord);
+    /// @brief Change max open files count closing least recently used files
+    void setMaxOpenRegFiles(size_t limit);
 
     WorldRegion* getRegion(int x, int z);
     WorldRegion* getOrCreateRegion(int x, int z);
 
     io::path getRegionFilePath(int x, int z) const;
 
+    /// @return current dictionary id or 0
+    uint32_t getDictionaryId() const;
+
+    /// @brief Get dictionary of region files. Loaded from the layer folder
+    /// if not loaded yet
+    /// @throws std::runtime_error if dictionary file is not found
+    std::shared_ptr<const compression::Dictionary> getDictionary(uint32_t id);
+
+    /// @brief Save dictionary to the layer folder to read files using it
+    void saveDictionary(const compression::Dictionary& dictionary);
+
+    /// @brief Change compression method and dictionary. In-memory chunks
+    /// data is recompressed, region files are converted on write
+    void setCodec(
+        compression::Method method,
+        std::shared_ptr<const compression::Dictionary> dictionary
+    );
+
+    /// @brief Compress chunk data with the layer codec
+    /// @param size [out] compressed data size
+    std::unique_ptr<ubyte[]> compress(
+        const ubyte* src, size_t srcSize, size_t& size
+    ) const;
+
+    /// @brief Decompress chunk data compressed with the layer codec
+    std::unique_ptr<ubyte[]> decompress(
+        const ubyte* src, size_t size, size_t srcSize
+    ) const;
+
     /// @brief Get chunk data. Read from file if not loaded yet.
     /// @param x chunk x coord
     /// @param z chunk z coord
@@ -153,24 +285,48 @@ struct RegionsLayer {
     /// @return nullptr if no saved chunk data found
     [[nodiscard]] ubyte* getData(int x, int z, uint32_t& size, uint32_t& srcSize);
 
-    /// @brief Write or rewrite region file
+    /// @brief Write unsaved region chunks to file. Chunks are written to
+    /// free sectors of the file and the offsets table is updated after.
+    /// The file is rewritten completely if it has older format or too much
+    /// free space
     /// @param x region X
     /// @param z region Z
     void writeRegion(int x, int y, WorldRegion* entry);
 
-    /// @brief Write all unsaved regions to files
-    void writeAll();
+    /// @brief Remove region from memory dropping unsaved data.
+    /// Region is kept if its file is currently used by other threads
+    /// @return true if region was removed
+    bool evictRegion(int x, int z);
 
-    /// @brief Read chunk data from region file
+    /// @brief Read chunk data from region file. Data of a file using other
+    /// compression method or dictionary is recompressed with the layer codec
     /// @param x chunk x coord
     /// @param z chunk z coord
     /// @param size [out] compressed chunk data length
     /// @param srcSize [out] source chunk data length
     /// @param rfile region file
     /// @return nullptr if chunk is not present in region file
-    [[nodiscard]] static std::unique_ptr<ubyte[]> readChunkData(
+    [[nodiscard]] std::unique_ptr<ubyte[]> readChunkData(
         int x, int z, uint32_t& size, uint32_t& srcSize, regfile* rfile
     );
+
+    /// @brief Read and decompress chunk data directly from region file
+    /// using the file codec
+    /// @param srcSize [out] decompressed chunk data length
+    /// @return nullptr if chunk is not present in region file
+    [[nodiscard]] std::unique_ptr<ubyte[]> readChunk(
+        int x, int z, uint32_t& srcSize, regfile* rfile
+    );
+
+    /// @brief Get decompressed chunk data. Chunks not loaded to memory are
+    /// decompressed from the region file without keeping compressed data
+    /// @param srcSize [out] decompressed chunk data length
+    /// @param file [out] if not nullptr, region file to read the chunk from
+    /// (see readChunk) is returned instead of reading it
+    /// @return nullptr if chunk is not present or has to be read from file
+    [[nodiscard]] std::unique_ptr<ubyte[]> getDecompressed(
+        int x, int z, uint32_t& srcSize, regfile_ptr* file = nullptr
+    );
 };
 
 class WorldRegions {
@@ -178,7 +334,112 @@ class WorldRegions {
     io::path directory;
 
     RegionsLayer layers[REGION_LAYERS_COUNT] {};
+
+    /// @brief Guards layers data shared with the saving thread. Region
+    /// files are written without it
+    std::mutex mutex;
+
+    /// @brief Memory budget of in-memory regions of all layers in bytes
+    size_t cacheBudget = DEFAULT_CACHE_BUDGET;
+    /// @brief Regions kept in memory (having loaded chunks)
+    std::unordered_set<glm::ivec2> regionsInUse;
+    /// @brief Unsaved regions chosen for eviction, written and evicted by
+    /// the saver. Key is region x, region z and layer index. Changed with
+    /// mutex locked
+    std::unordered_set<glm::ivec3> writebackQueue;
+    std::atomic<uint64_t> useClock {0};
+
+    struct PendingData {
+        std::unique_ptr<ubyte[]> data;
+        size_t size;
+    };
+    /// @brief Chunks data put but not compressed and stored to regions yet.
+    /// Key is chunk x, chunk z and layer index
+    std::unordered_map<glm::ivec3, std::shared_ptr<PendingData>> pending;
+    /// @brief Pending data in put order waiting for the next store batch
+    std::vector<std::pair<glm::ivec3, std::shared_ptr<PendingData>>>
+        storeQueue;
+    /// @brief Decompressed data of prefetched chunks, removed when read
+    std::unordered_map<glm::ivec3, std::shared_ptr<PendingData>> prefetched;
+    /// @brief Prefetched data in insertion order, the oldest is dropped
+    /// when MAX_PREFETCHED is exceeded
+    std::deque<std::pair<glm::ivec3, std::shared_ptr<PendingData>>>
+        prefetchOrder;
+    /// @brief Chunks put while a prefetch is running: data read by the
+    /// prefetch may be outdated
+    std::unordered_set<glm::ivec3> putsDuringPrefetch;
+    uint prefetchesRunning = 0;
+    /// @brief The latest chunks prefetch request not taken by the
+    /// prefetcher thread yet
+    std::vector<glm::ivec2> prefetchRequest;
+    bool prefetchScheduled = false;
+    size_t prefetchedCount = 0;
+    size_t prefetchHits = 0;
+    size_t prefetchMisses = 0;
+    size_t prefetchWasted = 0;
+    std::mutex pendingMutex;
+
+    /// @brief Runs compression and decompression batches
+    util::WorkerGroup codecWorkers {util::WorkerGroup::countFor(0)};
+
+    /// @brief Reads and decompresses requested chunks ahead of time.
+    /// Declared after the data used to be stopped before its destruction
+    util::SerialWorker prefetcher {"world-regions-prefetcher"};
+
+    /// @brief Compresses put data and writes regions in background.
+    /// Declared last to be stopped before other members destruction
+    util::SerialWorker saver {"world-regions-saver"};
+
+    /// @brief Drop the oldest prefetched data exceeding MAX_PREFETCHED.
+    /// Requires pendingMutex locked
+    void trimPrefetched();
+
+    /// @brief Evict least recently used regions not in use until the
+    /// memory usage fits the budget. Unsaved regions are queued to be
+    /// written and evicted by the saver. Requires mutex locked
+    void evictRegions();
+
+    /// @brief Write and evict regions of the writeback queue. Saver only
+    void writeEvicted();
+
+    /// @brief Write unsaved region chunks. The chunks are copied with mutex
+    /// locked and written to file without it. Saver only: data is stored
+    /// by the saver so the region does not change while it's written
+    /// @return true if region was unsaved
+    bool writeRegion(RegionsLayer& layer, glm::ivec2 coord);
+
+    /// @brief Compress queued pending data in parallel and store it in
+    /// regions in put order
+    void storeQueued();
+
+    /// @brief Store compressed data in the region. Requires mutex locked
+    /// @param data compressed data, nullptr to remove chunk data
+    void store(
+        const glm::ivec3& key,
+        std::unique_ptr<ubyte[]> data,
+        size_t size,
+        size_t srcSize
+    );
+
+    /// @brief Get decompressed chunk data including pending one
+    /// @param size [out] data size
+    /// @return nullptr if no data found
+    std::unique_ptr<ubyte[]> getData(
+        int x, int z, RegionLayerIndex layer, uint32_t& size
+    );
+
+    /// @brief Find data put but not stored yet
+    /// @return nullptr if there is no pending data for the chunk
+    std::shared_ptr<PendingData> getPending(
+        int x, int z, RegionLayerIndex layer
+    );
+
+    void writeLayer(RegionsLayer& layer);
 public:
+    static inline constexpr size_t DEFAULT_CACHE_BUDGET = 128 * 1024 * 1024;
+    /// @brief Max number of prefetched chunks data (of all layers) kept
+    static inline constexpr size_t MAX_PREFETCHED = 128;
+
     bool generatorTestMode = false;
     bool doWriteLights = true;
 
@@ -186,10 +447,12 @@ public:
     WorldRegions(const WorldRegions&) = delete;
     ~WorldRegions();
 
-    /// @brief Put all chunk data to regions
+    /// @brief Put all chunk data to regions. Chunk data is encoded on the
+    /// calling thread, compressed and stored in background
     void put(Chunk* chunk, std::vector<ubyte> entitiesData);
 
-    /// @brief Store data in specified region
+    /// @brief Store data in specified region. Data is compressed and
+    /// stored in background, following reads return the put data
     /// @param x chunk.x
     /// @param z chunk.z
     /// @param layer regions layer
@@ -203,12 +466,30 @@ public:
         size_t size
     );
 
+    /// @brief Read and decompress voxels and lights of the chunks in
+    /// parallel. Following getVoxels and getLights calls for these chunks
+    /// return prefetched data. At most MAX_PREFETCHED chunks data is kept,
+    /// the oldest is dropped
+    /// @param chunks chunks coords
+    void prefetch(const std::vector<glm::ivec2>& chunks);
+
+    /// @brief Prefetch chunks on the prefetcher thread. Replaces the
+    /// previous request if it is not started yet
+    /// @param chunks chunks coords, the most needed first
+    void requestPrefetch(std::vector<glm::ivec2> chunks);
+
     /// @brief Get chunk voxels data
     /// @param x chunk.x
     /// @param z chunk.z
     /// @return voxels data buffer or nullptr
     std::unique_ptr<ubyte[]> getVoxels(int x, int z);
 
+    /// @brief Check if chunk voxels data is saved. Compressed data is cached
+    /// so following getVoxels call does not read the region file again.
+    /// @param x chunk.x
+    /// @param z chunk.z
+    bool hasVoxels(int x, int z);
+
     /// @brief Get cached lights for chunk at x,z
     /// @return lights data or nullptr
     std::unique_ptr<light_t[]> getLights(int x, int z);
@@ -242,9 +523,51 @@ public:
 
     io::path getRegionFilePath(RegionLayerIndex layerid, int x, int z) const;
 
-    /// @brief Write all region layers
+    /// @brief Write all region layers in background
+    /// (see flush)
     void writeAll();
 
+    /// @brief Wait until all put data is stored and regions are written
+    void flush();
+
+    /// @brief Set memory budget of in-memory regions. Least recently used
+    /// regions are written to files if unsaved and removed from memory
+    /// when the budget is exceeded
+    /// @param bytes memory budget in bytes
+    void setCacheBudget(size_t bytes);
+
+    /// @brief Set max open region files count of each layer. Least
+    /// recently used files are closed when the limit is exceeded
+    void setRegionFilesLimit(size_t limit);
+
+    /// @brief Set layer compression method and dictionary. Region files
+    /// written with other codec stay readable and are converted on write
+    /// @param layer regions layer
+    /// @param method compression method
+    /// @param dictionary optional dictionary (ignored if not supported by
+    /// the method)
+    void setCodec(
+        RegionLayerIndex layer,
+        compression::Method method,
+        std::shared_ptr<const compression::Dictionary> dictionary = nullptr
+    );
+
+    /// @brief Get layer dictionary trained on saved chunks data. The
+    /// dictionary is trained once and stored in the layer folder
+    /// @param maxSamples max number of chunks used for training
+    /// @return nullptr if there is no saved data to train on
+    std::shared_ptr<const compression::Dictionary> requireDictionary(
+        RegionLayerIndex layer, size_t maxSamples = 64
+    );
+
+    /// @brief Protect region from eviction (region has loaded chunks)
+    /// @param x region X
+    /// @param z region Z
+    void setRegionInUse(int x, int z, bool inUse);
+
+    /// @return regions cache counters of all layers
+    RegionsCacheStats getCacheStats();
+
     void deleteRegion(RegionLayerIndex layerid, int x, int z);
 
     /// @brief Extract X and Z from 'X_Z.bin' region file name.
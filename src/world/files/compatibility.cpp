@@ -1,5 +1,6 @@
 #include "compatibility.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "constants.hpp"
@@ -8,6 +9,7 @@
 #include "coders/byte_utils.hpp"
 #include "lighting/Lightmap.hpp"
 #include "util/data_io.hpp"
+#include "WorldRegions.hpp"
 
 static inline size_t VOXELS_DATA_SIZE_V1 = CHUNK_VOL * 4;
 static inline size_t VOXELS_DATA_SIZE_V2 = CHUNK_VOL * 4;
@@ -107,3 +109,70 @@ util::Buffer<ubyte> compatibility::convert_region_2to3(
     }
     return util::Buffer<ubyte>(builder.build().data(), builder.size());
 }
+
+util::Buffer<ubyte> compatibility::convert_region_3to4(
+    const util::Buffer<ubyte>& src
+) {
+    // version 3 offsets table is at the end of file
+    const size_t OFFSET_TABLE_SIZE = REGION_CHUNKS_COUNT * sizeof(uint32_t);
+
+    const ubyte* const ptr = src.data();
+    if (src.size() < REGION_HEADER_SIZE + OFFSET_TABLE_SIZE) {
+        throw std::invalid_argument("incomplete region file");
+    }
+
+    ByteBuilder builder;
+    builder.putCStr(".VOXREG");
+    builder.put(4);
+    builder.put(ptr[9]); // compression method
+    while (builder.size() < REGION_TABLE_OFFSET) {
+        builder.put(0);
+    }
+    size_t tablePos = builder.size();
+    while (builder.size() <
+           tablePos + REGION_CHUNKS_COUNT * REGION_TABLE_ENTRY_SIZE) {
+        builder.put(0);
+    }
+
+    size_t tableStart = src.size() - OFFSET_TABLE_SIZE;
+    auto tablePtr = reinterpret_cast<const uint32_t*>(ptr + tableStart);
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        uint32_t srcOffset = dataio::le2h(tablePtr[i]);
+        if (srcOffset == 0) {
+            continue;
+        }
+        if (srcOffset < REGION_HEADER_SIZE ||
+            srcOffset + sizeof(uint32_t) * 2 > tableStart) {
+            throw illegal_region_format(
+                "chunk record offset is out of region file bounds"
+            );
+        }
+        uint32_t size = dataio::le2h(
+            *reinterpret_cast<const uint32_t*>(ptr + srcOffset)
+        );
+        if (size > tableStart - srcOffset - sizeof(uint32_t) * 2) {
+            throw illegal_region_format(
+                "chunk record is out of region file bounds"
+            );
+        }
+        // records are aligned to sectors
+        size_t offset = std::max<size_t>(
+            REGION_DATA_OFFSET,
+            (builder.size() + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE *
+                REGION_SECTOR_SIZE
+        );
+        while (builder.size() < offset) {
+            builder.put(0);
+        }
+        uint32_t length = size + sizeof(uint32_t) * 2;
+        size_t entryPos = tablePos + i * REGION_TABLE_ENTRY_SIZE;
+        builder.setInt32(entryPos, offset);
+        builder.setInt32(entryPos + 4, length);
+        // size, source size and data are copied as is
+        builder.put(ptr + srcOffset, length);
+    }
+    while (builder.size() % REGION_SECTOR_SIZE) {
+        builder.put(0);
+    }
+    return util::Buffer<ubyte>(builder.build().data(), builder.size());
+}
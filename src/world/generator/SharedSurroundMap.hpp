@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "typedefs.hpp"
+
+/// @brief Sparse SurroundMap variant storing a value per point and shared
+/// by multiple interest areas.
+/// Points covered by at least one area are kept. Other points are
+/// evicted in least recently used order when the total size of values
+/// exceeds the memory budget.
+template <class T>
+class SharedSurroundMap {
+public:
+    using Supplier = std::function<std::unique_ptr<T>(int, int)>;
+    using LevelCallback = std::function<void(int, int, T&)>;
+    using SizeFunction = std::function<size_t(const T&)>;
+
+    struct Area {
+        int x;
+        int z;
+        int radius;
+
+        bool contains(int px, int pz) const {
+            return std::abs(px - x) <= radius && std::abs(pz - z) <= radius;
+        }
+    };
+private:
+    struct Entry {
+        std::unique_ptr<T> value;
+        int8_t level = 0;
+        /// @brief Number of areas covering the point
+        uint refs = 0;
+        size_t size = 0;
+        uint64_t lastUse = 0;
+        /// @brief Position in the LRU list if not referenced
+        typename std::list<glm::ivec2>::iterator lruIterator;
+    };
+
+    std::unordered_map<glm::ivec2, Entry> entries;
+    std::unordered_map<uint64_t, Area> areas;
+    /// @brief Not referenced entries, least recently used first
+    std::list<glm::ivec2> lru;
+    Supplier supplier;
+    std::vector<LevelCallback> levelCallbacks;
+    SizeFunction sizeFunction;
+    int8_t maxLevel;
+    size_t totalSize = 0;
+    size_t budget;
+    uint64_t useCounter = 0;
+
+    void addRef(Entry& entry) {
+        if (entry.refs++ == 0) {
+            lru.erase(entry.lruIterator);
+        }
+    }
+
+    void removeRef(const glm::ivec2& pos, Entry& entry) {
+        if (--entry.refs == 0) {
+            entry.lruIterator = lru.insert(lru.end(), pos);
+        }
+    }
+
+    void updateRefs(const Area& area, bool add) {
+        for (int z = area.z - area.radius; z <= area.z + area.radius; z++) {
+            for (int x = area.x - area.radius; x <= area.x + area.radius;
+                 x++) {
+                auto found = entries.find({x, z});
+                if (found == entries.end()) {
+                    continue;
+                }
+                if (add) {
+                    addRef(found->second);
+                } else {
+                    removeRef(found->first, found->second);
+                }
+            }
+        }
+    }
+
+    Entry& touch(int x, int z) {
+        glm::ivec2 pos(x, z);
+        auto found = entries.find(pos);
+        if (found == entries.end()) {
+            auto& entry = entries[pos];
+            for (const auto& [_, area] : areas) {
+                if (area.contains(x, z)) {
+                    entry.refs++;
+                }
+            }
+            if (entry.refs == 0) {
+                entry.lruIterator = lru.insert(lru.end(), pos);
+            }
+            entry.lastUse = useCounter;
+            return entry;
+        }
+        auto& entry = found->second;
+        if (entry.refs == 0 && entry.lastUse != useCounter) {
+            lru.splice(lru.end(), lru, entry.lruIterator);
+        }
+        entry.lastUse = useCounter;
+        return entry;
+    }
+
+    void updateSize(Entry& entry) {
+        size_t size = sizeFunction ? sizeFunction(*entry.value) : 0;
+        totalSize = totalSize - entry.size + size;
+        entry.size = size;
+    }
+
+    void upgrade(int x, int z, int8_t level) {
+        const auto& callback = levelCallbacks[level - 1];
+        int size = maxLevel - level + 1;
+        for (int lz = -size + 1; lz < size; lz++) {
+            for (int lx = -size + 1; lx < size; lx++) {
+                int posX = lx + x;
+                int posZ = lz + z;
+                auto& entry = touch(posX, posZ);
+                if (entry.level < level - 1) {
+                    throw std::runtime_error("invalid map state");
+                }
+                if (entry.level >= level) {
+                    continue;
+                }
+                entry.level = level;
+                if (level == 1) {
+                    entry.value = supplier(posX, posZ);
+                }
+                if (callback) {
+                    callback(posX, posZ, *entry.value);
+                }
+                updateSize(entry);
+            }
+        }
+    }
+public:
+    /// @param maxLevel number of levels
+    /// @param supplier creates point value on the first level
+    /// @param budget memory budget in bytes (see setSizeFunction)
+    SharedSurroundMap(int8_t maxLevel, Supplier supplier, size_t budget)
+        : supplier(std::move(supplier)),
+          levelCallbacks(maxLevel),
+          maxLevel(maxLevel),
+          budget(budget) {
+    }
+
+    /// @brief Callback called on point level increments
+    void setLevelCallback(int8_t level, LevelCallback callback) {
+        levelCallbacks.at(level - 1) = std::move(callback);
+    }
+
+    /// @brief Set function estimating value memory usage. The value size
+    /// is updated on its level changes
+    void setSizeFunction(SizeFunction function) {
+        sizeFunction = std::move(function);
+    }
+
+    void setBudget(size_t budget) {
+        this->budget = budget;
+        evict();
+    }
+
+    /// @brief Set or move interest area
+    /// @param id area owner id
+    /// @param radius radius of points that may be completed
+    void setArea(uint64_t id, int x, int z, int radius) {
+        // points required to complete a point at the area border
+        Area area {x, z, radius + maxLevel};
+        auto found = areas.find(id);
+        if (found != areas.end()) {
+            auto& current = found->second;
+            if (current.x == area.x && current.z == area.z &&
+                current.radius == area.radius) {
+                return;
+            }
+            updateRefs(area, true);
+            updateRefs(current, false);
+            current = area;
+        } else {
+            updateRefs(area, true);
+            areas[id] = area;
+        }
+        evict();
+    }
+
+    void removeArea(uint64_t id) {
+        auto found = areas.find(id);
+        if (found == areas.end()) {
+            return;
+        }
+        updateRefs(found->second, false);
+        areas.erase(found);
+        evict();
+    }
+
+    /// @brief Upgrade point to maxLevel
+    void completeAt(int x, int z) {
+        useCounter++;
+        for (int8_t level = 1; level <= maxLevel; level++) {
+            upgrade(x, z, level);
+        }
+        evict();
+    }
+
+    /// @brief Evict not referenced points until the total size fits the
+    /// budget. Points used by the last completeAt call are kept
+    void evict() {
+        auto it = lru.begin();
+        while (totalSize > budget && it != lru.end()) {
+            auto found = entries.find(*it);
+            if (found->second.lastUse == useCounter) {
+                ++it;
+                continue;
+            }
+            totalSize -= found->second.size;
+            it = lru.erase(it);
+            entries.erase(found);
+        }
+    }
+
+    /// @return point value or nullptr if the point is not created
+    T* get(int x, int z) const {
+        auto found = entries.find({x, z});
+        if (found == entries.end()) {
+            return nullptr;
+        }
+        return found->second.value.get();
+    }
+
+    /// @return point level, 0 if point is not created
+    int8_t at(int x, int z) const {
+        auto found = entries.find({x, z});
+        if (found == entries.end()) {
+            return 0;
+        }
+        return found->second.level;
+    }
+
+    /// @return area covered by the interest area or nullptr
+    const Area* getArea(uint64_t id) const {
+        auto found = areas.find(id);
+        if (found == areas.end()) {
+            return nullptr;
+        }
+        return &found->second;
+    }
+
+    size_t getTotalSize() const {
+        return totalSize;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+};
@@ -23,46 +23,59 @@ static inline constexpr uint MAX_PARAMETERS = 4;
 /// @brief Initial + wide_structs + biomes + heightmaps + complete
 static inline constexpr uint BASIC_PROTOTYPE_LAYERS = 5;
 
+size_t ChunkPrototype::getMemoryUsage() const {
+    size_t size = sizeof(ChunkPrototype);
+    if (biomes) {
+        size += CHUNK_W * CHUNK_D * sizeof(const Biome*);
+    }
+    if (heightmap) {
+        size += heightmap->getWidth() * heightmap->getHeight() * sizeof(float);
+    }
+    for (const auto& map : heightmapInputs) {
+        size += map->getWidth() * map->getHeight() * sizeof(float);
+    }
+    size += placements.capacity() * sizeof(Placement);
+    return size;
+}
+
 WorldGenerator::WorldGenerator(
-    const GeneratorDef& def, const Content& content, uint64_t seed
+    const GeneratorDef& def,
+    const Content& content,
+    uint64_t seed,
+    size_t memoryBudget
 )
     : def(def), 
       content(content), 
       seed(seed),
-      surroundMap(0, BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2)
+      prototypes(
+          BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2,
+          [this](int x, int z) { return generatePrototype(x, z); },
+          memoryBudget
+      )
 {
     def.script->initialize(seed);
 
     uint levels = BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2;
 
-    surroundMap = SurroundMap(0, levels);
     logger.info() << "total number of prototype levels is " << levels;
-    surroundMap.setOutCallback([this](int const x, int const z, int8_t) {
-        const auto& found = prototypes.find({x, z});
-        if (found == prototypes.end()) {
-            logger.warning() << "unable to remove non-existing chunk prototype";
-            return;
-        }
-        prototypes.erase({x, z});
-    });
-    surroundMap.setLevelCallback(1, [this](int const x, int const z) {
-        if (prototypes.find({x, z}) != prototypes.end()) {
-            return;
-        }
-        prototypes[{x, z}] = generatePrototype(x, z);
+    prototypes.setSizeFunction([](const ChunkPrototype& prototype) {
+        return prototype.getMemoryUsage();
     });
-    surroundMap.setLevelCallback(def.wideStructsChunksRadius + 1, 
-    [this](int const x, int const z) {
-        generateStructuresWide(requirePrototype(x, z), x, z);
+    prototypes.setLevelCallback(def.wideStructsChunksRadius + 1, 
+    [this](int const x, int const z, ChunkPrototype& prototype) {
+        generateStructuresWide(prototype, x, z);
     });
-    surroundMap.setLevelCallback(levels-3, [this](int const x, int const z) {
-        generateBiomes(requirePrototype(x, z), x, z);
+    prototypes.setLevelCallback(levels-3,
+    [this](int const x, int const z, ChunkPrototype& prototype) {
+        generateBiomes(prototype, x, z);
     });
-    surroundMap.setLevelCallback(levels-2, [this](int const x, int const z) {
-        generateHeightmap(requirePrototype(x, z), x, z);
+    prototypes.setLevelCallback(levels-2,
+    [this](int const x, int const z, ChunkPrototype& prototype) {
+        generateHeightmap(prototype, x, z);
     });
-    surroundMap.setLevelCallback(levels-1, [this](int const x, int const z) {
-        generateStructures(requirePrototype(x, z), x, z);
+    prototypes.setLevelCallback(levels-1,
+    [this](int const x, int const z, ChunkPrototype& prototype) {
+        generateStructures(prototype, x, z);
     });
     for (int i = 0; i < def.structures.size(); i++) {
         // pre-calculate rotated structure variants
@@ -76,14 +89,6 @@ WorldGenerator::WorldGenerator(
 
 WorldGenerator::~WorldGenerator() {}
 
-ChunkPrototype& WorldGenerator::requirePrototype(int x, int z) {
-    const auto& found = prototypes.find({x, z});
-    if (found == prototypes.end()) {
-        throw std::runtime_error("prototype not found");
-    }
-    return *found->second;
-}
-
 static inline void generate_pole(
     const BlocksLayers& layers,
     int top, int bottom,
@@ -165,14 +170,13 @@ void WorldGenerator::placeStructure(
     AABB aabb(position, position + size);
     for (int lcz = -1; lcz <= 1; lcz++) {
         for (int lcx = -1; lcx <= 1; lcx++) {
-            const auto& found = prototypes.find({chunkX + lcx, chunkZ + lcz});
-            if (found == prototypes.end()) {
+            auto otherPrototype = prototypes.get(chunkX + lcx, chunkZ + lcz);
+            if (otherPrototype == nullptr) {
                 continue;
             }
-            auto& otherPrototype = *found->second;
             auto chunkAABB = gen_chunk_aabb(chunkX + lcx, chunkZ + lcz);
             if (chunkAABB.intersect(aabb)) {
-                otherPrototype.placements.emplace_back(
+                otherPrototype->placements.emplace_back(
                     priority,
                     StructurePlacement {
                         placement.structure,
@@ -196,9 +200,8 @@ void WorldGenerator::placeLine(const LinePlacement& line, int priority) {
     int czb = floordiv<CHUNK_D>(aabb.b.z);
     for (int cz = cza; cz <= czb; cz++) {
         for (int cx = cxa; cx <= cxb; cx++) {
-            const auto& found = prototypes.find({cx, cz});
-            if (found != prototypes.end()) {
-                found->second->placements.emplace_back(priority, line);
+            if (auto prototype = prototypes.get(cx, cz)) {
+                prototype->placements.emplace_back(priority, line);
             }
         }
     }
@@ -350,14 +353,20 @@ void WorldGenerator::generateHeightmap(
         CHUNK_W + bpd, CHUNK_D + bpd, def.heightsInterpolation
     );
     prototype.heightmap->crop(0, 0, CHUNK_W, CHUNK_D);
+    // not needed anymore
+    prototype.heightmapInputs.clear();
     prototype.level = ChunkPrototypeLevel::HEIGHTMAP;
 }
 
-void WorldGenerator::update(int centerX, int centerY, int loadDistance) {
-    surroundMap.setCenter(centerX, centerY);
+void WorldGenerator::update(
+    u64id_t id, int centerX, int centerY, int loadDistance
+) {
     // 2 is safety padding preventing ChunksController rounding problem
-    surroundMap.resize(loadDistance + 2);
-    surroundMap.setCenter(centerX, centerY);
+    prototypes.setArea(id, centerX, centerY, loadDistance + 2);
+}
+
+void WorldGenerator::removeArea(u64id_t id) {
+    prototypes.removeArea(id);
 }
 
 void WorldGenerator::generatePlants(
@@ -367,7 +376,7 @@ void WorldGenerator::generatePlants(
     int chunkX,
     int chunkZ,
     const Biome** biomes
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
     util::PseudoRandom plantsRand;
     plantsRand.setSeed(chunkX, chunkZ);
@@ -409,7 +418,7 @@ void WorldGenerator::generateLand(
     int chunkX,
     int chunkZ,
     const Biome** biomes
-) {
+) const {
     uint seaLevel = def.seaLevel;
     for (uint z = 0; z < CHUNK_D; z++) {
         for (uint x = 0; x < CHUNK_W; x++) {
@@ -428,9 +437,29 @@ void WorldGenerator::generateLand(
 }
 
 void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
-    surroundMap.completeAt(chunkX, chunkZ);
+    prototypes.completeAt(chunkX, chunkZ);
+    generate(voxels, *prototypes.get(chunkX, chunkZ), chunkX, chunkZ);
+}
+
+std::shared_ptr<const ChunkPrototype> WorldGenerator::prepare(
+    int chunkX, int chunkZ
+) {
+    prototypes.completeAt(chunkX, chunkZ);
+
+    const auto& prototype = *prototypes.get(chunkX, chunkZ);
+    // placements list may be extended later by neighbour chunks lines,
+    // so it's copied to get the same result as the synchronous generation
+    auto snapshot = std::make_shared<ChunkPrototype>();
+    snapshot->level = prototype.level;
+    snapshot->biomes = prototype.biomes;
+    snapshot->heightmap = prototype.heightmap;
+    snapshot->placements = prototype.placements;
+    return snapshot;
+}
 
-    const auto& prototype = requirePrototype(chunkX, chunkZ);
+void WorldGenerator::generate(
+    voxel* voxels, const ChunkPrototype& prototype, int chunkX, int chunkZ
+) const {
     const auto values = prototype.heightmap->getValues();
 
     uint seaLevel = def.seaLevel;
@@ -471,7 +500,7 @@ void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
 
 void WorldGenerator::generatePlacements(
     const ChunkPrototype& prototype, voxel* voxels, int chunkX, int chunkZ
-) {
+) const {
     auto placements = prototype.placements;
     std::stable_sort(
         placements.begin(),
@@ -495,7 +524,7 @@ void WorldGenerator::generateStructure(
     const StructurePlacement& placement,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     if (placement.structure < 0 || placement.structure >= def.structures.size()) {
         logger.error() << "invalid structure index " << placement.structure;
         return;
@@ -536,7 +565,7 @@ void WorldGenerator::generateLine(
     const LinePlacement& line,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
 
     int cgx = chunkX * CHUNK_W;
@@ -592,21 +621,24 @@ void WorldGenerator::generateLine(
     }
 }
 
-WorldGenDebugInfo WorldGenerator::createDebugInfo() const {
-    const auto& area = surroundMap.getArea();
-    const auto& levels = area.getBuffer();
-    auto values = std::make_unique<ubyte[]>(area.getWidth()*area.getHeight());
-
-    for (uint i = 0; i < levels.size(); i++) {
-        values[i] = levels[i];
+WorldGenDebugInfo WorldGenerator::createDebugInfo(u64id_t id) const {
+    auto area = prototypes.getArea(id);
+    if (area == nullptr) {
+        return WorldGenDebugInfo {0, 0, 0, 0, nullptr};
+    }
+    int offsetX = area->x - area->radius;
+    int offsetZ = area->z - area->radius;
+    uint size = area->radius * 2 + 1;
+    auto values = std::make_unique<ubyte[]>(size * size);
+
+    for (uint z = 0; z < size; z++) {
+        for (uint x = 0; x < size; x++) {
+            values[z * size + x] = prototypes.at(offsetX + x, offsetZ + z);
+        }
     }
 
     return WorldGenDebugInfo {
-        area.getOffsetX(),
-        area.getOffsetY(),
-        static_cast<uint>(area.getWidth()),
-        static_cast<uint>(area.getHeight()),
-        std::move(values)
+        offsetX, offsetZ, size, size, std::move(values)
     };
 }
 
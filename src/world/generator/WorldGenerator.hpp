@@ -9,7 +9,7 @@
 #include "constants.hpp"
 #include "typedefs.hpp"
 #include "voxels/voxel.hpp"
-#include "SurroundMap.hpp"
+#include "SharedSurroundMap.hpp"
 #include "StructurePlacement.hpp"
 
 class Content;
@@ -26,7 +26,7 @@ struct ChunkPrototype {
     ChunkPrototypeLevel level = ChunkPrototypeLevel::VOID;
 
     /// @brief chunk biomes matrix
-    std::unique_ptr<const Biome*[]> biomes;
+    std::shared_ptr<const Biome*[]> biomes;
 
     /// @brief chunk heightmap
     std::shared_ptr<Heightmap> heightmap;
@@ -35,6 +35,9 @@ struct ChunkPrototype {
 
     /// @brief biome parameters maps saved until heightmaps generation
     std::vector<std::shared_ptr<Heightmap>> heightmapInputs {};
+
+    /// @brief Estimate memory used by the prototype in bytes
+    size_t getMemoryUsage() const;
 };
 
 struct WorldGenDebugInfo {
@@ -53,18 +56,14 @@ class WorldGenerator {
     const Content& content;
     /// @param seed world seed
     uint64_t seed;
-    /// @brief Chunk prototypes main storage
-    std::unordered_map<glm::ivec2, std::unique_ptr<ChunkPrototype>> prototypes;
-    /// @brief Chunk prototypes loading surround map
-    SurroundMap surroundMap;
+    /// @brief Chunk prototypes storage shared by players generation areas
+    SharedSurroundMap<ChunkPrototype> prototypes;
 
     /// @brief Generate chunk prototype (see ChunkPrototype)
     /// @param x chunk position X divided by CHUNK_W
     /// @param z chunk position Y divided by CHUNK_D
     std::unique_ptr<ChunkPrototype> generatePrototype(int x, int z);
 
-    ChunkPrototype& requirePrototype(int x, int z);
-
     void generateStructuresWide(ChunkPrototype& prototype, int x, int z);
 
     void generateStructures(ChunkPrototype& prototype, int x, int z);
@@ -82,19 +81,19 @@ class WorldGenerator {
 
     void generatePlacements(
         const ChunkPrototype& prototype, voxel* voxels, int x, int z
-    );
+    ) const;
     void generateLine(
         const ChunkPrototype& prototype, 
         const LinePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generateStructure(
         const ChunkPrototype& prototype, 
         const StructurePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generatePlants(
         const ChunkPrototype& prototype,
         float* values,
@@ -102,7 +101,7 @@ class WorldGenerator {
         int x,
         int z,
         const Biome** biomes
-    );
+    ) const;
     void generateLand(
         const ChunkPrototype& prototype,
         float* values,
@@ -110,7 +109,7 @@ class WorldGenerator {
         int x,
         int z,
         const Biome** biomes
-    );
+    ) const;
 
     void placeStructures(
         const std::vector<Placement>& placements,
@@ -118,14 +117,30 @@ class WorldGenerator {
         int x, int z
     );
 public:
+    /// @brief Default prototypes memory budget in bytes
+    static inline constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    /// @param memoryBudget memory budget for prototypes not required by
+    /// generation areas in bytes
     WorldGenerator(
         const GeneratorDef& def,
         const Content& content,
-        uint64_t seed
+        uint64_t seed,
+        size_t memoryBudget = DEFAULT_MEMORY_BUDGET
     );
     ~WorldGenerator();
 
-    void update(int centerX, int centerY, int loadDistance);
+    /// @brief Set or move generation area. Prototypes required to generate
+    /// chunks of the area are not evicted until the area is moved away
+    /// @param id area owner id (player id)
+    /// @param centerX area center chunk X
+    /// @param centerY area center chunk Z
+    /// @param loadDistance area radius in chunks
+    void update(u64id_t id, int centerX, int centerY, int loadDistance);
+
+    /// @brief Remove generation area
+    /// @param id area owner id (player id)
+    void removeArea(u64id_t id);
 
     /// @brief Generate complete chunk voxels
     /// @param voxels destinatiopn chunk voxels buffer
@@ -133,7 +148,24 @@ public:
     /// @param z chunk position Y divided by CHUNK_D
     void generate(voxel* voxels, int x, int z);
 
-    WorldGenDebugInfo createDebugInfo() const;
+    /// @brief Complete chunk prototype and take a snapshot of data required
+    /// to generate chunk voxels. Must be called from the main thread.
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    std::shared_ptr<const ChunkPrototype> prepare(int x, int z);
+
+    /// @brief Generate complete chunk voxels using a prepared prototype.
+    /// Does not modify generator state, so may be called from any thread.
+    /// @param voxels destination chunk voxels buffer
+    /// @param prototype complete chunk prototype (see prepare)
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    void generate(
+        voxel* voxels, const ChunkPrototype& prototype, int x, int z
+    ) const;
+
+    /// @param id generation area owner id (player id)
+    WorldGenDebugInfo createDebugInfo(u64id_t id) const;
 
     uint64_t getSeed() const;
 };
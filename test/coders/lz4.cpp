@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "typedefs.hpp"
+#include "coders/compression.hpp"
+#include "coders/lz4.hpp"
+
+static std::vector<ubyte> make_data(size_t size, int density) {
+    std::mt19937 random(size ^ density);
+    std::vector<ubyte> data(size);
+    ubyte next = random();
+    for (size_t i = 0; i < size; i++) {
+        data[i] = next;
+        if (random() % density == 0) {
+            next = random();
+        }
+    }
+    return data;
+}
+
+static std::vector<ubyte> encode_decode(
+    const std::vector<ubyte>& source,
+    const std::vector<ubyte>& dict = {}
+) {
+    std::vector<ubyte> encoded(lz4::compress_bound(source.size()));
+    size_t encodedSize = lz4::encode(
+        source.data(), source.size(), encoded.data(), dict.data(), dict.size()
+    );
+    EXPECT_LE(encodedSize, encoded.size());
+    std::vector<ubyte> decoded(source.size());
+    size_t decodedSize = lz4::decode(
+        encoded.data(),
+        encodedSize,
+        decoded.data(),
+        decoded.size(),
+        dict.data(),
+        dict.size()
+    );
+    EXPECT_EQ(decodedSize, source.size());
+    EXPECT_EQ(decoded, source);
+    encoded.resize(encodedSize);
+    return encoded;
+}
+
+TEST(LZ4, EncodeDecode) {
+    for (size_t size : {0, 1, 12, 13, 100, 70'000, 300'000}) {
+        encode_decode(make_data(size, 1));
+        encode_decode(make_data(size, 13));
+        encode_decode(make_data(size, 90123));
+    }
+    // incompressible data is expanded a little
+    auto encoded = encode_decode(make_data(50'000, 1));
+    EXPECT_LE(encoded.size(), lz4::compress_bound(50'000));
+    // long runs
+    encoded = encode_decode(std::vector<ubyte>(300'000, 7));
+    EXPECT_LT(encoded.size(), 2'000);
+}
+
+TEST(LZ4, Dictionary) {
+    auto dict = make_data(20'000, 1);
+    auto source = make_data(40'000, 1);
+    // data shares a part with the dictionary
+    std::copy(dict.begin() + 5'000, dict.begin() + 15'000, source.begin() + 100);
+    auto plain = encode_decode(source);
+    auto withDict = encode_decode(source, dict);
+    EXPECT_LT(withDict.size() + 9'000, plain.size());
+
+    // dictionary longer than max offset
+    auto longDict = make_data(200'000, 1);
+    std::copy(longDict.end() - 1'000, longDict.end(), source.begin());
+    encode_decode(source, longDict);
+}
+
+TEST(LZ4, Malformed) {
+    auto source = make_data(10'000, 13);
+    std::vector<ubyte> encoded(lz4::compress_bound(source.size()));
+    size_t size = lz4::encode(source.data(), source.size(), encoded.data());
+    std::vector<ubyte> decoded(source.size());
+    // truncated data is either invalid or shorter
+    size_t truncatedSize = 0;
+    try {
+        truncatedSize = lz4::decode(
+            encoded.data(), size / 2, decoded.data(), decoded.size()
+        );
+    } catch (const std::runtime_error&) {
+    }
+    EXPECT_LT(truncatedSize, source.size());
+    // small destination
+    EXPECT_THROW(
+        lz4::decode(encoded.data(), size, decoded.data(), decoded.size() / 2),
+        std::runtime_error
+    );
+    // match before data start
+    const ubyte invalid[] {0x10, 'a', 0x05, 0x00, 0x00};
+    EXPECT_THROW(
+        lz4::decode(invalid, sizeof(invalid), decoded.data(), decoded.size()),
+        std::runtime_error
+    );
+}
+
+TEST(Compression, Methods) {
+    using compression::Method;
+    auto source = make_data(100'000, 13);
+    std::vector<std::pair<const ubyte*, size_t>> samples {
+        {source.data(), 50'000}, {source.data() + 25'000, 50'000}};
+    auto dictionary = compression::train_dictionary(samples);
+    ASSERT_NE(dictionary, nullptr);
+    EXPECT_LE(dictionary->data.size(), compression::Dictionary::MAX_SIZE);
+
+    for (auto method : {Method::EXTRLE8, Method::EXTRLE16, Method::GZIP,
+                        Method::LZ4, Method::DEFLATE}) {
+        EXPECT_EQ(
+            compression::method_from_string(compression::to_string(method)),
+            method
+        );
+        for (auto dict : {static_cast<compression::Dictionary*>(nullptr),
+                          dictionary.get()}) {
+            size_t size;
+            auto compressed = compression::compress(
+                source.data(), source.size(), size, method, dict
+            );
+            auto decompressed = compression::decompress(
+                compressed.get(), size, source.size(), method, dict
+            );
+            EXPECT_TRUE(std::equal(
+                source.begin(), source.end(), decompressed.get()
+            )) << compression::to_string(method);
+        }
+    }
+    EXPECT_THROW(
+        compression::method_from_string("unknown"), std::invalid_argument
+    );
+}
@@ -1,7 +1,18 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
 #include "typedefs.hpp"
 #include "coders/rle.hpp"
+#include "voxels/Chunk.hpp"
+
+using encode_func = size_t(*)(const ubyte*, size_t, ubyte*);
+using decode_func = size_t(*)(const ubyte*, size_t, ubyte*);
 
 static void test_encode_decode(
     size_t(*encodefunc)(const ubyte*, size_t, ubyte*),
@@ -48,3 +59,295 @@ TEST(ExtRLE16, EncodeDecode) {
     test_encode_decode(extrle::encode16, extrle::decode16, 13);
     test_encode_decode(extrle::encode16, extrle::decode16, 90123);
 }
+
+/// @brief Element by element encoders the output must stay identical to
+namespace reference {
+    static size_t rle_encode(const ubyte* src, size_t srclen, ubyte* dst) {
+        if (srclen == 0) {
+            return 0;
+        }
+        size_t offset = 0;
+        ubyte counter = 0;
+        ubyte c = src[0];
+        for (size_t i = 1; i < srclen; i++) {
+            ubyte cnext = src[i];
+            if (cnext != c || counter == 255) {
+                dst[offset++] = counter;
+                dst[offset++] = c;
+                c = cnext;
+                counter = 0;
+            } else {
+                counter++;
+            }
+        }
+        dst[offset++] = counter;
+        dst[offset++] = c;
+        return offset;
+    }
+
+    static size_t rle_encode16(const ubyte* src, size_t srclen, ubyte* dst) {
+        if (srclen == 0) {
+            return 0;
+        }
+        auto src16 = reinterpret_cast<const uint16_t*>(src);
+        auto dst16 = reinterpret_cast<uint16_t*>(dst);
+        size_t offset = 0;
+        uint16_t counter = 0;
+        uint16_t c = src16[0];
+        for (size_t i = 1; i < srclen / 2; i++) {
+            uint16_t cnext = src16[i];
+            if (cnext != c || counter == 0xFFFF) {
+                dst16[offset++] = counter;
+                dst16[offset++] = c;
+                c = cnext;
+                counter = 0;
+            } else {
+                counter++;
+            }
+        }
+        dst16[offset++] = counter;
+        dst16[offset++] = c;
+        return offset * 2;
+    }
+
+    static void extrle_emit(ubyte* dst, size_t& offset, uint counter, ubyte c) {
+        if (counter >= 0x80) {
+            dst[offset++] = 0x80 | (counter & 0x7F);
+            dst[offset++] = counter >> 7;
+        } else {
+            dst[offset++] = counter;
+        }
+        dst[offset++] = c;
+    }
+
+    static size_t extrle_encode(const ubyte* src, size_t srclen, ubyte* dst) {
+        if (srclen == 0) {
+            return 0;
+        }
+        size_t offset = 0;
+        uint counter = 0;
+        ubyte c = src[0];
+        for (size_t i = 1; i < srclen; i++) {
+            ubyte cnext = src[i];
+            if (cnext != c || counter == extrle::max_sequence) {
+                extrle_emit(dst, offset, counter, c);
+                c = cnext;
+                counter = 0;
+            } else {
+                counter++;
+            }
+        }
+        extrle_emit(dst, offset, counter, c);
+        return offset;
+    }
+
+    static void extrle_emit16(
+        ubyte* dst, size_t& offset, uint counter, uint16_t c
+    ) {
+        if (counter >= 0x40) {
+            dst[offset++] = 0x80 | ((c > 255) << 6) | (counter & 0x3F);
+            dst[offset++] = counter >> 6;
+        } else {
+            dst[offset++] = counter | ((c > 255) << 6);
+        }
+        if (c > 255) {
+            dst[offset++] = c & 0xFF;
+            dst[offset++] = c >> 8;
+        } else {
+            dst[offset++] = c;
+        }
+    }
+
+    static size_t extrle_encode16(const ubyte* src8, size_t srclen, ubyte* dst) {
+        if (srclen == 0) {
+            return 0;
+        }
+        auto src = reinterpret_cast<const uint16_t*>(src8);
+        size_t offset = 0;
+        uint counter = 0;
+        uint16_t c = src[0];
+        for (size_t i = 1; i < srclen / 2; i++) {
+            uint16_t cnext = src[i];
+            if (cnext != c || counter == extrle::max_sequence16) {
+                extrle_emit16(dst, offset, counter, c);
+                c = cnext;
+                counter = 0;
+            } else {
+                counter++;
+            }
+        }
+        extrle_emit16(dst, offset, counter, c);
+        return offset;
+    }
+}
+
+namespace {
+    struct Codec {
+        const char* name;
+        encode_func encode;
+        decode_func decode;
+        encode_func reference;
+    };
+}
+
+static const Codec CODECS[] {
+    {"rle", rle::encode, rle::decode, reference::rle_encode},
+    {"rle16", rle::encode16, rle::decode16, reference::rle_encode16},
+    {"extrle", extrle::encode, extrle::decode, reference::extrle_encode},
+    {"extrle16",
+     extrle::encode16,
+     extrle::decode16,
+     reference::extrle_encode16},
+};
+
+/// @return kernels supported by the CPU
+static std::vector<rle::Kernels> supported_kernels() {
+    std::vector<rle::Kernels> kernels {rle::Kernels::SCALAR};
+    for (auto k : {rle::Kernels::SSE2, rle::Kernels::AVX2}) {
+        if (static_cast<int>(k) <= static_cast<int>(rle::best_kernels())) {
+            kernels.push_back(k);
+        }
+    }
+    return kernels;
+}
+
+/// @brief Random runs of random lengths including runs longer than max
+/// sequences of all formats, 16 bit values are wide sometimes
+static std::vector<ubyte> make_fuzz_data(std::mt19937& random) {
+    size_t length = random() % 3 == 0 ? random() % 64 : random() % 200'000;
+    std::vector<ubyte> data(length);
+    uint maxRun = std::uniform_int_distribution<uint>(1, 5)(random);
+    maxRun = std::pow(8, maxRun);
+    for (size_t i = 0; i < length;) {
+        size_t run = std::min<size_t>(1 + random() % maxRun, length - i);
+        // 0x00 and 0xFF are compared as signed bytes in SIMD kernels
+        ubyte value = random() % 4 == 0 ? (random() % 2) * 0xFF : random();
+        std::memset(data.data() + i, value, run);
+        if (random() % 3 == 0 && run > 1) {
+            data[i + random() % run] = random();
+        }
+        i += run;
+    }
+    return data;
+}
+
+TEST(RLE, FuzzMatchesReference) {
+    std::mt19937 random(1337);
+    auto defaultKernels = rle::get_kernels();
+    for (int iteration = 0; iteration < 200; iteration++) {
+        auto source = make_fuzz_data(random);
+        size_t length = source.size();
+        // encoders may read the first element of empty 16 bit data
+        source.resize(length + 2);
+
+        std::vector<ubyte> expected(length * 2 + 8);
+        std::vector<ubyte> encoded(length * 2 + 8);
+        std::vector<ubyte> decoded(length + 64);
+        for (const auto& codec : CODECS) {
+            size_t expectedSize =
+                codec.reference(source.data(), length, expected.data());
+            for (auto kernels : supported_kernels()) {
+                rle::use_kernels(kernels);
+                size_t size = codec.encode(source.data(), length, encoded.data());
+                ASSERT_EQ(size, expectedSize)
+                    << codec.name << " " << rle::to_string(kernels);
+                ASSERT_EQ(
+                    std::memcmp(encoded.data(), expected.data(), size), 0
+                ) << codec.name << " " << rle::to_string(kernels);
+
+                size_t decodedSize =
+                    codec.decode(encoded.data(), size, decoded.data());
+                size_t validSize = length;
+                if (codec.encode == rle::encode16 ||
+                    codec.encode == extrle::encode16) {
+                    validSize = length == 1 ? 2 : length / 2 * 2;
+                }
+                ASSERT_EQ(decodedSize, validSize);
+                ASSERT_EQ(
+                    std::memcmp(decoded.data(), source.data(), validSize), 0
+                ) << codec.name << " " << rle::to_string(kernels);
+            }
+        }
+    }
+    rle::use_kernels(defaultKernels);
+}
+
+/// @brief Chunk data in Chunk::encode layout: terrain-like block ids (stone
+/// with ores, dirt, grass and air above) followed by states (mostly zero,
+/// some rotated blocks)
+static std::vector<ubyte> make_chunk_data(std::mt19937& random, int cx, int cz) {
+    std::vector<ubyte> data(CHUNK_DATA_LEN);
+    auto ids = reinterpret_cast<uint16_t*>(data.data());
+    auto states = ids + CHUNK_VOL;
+    for (int y = 0; y < CHUNK_H; y++) {
+        for (int z = 0; z < CHUNK_D; z++) {
+            for (int x = 0; x < CHUNK_W; x++) {
+                float gx = cx * CHUNK_W + x;
+                float gz = cz * CHUNK_D + z;
+                int height =
+                    64 + std::sin(gx * 0.05f) * 12 + std::cos(gz * 0.07f) * 9;
+                uint index = vox_index(x, y, z);
+                uint16_t id = 0;
+                if (y == height - 1) {
+                    id = 3;
+                } else if (y >= height - 4 && y < height) {
+                    id = 2;
+                } else if (y < height) {
+                    id = random() % 50 == 0 ? 260 + random() % 3 : 1;
+                }
+                ids[index] = id;
+                states[index] = id == 3 && random() % 8 == 0 ? random() % 4 : 0;
+            }
+        }
+    }
+    return data;
+}
+
+/// @brief Encode and decode throughput of every kernels on chunk data.
+/// Results are printed only
+TEST(RLE, DISABLED_KernelsBenchmark) {
+    using namespace std::chrono;
+    constexpr int CHUNKS = 32;
+    constexpr int ROUNDS = 4;
+
+    std::mt19937 random(42);
+    std::vector<std::vector<ubyte>> chunks;
+    for (int i = 0; i < CHUNKS; i++) {
+        chunks.push_back(make_chunk_data(random, i % 8, i / 8));
+    }
+    std::vector<ubyte> encoded(CHUNK_DATA_LEN * 2);
+    std::vector<ubyte> decoded(CHUNK_DATA_LEN);
+    double megabytes = CHUNKS * ROUNDS * CHUNK_DATA_LEN / (1024.0 * 1024.0);
+
+    auto defaultKernels = rle::get_kernels();
+    for (const auto& codec : CODECS) {
+        for (auto kernels : supported_kernels()) {
+            rle::use_kernels(kernels);
+            microseconds encodeTime {}, decodeTime {};
+            for (int round = 0; round < ROUNDS; round++) {
+                for (const auto& chunk : chunks) {
+                    auto start = high_resolution_clock::now();
+                    size_t size = codec.encode(
+                        chunk.data(), CHUNK_DATA_LEN, encoded.data()
+                    );
+                    auto middle = high_resolution_clock::now();
+                    size_t decodedSize =
+                        codec.decode(encoded.data(), size, decoded.data());
+                    auto end = high_resolution_clock::now();
+                    encodeTime += duration_cast<microseconds>(middle - start);
+                    decodeTime += duration_cast<microseconds>(end - middle);
+                    ASSERT_EQ(decodedSize, CHUNK_DATA_LEN);
+                    ASSERT_EQ(decoded, chunk);
+                }
+            }
+            auto throughput = [megabytes](microseconds time) {
+                return megabytes / (std::max<int64_t>(time.count(), 1) / 1e6);
+            };
+            std::cout << codec.name << " " << rle::to_string(kernels)
+                      << ": encode " << throughput(encodeTime)
+                      << " MB/s, decode " << throughput(decodeTime) << " MB/s"
+                      << std::endl;
+        }
+    }
+    rle::use_kernels(defaultKernels);
+}
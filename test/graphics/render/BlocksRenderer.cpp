@@ -0,0 +1,324 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include "assets/Assets.hpp"
+#include "content/Content.hpp"
+#include "content/ContentBuilder.hpp"
+#include "core_defs.hpp"
+#include "frontend/ContentGfxCache.hpp"
+#include "graphics/core/Atlas.hpp"
+#include "graphics/core/ImageData.hpp"
+#include "graphics/core/Mesh.hpp"
+#include "graphics/render/BlocksRenderer.hpp"
+#include "items/ItemDef.hpp"
+#include "objects/rigging.hpp"
+#include "settings.hpp"
+#include "voxels/Chunks.hpp"
+
+static constexpr size_t CAPACITY = 512 * 1024;
+
+/// @brief Single chunk of heightmap terrain with grass on top of stone,
+/// sky light above the surface and a few torch-lit cells in caves
+class MeshingScene {
+    static std::unique_ptr<Content> build_content() {
+        ContentBuilder builder;
+        {
+            Block& block = builder.blocks.create(CORE_AIR);
+            block.drawGroup = 1;
+            block.lightPassing = true;
+            block.skyLightPassing = true;
+            block.model = BlockModel::none;
+            block.pickingItem = CORE_EMPTY;
+        }
+        builder.items.create(CORE_EMPTY);
+        {
+            Block& block = builder.blocks.create("test:stone");
+            block.textureFaces.fill("stone");
+            block.pickingItem = CORE_EMPTY;
+        }
+        {
+            Block& block = builder.blocks.create("test:grass");
+            block.textureFaces.fill("grass_side");
+            block.textureFaces[2] = "stone";
+            block.textureFaces[3] = "grass_top";
+            block.pickingItem = CORE_EMPTY;
+        }
+        {
+            // texture is missing in atlas so faces have no region index
+            Block& block = builder.blocks.create("test:lamp");
+            block.textureFaces.fill("lamp");
+            block.ambientOcclusion = false;
+            block.pickingItem = CORE_EMPTY;
+        }
+        return builder.build();
+    }
+
+    static std::unique_ptr<Atlas> build_atlas() {
+        AtlasBuilder builder;
+        for (const auto& name : {"stone", "grass_side", "grass_top"}) {
+            builder.add(
+                name, std::make_unique<ImageData>(ImageFormat::rgba8888, 16, 16)
+            );
+        }
+        return builder.build(2, false, 1024);
+    }
+public:
+    EngineSettings settings;
+    std::unique_ptr<Content> content = build_content();
+    Assets assets;
+    std::unique_ptr<ContentGfxCache> cache;
+    Chunks chunks {3, 3, 0, 0, nullptr, *content->getIndices()};
+    std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(0, 0);
+
+    MeshingScene() {
+        assets.store(build_atlas(), "blocks");
+        cache = std::make_unique<ContentGfxCache>(
+            *content, assets, settings.graphics
+        );
+        blockid_t stone = content->blocks.require("test:stone").rt.id;
+        blockid_t grass = content->blocks.require("test:grass").rt.id;
+
+        srand(42);
+        for (int z = 0; z < CHUNK_D; z++) {
+            for (int x = 0; x < CHUNK_W; x++) {
+                int height = 60 + (x / 5 + z / 7) % 3;
+                for (int y = 0; y < CHUNK_H; y++) {
+                    voxel vox {};
+                    if (y < height) {
+                        vox.id = (y == height - 1) ? grass : stone;
+                    }
+                    // caves
+                    if (y > 40 && y < height - 3 && rand() % 4 == 0) {
+                        vox.id = 0;
+                    }
+                    chunk->voxels.set(vox_index(x, y, z), vox);
+                    if (vox.id == 0) {
+                        chunk->lightmap.setS(x, y, z, y >= height ? 15 : 0);
+                        if (y < height && rand() % 8 == 0) {
+                            chunk->lightmap.setR(x, y, z, rand() % 16);
+                        }
+                    }
+                }
+            }
+        }
+        chunk->updateHeights();
+        chunks.putChunk(chunk);
+    }
+
+    ChunkMeshData build(BlocksRenderer& renderer, bool greedy) {
+        settings.graphics.greedyMeshing.set(greedy);
+        renderer.build(chunk.get(), &chunks);
+        return renderer.createMesh();
+    }
+
+    /// @brief Replace every fifth stone block in caves level with a lamp
+    void placeLamps() {
+        blockid_t stone = content->blocks.require("test:stone").rt.id;
+        blockid_t lamp = content->blocks.require("test:lamp").rt.id;
+        for (int y = 40; y < 60; y++) {
+            for (int z = 0; z < CHUNK_D; z++) {
+                for (int x = 0; x < CHUNK_W; x++) {
+                    uint index = vox_index(x, y, z);
+                    voxel vox = chunk->voxels[index];
+                    if (vox.id == stone && (x + y + z) % 5 == 0) {
+                        vox.id = lamp;
+                        chunk->voxels.set(index, vox);
+                    }
+                }
+            }
+        }
+    }
+};
+
+/// @brief Unit block face: normal axis, normal sign, face plane position
+/// (doubled), cell coordinates on two other axes
+using FaceKey = std::tuple<int, int, int, int, int>;
+
+/// @brief Texture region and sorted vertex lights of a unit face
+struct FaceValue {
+    glm::vec4 region;
+    std::array<uint32_t, 4> lights;
+};
+
+/// @brief Split mesh quads into unit faces. Every face must be covered once
+static std::map<FaceKey, FaceValue> collect_faces(
+    const MeshData& mesh, const ContentGfxCache& cache
+) {
+    auto vertices = reinterpret_cast<const ChunkVertex*>(mesh.vertices.data());
+    size_t count = mesh.vertices.size() / sizeof(ChunkVertex);
+    EXPECT_EQ(count % 4, 0U);
+
+    std::map<FaceKey, FaceValue> faces;
+    for (size_t q = 0; q + 4 <= count; q += 4) {
+        const ChunkVertex* quad = vertices + q;
+        glm::vec3 p[4];
+        for (int i = 0; i < 4; i++) {
+            p[i] = quad[i].getPosition();
+        }
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        int n = 0;
+        for (int i = 1; i < 3; i++) {
+            if (std::abs(normal[i]) > std::abs(normal[n])) {
+                n = i;
+            }
+        }
+        int a = (n + 1) % 3;
+        int b = (n + 2) % 3;
+        glm::vec3 min = p[0];
+        glm::vec3 max = p[0];
+        for (int i = 1; i < 4; i++) {
+            min = glm::min(min, p[i]);
+            max = glm::max(max, p[i]);
+        }
+        FaceValue value {};
+        if (quad[0].isMerged()) {
+            const auto& region = cache.getRegionByIndex(
+                quad[0].getRegionIndex()
+            );
+            value.region = glm::vec4(region.u1, region.v1, region.u2, region.v2);
+        } else {
+            glm::vec2 uvmin = quad[0].getUV();
+            glm::vec2 uvmax = uvmin;
+            for (int i = 1; i < 4; i++) {
+                uvmin = glm::min(uvmin, quad[i].getUV());
+                uvmax = glm::max(uvmax, quad[i].getUV());
+            }
+            value.region = glm::vec4(uvmin, uvmax);
+        }
+        for (int i = 0; i < 4; i++) {
+            const auto& l = quad[i].light;
+            value.lights[i] = l[0] << 24 | l[1] << 16 | l[2] << 8 | l[3];
+        }
+        std::sort(value.lights.begin(), value.lights.end());
+
+        int plane = static_cast<int>(std::round(p[0][n] * 2));
+        int sign = normal[n] > 0.0f ? 1 : -1;
+        for (int cb = std::round(min[b]); cb < std::round(max[b]); cb++) {
+            for (int ca = std::round(min[a]); ca < std::round(max[a]); ca++) {
+                bool inserted = faces.emplace(
+                    FaceKey {n, sign, plane, ca, cb}, value
+                ).second;
+                EXPECT_TRUE(inserted) << "face is covered twice";
+            }
+        }
+    }
+    return faces;
+}
+
+TEST(BlocksRenderer, GreedyMeshingCoverage) {
+    MeshingScene scene;
+    BlocksRenderer renderer(
+        CAPACITY, *scene.content, *scene.cache, scene.settings
+    );
+    auto plain = scene.build(renderer, false);
+    auto greedy = scene.build(renderer, true);
+    ASSERT_FALSE(renderer.isCancelled());
+
+    auto plainFaces = collect_faces(plain.mesh, *scene.cache);
+    auto greedyFaces = collect_faces(greedy.mesh, *scene.cache);
+    ASSERT_FALSE(plainFaces.empty());
+    EXPECT_LT(greedy.mesh.vertices.size(), plain.mesh.vertices.size());
+    ASSERT_EQ(greedyFaces.size(), plainFaces.size());
+
+    // face uv is quantized to 16 bits
+    constexpr float EPSILON = 0.5f / 65535.0f;
+    for (const auto& [key, expected] : plainFaces) {
+        auto found = greedyFaces.find(key);
+        ASSERT_NE(found, greedyFaces.end());
+        const auto& actual = found->second;
+        for (int i = 0; i < 4; i++) {
+            ASSERT_NEAR(actual.region[i], expected.region[i], EPSILON);
+        }
+        ASSERT_EQ(actual.lights, expected.lights);
+    }
+}
+
+/// @brief Faces which are not merged are lit the same way as without
+/// greedy meshing, including blocks without ambient occlusion
+TEST(BlocksRenderer, GreedyMeshingNoAO) {
+    MeshingScene scene;
+    scene.placeLamps();
+    BlocksRenderer renderer(
+        CAPACITY, *scene.content, *scene.cache, scene.settings
+    );
+    auto plain = scene.build(renderer, false);
+    auto greedy = scene.build(renderer, true);
+
+    auto plainFaces = collect_faces(plain.mesh, *scene.cache);
+    auto greedyFaces = collect_faces(greedy.mesh, *scene.cache);
+    ASSERT_EQ(greedyFaces.size(), plainFaces.size());
+    for (const auto& [key, expected] : plainFaces) {
+        auto found = greedyFaces.find(key);
+        ASSERT_NE(found, greedyFaces.end());
+        ASSERT_EQ(found->second.lights, expected.lights);
+    }
+}
+
+/// @brief Decode regions table like chunk shaders do (see main.glslv)
+TEST(BlocksRenderer, RegionsTable) {
+    MeshingScene scene;
+    const auto& cache = *scene.cache;
+    auto image = cache.createRegionsImage();
+    ASSERT_EQ(image->getWidth(), ContentGfxCache::REGIONS_PER_ROW * 2);
+
+    auto decode = [&](int x, int y) {
+        const ubyte* texel =
+            image->getData() + (y * image->getWidth() + x) * 4;
+        return glm::vec2(
+            (texel[0] * 256 + texel[1]) / 65535.0f,
+            (texel[2] * 256 + texel[3]) / 65535.0f
+        );
+    };
+    size_t count = scene.content->getIndices()->blocks.count();
+    blockid_t lamp = scene.content->blocks.require("test:lamp").rt.id;
+    for (blockid_t id = 1; id < count; id++) {
+        for (int side = 0; side < 6; side++) {
+            uint16_t index = cache.getRegionIndex(id, side);
+            if (id == lamp) {
+                EXPECT_EQ(index, ContentGfxCache::NO_REGION);
+                continue;
+            }
+            ASSERT_NE(index, ContentGfxCache::NO_REGION);
+            const auto& expected = cache.getRegion(id, side);
+            int x = index % ContentGfxCache::REGIONS_PER_ROW * 2;
+            int y = index / ContentGfxCache::REGIONS_PER_ROW;
+            glm::vec4 region(decode(x, y), decode(x + 1, y));
+            EXPECT_NEAR(region.x, expected.u1, 0.5f / 65535.0f);
+            EXPECT_NEAR(region.y, expected.v1, 0.5f / 65535.0f);
+            EXPECT_NEAR(region.z, expected.u2, 0.5f / 65535.0f);
+            EXPECT_NEAR(region.w, expected.v2, 0.5f / 65535.0f);
+        }
+    }
+}
+
+/// @brief Vertices and meshing time of a terrain chunk with and without
+/// greedy meshing. Results are printed only
+TEST(BlocksRenderer, DISABLED_TerrainBenchmark) {
+    constexpr int ITERATIONS = 50;
+    using clock = std::chrono::high_resolution_clock;
+
+    MeshingScene scene;
+    BlocksRenderer renderer(
+        CAPACITY, *scene.content, *scene.cache, scene.settings
+    );
+    for (bool greedy : {false, true}) {
+        size_t vertices = 0;
+        auto start = clock::now();
+        for (int i = 0; i < ITERATIONS; i++) {
+            auto data = scene.build(renderer, greedy);
+            vertices = data.mesh.vertices.size() / sizeof(ChunkVertex);
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+                        clock::now() - start
+                    ).count() / ITERATIONS;
+        std::cout << (greedy ? "greedy" : "per-face") << ": " << vertices
+                  << " vertices (" << vertices * sizeof(ChunkVertex) / 1024
+                  << " KB), " << ms << " ms per chunk" << std::endl;
+    }
+}
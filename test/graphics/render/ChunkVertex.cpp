@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+
+#include "constants.hpp"
+#include "graphics/core/Mesh.hpp"
+#include "graphics/render/commons.hpp"
+
+static float random_float(float min, float max) {
+    return min + (max - min) * (rand() / static_cast<float>(RAND_MAX));
+}
+
+TEST(ChunkVertex, AttributesLayout) {
+    const uint offsets[] {
+        offsetof(ChunkVertex, position),
+        offsetof(ChunkVertex, tile),
+        offsetof(ChunkVertex, uv),
+        offsetof(ChunkVertex, light),
+    };
+    uint offset = 0;
+    int i = 0;
+    for (; CHUNK_VATTRS[i].count; i++) {
+        ASSERT_LT(i, 4);
+        EXPECT_EQ(offset, offsets[i]);
+        offset += CHUNK_VATTRS[i].size();
+    }
+    EXPECT_EQ(i, 4);
+    EXPECT_EQ(offset, sizeof(ChunkVertex));
+    EXPECT_EQ(sizeof(ChunkVertex), 16U);
+
+    EXPECT_EQ((VertexAttribute {3}).size(), 12U);
+    EXPECT_EQ((VertexAttribute {3, VertexAttribute::Type::INT16}).size(), 6U);
+    EXPECT_EQ((VertexAttribute {4, VertexAttribute::Type::UINT8}).size(), 4U);
+}
+
+/// @brief Compare packed vertices with float ones written before: position,
+/// uv and compressed light bits (position(3), uv(2), light(1))
+TEST(ChunkVertex, PackRoundTrip) {
+    constexpr int COUNT = 100'000;
+    srand(7);
+    for (int i = 0; i < COUNT; i++) {
+        glm::vec3 position(
+            random_float(-1.0f, CHUNK_W + 1.0f),
+            random_float(-1.0f, CHUNK_H + 1.0f),
+            random_float(-1.0f, CHUNK_D + 1.0f)
+        );
+        glm::vec2 uv(random_float(0.0f, 1.0f), random_float(0.0f, 1.0f));
+        glm::vec4 light(
+            random_float(0.0f, 1.0f),
+            random_float(0.0f, 1.0f),
+            random_float(0.0f, 1.0f),
+            random_float(0.0f, 1.0f)
+        );
+        uint32_t compressed = ChunkVertex::compressLight(light);
+        auto vertex = ChunkVertex::pack(position, uv, compressed);
+
+        auto unpacked = vertex.getPosition();
+        for (int c = 0; c < 3; c++) {
+            ASSERT_NEAR(
+                unpacked[c], position[c], 0.5f / CHUNK_POSITION_SCALE + 1e-4f
+            );
+        }
+        ASSERT_NEAR(vertex.getUV().x, uv.x, 0.5f / 65535.0f + 1e-7f);
+        ASSERT_NEAR(vertex.getUV().y, uv.y, 0.5f / 65535.0f + 1e-7f);
+        ASSERT_FALSE(vertex.isMerged());
+
+        // the same values as decompress_light in shaders gave
+        auto unpackedLight = vertex.getLight();
+        for (int c = 0; c < 4; c++) {
+            float expected = ((compressed >> (24 - c * 8)) & 0xFF) / 255.0f;
+            ASSERT_EQ(unpackedLight[c], expected);
+        }
+    }
+}
+
+TEST(ChunkVertex, MergedFaceVertex) {
+    // block faces coordinates are multiples of 0.5 and stay exact
+    glm::vec3 position(-0.5f, 255.5f, 16.5f);
+    auto vertex = ChunkVertex::packMerged(
+        position, 0xFFFFFFFF, {0, ChunkVertex::MAX_TILES}, 65534
+    );
+    EXPECT_EQ(vertex.getPosition(), position);
+    EXPECT_TRUE(vertex.isMerged());
+    EXPECT_EQ(vertex.getTile(), glm::ivec2(0, ChunkVertex::MAX_TILES));
+    EXPECT_EQ(vertex.getRegionIndex(), 65534);
+    EXPECT_EQ(vertex.getLight(), glm::vec4(1.0f));
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "graphics/render/greedy_meshing.hpp"
+
+static constexpr int SIZE = 16;
+
+TEST(greedy_meshing, RandomLayerCoverage) {
+    srand(1024);
+    for (int iteration = 0; iteration < 200; iteration++) {
+        std::vector<uint64_t> source(SIZE * SIZE);
+        int variants = 1 + iteration % 4;
+        for (auto& cell : source) {
+            cell = rand() % (variants + 1);
+        }
+        std::vector<uint64_t> cells = source;
+        std::vector<int> coverage(SIZE * SIZE);
+        greedy_meshing::merge(
+            cells.data(),
+            SIZE,
+            SIZE,
+            1,
+            SIZE,
+            [&](const greedy_meshing::Rect& rect) {
+                ASSERT_NE(rect.key, 0U);
+                ASSERT_LE(rect.a + rect.w, SIZE);
+                ASSERT_LE(rect.b + rect.h, SIZE);
+                for (int b = rect.b; b < rect.b + rect.h; b++) {
+                    for (int a = rect.a; a < rect.a + rect.w; a++) {
+                        ASSERT_EQ(source[b * SIZE + a], rect.key);
+                        coverage[b * SIZE + a]++;
+                    }
+                }
+            }
+        );
+        for (int i = 0; i < SIZE * SIZE; i++) {
+            ASSERT_EQ(cells[i], 0U);
+            ASSERT_EQ(coverage[i], source[i] != 0 ? 1 : 0);
+        }
+    }
+}
+
+TEST(greedy_meshing, Strides) {
+    // column-major layer inside of a bigger buffer
+    std::vector<uint64_t> cells(SIZE * SIZE * 2);
+    for (int a = 0; a < SIZE; a++) {
+        for (int b = 0; b < 4; b++) {
+            cells[a * SIZE * 2 + b] = 7;
+        }
+    }
+    std::vector<greedy_meshing::Rect> rects;
+    greedy_meshing::merge(
+        cells.data(),
+        SIZE,
+        SIZE,
+        SIZE * 2,
+        1,
+        [&](const greedy_meshing::Rect& rect) { rects.push_back(rect); }
+    );
+    ASSERT_EQ(rects.size(), 1U);
+    EXPECT_EQ(rects[0].w, SIZE);
+    EXPECT_EQ(rects[0].h, 4);
+    EXPECT_EQ(rects[0].key, 7U);
+}
+
+/// @brief Count top faces of a heightmap terrain before and after merging.
+/// Not a correctness test, results are printed only
+TEST(greedy_meshing, DISABLED_TerrainBenchmark) {
+    constexpr int HEIGHT = 128;
+    constexpr int ITERATIONS = 200;
+
+    int heights[SIZE * SIZE];
+    for (int z = 0; z < SIZE; z++) {
+        for (int x = 0; x < SIZE; x++) {
+            heights[z * SIZE + x] = 60 + (x / 5 + z / 7) % 3;
+        }
+    }
+    // top faces layers of y levels, grass on top, light is uniform
+    std::vector<uint64_t> source(HEIGHT * SIZE * SIZE);
+    size_t faces = 0;
+    for (int z = 0; z < SIZE; z++) {
+        for (int x = 0; x < SIZE; x++) {
+            int y = heights[z * SIZE + x];
+            source[(y * SIZE + z) * SIZE + x] = 2ULL << 32 | 0xF000;
+            faces++;
+        }
+    }
+    using clock = std::chrono::high_resolution_clock;
+
+    size_t quads = 0;
+    std::vector<uint64_t> cells;
+    auto start = clock::now();
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        cells = source;
+        quads = 0;
+        for (int y = 0; y < HEIGHT; y++) {
+            greedy_meshing::merge(
+                cells.data() + y * SIZE * SIZE,
+                SIZE,
+                SIZE,
+                1,
+                SIZE,
+                [&](const greedy_meshing::Rect&) { quads++; }
+            );
+        }
+    }
+    auto elapsed = clock::now() - start;
+    EXPECT_LT(quads, faces);
+
+    double us = std::chrono::duration<double, std::micro>(elapsed).count() /
+                ITERATIONS;
+    std::cout << "faces: " << faces << "\n";
+    std::cout << "merged quads: " << quads << "\n";
+    std::cout << "merge time: " << us << " us per chunk" << std::endl;
+}
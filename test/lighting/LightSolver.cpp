@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "content/Content.hpp"
+#include "lighting/Lighting.hpp"
+#include "lighting/LightSolver.hpp"
+#include "lighting/ParallelLightSolver.hpp"
+#include "util/WorkerGroup.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+
+static constexpr int WORLD_SIZE = 3;
+
+static constexpr blockid_t AIR = 0;
+static constexpr blockid_t STONE = 1;
+static constexpr blockid_t LAMP = 2;
+
+struct TestContent {
+    Block air {"core:air"};
+    Block stone {"test:stone"};
+    Block lamp {"test:lamp"};
+    ContentIndices indices;
+
+    TestContent() : indices({{&air, &stone, &lamp}}, {{}}, {{}}) {
+        air.lightPassing = true;
+        air.skyLightPassing = true;
+        lamp.emission[0] = 15;
+        lamp.emission[1] = 9;
+        lamp.emission[2] = 4;
+        lamp.rt.emissive = true;
+    }
+};
+
+struct TestWorld {
+    Chunks chunks;
+
+    TestWorld(const ContentIndices& indices, uint seed)
+        : chunks(WORLD_SIZE, WORLD_SIZE, 0, 0, nullptr, indices) {
+        chunks.setCenter(0, 0);
+        srand(seed);
+        int offset = WORLD_SIZE / 2;
+        for (int cz = -offset; cz <= offset; cz++) {
+            for (int cx = -offset; cx <= offset; cx++) {
+                auto chunk = std::make_shared<Chunk>(cx, cz);
+                for (uint i = 0; i < CHUNK_VOL; i++) {
+                    uint y = i / (CHUNK_W * CHUNK_D);
+                    int r = rand() % 100;
+                    voxel vox {AIR, {}};
+                    if (y < 100) {
+                        vox.id = r < 3 ? LAMP : (r < 60 ? STONE : AIR);
+                    } else if (y < 110) {
+                        vox.id = r < 90 ? STONE : AIR;
+                    }
+                    chunk->voxels.set(i, vox);
+                }
+                chunk->updateHeights();
+                Lighting::prebuildSkyLight(*chunk, indices);
+                chunks.putChunk(chunk);
+            }
+        }
+    }
+
+    /// @brief Clear lightmaps keeping prebuilt sky light
+    void clearLights(const ContentIndices& indices) {
+        for (const auto& chunk : chunks.getChunks()) {
+            chunk->lightmap.clear();
+            Lighting::prebuildSkyLight(*chunk, indices);
+        }
+    }
+
+    /// @brief Add lamps and sky light seeds like Lighting::onChunkLoaded
+    template <class Func>
+    void addSeeds(const ContentIndices& indices, Func&& add) {
+        const auto defs = indices.blocks.getDefs();
+        for (const auto& chunk : chunks.getChunks()) {
+            for (uint i = 0; i < CHUNK_VOL; i++) {
+                int x = i % CHUNK_W + chunk->x * CHUNK_W;
+                int y = i / (CHUNK_W * CHUNK_D);
+                int z = (i / CHUNK_W) % CHUNK_D + chunk->z * CHUNK_D;
+                const auto& def = *defs[chunk->voxels[i].id];
+                if (def.rt.emissive) {
+                    for (int c = 0; c < 3; c++) {
+                        add(x, y, z, c, def.emission[c]);
+                    }
+                }
+                add(x, y, z, 3, chunk->lightmap.getLights()[i] >> 12);
+            }
+        }
+    }
+};
+
+TEST(LightSolver, ParallelSolveEquality) {
+    TestContent content;
+    const auto& indices = content.indices;
+
+    TestWorld serialWorld(indices, 2025);
+    LightSolver solvers[] {
+        {indices, serialWorld.chunks, 0},
+        {indices, serialWorld.chunks, 1},
+        {indices, serialWorld.chunks, 2},
+        {indices, serialWorld.chunks, 3},
+    };
+    serialWorld.addSeeds(indices, [&](int x, int y, int z, int c, int e) {
+        solvers[c].add(x, y, z, e);
+    });
+    for (auto& solver : solvers) {
+        solver.solve();
+    }
+
+    TestWorld parallelWorld(indices, 2025);
+    util::WorkerGroup workers(4);
+    ParallelLightSolver solver(indices, parallelWorld.chunks, workers);
+    parallelWorld.addSeeds(indices, [&](int x, int y, int z, int c, int e) {
+        solver.add(x, y, z, c, e);
+    });
+    solver.solve();
+
+    const auto& serialChunks = serialWorld.chunks.getChunks();
+    const auto& parallelChunks = parallelWorld.chunks.getChunks();
+    ASSERT_EQ(serialChunks.size(), parallelChunks.size());
+    for (size_t i = 0; i < serialChunks.size(); i++) {
+        const auto serialLights = serialChunks[i]->lightmap.getLights();
+        const auto parallelLights = parallelChunks[i]->lightmap.getLights();
+        for (uint j = 0; j < CHUNK_VOL; j++) {
+            ASSERT_EQ(serialLights[j], parallelLights[j]);
+        }
+        EXPECT_EQ(
+            serialChunks[i]->flags.modified, parallelChunks[i]->flags.modified
+        );
+    }
+}
+
+static void assert_lights_equal(const Chunks& a, const Chunks& b) {
+    const auto& chunksA = a.getChunks();
+    const auto& chunksB = b.getChunks();
+    ASSERT_EQ(chunksA.size(), chunksB.size());
+    for (size_t i = 0; i < chunksA.size(); i++) {
+        const auto lightsA = chunksA[i]->lightmap.getLights();
+        const auto lightsB = chunksB[i]->lightmap.getLights();
+        for (uint j = 0; j < CHUNK_VOL; j++) {
+            ASSERT_EQ(lightsA[j], lightsB[j]);
+        }
+        EXPECT_EQ(chunksA[i]->flags.modified, chunksB[i]->flags.modified);
+    }
+}
+
+/// @brief Solve all channels, then remove every 7th lamp and solve again
+static void solve_with_removal(
+    const ContentIndices& indices, TestWorld& world, bool chunkLocal
+) {
+    LightSolver solvers[] {
+        {indices, world.chunks, 0},
+        {indices, world.chunks, 1},
+        {indices, world.chunks, 2},
+        {indices, world.chunks, 3},
+    };
+    for (auto& solver : solvers) {
+        solver.setChunkLocal(chunkLocal);
+    }
+    world.addSeeds(indices, [&](int x, int y, int z, int c, int e) {
+        solvers[c].add(x, y, z, e);
+    });
+    for (auto& solver : solvers) {
+        solver.solve();
+    }
+    int counter = 0;
+    for (const auto& chunk : world.chunks.getChunks()) {
+        for (uint i = 0; i < CHUNK_VOL; i++) {
+            if (chunk->voxels[i].id != LAMP || counter++ % 7) {
+                continue;
+            }
+            chunk->voxels.set(i, voxel {AIR, {}});
+            int x = i % CHUNK_W + chunk->x * CHUNK_W;
+            int y = i / (CHUNK_W * CHUNK_D);
+            int z = (i / CHUNK_W) % CHUNK_D + chunk->z * CHUNK_D;
+            for (int c = 0; c < 3; c++) {
+                solvers[c].remove(x, y, z);
+            }
+        }
+    }
+    for (auto& solver : solvers) {
+        solver.solve();
+    }
+}
+
+TEST(LightSolver, ChunkLocalEquality) {
+    TestContent content;
+    const auto& indices = content.indices;
+
+    TestWorld genericWorld(indices, 1337);
+    solve_with_removal(indices, genericWorld, false);
+
+    TestWorld localWorld(indices, 1337);
+    solve_with_removal(indices, localWorld, true);
+
+    assert_lights_equal(genericWorld.chunks, localWorld.chunks);
+}
+
+/// @brief Measure flood fill speed in lit voxels per second
+static double measure_flood_fill(
+    const ContentIndices& indices, TestWorld& world, bool chunkLocal
+) {
+    constexpr int ITERATIONS = 5;
+    using clock = std::chrono::high_resolution_clock;
+
+    clock::duration total {};
+    size_t voxels = 0;
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        world.clearLights(indices);
+        LightSolver solvers[] {
+            {indices, world.chunks, 0},
+            {indices, world.chunks, 1},
+            {indices, world.chunks, 2},
+            {indices, world.chunks, 3},
+        };
+        for (auto& solver : solvers) {
+            solver.setChunkLocal(chunkLocal);
+        }
+        world.addSeeds(indices, [&](int x, int y, int z, int c, int e) {
+            solvers[c].add(x, y, z, e);
+        });
+        auto start = clock::now();
+        for (auto& solver : solvers) {
+            solver.solve();
+        }
+        total += clock::now() - start;
+
+        for (const auto& chunk : world.chunks.getChunks()) {
+            const auto lights = chunk->lightmap.getLights();
+            for (uint i = 0; i < CHUNK_VOL; i++) {
+                for (int c = 0; c < 4; c++) {
+                    voxels += Lightmap::extract(lights[i], c) != 0;
+                }
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(total).count();
+    return voxels / std::max(seconds, 1e-9);
+}
+
+TEST(LightSolver, DISABLED_FloodFillBenchmark) {
+    TestContent content;
+    const auto& indices = content.indices;
+
+    TestWorld world(indices, 42);
+    double generic = measure_flood_fill(indices, world, false);
+    double local = measure_flood_fill(indices, world, true);
+
+    std::cout << "generic: " << generic / 1e6 << " M voxels/s\n";
+    std::cout << "chunk-local: " << local / 1e6 << " M voxels/s\n";
+    std::cout << "speedup: " << local / generic << "x" << std::endl;
+}
+
+TEST(Lighting, PrebuildSkyLightSections) {
+    TestContent content;
+    const auto& indices = content.indices;
+
+    auto chunk = std::make_shared<Chunk>(0, 0);
+    for (int x = 0; x < CHUNK_W; x++) {
+        for (int z = 0; z < CHUNK_D; z++) {
+            chunk->voxels.set(vox_index(x, 40 + x + z, z), voxel {STONE, {}});
+        }
+    }
+    Lighting::prebuildSkyLight(*chunk, indices);
+
+    for (int x = 0; x < CHUNK_W; x++) {
+        for (int z = 0; z < CHUNK_D; z++) {
+            for (int y = 0; y < CHUNK_H; y++) {
+                int expected = y > 40 + x + z ? 15 : 0;
+                ASSERT_EQ(chunk->lightmap.getS(x, y, z), expected);
+            }
+        }
+    }
+    EXPECT_EQ(chunk->lightmap.highestPoint, 40 + 2 * 15 + 1);
+}
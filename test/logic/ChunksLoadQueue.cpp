@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <set>
+
+#include "content/Content.hpp"
+#include "logic/ChunksLoadQueue.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+
+struct TestContent {
+    Block air {"core:air"};
+    ContentIndices indices;
+
+    TestContent() : indices({{&air}}, {{}}, {{}}) {
+    }
+};
+
+static int distance2(const Chunks& chunks, const glm::ivec2& pos) {
+    int dx = pos.x - (chunks.getOffsetX() + chunks.getWidth() / 2);
+    int dz = pos.y - (chunks.getOffsetY() + chunks.getHeight() / 2);
+    return dx * dx + dz * dz;
+}
+
+static void put_chunk(Chunks& chunks, ChunksLoadQueue& queue, int x, int z) {
+    auto chunk = std::make_shared<Chunk>(x, z);
+    chunk->flags.loaded = true;
+    chunks.putChunk(chunk);
+    queue.onChunkPut(chunks, x, z);
+}
+
+TEST(ChunksLoadQueue, NearestFirst) {
+    TestContent content;
+    Chunks chunks(20, 20, 0, 0, nullptr, content.indices);
+    chunks.configure(100, -40, 10);
+
+    ChunksLoadQueue queue;
+    queue.update(chunks, 2, {});
+    // the circle inscribed in the area without padding
+    EXPECT_EQ(queue.getMissingCount(), 193);
+
+    std::set<std::pair<int, int>> visited;
+    glm::ivec2 pos;
+    int prevDistance = 0;
+    while (queue.popMissing(chunks, pos)) {
+        int distance = distance2(chunks, pos);
+        EXPECT_GE(distance, prevDistance);
+        prevDistance = distance;
+        EXPECT_TRUE(visited.insert({pos.x, pos.y}).second);
+        put_chunk(chunks, queue, pos.x, pos.y);
+        queue.update(chunks, 2, {});
+    }
+    EXPECT_EQ(visited.size(), 193);
+    EXPECT_EQ(chunks.getChunksCount(), 193);
+}
+
+TEST(ChunksLoadQueue, ForwardFirst) {
+    TestContent content;
+    Chunks chunks(16, 16, 0, 0, nullptr, content.indices);
+    chunks.configure(0, 0, 8);
+
+    ChunksLoadQueue queue;
+    queue.update(chunks, 0, {1.0f, 0.0f});
+    glm::ivec2 pos;
+    ASSERT_TRUE(queue.popMissing(chunks, pos));
+    EXPECT_EQ(pos, glm::ivec2(0, 0));
+    ASSERT_TRUE(queue.popMissing(chunks, pos));
+    EXPECT_EQ(pos, glm::ivec2(1, 0));
+
+    // the direction change causes rebuild
+    queue.update(chunks, 0, {0.0f, -1.0f});
+    ASSERT_TRUE(queue.popMissing(chunks, pos));
+    EXPECT_EQ(pos, glm::ivec2(0, 0));
+    ASSERT_TRUE(queue.popMissing(chunks, pos));
+    EXPECT_EQ(pos, glm::ivec2(0, -1));
+}
+
+TEST(ChunksLoadQueue, Lighting) {
+    TestContent content;
+    Chunks chunks(8, 8, 0, 0, nullptr, content.indices);
+    chunks.configure(0, 0, 4);
+
+    ChunksLoadQueue queue;
+    queue.update(chunks, 1, {});
+    put_chunk(chunks, queue, 0, 0);
+
+    std::set<std::pair<int, int>> positions;
+    glm::ivec2 pos;
+    while (queue.popLighting(pos)) {
+        positions.insert({pos.x, pos.y});
+    }
+    EXPECT_EQ(positions.size(), 9);
+    EXPECT_TRUE(positions.count({-1, -1}));
+    EXPECT_TRUE(positions.count({1, 1}));
+
+    // chunks left unlighted are found again after the matrix shift
+    chunks.configure(CHUNK_W, 0, 4);
+    queue.update(chunks, 1, {});
+    ASSERT_TRUE(queue.popLighting(pos));
+    EXPECT_EQ(pos, glm::ivec2(0, 0));
+    EXPECT_FALSE(queue.popLighting(pos));
+}
+
+/// @brief The nearest missing chunk search scanning the whole matrix as
+/// ChunksController did before
+static bool scan_nearest(const Chunks& chunks, uint padding, glm::ivec2& pos) {
+    int sizeX = chunks.getWidth();
+    int sizeY = chunks.getHeight();
+    bool assigned = false;
+    int minDistance = ((sizeX - padding * 2) / 2) * ((sizeY - padding * 2) / 2);
+    for (uint z = padding; z < sizeY - padding; z++) {
+        for (uint x = padding; x < sizeX - padding; x++) {
+            if (chunks.getChunks()[z * sizeX + x] != nullptr) {
+                continue;
+            }
+            int lx = x - sizeX / 2;
+            int lz = z - sizeY / 2;
+            int distance = (lx * lx + lz * lz);
+            if (distance < minDistance) {
+                minDistance = distance;
+                pos = {chunks.getOffsetX() + x, chunks.getOffsetY() + z};
+                assigned = true;
+            }
+        }
+    }
+    return assigned;
+}
+
+/// @brief Compare time spent on choosing chunks to load (chunks creation
+/// excluded) while filling the whole matrix. Results are printed only
+TEST(ChunksLoadQueue, DISABLED_Benchmark) {
+    using namespace std::chrono;
+    constexpr int LOAD_DISTANCE = 32;
+    constexpr uint PADDING = 2;
+    constexpr int SIZE = Chunks::matrixSize(LOAD_DISTANCE, PADDING);
+    constexpr int COUNT = SIZE * SIZE;
+
+    TestContent content;
+    std::vector<std::shared_ptr<Chunk>> pool;
+    for (int i = 0; i < COUNT; i++) {
+        pool.push_back(std::make_shared<Chunk>(0, 0));
+    }
+    auto take_chunk = [&pool](const glm::ivec2& pos) {
+        auto chunk = pool.back();
+        pool.pop_back();
+        chunk->x = pos.x;
+        chunk->z = pos.y;
+        return chunk;
+    };
+
+    glm::ivec2 pos;
+    int64_t scanTime = 0;
+    int64_t queueTime = 0;
+    size_t loaded = 0;
+    {
+        Chunks chunks(SIZE, SIZE, 0, 0, nullptr, content.indices);
+        chunks.configure(0, 0, SIZE / 2);
+        auto start = high_resolution_clock::now();
+        while (scan_nearest(chunks, PADDING, pos)) {
+            chunks.putChunk(take_chunk(pos));
+        }
+        loaded = chunks.getChunksCount();
+        scanTime = duration_cast<microseconds>(
+            high_resolution_clock::now() - start
+        ).count();
+        for (const auto& chunk : chunks.getChunks()) {
+            if (chunk) pool.push_back(chunk);
+        }
+    }
+    {
+        Chunks chunks(SIZE, SIZE, 0, 0, nullptr, content.indices);
+        chunks.configure(0, 0, SIZE / 2);
+        ChunksLoadQueue queue;
+        auto start = high_resolution_clock::now();
+        queue.update(chunks, PADDING, {});
+        while (queue.popMissing(chunks, pos)) {
+            chunks.putChunk(take_chunk(pos));
+            queue.onChunkPut(chunks, pos.x, pos.y);
+            while (queue.popLighting(pos));
+            queue.update(chunks, PADDING, {});
+        }
+        queueTime = duration_cast<microseconds>(
+            high_resolution_clock::now() - start
+        ).count();
+        EXPECT_EQ(chunks.getChunksCount(), loaded);
+    }
+    std::cout << "scheduling " << loaded << " chunks: scan " << scanTime
+              << " us, queue " << queueTime << " us" << std::endl;
+}
@@ -0,0 +1,372 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "content/Content.hpp"
+#include "content/ContentBuilder.hpp"
+#include "core_defs.hpp"
+#include "items/ItemDef.hpp"
+#include "objects/rigging.hpp"
+#include "physics/Hitbox.hpp"
+#include "physics/PhysicsSolver.hpp"
+#include "settings.hpp"
+#include "util/WorkerGroup.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
+#include "world/Level.hpp"
+#include "world/World.hpp"
+
+static constexpr float DELTA = 1.0f / 60.0f;
+/// @brief Top of the stone floor
+static constexpr int FLOOR_Y = 10;
+/// @brief Gap kept between the body and obstacles (see PhysicsSolver.cpp)
+static constexpr float GAP = 0.03f;
+static constexpr float TOLERANCE = 0.01f;
+static const glm::vec3 HALFSIZE(0.3f, 0.9f, 0.3f);
+
+/// @brief Level of 3x3 chunks around the origin with stone floor.
+/// Door is 2 blocks tall extended block, pane is rotatable thin block
+class PhysicsScene {
+    static std::unique_ptr<Content> build_content() {
+        ContentBuilder builder;
+        {
+            Block& block = builder.blocks.create(CORE_AIR);
+            block.obstacle = false;
+            block.model = BlockModel::none;
+            block.pickingItem = CORE_EMPTY;
+        }
+        builder.items.create(CORE_EMPTY);
+        {
+            Block& block = builder.blocks.create("test:stone");
+            block.pickingItem = CORE_EMPTY;
+        }
+        {
+            Block& block = builder.blocks.create("test:slab");
+            block.hitboxes = {AABB(glm::vec3(0.0f), glm::vec3(1, 0.5f, 1))};
+            block.pickingItem = CORE_EMPTY;
+        }
+        {
+            Block& block = builder.blocks.create("test:door");
+            block.size = {1, 2, 1};
+            block.hitboxes = {AABB(glm::vec3(0, 0, 0.8f), glm::vec3(1, 2, 1))};
+            block.pickingItem = CORE_EMPTY;
+        }
+        {
+            Block& block = builder.blocks.create("test:pane");
+            block.rotatable = true;
+            block.rotations = BlockRotProfile::PANE;
+            block.hitboxes = {AABB(glm::vec3(0.0f), glm::vec3(1, 1, 0.1f))};
+            block.pickingItem = CORE_EMPTY;
+        }
+        return builder.build();
+    }
+public:
+    EngineSettings settings;
+    std::unique_ptr<Content> content = build_content();
+    Level level {
+        std::make_unique<World>(
+            WorldInfo {}, nullptr, *content, std::vector<ContentPack> {}
+        ),
+        *content,
+        settings};
+    GlobalChunks& chunks = *level.chunks;
+    PhysicsSolver& solver = *level.physics;
+
+    PhysicsScene() {
+        blockid_t stone = require("test:stone");
+        for (int cz = -1; cz <= 1; cz++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                auto chunk = std::make_shared<Chunk>(cx, cz);
+                for (int y = 0; y < FLOOR_Y; y++) {
+                    for (int z = 0; z < CHUNK_D; z++) {
+                        for (int x = 0; x < CHUNK_W; x++) {
+                            chunk->voxels.set(
+                                vox_index(x, y, z), voxel {stone, {}}
+                            );
+                        }
+                    }
+                }
+                chunk->updateHeights();
+                chunks.putChunk(chunk);
+            }
+        }
+    }
+
+    blockid_t require(const std::string& name) const {
+        return content->blocks.require(name).rt.id;
+    }
+
+    void set(int x, int y, int z, const std::string& name, uint8_t rotation = 0) {
+        blockstate state {};
+        state.rotation = rotation;
+        blocks_agent::set(chunks, x, y, z, require(name), state);
+    }
+
+    /// @brief Step the body like Entities::updatePhysics does
+    void step(Hitbox& hitbox, int ticks) {
+        std::vector<Hitbox*> bodies {&hitbox};
+        for (int i = 0; i < ticks; i++) {
+            solver.stepBodies(chunks, bodies, DELTA, nullptr);
+        }
+    }
+
+    /// @brief Step the body keeping its horizontal velocity as player
+    /// controls do
+    void walk(Hitbox& hitbox, glm::vec3 velocity, int ticks) {
+        for (int i = 0; i < ticks; i++) {
+            hitbox.velocity.x = velocity.x;
+            hitbox.velocity.z = velocity.z;
+            step(hitbox, 1);
+        }
+    }
+};
+
+/// @brief Body standing on the floor at x, z
+static Hitbox make_body(PhysicsScene& scene, float x, float z) {
+    Hitbox hitbox(
+        BodyType::DYNAMIC, glm::vec3(x, FLOOR_Y + HALFSIZE.y + GAP, z), HALFSIZE
+    );
+    scene.step(hitbox, 10);
+    EXPECT_TRUE(hitbox.grounded);
+    return hitbox;
+}
+
+static float bottom(const Hitbox& hitbox) {
+    return hitbox.position.y - hitbox.halfsize.y;
+}
+
+TEST(PhysicsSolver, LandOnBlock) {
+    PhysicsScene scene;
+    scene.set(3, FLOOR_Y, 0, "test:slab");
+
+    Hitbox body(BodyType::DYNAMIC, glm::vec3(0.5f, FLOOR_Y + 4, 0.5f), HALFSIZE);
+    scene.step(body, 60);
+    EXPECT_TRUE(body.grounded);
+    EXPECT_EQ(body.velocity.y, 0.0f);
+    EXPECT_NEAR(bottom(body), FLOOR_Y + GAP, TOLERANCE);
+
+    Hitbox onSlab(BodyType::DYNAMIC, glm::vec3(3.5f, FLOOR_Y + 4, 0.5f), HALFSIZE);
+    scene.step(onSlab, 60);
+    EXPECT_TRUE(onSlab.grounded);
+    EXPECT_NEAR(bottom(onSlab), FLOOR_Y + 0.5f + GAP, TOLERANCE);
+}
+
+TEST(PhysicsSolver, WallStop) {
+    PhysicsScene scene;
+    for (int y = FLOOR_Y; y < FLOOR_Y + 2; y++) {
+        scene.set(3, y, 0, "test:stone");
+        scene.set(-3, y, 0, "test:stone");
+        scene.set(0, y, 3, "test:stone");
+        scene.set(0, y, -3, "test:stone");
+    }
+    // walls faces: cells of blocks at 3 and -3 are [3, 4] and [-3, -2]
+    struct Case {
+        glm::vec3 velocity;
+        int axis;
+        float expected;
+    };
+    const float half = HALFSIZE.x;
+    for (const auto& [velocity, axis, expected] : {
+             Case {{5, 0, 0}, 0, 3.0f - half - GAP},
+             Case {{-5, 0, 0}, 0, -2.0f + half + GAP},
+             Case {{0, 0, 5}, 2, 3.0f - half - GAP},
+             Case {{0, 0, -5}, 2, -2.0f + half + GAP},
+         }) {
+        Hitbox body = make_body(scene, 0.5f, 0.5f);
+        scene.walk(body, velocity, 120);
+        EXPECT_NEAR(body.position[axis], expected, TOLERANCE)
+            << "axis " << axis << " velocity " << velocity[axis];
+        EXPECT_NEAR(body.position[2 - axis], 0.5f, TOLERANCE);
+        EXPECT_TRUE(body.grounded);
+    }
+}
+
+/// @brief Grounded body steps up to a slab and stays on its top
+TEST(PhysicsSolver, StepUp) {
+    PhysicsScene scene;
+    for (int x = 3; x < 10; x++) {
+        scene.set(x, FLOOR_Y, 0, "test:slab");
+    }
+    Hitbox body = make_body(scene, 0.5f, 0.5f);
+    scene.walk(body, glm::vec3(4, 0, 0), 120);
+    EXPECT_GT(body.position.x, 4.0f);
+    EXPECT_TRUE(body.grounded);
+    EXPECT_NEAR(bottom(body), FLOOR_Y + 0.5f + GAP, TOLERANCE);
+
+    // falling body is not lifted
+    Hitbox falling(
+        BodyType::DYNAMIC, glm::vec3(2.6f, FLOOR_Y + 1.3f, 0.5f), HALFSIZE
+    );
+    falling.velocity.y = -1.0f;
+    scene.walk(falling, glm::vec3(4, 0, 0), 2);
+    EXPECT_FALSE(falling.grounded);
+    EXPECT_NEAR(falling.position.x, 3.0f - HALFSIZE.x - GAP, TOLERANCE);
+}
+
+TEST(PhysicsSolver, CeilingHit) {
+    constexpr int CEILING = FLOOR_Y + 3;
+    PhysicsScene scene;
+    scene.set(0, CEILING, 0, "test:stone");
+
+    Hitbox body = make_body(scene, 0.5f, 0.5f);
+    body.velocity.y = 10.0f;
+    float top = 0.0f;
+    for (int i = 0; i < 30; i++) {
+        scene.step(body, 1);
+        top = std::max(top, body.position.y + HALFSIZE.y);
+    }
+    EXPECT_NEAR(top, CEILING - GAP, TOLERANCE);
+    EXPECT_TRUE(body.grounded);
+    EXPECT_NEAR(bottom(body), FLOOR_Y + GAP, TOLERANCE);
+
+    // the jump is not stopped without the ceiling
+    Hitbox free = make_body(scene, 2.5f, 0.5f);
+    free.velocity.y = 10.0f;
+    scene.step(free, 20);
+    EXPECT_GT(free.position.y + HALFSIZE.y, CEILING);
+}
+
+/// @brief Crouching body does not walk off a platform edge
+TEST(PhysicsSolver, CrouchEdgeHold) {
+    constexpr int PLATFORM_Y = FLOOR_Y + 1;
+    PhysicsScene scene;
+    for (int z = -2; z <= 2; z++) {
+        for (int x = -3; x <= 0; x++) {
+            scene.set(x, FLOOR_Y, z, "test:stone");
+        }
+    }
+    for (auto velocity : {glm::vec3(3, 0, 0), glm::vec3(3, 0, 3)}) {
+        Hitbox body(
+            BodyType::DYNAMIC,
+            glm::vec3(-0.5f, PLATFORM_Y + HALFSIZE.y + GAP, 0.5f),
+            HALFSIZE
+        );
+        body.crouching = true;
+        scene.walk(body, velocity, 60);
+        EXPECT_TRUE(body.grounded);
+        EXPECT_NEAR(bottom(body), PLATFORM_Y + GAP, TOLERANCE);
+        // the body still stands on the platform, x = 1 is its edge
+        EXPECT_LT(body.position.x - HALFSIZE.x, 1.0f);
+        EXPECT_GT(body.position.x, 1.0f);
+
+        body.crouching = false;
+        scene.walk(body, velocity, 60);
+        EXPECT_NEAR(bottom(body), FLOOR_Y + GAP, TOLERANCE);
+    }
+}
+
+/// @brief Boxes of extended block segments are taken from the origin block
+TEST(PhysicsSolver, ExtendedHitbox) {
+    PhysicsScene scene;
+    scene.set(3, FLOOR_Y, 0, "test:door");
+    ASSERT_NE(blocks_agent::get(scene.chunks, 3, FLOOR_Y + 1, 0)->state.segment, 0);
+
+    // door box is z in [0.8, 1]
+    Hitbox body = make_body(scene, 3.5f, -2.5f);
+    scene.walk(body, glm::vec3(0, 0, 4), 120);
+    EXPECT_NEAR(body.position.z, 0.8f - HALFSIZE.z - GAP, TOLERANCE);
+
+    Hitbox onTop(
+        BodyType::DYNAMIC, glm::vec3(3.5f, FLOOR_Y + 5, 0.9f), HALFSIZE
+    );
+    scene.step(onTop, 60);
+    EXPECT_TRUE(onTop.grounded);
+    EXPECT_NEAR(bottom(onTop), FLOOR_Y + 2 + GAP, TOLERANCE);
+}
+
+/// @brief Rotated block boxes are used
+TEST(PhysicsSolver, RotatedHitbox) {
+    PhysicsScene scene;
+    const auto& pane = scene.content->blocks.require("test:pane");
+    std::vector<float> stops;
+    for (uint8_t rotation : {0, 2}) {
+        int x = rotation * 3;
+        scene.set(x, FLOOR_Y, 3, "test:pane", rotation);
+        float boxStart = pane.rt.hitboxes[rotation].at(0).min().z;
+
+        Hitbox body = make_body(scene, x + 0.5f, 0.5f);
+        scene.walk(body, glm::vec3(0, 0, 4), 120);
+        EXPECT_NEAR(
+            body.position.z, 3 + boxStart - HALFSIZE.z - GAP, TOLERANCE
+        ) << "rotation " << static_cast<int>(rotation);
+        stops.push_back(body.position.z);
+    }
+    // south pane is on the far side of the block
+    EXPECT_GT(stops[1], stops[0] + 0.5f);
+}
+
+/// @brief Bodies stepped on the calling thread only and by multiple workers
+/// end up in exactly the same state
+TEST(PhysicsSolver, ParallelStepIsDeterministic) {
+    constexpr int BODIES = 500;
+    constexpr int TICKS = 120;
+
+    PhysicsScene scene;
+    std::mt19937 random(7);
+    for (int z = -14; z < 30; z++) {
+        for (int x = -14; x < 30; x++) {
+            switch (random() % 12) {
+                case 0:
+                    scene.set(x, FLOOR_Y, z, "test:stone");
+                    break;
+                case 1:
+                    scene.set(x, FLOOR_Y, z, "test:slab");
+                    break;
+            }
+        }
+    }
+    std::vector<Hitbox> serial;
+    for (int i = 0; i < BODIES; i++) {
+        glm::vec3 position(
+            random() % 40 - 12 + 0.5f,
+            FLOOR_Y + 2 + random() % 4,
+            random() % 40 - 12 + 0.5f
+        );
+        Hitbox hitbox(BodyType::DYNAMIC, position, glm::vec3(0.3f, 0.9f, 0.3f));
+        hitbox.velocity = glm::vec3(
+            (random() % 200) / 20.0f - 5.0f, 0, (random() % 200) / 20.0f - 5.0f
+        );
+        hitbox.crouching = i % 7 == 0;
+        serial.push_back(hitbox);
+    }
+    auto parallel = serial;
+
+    auto pointers = [](std::vector<Hitbox>& hitboxes) {
+        std::vector<Hitbox*> bodies;
+        for (auto& hitbox : hitboxes) {
+            bodies.push_back(&hitbox);
+        }
+        return bodies;
+    };
+    auto serialBodies = pointers(serial);
+    auto parallelBodies = pointers(parallel);
+    util::WorkerGroup workers(4);
+    for (int tick = 0; tick < TICKS; tick++) {
+        scene.solver.stepBodies(scene.chunks, serialBodies, DELTA, nullptr);
+        scene.solver.stepBodies(scene.chunks, parallelBodies, DELTA, &workers);
+        if (tick % 40 == 0) {
+            for (auto& bodies : {serialBodies, parallelBodies}) {
+                for (size_t i = 0; i < bodies.size(); i++) {
+                    bodies[i]->velocity.x += static_cast<int>(i % 5) - 2;
+                    bodies[i]->velocity.y += (i % 3 == 0) * 8.0f;
+                }
+            }
+        }
+    }
+    int grounded = 0;
+    for (int i = 0; i < BODIES; i++) {
+        const auto& expected = serial[i];
+        const auto& actual = parallel[i];
+        ASSERT_EQ(actual.position, expected.position) << "body " << i;
+        ASSERT_EQ(actual.velocity, expected.velocity) << "body " << i;
+        ASSERT_EQ(actual.grounded, expected.grounded) << "body " << i;
+        ASSERT_EQ(actual.linearDamping, expected.linearDamping);
+        grounded += expected.grounded;
+    }
+    // bodies collided with blocks
+    EXPECT_GT(grounded, 0);
+}
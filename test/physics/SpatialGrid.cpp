@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "physics/SpatialGrid.hpp"
+
+static AABB random_box(std::mt19937& random, float range, float maxSize) {
+    std::uniform_real_distribution<float> pos(-range, range);
+    std::uniform_real_distribution<float> size(0.1f, maxSize);
+    glm::vec3 a(pos(random), pos(random) * 0.25f, pos(random));
+    return AABB(a, a + glm::vec3(size(random), size(random), size(random)));
+}
+
+static bool overlaps(const AABB& a, const AABB& b) {
+    return a.a.x <= b.b.x && a.b.x >= b.a.x && a.a.y <= b.b.y &&
+           a.b.y >= b.a.y && a.a.z <= b.b.z && a.b.z >= b.a.z;
+}
+
+/// @brief Query results match brute force check while boxes are moved,
+/// resized (large ones included) and removed
+TEST(SpatialGrid, MatchesBruteForce) {
+    std::mt19937 random(7);
+    SpatialGrid<int> grid(4.0f);
+    std::vector<std::optional<AABB>> boxes(2000);
+    for (int step = 0; step < 20; step++) {
+        for (size_t i = 0; i < boxes.size(); i++) {
+            switch (random() % 8) {
+                case 0:
+                    grid.remove(i);
+                    boxes[i] = std::nullopt;
+                    break;
+                case 1:
+                    boxes[i] = random_box(random, 100.0f, 60.0f);
+                    grid.update(i, *boxes[i]);
+                    break;
+                case 2:
+                case 3:
+                    boxes[i] = random_box(random, 100.0f, 2.0f);
+                    grid.update(i, *boxes[i]);
+                    break;
+                default:
+                    if (boxes[i]) {
+                        // small move
+                        *boxes[i] = boxes[i]->translated(glm::vec3(0.3f));
+                        grid.update(i, *boxes[i]);
+                    }
+                    break;
+            }
+        }
+        for (int q = 0; q < 50; q++) {
+            AABB area = random_box(random, 100.0f, q % 10 == 0 ? 150.0f : 8.0f);
+            std::set<int> expected;
+            for (size_t i = 0; i < boxes.size(); i++) {
+                if (boxes[i] && overlaps(*boxes[i], area)) {
+                    expected.insert(i);
+                }
+            }
+            std::vector<int> found;
+            grid.query(area, [&](int value, const AABB& aabb) {
+                found.push_back(value);
+            });
+            std::set<int> foundSet(found.begin(), found.end());
+            ASSERT_EQ(found.size(), foundSet.size()) << "reported twice";
+            ASSERT_EQ(foundSet, expected);
+        }
+    }
+    size_t alive = std::count_if(boxes.begin(), boxes.end(), [](auto& box) {
+        return box.has_value();
+    });
+    EXPECT_EQ(grid.size(), alive);
+
+    grid.clear();
+    EXPECT_EQ(grid.size(), 0);
+    grid.query(AABB(glm::vec3(-1000), glm::vec3(1000)), [](int, const AABB&) {
+        FAIL();
+    });
+}
+
+TEST(SpatialGrid, NotFiniteBoxes) {
+    SpatialGrid<int> grid(4.0f);
+    grid.update(1, AABB(glm::vec3(NAN), glm::vec3(NAN)));
+    grid.update(2, AABB(glm::vec3(0.0f), glm::vec3(INFINITY)));
+    grid.update(3, AABB(glm::vec3(0.0f), glm::vec3(1.0f)));
+    std::set<int> found;
+    grid.query(AABB(glm::vec3(0.5f), glm::vec3(2.0f)), [&](int value, auto&) {
+        found.insert(value);
+    });
+    EXPECT_EQ(found, std::set<int>({2, 3}));
+}
+
+/// @brief Sensors pass of a physics tick: every moving body is checked
+/// against sensors of 1/10 of bodies. Grid and brute force time is
+/// printed only
+TEST(SpatialGrid, DISABLED_SensorsBenchmark) {
+    using namespace std::chrono;
+    for (int count : {1000, 5000, 20000, 50000}) {
+        std::mt19937 random(count);
+        // entities spread over loaded area of ~32x32 chunks
+        std::vector<AABB> bodies;
+        for (int i = 0; i < count; i++) {
+            bodies.push_back(random_box(random, 256.0f, 1.0f));
+        }
+        std::vector<AABB> sensors;
+        for (int i = 0; i < count / 10; i++) {
+            glm::vec3 center = bodies[i * 10].center();
+            sensors.push_back(AABB(center - 1.5f, center + 1.5f));
+        }
+
+        auto start = high_resolution_clock::now();
+        SpatialGrid<int> sensorsIndex(4.0f);
+        SpatialGrid<int> bodiesIndex(4.0f);
+        for (size_t i = 0; i < sensors.size(); i++) {
+            sensorsIndex.update(i, sensors[i]);
+        }
+        size_t gridHits = 0;
+        for (size_t i = 0; i < bodies.size(); i++) {
+            bodies[i] = bodies[i].translated(glm::vec3(0.05f, 0, 0));
+            bodiesIndex.update(i, bodies[i]);
+            sensorsIndex.query(bodies[i], [&](int, const AABB&) {
+                gridHits++;
+            });
+        }
+        auto gridTime = high_resolution_clock::now() - start;
+
+        start = high_resolution_clock::now();
+        size_t bruteHits = 0;
+        for (const auto& body : bodies) {
+            for (const auto& sensor : sensors) {
+                bruteHits += overlaps(body, sensor);
+            }
+        }
+        auto bruteTime = high_resolution_clock::now() - start;
+        EXPECT_EQ(gridHits, bruteHits);
+
+        std::cout << count << " entities: grid "
+                  << duration_cast<microseconds>(gridTime).count()
+                  << " us, brute force "
+                  << duration_cast<microseconds>(bruteTime).count() << " us"
+                  << std::endl;
+    }
+}
@@ -0,0 +1,287 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "util/JobSystem.hpp"
+#include "util/ThreadPool.hpp"
+#include "util/WorkerGroup.hpp"
+
+using namespace util;
+using namespace std::chrono_literals;
+
+template <class Predicate>
+static bool wait_for(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+TEST(JobSystem, AllJobsDone) {
+    JobSystem system(4);
+    std::atomic<int> done = 0;
+    for (int i = 0; i < 10'000; i++) {
+        system.submit([&done]() { done++; }, i % 7);
+    }
+    EXPECT_TRUE(wait_for([&]() { return done == 10'000; }));
+    EXPECT_EQ(system.getPendingCount(), 0);
+}
+
+TEST(JobSystem, PriorityOrder) {
+    JobSystem system(1);
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool released = false;
+    std::atomic<bool> started = false;
+    system.submit([&]() {
+        started = true;
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [&]() { return released; });
+    });
+    ASSERT_TRUE(wait_for([&]() { return started.load(); }));
+
+    std::vector<int> order;
+    std::atomic<int> done = 0;
+    for (int priority : {1, 5, -3, 5, 0, 10}) {
+        system.submit([&order, &done, priority]() {
+            order.push_back(priority);
+            done++;
+        }, priority);
+    }
+    {
+        std::lock_guard lock(mutex);
+        released = true;
+    }
+    condition.notify_one();
+    ASSERT_TRUE(wait_for([&]() { return done == 6; }));
+    EXPECT_EQ(order, (std::vector<int> {10, 5, 5, 1, 0, -3}));
+}
+
+TEST(JobSystem, Cancellation) {
+    JobSystem system(1);
+    std::atomic<bool> release = false;
+    system.submit([&]() {
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    auto token = std::make_shared<JobToken>();
+    std::atomic<int> cancelled = 0;
+    std::atomic<int> done = 0;
+    for (int i = 0; i < 100; i++) {
+        system.submit([&cancelled]() { cancelled++; }, 0, token);
+    }
+    system.submit([&done]() { done++; }, -1);
+    token->cancel();
+    release = true;
+    ASSERT_TRUE(wait_for([&]() { return done == 1; }));
+    EXPECT_EQ(cancelled, 0);
+}
+
+TEST(JobSystem, NestedSubmit) {
+    JobSystem system(3);
+    std::atomic<int> done = 0;
+    for (int i = 0; i < 100; i++) {
+        system.submit([&]() {
+            EXPECT_TRUE(system.isWorkerThread());
+            for (int j = 0; j < 10; j++) {
+                system.submit([&done]() { done++; });
+            }
+        });
+    }
+    EXPECT_TRUE(wait_for([&]() { return done == 1000; }));
+    EXPECT_FALSE(system.isWorkerThread());
+}
+
+TEST(JobSystem, WorkerGroupAllIndices) {
+    JobSystem system(2);
+    WorkerGroup group(6, system);
+    // keep scheduler threads busy: the caller must run the work itself
+    std::atomic<bool> release = false;
+    for (uint i = 0; i < system.getThreadsCount(); i++) {
+        system.submit([&]() {
+            while (!release) {
+                std::this_thread::yield();
+            }
+        }, INT_MAX);
+    }
+    std::vector<int> visits(group.size(), 0);
+    for (int round = 0; round < 3; round++) {
+        group.run([&visits](uint index) { visits[index]++; });
+    }
+    release = true;
+    for (auto& count : visits) {
+        EXPECT_EQ(count, 3);
+    }
+    EXPECT_THROW(
+        group.run([](uint index) {
+            if (index == 3) throw std::runtime_error("test");
+        }),
+        std::runtime_error
+    );
+}
+
+class SquareWorker : public Worker<int, int> {
+public:
+    int operator()(const int& value) override {
+        return value * value;
+    }
+};
+
+TEST(JobSystem, ThreadPoolAdapter) {
+    JobSystem system(4);
+    long long sum = 0;
+    bool complete = false;
+    ThreadPool<int, int> pool(
+        "test",
+        []() { return std::make_shared<SquareWorker>(); },
+        [&sum](int& result) { sum += result; },
+        2,
+        system
+    );
+    EXPECT_EQ(pool.getWorkersCount(), 2);
+    pool.setStandaloneResults(false);
+    pool.setOnComplete([&complete]() { complete = true; });
+    for (int i = 0; i < 100; i++) {
+        pool.enqueueJob(i, i % 3);
+    }
+    pool.waitForEnd();
+    EXPECT_TRUE(complete);
+    EXPECT_EQ(sum, 99 * 100 * 199 / 6);
+    EXPECT_EQ(pool.getWorkDone(), 100);
+}
+
+/// @brief Single queue pool with a thread per worker, as util::ThreadPool
+/// was implemented before JobSystem
+class LegacyPool {
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool working = true;
+public:
+    LegacyPool(uint count) {
+        for (uint i = 0; i < count; i++) {
+            threads.emplace_back([this]() {
+                while (true) {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock lock(mutex);
+                        condition.wait(lock, [this]() {
+                            return !jobs.empty() || !working;
+                        });
+                        if (!working) {
+                            return;
+                        }
+                        job = std::move(jobs.front());
+                        jobs.pop();
+                    }
+                    job();
+                }
+            });
+        }
+    }
+
+    ~LegacyPool() {
+        {
+            std::lock_guard lock(mutex);
+            working = false;
+        }
+        condition.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard lock(mutex);
+            jobs.push(std::move(job));
+        }
+        condition.notify_one();
+    }
+};
+
+/// @brief Measure jobs throughput and submit-to-start latency. Every
+/// producer thread submits a job, half of the jobs spawn a child job
+template <class Submit>
+static void benchmark(const char* name, Submit submit) {
+    using clock = std::chrono::steady_clock;
+    constexpr int PRODUCERS = 2;
+    constexpr int JOBS = 50'000;
+    constexpr int TOTAL = PRODUCERS * JOBS * 3 / 2;
+
+    std::vector<int64_t> latencies(TOTAL);
+    std::atomic<int> nextLatency = 0;
+    std::atomic<int> done = 0;
+
+    auto work = [&](clock::time_point submitted) {
+        auto start = clock::now();
+        latencies[nextLatency++] =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                start - submitted
+            ).count();
+        volatile int x = 0;
+        for (int i = 0; i < 200; i++) {
+            x = x + i;
+        }
+        done++;
+    };
+
+    auto start = clock::now();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&]() {
+            for (int i = 0; i < JOBS; i++) {
+                auto submitted = clock::now();
+                submit([&, submitted, i]() {
+                    work(submitted);
+                    if (i % 2 == 0) {
+                        auto childSubmitted = clock::now();
+                        submit([&, childSubmitted]() { work(childSubmitted); });
+                    }
+                });
+            }
+        });
+    }
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    ASSERT_TRUE(wait_for([&]() { return done == TOTAL; }));
+    auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << name << ": " << static_cast<int64_t>(TOTAL / seconds)
+              << " jobs/s, latency p50 " << latencies[TOTAL / 2] / 1000
+              << " us, p99 " << latencies[TOTAL * 99 / 100] / 1000
+              << " us, max " << latencies.back() / 1000 << " us" << std::endl;
+}
+
+TEST(JobSystem, DISABLED_Benchmark) {
+    uint threads = std::max(2U, std::thread::hardware_concurrency()) - 1;
+    {
+        LegacyPool pool(threads);
+        benchmark("single queue pool", [&pool](std::function<void()> job) {
+            pool.submit(std::move(job));
+        });
+    }
+    {
+        JobSystem system(threads);
+        benchmark("job system", [&system](std::function<void()> job) {
+            system.submit(std::move(job));
+        });
+    }
+}
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include "util/SerialWorker.hpp"
+
+using namespace util;
+
+TEST(SerialWorker, FlushRethrowsFirstError) {
+    SerialWorker worker("test-worker");
+    std::atomic<int> done = 0;
+    worker.submit([]() { throw std::runtime_error("first"); });
+    worker.submit([&done]() { done++; });
+    worker.submit([]() { throw std::runtime_error("second"); });
+    try {
+        worker.flush();
+        FAIL() << "error is not rethrown";
+    } catch (const std::runtime_error& err) {
+        EXPECT_STREQ(err.what(), "first");
+    }
+    // tasks after the failed one are still run
+    EXPECT_EQ(done, 1);
+
+    // the error is rethrown once
+    worker.submit([&done]() { done++; });
+    EXPECT_NO_THROW(worker.flush());
+    EXPECT_EQ(done, 2);
+}
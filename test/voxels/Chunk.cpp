@@ -5,10 +5,12 @@
 TEST(Chunk, EncodeDecode) {
     Chunk chunk1(0, 0);
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        chunk1.voxels[i].id = rand();
-        chunk1.voxels[i].state.rotation = rand();
-        chunk1.voxels[i].state.segment = rand();
-        chunk1.voxels[i].state.userbits = rand();
+        voxel vox {};
+        vox.id = rand();
+        vox.state.rotation = rand();
+        vox.state.segment = rand();
+        vox.state.userbits = rand();
+        chunk1.voxels.set(i, vox);
     }
     auto bytes = chunk1.encode();
 
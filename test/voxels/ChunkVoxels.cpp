@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "voxels/Chunk.hpp"
+#include "voxels/ChunkVoxels.hpp"
+#include "voxels/blocks_agent.hpp"
+
+/// @brief Fill flat voxels array with a terrain-like column: random stone
+/// and ore under height, air above
+static void fill_terrain(voxel* voxels, int height) {
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        int y = i / (CHUNK_W * CHUNK_D);
+        voxels[i] = {};
+        if (y < height) {
+            voxels[i].id = rand() % 10 == 0 ? 3 : 1;
+        }
+    }
+}
+
+TEST(ChunkVoxels, AssignCopy) {
+    auto src = std::make_unique<voxel[]>(CHUNK_VOL);
+    fill_terrain(src.get(), 70);
+    src[CHUNK_VOL - 1].state.userbits = 5;
+
+    ChunkVoxels voxels;
+    voxels.assign(src.get());
+    // 5 sections are filled with terrain, the last one has modified state
+    EXPECT_EQ(voxels.countAllocated(), 6U);
+
+    auto dst = std::make_unique<voxel[]>(CHUNK_VOL);
+    voxels.copyTo(dst.get());
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        ASSERT_EQ(src[i].id, voxels[i].id);
+        ASSERT_EQ(src[i].id, dst[i].id);
+        ASSERT_EQ(
+            blockstate2int(src[i].state), blockstate2int(dst[i].state)
+        );
+    }
+}
+
+TEST(ChunkVoxels, WriteUniform) {
+    ChunkVoxels voxels;
+    EXPECT_EQ(voxels.countAllocated(), 0U);
+    EXPECT_EQ(voxels[vox_index(3, 200, 7)].id, 0);
+
+    voxels.write(vox_index(3, 200, 7)).id = 2;
+    EXPECT_EQ(voxels.countAllocated(), 1U);
+    EXPECT_FALSE(voxels.isUniform(200 / CHUNK_SECTION_H));
+    EXPECT_EQ(voxels[vox_index(3, 200, 7)].id, 2);
+    EXPECT_EQ(voxels[vox_index(4, 200, 7)].id, 0);
+}
+
+/// @brief Single chunk storage for blocks_agent
+struct SingleChunk {
+    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(0, 0);
+
+    Chunk* getChunk(int cx, int cz) const {
+        return cx == 0 && cz == 0 ? chunk.get() : nullptr;
+    }
+};
+
+TEST(ChunkVoxels, AgentReadDoesNotAllocate) {
+    SingleChunk chunks;
+    const auto& voxels = chunks.chunk->voxels;
+    EXPECT_EQ(voxels.countAllocated(), 0U);
+
+    for (int y = 0; y < CHUNK_H; y++) {
+        const voxel* vox = blocks_agent::get(chunks, 3, y, 7);
+        ASSERT_NE(vox, nullptr);
+        EXPECT_EQ(vox->id, 0);
+    }
+    EXPECT_EQ(blocks_agent::get(chunks, CHUNK_W, 10, 0), nullptr);
+    EXPECT_EQ(voxels.countAllocated(), 0U);
+
+    blocks_agent::get_mutable(chunks, 3, 200, 7)->state.userbits = 1;
+    EXPECT_EQ(voxels.countAllocated(), 1U);
+    EXPECT_EQ(blocks_agent::get(chunks, 3, 200, 7)->state.userbits, 1);
+}
+
+TEST(ChunkVoxels, OccupancyMasks) {
+    ChunkVoxels voxels;
+    EXPECT_EQ(voxels.getOccupiedMask(), 0U);
+    EXPECT_EQ(voxels.getUniformMask(), 0xFFFFU);
+
+    uint index = vox_index(1, 33, 2);
+    voxels.set(index, voxel {1, {}});
+    EXPECT_EQ(voxels.getOccupiedMask(), 1U << 2);
+    EXPECT_EQ(voxels.getUniformMask(), 0xFFFFU & ~(1U << 2));
+
+    voxels.set(index, voxel {2, {}});
+    EXPECT_FALSE(voxels.isEmpty(2));
+    voxels.set(index, voxel {0, {}});
+    EXPECT_TRUE(voxels.isEmpty(2));
+    EXPECT_EQ(voxels.getOccupiedMask(), 0U);
+
+    auto src = std::make_unique<voxel[]>(CHUNK_VOL);
+    fill_terrain(src.get(), 20);
+    voxels.assign(src.get());
+    EXPECT_EQ(voxels.getOccupiedMask(), 0b11U);
+    // setting the same value does not allocate uniform section
+    voxels.set(vox_index(0, 100, 0), voxel {0, {}});
+    EXPECT_TRUE(voxels.isUniform(100 / CHUNK_SECTION_H));
+}
+
+/// @brief Compare memory footprint and random read speed with flat array.
+/// Not a correctness test, results are printed only
+TEST(ChunkVoxels, DISABLED_MemoryAndRandomAccess) {
+    constexpr int CHUNKS = 64;
+    constexpr int READS = 1 << 24;
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<std::unique_ptr<voxel[]>> flat;
+    size_t sectionedBytes = 0;
+    for (int i = 0; i < CHUNKS; i++) {
+        auto data = std::make_unique<voxel[]>(CHUNK_VOL);
+        fill_terrain(data.get(), 40 + rand() % 60);
+        auto chunk = std::make_unique<Chunk>(i, 0);
+        chunk->voxels.assign(data.get());
+        sectionedBytes += chunk->getMemoryUsage();
+        chunks.push_back(std::move(chunk));
+        flat.push_back(std::move(data));
+    }
+    size_t flatBytes = CHUNKS * (sizeof(Chunk) - sizeof(ChunkVoxels) +
+                                 CHUNK_VOL * sizeof(voxel));
+
+    std::vector<uint> indices(READS);
+    for (auto& index : indices) {
+        index = (rand() % CHUNKS) * CHUNK_VOL + rand() % CHUNK_VOL;
+    }
+    using clock = std::chrono::high_resolution_clock;
+
+    uint64_t flatSum = 0;
+    auto start = clock::now();
+    for (uint index : indices) {
+        flatSum += flat[index / CHUNK_VOL][index % CHUNK_VOL].id;
+    }
+    auto flatTime = clock::now() - start;
+
+    uint64_t sectionedSum = 0;
+    start = clock::now();
+    for (uint index : indices) {
+        sectionedSum += chunks[index / CHUNK_VOL]->voxels[index % CHUNK_VOL].id;
+    }
+    auto sectionedTime = clock::now() - start;
+    EXPECT_EQ(flatSum, sectionedSum);
+
+    auto ns = [](clock::duration duration) {
+        return std::chrono::duration<double, std::nano>(duration).count() /
+               READS;
+    };
+    std::cout << "chunk memory (flat): " << flatBytes / CHUNKS / 1024
+              << " KiB\n";
+    std::cout << "chunk memory (sectioned): " << sectionedBytes / CHUNKS / 1024
+              << " KiB\n";
+    std::cout << "random read (flat): " << ns(flatTime) << " ns\n";
+    std::cout << "random read (sectioned): " << ns(sectionedTime) << " ns"
+              << std::endl;
+}
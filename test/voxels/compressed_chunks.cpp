@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "content/Content.hpp"
+#include "util/data_io.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/compressed_chunks.hpp"
+
+namespace {
+    struct TestContent {
+        Block air {"core:air"};
+        Block stone {"test:stone"};
+        Block dirt {"test:dirt"};
+        ContentIndices indices;
+
+        TestContent() : indices({{&air, &stone, &dirt}}, {{}}, {{}}) {
+        }
+    };
+}
+
+static std::unique_ptr<Chunk> make_chunk(uint seed) {
+    auto chunk = std::make_unique<Chunk>(3, -7);
+    std::mt19937 random(seed);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        voxel vox {};
+        // layered terrain with random ores to get runs of different lengths
+        vox.id = (i / (CHUNK_W * CHUNK_D)) < 64 ? 1 + random() % 8 / 7 : 0;
+        vox.state.rotation = random() % 64 == 0;
+        chunk->voxels.set(i, vox);
+    }
+    return chunk;
+}
+
+static bool same_voxels(const Chunk& a, const Chunk& b) {
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        if (a.voxels[i].id != b.voxels[i].id ||
+            blockstate2int(a.voxels[i].state) !=
+                blockstate2int(b.voxels[i].state)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(CompressedChunks, EncodeDecode) {
+    TestContent content;
+    auto source = make_chunk(1);
+    auto bytes = compressed_chunks::encode(*source);
+
+    Chunk chunk(3, -7);
+    compressed_chunks::decode(
+        chunk, bytes.data(), bytes.size(), content.indices
+    );
+    EXPECT_TRUE(same_voxels(*source, chunk));
+    EXPECT_TRUE(chunk.flags.unsaved);
+}
+
+TEST(CompressedChunks, FindMaxBlockId) {
+    auto data = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+    auto ids = reinterpret_cast<uint16_t*>(data.get());
+    std::mt19937 random(42);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        ids[i] = dataio::h2le<uint16_t>(random() % 1000);
+        ids[CHUNK_VOL + i] = 0xFFFF; // states are not ids
+    }
+    EXPECT_LT(Chunk::findMaxBlockId(data.get()), 1000);
+    const uint positions[] {0, 1, 7, 8, 1234, CHUNK_VOL - 17, CHUNK_VOL - 1};
+    for (uint i : positions) {
+        for (uint16_t id : {1000, 0x7FFF, 0x8000, 0xFFFF}) {
+            uint16_t prev = ids[i];
+            ids[i] = dataio::h2le(id);
+            EXPECT_EQ(Chunk::findMaxBlockId(data.get()), id);
+            ids[i] = prev;
+        }
+    }
+}
+
+TEST(CompressedChunks, UnknownBlockId) {
+    TestContent content;
+    auto source = make_chunk(2);
+    source->voxels.set(CHUNK_VOL - 5, voxel {3, {}});
+    auto bytes = compressed_chunks::encode(*source);
+
+    Chunk chunk(3, -7);
+    EXPECT_THROW(
+        compressed_chunks::decode(
+            chunk, bytes.data(), bytes.size(), content.indices
+        ),
+        std::runtime_error
+    );
+}
+
+TEST(CompressedChunks, CorruptedData) {
+    TestContent content;
+    auto source = make_chunk(3);
+    auto bytes = compressed_chunks::encode(*source);
+
+    Chunk chunk(3, -7);
+    auto truncated = bytes;
+    truncated.resize(bytes.size() / 2);
+    EXPECT_THROW(
+        compressed_chunks::decode(
+            chunk, truncated.data(), truncated.size(), content.indices
+        ),
+        std::runtime_error
+    );
+    auto damaged = bytes;
+    for (size_t i = 16; i < damaged.size() / 2; i += 7) {
+        damaged[i] ^= 0x5A;
+    }
+    EXPECT_THROW(
+        compressed_chunks::decode(
+            chunk, damaged.data(), damaged.size(), content.indices
+        ),
+        std::runtime_error
+    );
+}
+
+/// @brief Chunks are decoded by worker threads at once
+TEST(CompressedChunks, ConcurrentDecode) {
+    constexpr int THREADS = 4;
+    constexpr int CHUNKS = 16;
+    TestContent content;
+    std::vector<std::unique_ptr<Chunk>> sources;
+    std::vector<std::vector<ubyte>> encoded;
+    for (int i = 0; i < CHUNKS; i++) {
+        sources.push_back(make_chunk(i));
+        encoded.push_back(compressed_chunks::encode(*sources.back()));
+    }
+    std::atomic<int> failures {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            Chunk chunk(3, -7);
+            for (int i = 0; i < CHUNKS; i++) {
+                int index = (i + t) % CHUNKS;
+                const auto& bytes = encoded[index];
+                compressed_chunks::decode(
+                    chunk, bytes.data(), bytes.size(), content.indices
+                );
+                if (!same_voxels(*sources[index], chunk)) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures, 0);
+}
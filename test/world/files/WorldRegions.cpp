@@ -0,0 +1,944 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <tuple>
+
+#include "coders/byte_utils.hpp"
+#include "io/io.hpp"
+#include "io/devices/StdfsDevice.hpp"
+#include "util/WorkerGroup.hpp"
+#include "util/data_io.hpp"
+#include "world/files/compatibility.hpp"
+#include "world/files/WorldRegions.hpp"
+
+namespace fs = std::filesystem;
+
+/// @brief Chunk voxels data with a small random (poorly compressible) part
+/// and a part common for all chunks
+static std::unique_ptr<ubyte[]> make_voxels(int x, int z, int revision = 0) {
+    constexpr size_t RANDOM_PART = 2048;
+    constexpr size_t COMMON_PART = 512;
+    auto data = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+    std::memset(data.get(), 0, CHUNK_DATA_LEN);
+    std::mt19937 random(x * 73856093 ^ z * 19349663 ^ revision * 83492791);
+    for (size_t i = 0; i < RANDOM_PART; i++) {
+        data[i] = random();
+    }
+    for (size_t i = 0; i < COMMON_PART; i++) {
+        data[RANDOM_PART + i] = (i * 7) % 13 + i / 64;
+    }
+    return data;
+}
+
+static bool check_voxels(
+    WorldRegions& regions, int x, int z, int revision = 0
+) {
+    auto data = regions.getVoxels(x, z);
+    if (data == nullptr) {
+        return false;
+    }
+    auto expected = make_voxels(x, z, revision);
+    return std::memcmp(data.get(), expected.get(), CHUNK_DATA_LEN) == 0;
+}
+
+static io::path prepare_world_dir(const std::string& name) {
+    auto root = fs::temp_directory_path() / "voxelcore-tests";
+    fs::remove_all(root / name);
+    io::set_device("test", std::make_shared<io::StdfsDevice>(root));
+    return io::path("test:") / name;
+}
+
+/// @brief Long exploration run: regions memory must stay flat and all
+/// evicted data must be written to files
+TEST(WorldRegions, SoakExploration) {
+    constexpr size_t BUDGET = 1024 * 1024;
+    constexpr int STEPS = 96;
+    constexpr int CHUNKS_PER_REGION = 16;
+
+    auto directory = prepare_world_dir("soak");
+    WorldRegions regions(directory);
+    regions.setCacheBudget(BUDGET);
+    // the first region has loaded chunks all the time
+    regions.setRegionInUse(0, 0, true);
+
+    size_t peakUsage = 0;
+    size_t warmUsage = 0;
+    for (int step = 0; step < STEPS; step++) {
+        for (int i = 0; i < CHUNKS_PER_REGION; i++) {
+            int x = step * REGION_SIZE + i;
+            regions.put(
+                x, 0, REGION_LAYER_VOXELS, make_voxels(x, 0), CHUNK_DATA_LEN
+            );
+        }
+        // revisit an evicted region
+        if (step >= 24) {
+            int x = (step - 24) * REGION_SIZE + step % CHUNKS_PER_REGION;
+            EXPECT_TRUE(check_voxels(regions, x, 0));
+        }
+        regions.flush();
+        auto stats = regions.getCacheStats();
+        peakUsage = std::max(peakUsage, stats.memoryUsage);
+        if (step == STEPS / 4) {
+            warmUsage = stats.memoryUsage;
+        }
+    }
+    auto stats = regions.getCacheStats();
+
+    // a region created after eviction may exceed the budget
+    size_t regionLimit = BUDGET / 2;
+    EXPECT_LE(peakUsage, BUDGET + regionLimit);
+    EXPECT_LE(stats.memoryUsage, warmUsage + regionLimit);
+    EXPECT_GT(stats.evictions, 0);
+    EXPECT_GT(stats.writebacks, 0);
+
+    // in use region is never evicted
+    size_t hits = stats.hits;
+    EXPECT_TRUE(check_voxels(regions, 1, 0));
+    EXPECT_EQ(regions.getCacheStats().hits, hits + 1);
+
+    regions.writeAll();
+    regions.flush();
+
+    WorldRegions loaded(directory);
+    for (int step = 0; step < STEPS; step++) {
+        for (int i = 0; i < CHUNKS_PER_REGION; i++) {
+            ASSERT_TRUE(check_voxels(loaded, step * REGION_SIZE + i, 0));
+        }
+    }
+}
+
+static void put_voxels(WorldRegions& regions, int x, int z, int revision = 0) {
+    regions.put(
+        x, z, REGION_LAYER_VOXELS, make_voxels(x, z, revision), CHUNK_DATA_LEN
+    );
+}
+
+/// @brief Saving changed chunks writes only their records and table entries
+TEST(WorldRegions, InPlaceWrite) {
+    constexpr int CHUNKS = 256;
+    auto directory = prepare_world_dir("inplace");
+    auto file = io::resolve(directory / "regions" / "0_0.bin");
+    {
+        WorldRegions regions(directory);
+        for (int i = 0; i < CHUNKS; i++) {
+            put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+        }
+        regions.writeAll();
+    }
+    size_t fileSize = fs::file_size(file);
+
+    for (int revision = 1; revision <= 20; revision++) {
+        WorldRegions regions(directory);
+        put_voxels(regions, 3, 2, revision);
+        regions.put(5, 5, REGION_LAYER_VOXELS, nullptr, 0);
+        regions.writeAll();
+        regions.flush();
+
+        auto stats = regions.getCacheStats();
+        EXPECT_LT(stats.writtenBytes, 8 * 1024);
+    }
+    // freed sectors are reused
+    EXPECT_LE(fs::file_size(file), fileSize + 8 * 1024);
+
+    WorldRegions regions(directory);
+    for (int i = 0; i < CHUNKS; i++) {
+        int x = i % REGION_SIZE;
+        int z = i / REGION_SIZE;
+        if (x == 5 && z == 5) {
+            EXPECT_EQ(regions.getVoxels(x, z), nullptr);
+        } else {
+            ASSERT_TRUE(check_voxels(regions, x, z, x == 3 && z == 2 ? 20 : 0));
+        }
+    }
+}
+
+/// @brief Region file is rewritten when most of it is free
+TEST(WorldRegions, Compaction) {
+    constexpr int CHUNKS = 512;
+    auto directory = prepare_world_dir("compaction");
+    auto file = io::resolve(directory / "regions" / "0_0.bin");
+
+    WorldRegions regions(directory);
+    for (int i = 0; i < CHUNKS; i++) {
+        put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+    }
+    regions.writeAll();
+    regions.flush();
+    size_t fileSize = fs::file_size(file);
+    ASSERT_GE(fileSize, 2048 * REGION_SECTOR_SIZE);
+
+    for (int i = 0; i < CHUNKS - 10; i++) {
+        regions.put(
+            i % REGION_SIZE, i / REGION_SIZE, REGION_LAYER_VOXELS, nullptr, 0
+        );
+    }
+    regions.writeAll();
+    regions.flush();
+    EXPECT_LT(fs::file_size(file) * 4, fileSize);
+
+    WorldRegions loaded(directory);
+    for (int i = CHUNKS - 10; i < CHUNKS; i++) {
+        ASSERT_TRUE(check_voxels(loaded, i % REGION_SIZE, i / REGION_SIZE));
+    }
+    EXPECT_EQ(loaded.getVoxels(0, 0), nullptr);
+}
+
+/// @brief Build version 3 region file
+static util::Buffer<ubyte> make_region_v3(int chunks) {
+    ByteBuilder builder;
+    builder.putCStr(".VOXREG");
+    builder.put(3);
+    builder.put(static_cast<ubyte>(compression::Method::EXTRLE16));
+    std::vector<uint32_t> offsets(REGION_CHUNKS_COUNT);
+    for (int i = 0; i < chunks; i++) {
+        auto data = make_voxels(i % REGION_SIZE, i / REGION_SIZE);
+        size_t size;
+        auto compressed = compression::compress(
+            data.get(), CHUNK_DATA_LEN, size, compression::Method::EXTRLE16
+        );
+        offsets[i] = builder.size();
+        builder.putInt32(size);
+        builder.putInt32(CHUNK_DATA_LEN);
+        builder.put(compressed.get(), size);
+    }
+    for (auto offset : offsets) {
+        builder.putInt32(offset);
+    }
+    return util::Buffer<ubyte>(builder.build().data(), builder.size());
+}
+
+TEST(WorldRegions, UpgradeRegion3to4) {
+    constexpr int CHUNKS = 40;
+    auto directory = prepare_world_dir("upgrade");
+    auto folder = directory / "regions";
+    io::create_directories(folder);
+
+    auto source = make_region_v3(CHUNKS);
+    io::write_bytes(folder / "0_0.bin", source.data(), source.size());
+    auto converted = compatibility::convert_region_3to4(source);
+    io::write_bytes(folder / "1_0.bin", converted.data(), converted.size());
+    EXPECT_EQ(converted[8], 4);
+
+    WorldRegions regions(directory);
+    for (int i = 0; i < CHUNKS; i++) {
+        int x = i % REGION_SIZE;
+        int z = i / REGION_SIZE;
+        ASSERT_TRUE(check_voxels(regions, x, z));
+        // converted region contains the same data
+        auto expected = regions.getVoxels(x, z);
+        auto data = regions.getVoxels(x + REGION_SIZE, z);
+        ASSERT_NE(data, nullptr);
+        EXPECT_EQ(std::memcmp(data.get(), expected.get(), CHUNK_DATA_LEN), 0);
+    }
+    // older format region is converted on write
+    put_voxels(regions, 0, 0, 1);
+    regions.writeAll();
+    regions.flush();
+    auto written = io::read_bytes_buffer(folder / "0_0.bin");
+    EXPECT_EQ(written[8], REGION_FORMAT_VERSION);
+
+    WorldRegions loaded(directory);
+    EXPECT_TRUE(check_voxels(loaded, 0, 0, 1));
+    for (int i = 1; i < CHUNKS; i++) {
+        ASSERT_TRUE(check_voxels(loaded, i % REGION_SIZE, i / REGION_SIZE));
+    }
+}
+
+static uint32_t get_int32(const util::Buffer<ubyte>& buffer, size_t pos) {
+    uint32_t value;
+    std::memcpy(&value, buffer.data() + pos, sizeof(value));
+    return dataio::le2h(value);
+}
+
+static void set_int32(util::Buffer<ubyte>& buffer, size_t pos, uint32_t value) {
+    value = dataio::h2le(value);
+    std::memcpy(buffer.data() + pos, &value, sizeof(value));
+}
+
+TEST(WorldRegions, UpgradeCorruptedRegion3to4) {
+    constexpr int CHUNKS = 4;
+    auto source = make_region_v3(CHUNKS);
+    size_t tableStart = source.size() - REGION_CHUNKS_COUNT * 4;
+    size_t lastEntry = tableStart + (CHUNKS - 1) * 4;
+    uint32_t offset = get_int32(source, lastEntry);
+
+    // record header is out of bounds
+    util::Buffer<ubyte> badOffset(source);
+    set_int32(badOffset, lastEntry, tableStart - 4);
+    EXPECT_THROW(
+        compatibility::convert_region_3to4(badOffset), illegal_region_format
+    );
+    // record data is out of bounds
+    util::Buffer<ubyte> badSize(source);
+    set_int32(badSize, offset, tableStart - offset - 7);
+    EXPECT_THROW(
+        compatibility::convert_region_3to4(badSize), illegal_region_format
+    );
+    // the last record may end right before the table
+    set_int32(badSize, offset, tableStart - offset - 8);
+    EXPECT_NO_THROW(compatibility::convert_region_3to4(badSize));
+}
+
+/// @brief Device reading files as streams only, like ZipFileDevice
+class StreamDevice : public io::SubDevice {
+public:
+    using io::SubDevice::SubDevice;
+
+    std::unique_ptr<io::mapped_file> map(std::string_view) override {
+        return nullptr;
+    }
+};
+
+/// @brief Many threads read chunks of more regions than open files limit
+/// (mapped and stream read files) while the files get closed and reopened
+TEST(WorldRegions, ConcurrentReaders) {
+    constexpr int REGIONS = 12;
+    constexpr int CHUNKS_PER_REGION = 16;
+    constexpr int CHUNKS = REGIONS * CHUNKS_PER_REGION;
+    constexpr int THREADS = 8;
+    constexpr int READS = 2000;
+    constexpr size_t FILES_LIMIT = 4;
+    auto directory = prepare_world_dir("concurrent");
+    {
+        WorldRegions regions(directory);
+        for (int r = 0; r < REGIONS; r++) {
+            for (int i = 0; i < CHUNKS_PER_REGION; i++) {
+                put_voxels(regions, r * REGION_SIZE + i, i);
+            }
+        }
+        regions.writeAll();
+    }
+    io::set_device(
+        "stream",
+        std::make_shared<StreamDevice>(
+            io::get_device("test"), "concurrent", false
+        )
+    );
+    for (const auto& root : {directory, io::path("stream:")}) {
+        RegionsLayer layer;
+        layer.layer = REGION_LAYER_VOXELS;
+        layer.folder = root / "regions";
+        layer.setMaxOpenRegFiles(FILES_LIMIT);
+
+        std::atomic<int> failures {0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t]() {
+                std::mt19937 random(t);
+                for (int n = 0; n < READS; n++) {
+                    int r = random() % REGIONS;
+                    int i = random() % CHUNKS_PER_REGION;
+                    int x = r * REGION_SIZE + i;
+                    // files are opened over the limit by other threads and
+                    // may be closed while in use by this one
+                    auto file = layer.getRegFile({r, 0});
+                    uint32_t srcSize;
+                    std::unique_ptr<ubyte[]> data;
+                    if (file) {
+                        data = layer.readChunk(x, i, srcSize, file.get());
+                    }
+                    auto expected = make_voxels(x, i);
+                    if (data == nullptr || srcSize != CHUNK_DATA_LEN ||
+                        std::memcmp(data.get(), expected.get(), srcSize)) {
+                        failures++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(failures, 0);
+        EXPECT_LE(layer.openRegFiles.size(), FILES_LIMIT);
+        EXPECT_GT(layer.regFileOpens, FILES_LIMIT);
+
+        // least recently used file is closed first
+        layer.setMaxOpenRegFiles(2);
+        for (int r : {0, 1, 0, 2}) {
+            ASSERT_NE(layer.getRegFile({r, 0}), nullptr);
+        }
+        EXPECT_NE(layer.getRegFile({0, 0}, false), nullptr);
+        EXPECT_EQ(layer.getRegFile({1, 0}, false), nullptr);
+        EXPECT_NE(layer.getRegFile({2, 0}, false), nullptr);
+    }
+
+    // chunks not loaded to memory are read without the regions lock
+    WorldRegions regions(directory);
+    regions.setRegionFilesLimit(FILES_LIMIT);
+    std::atomic<int> failures {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            for (int n = 0; n < CHUNKS; n++) {
+                int k = (n + t * CHUNKS_PER_REGION) % CHUNKS;
+                int i = k % CHUNKS_PER_REGION;
+                int x = (k / CHUNKS_PER_REGION) * REGION_SIZE + i;
+                if (!check_voxels(regions, x, i)) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures, 0);
+    EXPECT_LE(regions.getCacheStats().openFiles, FILES_LIMIT);
+}
+
+static constexpr int MAPPED_CHUNKS = 1024;
+
+/// @brief Write uncompressed region (to measure reading only) and register
+/// "stream" device reading the world without file mapping
+static io::path prepare_mapped_world(const std::string& name) {
+    auto directory = prepare_world_dir(name);
+    {
+        WorldRegions regions(directory);
+        regions.setCodec(REGION_LAYER_VOXELS, compression::Method::NONE);
+        for (int i = 0; i < MAPPED_CHUNKS; i++) {
+            put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+        }
+        regions.writeAll();
+    }
+    io::set_device(
+        "stream",
+        std::make_shared<StreamDevice>(io::get_device("test"), name, false)
+    );
+    return directory;
+}
+
+/// @brief Mapped and stream read region files give the same data
+TEST(WorldRegions, MappedRead) {
+    auto directory = prepare_mapped_world("mapped");
+    regfile mapped(directory / "regions" / "0_0.bin");
+    regfile streamed(io::path("stream:regions/0_0.bin"));
+    EXPECT_NE(mapped.file.data(), nullptr);
+    EXPECT_EQ(streamed.file.data(), nullptr);
+    std::vector<ubyte> buffer;
+    std::vector<ubyte> streamedBuffer;
+    for (int i = 0; i < MAPPED_CHUNKS; i++) {
+        uint32_t size, srcSize;
+        uint32_t streamedSize, streamedSrcSize;
+        const ubyte* data = mapped.getChunkData(i, size, srcSize, buffer);
+        const ubyte* streamedData = streamed.getChunkData(
+            i, streamedSize, streamedSrcSize, streamedBuffer
+        );
+        ASSERT_NE(data, nullptr);
+        ASSERT_NE(streamedData, nullptr);
+        ASSERT_EQ(size, streamedSize);
+        ASSERT_EQ(srcSize, streamedSrcSize);
+        ASSERT_EQ(std::memcmp(data, streamedData, size), 0);
+    }
+    for (const auto& path : {directory, io::path("stream:")}) {
+        WorldRegions regions(path);
+        regions.setCodec(REGION_LAYER_VOXELS, compression::Method::NONE);
+        for (int i = 0; i < MAPPED_CHUNKS; i++) {
+            ASSERT_TRUE(
+                check_voxels(regions, i % REGION_SIZE, i / REGION_SIZE)
+            );
+        }
+    }
+}
+
+/// @brief Chunk record read and chunk load latency of mapped and stream
+/// read region files. Results are printed only
+TEST(WorldRegions, DISABLED_MappedReadBenchmark) {
+    using namespace std::chrono;
+    auto directory = prepare_mapped_world("mapped-bench");
+    regfile mapped(directory / "regions" / "0_0.bin");
+    regfile streamed(io::path("stream:regions/0_0.bin"));
+    nanoseconds mappedTime {}, streamedTime {};
+    std::vector<ubyte> buffer;
+    for (int i = 0; i < MAPPED_CHUNKS; i++) {
+        uint32_t size, srcSize;
+        auto start = high_resolution_clock::now();
+        mapped.getChunkData(i, size, srcSize, buffer);
+        auto middle = high_resolution_clock::now();
+        streamed.getChunkData(i, size, srcSize, buffer);
+        mappedTime += middle - start;
+        streamedTime += high_resolution_clock::now() - middle;
+    }
+
+    auto measure = [](const io::path& directory) {
+        WorldRegions regions(directory);
+        regions.setCodec(REGION_LAYER_VOXELS, compression::Method::NONE);
+        nanoseconds total {};
+        for (int i = 0; i < MAPPED_CHUNKS; i++) {
+            auto start = high_resolution_clock::now();
+            auto data = regions.getVoxels(i % REGION_SIZE, i / REGION_SIZE);
+            total += high_resolution_clock::now() - start;
+            EXPECT_NE(data, nullptr);
+        }
+        return total.count() / 1000.0 / MAPPED_CHUNKS;
+    };
+    std::cout << "chunk record read: mapped "
+              << mappedTime.count() / 1000.0 / MAPPED_CHUNKS << " us, stream "
+              << streamedTime.count() / 1000.0 / MAPPED_CHUNKS << " us"
+              << std::endl;
+    double mappedLatency = measure(directory);
+    double streamLatency = measure(io::path("stream:"));
+    std::cout << "chunk load: mapped " << mappedLatency << " us, stream "
+              << streamLatency << " us" << std::endl;
+}
+
+/// @brief Autosave of a few changed chunks in fully populated regions.
+/// Results are printed only
+TEST(WorldRegions, DISABLED_AutosaveBenchmark) {
+    using namespace std::chrono;
+    constexpr int REGIONS = 4;
+    constexpr int CHANGED_CHUNKS = 16;
+
+    auto directory = prepare_world_dir("autosave");
+    WorldRegions regions(directory);
+    for (int r = 0; r < REGIONS; r++) {
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            put_voxels(
+                regions, r * REGION_SIZE + i % REGION_SIZE, i / REGION_SIZE
+            );
+        }
+    }
+    regions.flush();
+    auto start = high_resolution_clock::now();
+    regions.writeAll();
+    regions.flush();
+    auto fullTime = duration_cast<microseconds>(
+        high_resolution_clock::now() - start
+    ).count();
+    size_t fullBytes = regions.getCacheStats().writtenBytes;
+
+    std::mt19937 random(42);
+    for (int r = 0; r < REGIONS; r++) {
+        for (int i = 0; i < CHANGED_CHUNKS; i++) {
+            int index = random() % REGION_CHUNKS_COUNT;
+            put_voxels(
+                regions, r * REGION_SIZE + index % REGION_SIZE,
+                index / REGION_SIZE, 1
+            );
+        }
+    }
+    regions.flush();
+    start = high_resolution_clock::now();
+    regions.writeAll();
+    regions.flush();
+    auto autosaveTime = duration_cast<microseconds>(
+        high_resolution_clock::now() - start
+    ).count();
+    size_t autosaveBytes = regions.getCacheStats().writtenBytes - fullBytes;
+
+    std::cout << "full write: " << fullBytes << " bytes " << fullTime
+              << " us, autosave of " << CHANGED_CHUNKS * REGIONS
+              << " chunks: " << autosaveBytes << " bytes " << autosaveTime
+              << " us" << std::endl;
+    EXPECT_LT(autosaveBytes * 10, fullBytes);
+}
+
+/// @brief Saving does not block the caller and stored data is readable
+/// before it reaches region files
+TEST(WorldRegions, BackgroundSave) {
+    constexpr int CHUNKS = 1024;
+
+    auto directory = prepare_world_dir("background");
+    auto file = io::resolve(directory / "regions" / "0_0.bin");
+    WorldRegions regions(directory);
+
+    for (int i = 0; i < CHUNKS; i++) {
+        put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+    }
+    regions.writeAll();
+
+    // pending data is visible to readers
+    ASSERT_TRUE(check_voxels(regions, 7, 3));
+    put_voxels(regions, 7, 3, 1);
+    ASSERT_TRUE(check_voxels(regions, 7, 3, 1));
+    regions.put(8, 3, REGION_LAYER_VOXELS, nullptr, 0);
+    EXPECT_EQ(regions.getVoxels(8, 3), nullptr);
+    EXPECT_FALSE(regions.hasVoxels(8, 3));
+    regions.writeAll();
+    regions.flush();
+    ASSERT_TRUE(fs::exists(file));
+
+    WorldRegions loaded(directory);
+    for (int i = 0; i < CHUNKS; i++) {
+        int x = i % REGION_SIZE;
+        int z = i / REGION_SIZE;
+        if (x == 8 && z == 3) {
+            EXPECT_EQ(loaded.getVoxels(x, z), nullptr);
+        } else {
+            ASSERT_TRUE(check_voxels(loaded, x, z, x == 7 && z == 3 ? 1 : 0));
+        }
+    }
+}
+
+/// @brief Error of a background write is thrown by flush, unsaved data
+/// is written by the next save
+TEST(WorldRegions, WriteError) {
+    auto directory = prepare_world_dir("write-error");
+    auto file = io::resolve(directory / "regions" / "0_0.bin");
+    WorldRegions regions(directory);
+    put_voxels(regions, 1, 2);
+    regions.flush();
+
+    // region file can't replace a directory
+    fs::create_directories(file / "blocker");
+    regions.writeAll();
+    EXPECT_THROW(regions.flush(), std::exception);
+    EXPECT_TRUE(check_voxels(regions, 1, 2));
+
+    fs::remove_all(file);
+    regions.writeAll();
+    regions.flush();
+    WorldRegions loaded(directory);
+    EXPECT_TRUE(check_voxels(loaded, 1, 2));
+}
+
+/// @brief Region file opened by a reader while it is written is not kept
+/// open, evicted chunks are read from the written file
+TEST(WorldRegions, ReadDuringWrite) {
+    constexpr int CHUNKS = 256;
+    constexpr int CHANGED = 64;
+    constexpr int REVISIONS = 20;
+    auto directory = prepare_world_dir("read-during-write");
+    WorldRegions regions(directory);
+    for (int i = 0; i < CHUNKS; i++) {
+        put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+    }
+    regions.writeAll();
+    regions.flush();
+
+    for (int revision = 1; revision <= REVISIONS; revision++) {
+        for (int i = 0; i < CHANGED; i++) {
+            put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE, revision);
+        }
+        std::atomic<bool> written {false};
+        std::thread reader([&]() {
+            // unchanged chunks are read from the file
+            for (int i = 0; !written; i++) {
+                int index = CHANGED + i % (CHUNKS - CHANGED);
+                EXPECT_TRUE(check_voxels(
+                    regions, index % REGION_SIZE, index / REGION_SIZE
+                ));
+            }
+        });
+        regions.writeAll();
+        regions.flush();
+        written = true;
+        reader.join();
+
+        regions.setCacheBudget(0);
+        ASSERT_EQ(regions.getCacheStats().regions, 0);
+        for (int i = 0; i < CHANGED; i++) {
+            ASSERT_TRUE(check_voxels(
+                regions, i % REGION_SIZE, i / REGION_SIZE, revision
+            ));
+        }
+        regions.setCacheBudget(WorldRegions::DEFAULT_CACHE_BUDGET);
+    }
+}
+
+/// @brief Prefetched chunks are decompressed at once, put data replaces
+/// prefetched one
+TEST(WorldRegions, Prefetch) {
+    constexpr int CHUNKS = 64;
+    auto directory = prepare_world_dir("prefetch");
+    {
+        WorldRegions regions(directory);
+        for (int i = 0; i < CHUNKS; i++) {
+            put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+        }
+        regions.writeAll();
+    }
+    WorldRegions regions(directory);
+    std::vector<glm::ivec2> chunks;
+    for (int i = 0; i < CHUNKS; i++) {
+        chunks.emplace_back(i % REGION_SIZE, i / REGION_SIZE);
+    }
+    // missing chunk is skipped
+    chunks.emplace_back(REGION_SIZE * 3, 0);
+    regions.prefetch(chunks);
+    put_voxels(regions, 1, 0, 1);
+    for (int i = 0; i < CHUNKS; i++) {
+        int x = i % REGION_SIZE;
+        int z = i / REGION_SIZE;
+        ASSERT_TRUE(check_voxels(regions, x, z, x == 1 && z == 0 ? 1 : 0));
+    }
+    EXPECT_EQ(regions.getVoxels(REGION_SIZE * 3, 0), nullptr);
+    // pending data is not prefetched
+    regions.prefetch(chunks);
+    regions.flush();
+    EXPECT_TRUE(check_voxels(regions, 1, 0, 1));
+}
+
+/// @brief Wait until prefetched chunks counter reaches the value
+static bool wait_prefetched(WorldRegions& regions, size_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (regions.getCacheStats().prefetched < count) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// @brief Chunks prefetched on the prefetcher thread and the metrics
+TEST(WorldRegions, PrefetchRequest) {
+    constexpr int CHUNKS = 256;
+    auto directory = prepare_world_dir("prefetch-request");
+    {
+        WorldRegions regions(directory);
+        for (int i = 0; i < CHUNKS; i++) {
+            put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+        }
+        regions.writeAll();
+    }
+    auto range = [](int start, int end) {
+        std::vector<glm::ivec2> chunks;
+        for (int i = start; i < end; i++) {
+            chunks.emplace_back(i % REGION_SIZE, i / REGION_SIZE);
+        }
+        return chunks;
+    };
+    WorldRegions regions(directory);
+    regions.requestPrefetch(range(0, 32));
+    ASSERT_TRUE(wait_prefetched(regions, 32));
+    for (int i = 0; i < 40; i++) {
+        ASSERT_TRUE(check_voxels(regions, i % REGION_SIZE, i / REGION_SIZE));
+    }
+    auto stats = regions.getCacheStats();
+    EXPECT_EQ(stats.prefetchHits, 32);
+    EXPECT_EQ(stats.prefetchMisses, 8);
+
+    // data put after prefetch replaces prefetched one
+    regions.requestPrefetch(range(40, 64));
+    ASSERT_TRUE(wait_prefetched(regions, 56));
+    put_voxels(regions, 40 % REGION_SIZE, 40 / REGION_SIZE, 1);
+    EXPECT_TRUE(check_voxels(regions, 40 % REGION_SIZE, 40 / REGION_SIZE, 1));
+    EXPECT_EQ(regions.getCacheStats().prefetchWasted, 1);
+
+    // the oldest prefetched data is dropped
+    regions.prefetch(range(64, CHUNKS));
+    stats = regions.getCacheStats();
+    EXPECT_EQ(stats.prefetched, 56 + CHUNKS - 64);
+    EXPECT_EQ(
+        stats.prefetchWasted,
+        1 + 23 + (CHUNKS - 64) - WorldRegions::MAX_PREFETCHED
+    );
+    EXPECT_TRUE(check_voxels(regions, 7, CHUNKS / REGION_SIZE - 1));
+    EXPECT_EQ(regions.getCacheStats().prefetchHits, 33);
+    regions.flush();
+}
+
+/// @brief Terrain-like chunk voxels: stone with ores, dirt and grass
+static std::unique_ptr<ubyte[]> make_terrain_voxels(int cx, int cz) {
+    auto data = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+    auto voxels = reinterpret_cast<uint16_t*>(data.get());
+    std::memset(data.get(), 0, CHUNK_DATA_LEN);
+    std::mt19937 random(cx * 73856093 ^ cz * 19349663);
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            float gx = cx * CHUNK_W + x;
+            float gz = cz * CHUNK_D + z;
+            int height = 64 + std::sin(gx * 0.05f) * 12 + std::cos(gz * 0.07f) * 9;
+            for (int y = 0; y < height; y++) {
+                uint16_t id = 1;
+                if (y == height - 1) {
+                    id = 3;
+                } else if (y >= height - 4) {
+                    id = 2;
+                } else if (random() % 50 == 0) {
+                    id = 4 + random() % 3;
+                }
+                voxels[vox_index(x, y, z)] = id;
+            }
+        }
+    }
+    return data;
+}
+
+/// @brief Read chunks voxels of a saved world
+static std::vector<std::unique_ptr<ubyte[]>> read_world_voxels(
+    const fs::path& worldDir, size_t limit
+) {
+    std::vector<std::unique_ptr<ubyte[]>> chunks;
+    io::set_device("bench", std::make_shared<io::StdfsDevice>(worldDir));
+    WorldRegions regions(io::path("bench:"));
+    auto folder = regions.getRegionsFolder(REGION_LAYER_VOXELS);
+    for (const auto& file : io::directory_iterator(folder)) {
+        int rx, rz;
+        if (file.extension() != ".bin" ||
+            !WorldRegions::parseRegionFilename(file.stem(), rx, rz)) {
+            continue;
+        }
+        for (uint i = 0; i < REGION_CHUNKS_COUNT && chunks.size() < limit;
+             i++) {
+            auto data = regions.getVoxels(
+                rx * REGION_SIZE + i % REGION_SIZE,
+                rz * REGION_SIZE + i / REGION_SIZE
+            );
+            if (data) {
+                chunks.push_back(std::move(data));
+            }
+        }
+    }
+    return chunks;
+}
+
+/// @brief Compression ratio and throughput of chunks voxels for every
+/// codec on a single thread and on all cores. Set VOXELCORE_BENCH_WORLD to
+/// a world directory to measure saved chunks instead of generated ones.
+/// Results are printed only
+TEST(WorldRegions, DISABLED_CodecBenchmark) {
+    using namespace std::chrono;
+    using compression::Method;
+    constexpr int CHUNKS = 128;
+
+    std::vector<std::unique_ptr<ubyte[]>> sources;
+    if (const char* world = std::getenv("VOXELCORE_BENCH_WORLD")) {
+        sources = read_world_voxels(world, CHUNKS);
+        std::cout << "world " << world << ": ";
+    }
+    if (sources.empty()) {
+        for (int i = 0; i < CHUNKS; i++) {
+            sources.push_back(make_terrain_voxels(i % 12, i / 12));
+        }
+        std::cout << "generated terrain: ";
+    }
+    const size_t count = sources.size();
+    std::cout << count << " chunks" << std::endl;
+
+    // dictionary is trained on a half of chunks and tested on another one
+    std::vector<std::pair<const ubyte*, size_t>> samples;
+    for (size_t i = 0; i < count; i += 2) {
+        samples.emplace_back(sources[i].get(), CHUNK_DATA_LEN);
+    }
+    auto dictionary = compression::train_dictionary(samples);
+    ASSERT_NE(dictionary, nullptr);
+
+    std::vector<std::unique_ptr<ubyte[]>> compressed(count);
+    std::vector<size_t> sizes(count);
+
+    util::WorkerGroup parallel(util::WorkerGroup::countFor(0));
+    util::WorkerGroup single(1);
+    double megabytes = count * CHUNK_DATA_LEN / (1024.0 * 1024.0);
+
+    auto measure = [&](util::WorkerGroup& workers, auto func) {
+        std::atomic<size_t> next = 0;
+        auto start = high_resolution_clock::now();
+        workers.run([&](uint) {
+            size_t index;
+            while ((index = next++) < count) {
+                func(index);
+            }
+        });
+        auto time = duration_cast<microseconds>(
+            high_resolution_clock::now() - start
+        ).count();
+        return megabytes / (std::max<int64_t>(time, 1) / 1e6);
+    };
+    const std::tuple<Method, const char*, const compression::Dictionary*>
+        codecs[] {
+            {Method::EXTRLE8, "extrle8", nullptr},
+            {Method::EXTRLE16, "extrle16", nullptr},
+            {Method::GZIP, "gzip", nullptr},
+            {Method::LZ4, "lz4", nullptr},
+            {Method::LZ4, "lz4+dict", dictionary.get()},
+            {Method::DEFLATE, "deflate", nullptr},
+            {Method::DEFLATE, "deflate+dict", dictionary.get()},
+        };
+    for (const auto& [method, name, dict] : codecs) {
+        auto compress = [&, method = method, dict = dict](size_t index) {
+            compressed[index] = compression::compress(
+                sources[index].get(), CHUNK_DATA_LEN, sizes[index], method, dict
+            );
+        };
+        auto decompress = [&, method = method, dict = dict](size_t index) {
+            auto data = compression::decompress(
+                compressed[index].get(), sizes[index], CHUNK_DATA_LEN, method,
+                dict
+            );
+            ASSERT_EQ(
+                std::memcmp(data.get(), sources[index].get(), CHUNK_DATA_LEN),
+                0
+            );
+        };
+        double compressSingle = measure(single, compress);
+        double compressAll = measure(parallel, compress);
+        double decompressSingle = measure(single, decompress);
+        double decompressAll = measure(parallel, decompress);
+
+        size_t testedSize = 0;
+        for (size_t i = 1; i < count; i += 2) {
+            testedSize += sizes[i];
+        }
+        double ratio = (count / 2) * CHUNK_DATA_LEN /
+                       static_cast<double>(std::max<size_t>(testedSize, 1));
+        std::cout << name << ": ratio " << ratio << ", compress "
+                  << compressSingle << " MB/s (" << compressAll << " MB/s on "
+                  << parallel.size() << " threads), decompress "
+                  << decompressSingle << " MB/s (" << decompressAll
+                  << " MB/s)" << std::endl;
+    }
+}
+
+/// @brief Layer codec change: files written with the previous codec stay
+/// readable and are converted on write
+TEST(WorldRegions, ChangeCodec) {
+    constexpr int CHUNKS = 48;
+    auto directory = prepare_world_dir("codec");
+    auto file = io::resolve(directory / "regions" / "0_0.bin");
+    {
+        WorldRegions regions(directory);
+        for (int i = 0; i < CHUNKS; i++) {
+            put_voxels(regions, i % REGION_SIZE, i / REGION_SIZE);
+        }
+        regions.writeAll();
+    }
+    std::shared_ptr<const compression::Dictionary> dictionary;
+    {
+        WorldRegions regions(directory);
+        // loaded data is recompressed
+        ASSERT_TRUE(check_voxels(regions, 3, 0));
+        dictionary = regions.requireDictionary(REGION_LAYER_VOXELS);
+        ASSERT_NE(dictionary, nullptr);
+        regions.setCodec(
+            REGION_LAYER_VOXELS, compression::Method::LZ4, dictionary
+        );
+        ASSERT_TRUE(check_voxels(regions, 3, 0));
+        ASSERT_TRUE(check_voxels(regions, 4, 0));
+        put_voxels(regions, 5, 0, 1);
+        regions.writeAll();
+        regions.flush();
+    }
+    auto bytes = io::read_bytes_buffer(directory / "regions" / "0_0.bin");
+    EXPECT_EQ(bytes[9], static_cast<ubyte>(compression::Method::LZ4));
+    EXPECT_EQ(dataio::le2h(*reinterpret_cast<uint32_t*>(&bytes[10])),
+              dictionary->id);
+    {
+        // dictionary is loaded from the regions folder
+        WorldRegions regions(directory);
+        EXPECT_EQ(
+            regions.requireDictionary(REGION_LAYER_VOXELS)->id, dictionary->id
+        );
+        for (int i = 0; i < CHUNKS; i++) {
+            int x = i % REGION_SIZE;
+            int z = i / REGION_SIZE;
+            ASSERT_TRUE(check_voxels(regions, x, z, x == 5 && z == 0 ? 1 : 0));
+        }
+        // back to default codec
+        put_voxels(regions, 6, 0, 1);
+        regions.writeAll();
+        regions.flush();
+    }
+    bytes = io::read_bytes_buffer(directory / "regions" / "0_0.bin");
+    EXPECT_EQ(bytes[9], static_cast<ubyte>(compression::Method::EXTRLE16));
+    WorldRegions regions(directory);
+    EXPECT_TRUE(check_voxels(regions, 6, 0, 1));
+    EXPECT_TRUE(check_voxels(regions, 7, 0));
+}
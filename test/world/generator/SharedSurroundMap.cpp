@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include "world/generator/SharedSurroundMap.hpp"
+
+struct TestValue {
+    int x;
+    int z;
+};
+
+static SharedSurroundMap<TestValue> create_map(
+    int8_t maxLevel, size_t budget, int& created
+) {
+    SharedSurroundMap<TestValue> map(
+        maxLevel,
+        [&created](int x, int z) {
+            created++;
+            return std::make_unique<TestValue>(TestValue {x, z});
+        },
+        budget
+    );
+    map.setSizeFunction([](const TestValue&) { return 1; });
+    return map;
+}
+
+TEST(SharedSurroundMap, Levels) {
+    int8_t maxLevel = 5;
+    int created = 0;
+    auto map = create_map(maxLevel, 1'000'000, created);
+    int affected = 0;
+    map.setLevelCallback(2, [&affected](int x, int z, TestValue& value) {
+        EXPECT_EQ(value.x, x);
+        EXPECT_EQ(value.z, z);
+        affected++;
+    });
+    map.completeAt(0, 0);
+    EXPECT_EQ(created, (maxLevel * 2 - 1) * (maxLevel * 2 - 1));
+    EXPECT_EQ(affected, (maxLevel * 2 - 3) * (maxLevel * 2 - 3));
+
+    for (int z = -maxLevel + 1; z < maxLevel; z++) {
+        for (int x = -maxLevel + 1; x < maxLevel; x++) {
+            int levelExpected = maxLevel - std::max(std::abs(x), std::abs(z));
+            EXPECT_EQ(map.at(x, z), levelExpected);
+        }
+    }
+    created = 0;
+    map.completeAt(-1, 0);
+    EXPECT_EQ(created, maxLevel * 2 - 1);
+}
+
+TEST(SharedSurroundMap, DistantAreas) {
+    constexpr int8_t MAX_LEVEL = 3;
+    constexpr int RADIUS = 4;
+    int created = 0;
+    // budget is less than a single area requires
+    auto map = create_map(MAX_LEVEL, 10, created);
+    map.setArea(1, 0, 0, RADIUS);
+    map.setArea(2, 1000, 0, RADIUS);
+
+    for (int i = 0; i < 3; i++) {
+        for (int z = -RADIUS; z <= RADIUS; z++) {
+            for (int x = -RADIUS; x <= RADIUS; x++) {
+                map.completeAt(x, z);
+                map.completeAt(1000 + x, z);
+            }
+        }
+    }
+    // nothing was generated twice
+    int side = (RADIUS + MAX_LEVEL - 1) * 2 + 1;
+    EXPECT_EQ(created, side * side * 2);
+    EXPECT_EQ(map.size(), side * side * 2);
+    EXPECT_EQ(map.at(0, 0), MAX_LEVEL);
+    EXPECT_EQ(map.at(1000, 0), MAX_LEVEL);
+
+    // the moved area releases its points except ones used by the last
+    // completeAt call, the other area keeps all points
+    int lastUsed = (MAX_LEVEL * 2 - 1) * (MAX_LEVEL * 2 - 1);
+    map.setArea(2, 5000, 0, RADIUS);
+    EXPECT_EQ(map.at(1000, 0), 0);
+    EXPECT_EQ(map.at(0, 0), MAX_LEVEL);
+    EXPECT_EQ(map.getTotalSize(), side * side + lastUsed);
+
+    map.removeArea(1);
+    EXPECT_LE(map.getTotalSize(), 10 + lastUsed);
+}
+
+TEST(SharedSurroundMap, Budget) {
+    constexpr int8_t MAX_LEVEL = 4;
+    constexpr size_t BUDGET = 500;
+    int created = 0;
+    auto map = create_map(MAX_LEVEL, BUDGET, created);
+    int side = MAX_LEVEL * 2 - 1;
+
+    for (int i = 0; i < 1000; i++) {
+        map.completeAt(i * 3, (i * 7) % 50);
+        // the last completed point neighbourhood is never evicted
+        EXPECT_LE(map.getTotalSize(), BUDGET + side * side);
+        EXPECT_EQ(map.at(i * 3, (i * 7) % 50), MAX_LEVEL);
+    }
+    map.setBudget(0);
+    EXPECT_LE(map.size(), side * side);
+}